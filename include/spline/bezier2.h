@@ -21,3 +21,56 @@ float *bezier2_split(float *dest, size_t d, float const *p, double t);
 
    rbezier2_norm_w1(w0, w1, w2) returns the normalized weight w' */
 float rbezier2_norm_w1(float w0, float w1, float w2);
+
+/* Evaluate the 2D quadratic Bézier curve defined by the three consecutive
+   points that p points to at each of the n parameters in t, and store the
+   coordinates of point i in x[i] and y[i]. Every t[i] must be in [0, 1]. */
+void bezier2_n(
+	float *restrict x,
+	float *restrict y,
+	float const *p,
+	float const *restrict t,
+	size_t n);
+
+/* Evaluate the 2D rational quadratic Bézier curve defined by the three
+   consecutive (x, y, weight) control points that p points to, like
+   `rbezier2(dest, 2, p, t)`, at each of the n parameters in t, and store the
+   coordinates of point i in x[i] and y[i]. Every t[i] must be in
+   [0, 1]. */
+void rbezier2_n(
+	float *restrict x,
+	float *restrict y,
+	float const *p,
+	float const *restrict t,
+	size_t n);
+
+/* A set of 2D rational quadratic Bézier curves in struct-of-arrays layout.
+   Curve i goes from (x0[i], y0[i]) to (x2[i], y2[i]) with the control point
+   (x1[i], y1[i]) of weight w[i] in between, and its end-points have weight
+   one. */
+struct rbezier2_set
+{
+	float const *x0, *y0, *x1, *y1, *x2, *y2, *w;
+};
+
+/* Evaluate each of the first n curves of `set` at once, curve i at t[i], and
+   store its coordinates in x[i] and y[i]. Every t[i] must be in [0, 1]. */
+void rbezier2_set_eval(
+	float *restrict x,
+	float *restrict y,
+	struct rbezier2_set const *set,
+	float const *restrict t,
+	size_t n);
+
+/* Approximate the 2D rational quadratic Bézier curve p, laid out as for
+   `rbezier2_n`, with a polyline which is at most `tolerance` away from it,
+   by halving the curve until each part is flat enough. Store the points of
+   the polyline which follow p0, ending with p2, in dest, which has room for
+   `max` points, and return the number of such points. If it is greater than
+   `max`, then only the first `max` points are stored. A tolerance in screen
+   space is divided by the scale of the transform to the screen. */
+size_t rbezier2_flatten(
+	float (*dest)[2],
+	size_t max,
+	float const *p,
+	float tolerance);
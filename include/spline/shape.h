@@ -1,3 +1,5 @@
+struct wbuf;
+
 struct spline_segment
 {
 	float end[2], mid[2], weight;
@@ -22,3 +24,19 @@ struct spline_shape
 struct spline_shape *spline_simplify_shape(struct spline_shape const *shape);
 
 void spline_free_shape(struct spline_shape *shape);
+
+/* Store the bounding box of the control points of `shape` in `dest` as
+   x_min, y_min, x_max, y_max. The box contains the whole shape, since each
+   segment lies in the convex hull of its control points. An empty shape has
+   an empty box, where the minimum is greater than the maximum. */
+void spline_shape_bounds(float dest[4], struct spline_shape const *shape);
+
+/* Append a closed polyline which is at most `tolerance` away from `outline`
+   to `dest`, as consecutive float[2] points where the last point connects to
+   the first. Each segment starts with its end-point followed by points of the
+   flattened curve. Return the number of points, or negative on memory
+   allocation failure. See `rbezier2_flatten` for the tolerance. */
+long spline_flatten_outline(
+	struct wbuf *dest,
+	struct spline_outline const *outline,
+	float tolerance);
@@ -0,0 +1,61 @@
+struct spline_outline;
+struct spline_shape;
+
+/* How the offset curves on the outer side of a corner are connected */
+enum spline_join
+{
+	/* extend the offset edges until they meet, or bevel where the miter
+	   would be longer than `miter_limit` times the width */
+	SPLINE_JOIN_MITER,
+
+	/* a circular arc around the corner */
+	SPLINE_JOIN_ROUND,
+
+	/* a straight line between the offset curves */
+	SPLINE_JOIN_BEVEL
+};
+
+/* How the ends of an open outline are closed */
+enum spline_cap
+{
+	/* a straight line across the end-point */
+	SPLINE_CAP_BUTT,
+
+	/* a half circle around the end-point */
+	SPLINE_CAP_ROUND,
+
+	/* a half square which extends half the width past the end-point */
+	SPLINE_CAP_SQUARE
+};
+
+struct spline_stroke
+{
+	/* total width, half of which is on each side of the curve */
+	float width;
+
+	enum spline_join join;
+	enum spline_cap cap;
+
+	/* the longest miter relative to the width, at least one */
+	float miter_limit;
+
+	/* the largest distance between an approximated offset curve and the
+	   true one, like for `rbezier2_flatten` */
+	float tolerance;
+};
+
+/* Create a shape which covers the area within `width / 2` of `outline`, with
+   rational quadratic segments, which can be filled like any other shape. A
+   closed outline becomes two outlines, one on each side of it. The last
+   segment of an open outline is left out and only its end-point is used,
+   which makes it a single outline with caps at both ends. Each segment is
+   approximated by halving it until its offset curves are within `tolerance`
+   of the true offset curves, which are exact for circular arcs. The corners
+   on the inner side are trimmed where the offset curves intersect, or
+   connected through the corner where they do not, and outlines which turn
+   tighter than the width overlap themselves there. Free the shape with
+   `spline_free_shape`. Return NULL on failure. */
+struct spline_shape *spline_stroke_outline(
+	struct spline_outline const *outline,
+	int closed,
+	struct spline_stroke const *stroke);
@@ -14,3 +14,57 @@ struct triangle_set *triangle_set_triangulate(
 	size_t edge_count);
 
 void triangle_set_free(struct triangle_set *);
+
+/* Memory for triangulating one set of vertices after another, e.g. one shape
+   at a time, which is kept between calls so that it is not allocated again for
+   every set of vertices. */
+struct triangle_workspace;
+
+/* Create an empty workspace. Return NULL on failure. */
+struct triangle_workspace *triangle_workspace_make(void);
+
+void triangle_workspace_free(struct triangle_workspace *);
+
+/* Like `triangle_set_triangulate`, but the triangles are kept in the workspace
+   and only valid until it is used again or freed. Return NULL on failure. */
+struct triangle_set *triangle_workspace_triangulate(
+	struct triangle_workspace *,
+	float const (*vertices)[2],
+	size_t vertex_count,
+	unsigned const (*edges)[2],
+	size_t edge_count);
+
+/* A constrained delauney triangulation which is updated in place as points
+   and constraint edges are added, so that an edit only costs the local update
+   rather than a new triangulation from scratch. Points are referred to by the
+   index returned when they were inserted. */
+struct triangulation;
+
+/* Create an empty triangulation for points within `bounds`, given as
+   { min x, min y, max x, max y }. Return NULL on failure. */
+struct triangulation *triangulation_make(float const bounds[4]);
+
+void triangulation_free(struct triangulation *);
+
+/* Insert point `p` and return its index. If an earlier point has the same
+   coordinates then its index is returned instead. A point on a constraint edge
+   splits it in two. Return negative if `p` is outside the bounds or on memory
+   allocation failure. */
+long triangulation_insert_point(struct triangulation *, float const p[2]);
+
+/* Constrain the triangulation to contain the edge between points `a` and `b`,
+   by removing the edges it crosses and re-triangulating the area around it. An
+   edge which passes through other points is split at them. An edge can be
+   inserted multiple times, and is kept until it has been removed as many
+   times. Return zero on success, and negative if the points do not exist, the
+   edge crosses another constraint edge, or memory allocation fails. */
+int triangulation_insert_edge(struct triangulation *, size_t a, size_t b);
+
+/* Remove the constraint edge between `a` and `b` inserted earlier, and
+   restore the delauney property in the area around it. Return zero on
+   success, and negative if there is no such constraint. */
+int triangulation_remove_edge(struct triangulation *, size_t a, size_t b);
+
+/* Return the current triangles, which cover at least the areas enclosed by
+   constraint edges, or NULL on failure. Free with `triangle_set_free`. */
+struct triangle_set *triangulation_triangles(struct triangulation *);
@@ -0,0 +1,28 @@
+#include <stddef.h>
+
+/* struct tpool - a fixed set of worker threads which run the iterations of a
+   loop in parallel. The thread calling `tpool_run()` takes part in the work,
+   so a pool of size 1 has no worker threads and runs everything serially. */
+struct tpool;
+
+/* Create a thread pool which runs at most `nthreads` iterations at the same
+   time, including the calling thread, or one per online processor if
+   `nthreads` is zero. Return NULL on failure. */
+struct tpool *tpool_make(unsigned nthreads);
+
+/* Stop the worker threads and free the pool */
+void tpool_free(struct tpool *pool);
+
+/* Return the number of iterations that can run at the same time, or 1 if
+   `pool` is NULL */
+unsigned tpool_size(struct tpool const *pool);
+
+/* Call `fn(arg, i)` for each `i` in [0, n) and return once all calls have
+   returned. The calls are distributed over the threads of `pool` in no
+   particular order, or made in order by the calling thread if `pool` is
+   NULL. A pool can only run one loop at a time. */
+void tpool_run(
+	struct tpool *pool,
+	size_t n,
+	void fn(void *arg, size_t i),
+	void *arg);
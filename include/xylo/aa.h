@@ -10,8 +10,25 @@ enum xylo_aa {
 
 	/* rotated grid anti-aliased - four samples per pixel, avoiding sampling
 	   with the same X or Y coordinate per pixel  */
-	XYLO_AA_RGSS
+	XYLO_AA_RGSS,
+
+	/* adaptive - the best of the above modes whose recent drawing times
+	   fit the frame budget, see `xylo_set_aa_budget()`. Drawing is timed
+	   with GL_TIME_ELAPSED queries, which cannot be nested, so callers must
+	   not have a GL_TIME_ELAPSED query of their own active around
+	   `xylo_draw()` in this mode. */
+	XYLO_AA_AUTO
 };
 
 enum xylo_aa xylo_get_aa(struct xylo *);
 void xylo_set_aa(struct xylo *, enum xylo_aa aa);
+
+/* Set the time in microseconds that drawing should take at most with
+   XYLO_AA_AUTO. Quality drops as soon as drawing is too slow on average,
+   e.g. while many objects move, and returns once there has been time to
+   spare for a while, e.g. when the scene is still again. */
+void xylo_set_aa_budget(struct xylo *, unsigned long usec);
+
+/* Return the mode used for the most recent drawing, which is one of the
+   fixed modes even if `xylo_get_aa()` is XYLO_AA_AUTO */
+enum xylo_aa xylo_get_current_aa(struct xylo *);
@@ -0,0 +1,57 @@
+/* A xylo_dbvh is a bounding volume hierarchy over the leaves of a xylo_draw
+   tree, in the same (world) space as the transforms of the leaves. The bounds
+   of a leaf are the control point bounds of its outline or mesh, transformed
+   by the leaf transform. It is used to find the leaves that may be visible in
+   a rectangle, so that only those are compiled and drawn, and to find the
+   leaves that may cover a point without reading back any pixels.
+
+   The hierarchy refers to the leaves by pointer and does not track changes on
+   its own. Call `xylo_dbvh_update()` after moving a leaf or changing its
+   shape, and `xylo_dbvh_build()` again after adding or removing nodes in the
+   draw tree. Each leaf should appear at most once in the tree. */
+struct xylo_dbvh;
+
+struct xylo_draw;
+struct wbuf;
+
+/* allocate an empty xylo_dbvh */
+struct xylo_dbvh *xylo_make_dbvh(void);
+
+/* deallocate a xylo_dbvh */
+void xylo_free_dbvh(struct xylo_dbvh *bvh);
+
+/* Replace the contents of `bvh` with the leaves of `root`. Return zero on
+   success, and non-zero on allocation failure, in which case `bvh` is
+   empty. */
+int xylo_dbvh_build(struct xylo_dbvh *bvh, struct xylo_draw const *root);
+
+/* Recompute the bounds of `leaf` and of the nodes that contain it. Return
+   non-zero if `leaf` was not part of the tree when `bvh` was built. The
+   structure of the hierarchy is kept, so rebuild it when many leaves have
+   moved far from where they were. */
+int xylo_dbvh_update(struct xylo_dbvh *bvh, struct xylo_draw const *leaf);
+
+/* Recompute the bounds of all leaves and nodes */
+void xylo_dbvh_refit(struct xylo_dbvh *bvh);
+
+/* Return the number of leaves in `bvh` */
+size_t xylo_dbvh_length(struct xylo_dbvh const *bvh);
+
+/* Append the leaves (struct xylo_draw const *) whose bounds overlap `rect`
+   (x_min, y_min, x_max, y_max) to `dest`, in drawing order. Return non-zero
+   on allocation failure. */
+int xylo_dbvh_query(
+	struct xylo_dbvh *bvh,
+	float const rect[4],
+	struct wbuf *dest);
+
+/* Store up to `max` leaves whose bounds contain the point (x, y) in `dest`,
+   the topmost (last drawn) first, and return the number of leaves stored. The
+   bounds are conservative, so the leaves are candidates that may cover the
+   point, but no other leaf does. Return zero on allocation failure too. */
+size_t xylo_dbvh_pick(
+	struct xylo_dbvh *bvh,
+	float x,
+	float y,
+	struct xylo_draw const **dest,
+	size_t max);
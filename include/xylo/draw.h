@@ -74,3 +74,53 @@ struct xylo_doutline *xylo_doutline_cast(struct xylo_draw *);
 void xylo_init_dmesh(struct xylo_dmesh *, struct xylo_mesh const *);
 void xylo_term_dmesh(struct xylo_dmesh *);
 struct xylo_dmesh *xylo_dmesh_cast(struct xylo_draw *);
+
+/* A single leaf of a xylo_draw tree, as recorded by `xylo_dcmds_compile()` */
+struct xylo_dcmd
+{
+	enum xylo_dtype type; /* xylo_doutline or xylo_dmesh */
+	unsigned id;
+	float color[4];
+	struct xylo_outline const *outline;
+	struct xylo_mesh const *mesh;
+};
+
+/* A flat array of draw commands compiled from a tree of xylo_draw nodes. The
+   tree is walked once, in drawing order, and the model-view matrix of each
+   leaf is computed up front so that drawing it with `xylo_draw_dcmds()` is a
+   linear pass over contiguous memory. The model-view-projection matrices are
+   cached and recomputed only when the projection changes. Transforms, styles,
+   and IDs are copied, so compile the tree again whenever it changes. */
+struct xylo_dcmds
+{
+	struct wbuf cmds; /* struct xylo_dcmd[] */
+	struct wbuf mv;   /* float[][16] */
+	struct wbuf mvp;  /* float[][16], for `proj` */
+	struct wbuf objects; /* per-object shader data, for `proj` */
+	struct wbuf bounds; /* float[][4], screen-space bounds for `proj` */
+	float proj[16];
+	int has_mvp, has_objects;
+};
+
+void xylo_init_dcmds(struct xylo_dcmds *);
+void xylo_term_dcmds(struct xylo_dcmds *);
+
+/* Replace the contents of `cmds` with the leaves of `draw`. Return zero on
+   success, and non-zero on allocation failure, in which case `cmds` is
+   empty. */
+int xylo_dcmds_compile(struct xylo_dcmds *cmds, struct xylo_draw const *draw);
+
+/* Same as `xylo_dcmds_compile()`, but compile the nodes `leaves[0]` ...
+   `leaves[n - 1]` one after another, e.g. the visible leaves found by
+   `xylo_dbvh_query()`. */
+int xylo_dcmds_compile_leaves(
+	struct xylo_dcmds *cmds,
+	struct xylo_draw const *const *leaves,
+	size_t n);
+
+/* Return the number of commands in `cmds` */
+size_t xylo_dcmds_length(struct xylo_dcmds const *cmds);
+
+/* Return the model-view-projection matrices of `cmds` for the projection
+   `proj`, recomputing them only if `proj` differs from the previous call */
+float const *xylo_dcmds_project(struct xylo_dcmds *cmds, float const *proj);
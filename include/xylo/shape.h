@@ -4,8 +4,10 @@ struct xylo_outline;
 struct xylo_outline_set;
 struct xylo_mesh;
 struct xylo_mesh_set;
+struct xylo_mesh_cache;
 
 struct gl_api;
+struct tpool;
 
 struct xylo_outline_set *xylo_make_outline_set(
 	struct gl_api *gl,
@@ -25,8 +27,41 @@ struct xylo_mesh_set *xylo_make_mesh_set(
 	size_t n,
 	struct spline_shape const *shapes);
 
+/* Like `xylo_make_mesh_set()`, but triangulate the shapes on the threads of
+   `pool`, one shape per iteration, before uploading them all at once from the
+   calling thread. The result is the same as that of `xylo_make_mesh_set()`. */
+struct xylo_mesh_set *xylo_make_mesh_set_parallel(
+	struct gl_api *api,
+	size_t n,
+	struct spline_shape const *shapes,
+	struct tpool *pool);
+
+/* Like `xylo_make_mesh_set_parallel()`, but take the triangles of shapes
+   which are in `cache` from there, and add those of the others to it, so that
+   identical shapes are only triangulated once. */
+struct xylo_mesh_set *xylo_make_mesh_set_cached(
+	struct gl_api *api,
+	size_t n,
+	struct spline_shape const *shapes,
+	struct tpool *pool,
+	struct xylo_mesh_cache *cache);
+
 void xylo_free_mesh_set(struct xylo_mesh_set *set, struct gl_api *api);
 
+/* Create a cache of the triangles of shapes, keyed by a hash of their
+   segments. If `path` names a file written by `xylo_save_mesh_cache()`, then
+   it is mapped into memory and its triangles are used as they are, so that
+   shapes from an earlier run are not triangulated again. A missing or stale
+   file is ignored. Return NULL on failure. */
+struct xylo_mesh_cache *xylo_make_mesh_cache(char const *path);
+
+/* Write the triangles of every shape in `cache` to the file at `path`,
+   which replaces it only once it is complete, even if it is the file of the
+   cache. Return non-zero on failure. */
+int xylo_save_mesh_cache(struct xylo_mesh_cache *cache, char const *path);
+
+void xylo_free_mesh_cache(struct xylo_mesh_cache *cache);
+
 struct xylo_mesh const *xylo_get_mesh(
 	struct xylo_mesh_set *set,
 	size_t i);
@@ -0,0 +1,147 @@
+#include <stdio.h>
+
+struct spline_shape;
+
+struct xylo_outline;
+struct xylo_mesh;
+struct xylo_mesh_set;
+struct xylo_mesh_cache;
+struct xylo_glyph_set;
+struct xylo_layout_cache;
+
+struct gl_api;
+struct tpool;
+
+/* Outline fonts are read from plain text files of one item per line, where
+   blank lines and lines starting with `#` are ignored:
+
+       font <units per em> <ascent> <descent> <line gap>
+       glyph <code point> <advance>
+       outline
+       <end x> <end y> <mid x> <mid y> <weight>
+       kern <left code point> <right code point> <adjustment>
+
+   The `font` line comes first. Each `glyph` is followed by its outlines, each
+   `outline` by its segments, like those of `struct spline_segment`, and
+   glyphs without outlines, like spaces, only advance the pen. The glyph of
+   code point zero, if any, is used for characters which are missing. */
+
+struct xylo_glyph
+{
+	unsigned long code;
+	float advance;
+};
+
+struct xylo_kerning
+{
+	unsigned long left, right;
+	float adjust;
+};
+
+struct xylo_font
+{
+	/* font units, where the descent is negative below the baseline */
+	float units_per_em, ascent, descent, line_gap;
+
+	/* glyphs and their shapes sorted by code point, and kerning pairs
+	   sorted by left and then right code point */
+	size_t nglyphs, nkernings;
+	struct xylo_glyph const *glyphs;
+	struct spline_shape const *shapes;
+	struct xylo_kerning const *kernings;
+};
+
+/* Read an outline font from the file `filename`, or from `fp`. Free the font
+   with `xylo_free_font`. Return NULL on failure. */
+struct xylo_font const *xylo_load_font(char const *filename);
+struct xylo_font const *xylo_fload_font(FILE *fp);
+
+void xylo_free_font(struct xylo_font const *font);
+
+/* Return the index of the glyph of `code` in `font`, or the index of its
+   missing glyph, or `font->nglyphs` if it has neither */
+size_t xylo_font_glyph(struct xylo_font const *font, unsigned long code);
+
+/* A glyph at `pos` relative to the first baseline, in font units */
+struct xylo_glyph_pos
+{
+	size_t glyph;
+	float pos[2];
+};
+
+/* Glyphs of laid out text, except those without outlines. Lines go downwards
+   from the first baseline at y = 0, and start at x = 0. */
+struct xylo_text_layout
+{
+	size_t n, nlines;
+	struct xylo_glyph_pos const *glyphs;
+
+	/* x_min, y_min, x_max, y_max of the advances and the line heights */
+	float bounds[4];
+};
+
+/* Lay out the `size` bytes of UTF-8 text `utf8` with the glyphs and kerning
+   of `font`. Lines end at newlines, and if `width` is positive then lines
+   which would be wider than it are broken at the last space, or before the
+   glyph which does not fit if there is no space. Free the layout with
+   `xylo_free_text_layout`. Return NULL on failure. */
+struct xylo_text_layout *xylo_layout_text(
+	struct xylo_font const *font,
+	char const *utf8,
+	size_t size,
+	float width);
+
+void xylo_free_text_layout(struct xylo_text_layout *layout);
+
+/* Create a cache of layouts of text in `font`, which has to outlive it.
+   Return NULL on failure. */
+struct xylo_layout_cache *xylo_make_layout_cache(struct xylo_font const *font);
+
+/* Like `xylo_layout_text`, but return the same layout for the same text and
+   width until it has been released as many times as it has been returned
+   and the cache has been cleaned. */
+struct xylo_text_layout const *xylo_cached_layout(
+	struct xylo_layout_cache *cache,
+	char const *utf8,
+	size_t size,
+	float width);
+
+void xylo_release_layout(
+	struct xylo_layout_cache *cache,
+	struct xylo_text_layout const *layout);
+
+/* Free the layouts which are not in use, and return how many there were */
+size_t xylo_clean_layout_cache(struct xylo_layout_cache *cache);
+
+void xylo_free_layout_cache(struct xylo_layout_cache *cache);
+
+/* Create an outline and a mesh of every glyph of `font`, which has to outlive
+   the set, in one outline set and one mesh set. The glyphs are triangulated
+   like by `xylo_make_mesh_set_cached`, where `pool` and `cache` can be NULL,
+   and their triangles are kept for `xylo_make_text_mesh_set`. Return NULL on
+   failure. */
+struct xylo_glyph_set *xylo_make_glyph_set(
+	struct gl_api *api,
+	struct xylo_font const *font,
+	struct tpool *pool,
+	struct xylo_mesh_cache *cache);
+
+struct xylo_outline const *xylo_get_glyph_outline(
+	struct xylo_glyph_set *set,
+	size_t glyph);
+
+struct xylo_mesh const *xylo_get_glyph_mesh(
+	struct xylo_glyph_set *set,
+	size_t glyph);
+
+void xylo_free_glyph_set(struct xylo_glyph_set *set, struct gl_api *api);
+
+/* Create a mesh set with one mesh per layout, of the triangles of its glyphs
+   moved to their positions, so that each layout is drawn like any other mesh
+   with a single draw call, whatever its length. Free the set with
+   `xylo_free_mesh_set`. Return NULL on failure. */
+struct xylo_mesh_set *xylo_make_text_mesh_set(
+	struct gl_api *api,
+	struct xylo_glyph_set const *glyphs,
+	size_t n,
+	struct xylo_text_layout const *const *layouts);
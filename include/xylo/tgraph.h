@@ -13,6 +13,8 @@ struct xylo_tgraph;
    space */
 struct xylo_tnode;
 
+struct tpool;
+
 /* initiate a xylo_tgraph */
 void xylo_init_tgraph(struct xylo_tgraph *graph, size_t transform_size);
 
@@ -30,6 +32,41 @@ int xylo_tgraph_transform(
 	struct xylo_tgraph *graph,
 	void transform(void *dest, void const *child, void const *parent));
 
+/* Built-in transformation formats for `xylo_tgraph_propagate()` */
+enum xylo_tformat
+{
+	/* 2D affine transform, see struct xylo_draw_transform */
+	xylo_taffine2d,
+	/* column-major 4x4 float matrix */
+	xylo_tmat44f
+};
+
+/* Propagate transformations from the roots to the leaves, like
+   `xylo_tgraph_transform()`, but with a built-in combination operation for
+   transforms in `format`. The transforms are first laid out in breadth-first
+   order together with the index of each parent (unless the graph has not
+   changed shape since the previous call) so that the update is a single
+   linear pass over contiguous memory. Return non-zero on allocation
+   failure. */
+int xylo_tgraph_propagate(struct xylo_tgraph *graph, enum xylo_tformat format);
+
+/* Same as `xylo_tgraph_propagate()`, but each level of the graph is split
+   between the threads of `pool`, keeping siblings together. The result is
+   identical to that of `xylo_tgraph_propagate()`. */
+int xylo_tgraph_propagate_parallel(
+	struct xylo_tgraph *graph,
+	enum xylo_tformat format,
+	struct tpool *pool);
+
+/* Update the global transformations of nodes that have been touched (see
+   `xylo_tnode_touch()`) since the previous update, and of their descendants,
+   with the built-in combination operation for `format`. This costs time
+   proportional to the number of affected nodes rather than to the size of
+   the graph, unless so many nodes have been touched that a full
+   `xylo_tgraph_propagate()` is likely faster. Return non-zero on allocation
+   failure, in which case the touched nodes remain touched. */
+int xylo_tgraph_update(struct xylo_tgraph *graph, enum xylo_tformat format);
+
 /* move transformations to improve memory locality */
 int xylo_tgraph_compact(struct xylo_tgraph *graph);
 
@@ -42,14 +79,30 @@ struct xylo_tnode *xylo_make_tnode(
 	void const *transform);
 
 /* Return pointer to the local transform of a transformation node. The
-   returned pointer can be invalidated if a new node is created, so use it only
-   temporarily as a target location when updating the relative transform. */
+   returned pointer can be invalidated if a new node is created, and by
+   `xylo_tgraph_propagate()`, `xylo_tgraph_propagate_parallel()`,
+   `xylo_tgraph_update()` and `xylo_tgraph_compact()`, which can move the
+   transforms, so use it only temporarily as a target location when updating
+   the relative transform. */
 void *xylo_tnode_local(struct xylo_tnode *node);
 
+/* Mark the local transform of `node` as changed, so that it and its
+   descendants are recomputed by the next `xylo_tgraph_update()`. Newly created
+   nodes start out as touched. Call this after writing to the pointer returned
+   by `xylo_tnode_local()`. Return non-zero on allocation failure. */
+int xylo_tnode_touch(struct xylo_tgraph *graph, struct xylo_tnode *node);
+
+/* Copy `transform` to the local transform of `node` and touch it */
+int xylo_tnode_set_local(
+	struct xylo_tgraph *graph,
+	struct xylo_tnode *node,
+	void const *transform);
+
 /* Return a pointer to the global, or world, transform of a transformation
-   node. The global transformation is only updated after
-   `xylo_tgraph_transform()` have been called. The returned pointer can be
-   invalidated if a new node is created, so don't hold on to it for long. */
+   node. The global transformation is only updated by
+   `xylo_tgraph_transform()`, propagation and `xylo_tgraph_update()`. The
+   returned pointer can be invalidated like the one returned by
+   `xylo_tnode_local()`, so don't hold on to it for long. */
 void const *xylo_tnode_global(struct xylo_tnode const *node);
 
 /* Release `node`, and all of its children, back to `graph` */
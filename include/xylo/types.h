@@ -2,3 +2,13 @@ struct xylo_view
 {
 	float projection[16];
 };
+
+/* object IDs of a region, read asynchronously by `xylo_pick_object_ids()` */
+struct xylo_pick
+{
+	unsigned serial;
+	GLint x, y;
+	GLsizei width, height;
+	/* width * height IDs, bottom row first, valid until the next poll */
+	unsigned short const *ids;
+};
@@ -2,6 +2,8 @@ struct gl_api;
 struct xylo;
 struct xylo_view;
 struct xylo_draw;
+struct xylo_dcmds;
+struct xylo_pick;
 
 struct xylo *make_xylo(struct gl_api *);
 void xylo_begin(struct xylo *);
@@ -10,8 +12,20 @@ void xylo_draw(
 	struct xylo *,
 	struct xylo_view const *,
 	struct xylo_draw const *);
+void xylo_draw_dcmds(
+	struct xylo *,
+	struct xylo_view const *,
+	struct xylo_dcmds *);
 unsigned xylo_get_object_id(
 	struct xylo *xylo,
 	GLsizei x,
 	GLsizei y);
+unsigned xylo_pick_object_ids(
+	struct xylo *xylo,
+	GLint x,
+	GLint y,
+	GLsizei width,
+	GLsizei height);
+int xylo_poll_object_ids(struct xylo *xylo, struct xylo_pick *pick);
+void xylo_set_fb_limit(struct xylo *xylo, size_t limit);
 void free_xylo(struct xylo *);
@@ -161,7 +161,7 @@ void *wbuf_write(struct wbuf *buf, void const *data, size_t size)
 {
 	assert(buf != NULL);
 	void *result = wbuf_alloc(buf, size);
-	if (result) { (void)memcpy(result, data, size); }
+	if (result && size > 0) { (void)memcpy(result, data, size); }
 	return result;
 }
 
@@ -0,0 +1,437 @@
+#ifndef GENERIC_H_INCLUDED
+#include "generic.h"
+#endif
+
+#include <stddef.h>
+#include <math.h>
+
+#include "batch.g.h"
+
+/* Matrices are stored in column-major order */
+#define A(m,row,col) (m)[((col)<<2)+(row)]
+
+/* Only the float instantiation has an SSE path, where a column of a matrix
+   or a 4-vector fills one register. The other types rely on the compiler. */
+#define BATCH_SSE_FLT 1
+#define BATCH_SSE_DBL 0
+#define BATCH_SSE_LDBL 0
+#if defined(__SSE__) && PASTE(BATCH_SSE_, FPFX)
+#define BATCH_SSE 1
+#include <xmmintrin.h>
+#else
+#define BATCH_SSE 0
+#endif
+
+#if BATCH_SSE
+/* x*c[0] + y*c[1] + z*c[2] + w*c[3] for the columns c of a matrix */
+static inline __m128 combine4(__m128 const c[4], float x, float y, float z,
+                              float w)
+{
+	return _mm_add_ps(
+		_mm_add_ps(_mm_mul_ps(c[0], _mm_set1_ps(x)),
+		           _mm_mul_ps(c[1], _mm_set1_ps(y))),
+		_mm_add_ps(_mm_mul_ps(c[2], _mm_set1_ps(z)),
+		           _mm_mul_ps(c[3], _mm_set1_ps(w))));
+}
+
+static inline void load_columns(__m128 dest[4], float const a[static 16])
+{
+	int col;
+	for (col = 0; col < 4; col++) { dest[col] = _mm_loadu_ps(a + 4*col); }
+}
+#endif
+
+/* dest[i] = b[0]*c[0][i] + b[1]*c[1][i] + b[2]*c[2][i] + b[3]*c[3][i] */
+static void combine_arrays(
+	T dest[restrict],
+	T const b[static 4],
+	T const *const c[static 4],
+	size_t n)
+{
+	size_t i = 0;
+#if BATCH_SSE
+	__m128 const b0 = _mm_set1_ps(b[0]), b1 = _mm_set1_ps(b[1]);
+	__m128 const b2 = _mm_set1_ps(b[2]), b3 = _mm_set1_ps(b[3]);
+
+	for (; i + 4 <= n; i += 4) {
+		_mm_storeu_ps(dest + i, _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(b0, _mm_loadu_ps(c[0] + i)),
+			           _mm_mul_ps(b1, _mm_loadu_ps(c[1] + i))),
+			_mm_add_ps(_mm_mul_ps(b2, _mm_loadu_ps(c[2] + i)),
+			           _mm_mul_ps(b3, _mm_loadu_ps(c[3] + i)))));
+	}
+#endif
+	for (; i < n; i++) {
+		dest[i] = b[0]*c[0][i] + b[1]*c[1][i] + b[2]*c[2][i] + b[3]*c[3][i];
+	}
+}
+
+/* dest[i] = b[0][i]*c[0][i] + ... + b[3][i]*c[3][i] */
+static void dot_arrays(
+	T dest[restrict],
+	T const *const b[static 4],
+	T const *const c[static 4],
+	size_t n)
+{
+	size_t i = 0;
+#if BATCH_SSE
+	for (; i + 4 <= n; i += 4) {
+		_mm_storeu_ps(dest + i, _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(b[0] + i),
+			                      _mm_loadu_ps(c[0] + i)),
+			           _mm_mul_ps(_mm_loadu_ps(b[1] + i),
+			                      _mm_loadu_ps(c[1] + i))),
+			_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(b[2] + i),
+			                      _mm_loadu_ps(c[2] + i)),
+			           _mm_mul_ps(_mm_loadu_ps(b[3] + i),
+			                      _mm_loadu_ps(c[3] + i)))));
+	}
+#endif
+	for (; i < n; i++) {
+		dest[i] = b[0][i]*c[0][i] + b[1][i]*c[1][i]
+		        + b[2][i]*c[2][i] + b[3][i]*c[3][i];
+	}
+}
+
+T *m44mulv3n(T v[restrict], T const a[restrict static 16], T const u[restrict],
+             size_t n)
+{
+#if BATCH_SSE
+	__m128 c[4];
+	float last[4];
+	size_t i;
+
+	if (n == 0) { return v; }
+	load_columns(c, a);
+	/* each store writes one float past the point, which the next point
+	   overwrites, so only the last point is stored through a copy */
+	for (i = 0; i < n - 1; i++) {
+		_mm_storeu_ps(v + 3*i,
+			combine4(c, u[3*i + 0], u[3*i + 1], u[3*i + 2], 1.f));
+	}
+	_mm_storeu_ps(last, combine4(c, u[3*i + 0], u[3*i + 1], u[3*i + 2], 1.f));
+	v[3*i + 0] = last[0];
+	v[3*i + 1] = last[1];
+	v[3*i + 2] = last[2];
+	return v;
+#else
+	size_t i;
+	T const a00 = A(a,0,0), a01 = A(a,0,1), a02 = A(a,0,2), a03 = A(a,0,3);
+	T const a10 = A(a,1,0), a11 = A(a,1,1), a12 = A(a,1,2), a13 = A(a,1,3);
+	T const a20 = A(a,2,0), a21 = A(a,2,1), a22 = A(a,2,2), a23 = A(a,2,3);
+
+	for (i = 0; i < n; i++) {
+		T const x = u[3*i + 0], y = u[3*i + 1], z = u[3*i + 2];
+		v[3*i + 0] = x*a00 + y*a01 + z*a02 + a03;
+		v[3*i + 1] = x*a10 + y*a11 + z*a12 + a13;
+		v[3*i + 2] = x*a20 + y*a21 + z*a22 + a23;
+	}
+	return v;
+#endif
+}
+
+void m44mulv3nsoa(
+	T vx[restrict], T vy[restrict], T vz[restrict],
+	T const a[restrict static 16],
+	T const ux[restrict], T const uy[restrict], T const uz[restrict],
+	size_t n)
+{
+	size_t i = 0;
+	T const a00 = A(a,0,0), a01 = A(a,0,1), a02 = A(a,0,2), a03 = A(a,0,3);
+	T const a10 = A(a,1,0), a11 = A(a,1,1), a12 = A(a,1,2), a13 = A(a,1,3);
+	T const a20 = A(a,2,0), a21 = A(a,2,1), a22 = A(a,2,2), a23 = A(a,2,3);
+#if BATCH_SSE
+	T *const v[3] = { vx, vy, vz };
+	__m128 r[3][4];
+	int row, col;
+
+	/* the matrix without its last row, each element in all lanes */
+	for (row = 0; row < 3; row++) {
+		for (col = 0; col < 4; col++) {
+			r[row][col] = _mm_set1_ps(A(a,row,col));
+		}
+	}
+	for (; i + 4 <= n; i += 4) {
+		__m128 const x = _mm_loadu_ps(ux + i);
+		__m128 const y = _mm_loadu_ps(uy + i);
+		__m128 const z = _mm_loadu_ps(uz + i);
+		for (row = 0; row < 3; row++) {
+			_mm_storeu_ps(v[row] + i, _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(x, r[row][0]),
+				           _mm_mul_ps(y, r[row][1])),
+				_mm_add_ps(_mm_mul_ps(z, r[row][2]), r[row][3])));
+		}
+	}
+#endif
+	for (; i < n; i++) {
+		vx[i] = ux[i]*a00 + uy[i]*a01 + uz[i]*a02 + a03;
+		vy[i] = ux[i]*a10 + uy[i]*a11 + uz[i]*a12 + a13;
+		vz[i] = ux[i]*a20 + uy[i]*a21 + uz[i]*a22 + a23;
+	}
+}
+
+T *m44mulvn(T v[restrict], T const a[restrict static 16], T const u[restrict],
+            size_t n)
+{
+	size_t i;
+#if BATCH_SSE
+	__m128 c[4];
+
+	load_columns(c, a);
+	for (i = 0; i < n; i++) {
+		T const *x = u + 4*i;
+		_mm_storeu_ps(v + 4*i, combine4(c, x[0], x[1], x[2], x[3]));
+	}
+#else
+	int row;
+
+	for (i = 0; i < n; i++) {
+		T const *x = u + 4*i;
+		for (row = 0; row < 4; row++) {
+			v[4*i + row] = x[0]*A(a,row,0) + x[1]*A(a,row,1)
+			             + x[2]*A(a,row,2) + x[3]*A(a,row,3);
+		}
+	}
+#endif
+	return v;
+}
+
+#if BATCH_SSE
+/* dest = b*c for single 4x4 matrices, with the columns of b loaded */
+static inline void mul44(
+	float dest[restrict static 16],
+	__m128 const b[4],
+	float const c[restrict static 16])
+{
+	int col;
+
+	for (col = 0; col < 4; col++) {
+		_mm_storeu_ps(dest + 4*col, combine4(b, A(c,0,col), A(c,1,col),
+		                                     A(c,2,col), A(c,3,col)));
+	}
+}
+#else
+/* dest = b*c for single 4x4 matrices, where none of them overlap */
+static void mul44(
+	T dest[restrict static 16],
+	T const b[restrict static 16],
+	T const c[restrict static 16])
+{
+	int row, col;
+
+	for (col = 0; col < 4; col++) {
+		for (row = 0; row < 4; row++) {
+			A(dest,row,col) = A(b,row,0)*A(c,0,col)
+			                + A(b,row,1)*A(c,1,col)
+			                + A(b,row,2)*A(c,2,col)
+			                + A(b,row,3)*A(c,3,col);
+		}
+	}
+}
+#endif
+
+T *m44mulmn(T a[restrict], T const b[restrict static 16], T const c[restrict],
+            size_t n)
+{
+	size_t i;
+#if BATCH_SSE
+	__m128 bc[4];
+
+	load_columns(bc, b);
+	for (i = 0; i < n; i++) {
+		mul44(a + 16*i, bc, c + 16*i);
+	}
+#else
+	for (i = 0; i < n; i++) {
+		mul44(a + 16*i, b, c + 16*i);
+	}
+#endif
+	return a;
+}
+
+void m44mulmnsoa(
+	T *const a[restrict static 16],
+	T const b[restrict static 16],
+	T const *const c[restrict static 16],
+	size_t n)
+{
+	T row[4];
+	int i, j;
+
+	for (j = 0; j < 4; j++) {
+		for (i = 0; i < 4; i++) {
+			row[0] = A(b,i,0), row[1] = A(b,i,1);
+			row[2] = A(b,i,2), row[3] = A(b,i,3);
+			combine_arrays(A(a,i,j), row, &A(c,0,j), n);
+		}
+	}
+}
+
+T *m44muln(T a[restrict], T const b[restrict], T const c[restrict], size_t n)
+{
+	size_t i;
+#if BATCH_SSE
+	__m128 bc[4];
+
+	for (i = 0; i < n; i++) {
+		load_columns(bc, b + 16*i);
+		mul44(a + 16*i, bc, c + 16*i);
+	}
+#else
+	for (i = 0; i < n; i++) {
+		mul44(a + 16*i, b + 16*i, c + 16*i);
+	}
+#endif
+	return a;
+}
+
+void m44mulnsoa(
+	T *const a[restrict static 16],
+	T const *const b[restrict static 16],
+	T const *const c[restrict static 16],
+	size_t n)
+{
+	T const *row[4];
+	int i, j;
+
+	for (j = 0; j < 4; j++) {
+		for (i = 0; i < 4; i++) {
+			row[0] = A(b,i,0), row[1] = A(b,i,1);
+			row[2] = A(b,i,2), row[3] = A(b,i,3);
+			dot_arrays(A(a,i,j), row, &A(c,0,j), n);
+		}
+	}
+}
+
+T *v3normn(T w[restrict], T const u[restrict], size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		T const x = u[3*i + 0], y = u[3*i + 1], z = u[3*i + 2];
+		T const len2 = x*x + y*y + z*z;
+		T const s = len2 > LIT(0.0) ? LIT(1.0) / sqrtM(len2) : LIT(0.0);
+		w[3*i + 0] = x*s;
+		w[3*i + 1] = y*s;
+		w[3*i + 2] = z*s;
+	}
+	return w;
+}
+
+void v3normnsoa(
+	T wx[restrict], T wy[restrict], T wz[restrict],
+	T const ux[restrict], T const uy[restrict], T const uz[restrict],
+	size_t n)
+{
+	size_t i;
+#if BATCH_SSE
+	__m128 const zero = _mm_setzero_ps(), one = _mm_set1_ps(1.f);
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		__m128 const x = _mm_loadu_ps(ux + i);
+		__m128 const y = _mm_loadu_ps(uy + i);
+		__m128 const z = _mm_loadu_ps(uz + i);
+		__m128 const len2 = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)),
+			_mm_mul_ps(z, z));
+		/* null vectors get the scale 0 instead of 1/0 */
+		__m128 const s = _mm_and_ps(_mm_cmpgt_ps(len2, zero),
+		                            _mm_div_ps(one, _mm_sqrt_ps(len2)));
+		_mm_storeu_ps(wx + i, _mm_mul_ps(x, s));
+		_mm_storeu_ps(wy + i, _mm_mul_ps(y, s));
+		_mm_storeu_ps(wz + i, _mm_mul_ps(z, s));
+	}
+#else
+	i = 0;
+#endif
+	for (; i < n; i++) {
+		T const len2 = ux[i]*ux[i] + uy[i]*uy[i] + uz[i]*uz[i];
+		T const s = len2 > LIT(0.0) ? LIT(1.0) / sqrtM(len2) : LIT(0.0);
+		wx[i] = ux[i]*s;
+		wy[i] = uy[i]*s;
+		wz[i] = uz[i]*s;
+	}
+}
+
+/* the weights of slerp between quaternions with the dot product `dot`, where
+   sin(omega) follows from cos(omega) = dot, since omega is in [0, pi] */
+static inline void slerp_weights(T *s0, T *s1, T dot, T t)
+{
+	T omega, sin_omega;
+
+	dot = fminM(fmaxM(dot, LIT(-1.0)), LIT(1.0));
+	sin_omega = sqrtM(LIT(1.0) - dot*dot);
+	if (sin_omega > EPSILON) {
+		omega = acosM(dot);
+		*s0 = sinM(omega * (LIT(1.0) - t)) / sin_omega;
+		*s1 = sinM(omega * t) / sin_omega;
+	} else {
+		*s0 = LIT(1.0) - t;
+		*s1 = t;
+	}
+}
+
+T *qslerpn(T dest[restrict], T const q0[restrict], T const q1[restrict], T t,
+           size_t n)
+{
+	size_t i;
+	int j;
+
+	for (i = 0; i < n; i++) {
+		T const *p = q0 + 4*i, *q = q1 + 4*i;
+		T s0, s1;
+
+		slerp_weights(&s0, &s1,
+		              p[0]*q[0] + p[1]*q[1] + p[2]*q[2] + p[3]*q[3], t);
+		for (j = 0; j < 4; j++) {
+			dest[4*i + j] = p[j]*s0 + q[j]*s1;
+		}
+	}
+	return dest;
+}
+
+#define SLERP_BLOCK 64
+
+void qslerpnsoa(
+	T *const dest[restrict static 4],
+	T const *const q0[restrict static 4],
+	T const *const q1[restrict static 4],
+	T t,
+	size_t n)
+{
+	T s0[SLERP_BLOCK], s1[SLERP_BLOCK];
+	T const *p[4], *q[4];
+	size_t i, j, m;
+	int k;
+
+	/* the dot products and the blend go through whole blocks, and only the
+	   weights between them call the math library for each quaternion */
+	for (i = 0; i < n; i += m) {
+		m = n - i < SLERP_BLOCK ? n - i : SLERP_BLOCK;
+		for (k = 0; k < 4; k++) {
+			p[k] = q0[k] + i;
+			q[k] = q1[k] + i;
+		}
+		dot_arrays(s0, p, q, m);
+		for (j = 0; j < m; j++) {
+			slerp_weights(s0 + j, s1 + j, s0[j], t);
+		}
+		for (k = 0; k < 4; k++) {
+			T *d = dest[k] + i;
+
+			j = 0;
+#if BATCH_SSE
+			for (; j + 4 <= m; j += 4) {
+				_mm_storeu_ps(d + j, _mm_add_ps(
+					_mm_mul_ps(_mm_loadu_ps(p[k] + j),
+					           _mm_loadu_ps(s0 + j)),
+					_mm_mul_ps(_mm_loadu_ps(q[k] + j),
+					           _mm_loadu_ps(s1 + j))));
+			}
+#endif
+			for (; j < m; j++) {
+				d[j] = p[k][j]*s0[j] + q[k][j]*s1[j];
+			}
+		}
+	}
+}
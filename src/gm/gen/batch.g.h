@@ -0,0 +1,101 @@
+#ifndef GENERIC_H_INCLUDED
+#include "generic.h"
+#endif
+
+/*
+ * Batch versions of common matrix, vector and quaternion operations. Each
+ * function applies the same operation to n elements stored back to back.
+ * Functions with an "soa" suffix take one array per component (structure of
+ * arrays) instead of interleaved vectors (array of structures). Input and
+ * output arrays may not overlap, which lets the compiler vectorize the loops.
+ * Where SSE is available, the float functions on interleaved matrices and
+ * vectors, and v3normnsoa, use it.
+ */
+
+/* begin gm header */
+#undef m44mulv3n
+#define m44mulv3n MANGLE(m44mulv3n)
+/* Transform n 3x1 points in u, stored as [x y z x y z ...], with the 4x4
+   matrix a (w = 1, last row assumed to be [0 0 0 1]) and store in v */
+T *m44mulv3n(T v[restrict], T const a[restrict static 16], T const u[restrict],
+             size_t n);
+
+#undef m44mulv3nsoa
+#define m44mulv3nsoa MANGLE(m44mulv3nsoa)
+/* Same as m44mulv3n, but with each coordinate in a separate array */
+void m44mulv3nsoa(
+	T vx[restrict], T vy[restrict], T vz[restrict],
+	T const a[restrict static 16],
+	T const ux[restrict], T const uy[restrict], T const uz[restrict],
+	size_t n);
+
+#undef m44mulvn
+#define m44mulvn MANGLE(m44mulvn)
+/* Transform n 4x1 vectors in u with the 4x4 matrix a and store in v */
+T *m44mulvn(T v[restrict], T const a[restrict static 16], T const u[restrict],
+            size_t n);
+
+#undef m44mulmn
+#define m44mulmn MANGLE(m44mulmn)
+/* Multiply each of the n 4x4 matrices in c from the left by b, i.e.
+   a[i] = b*c[i], and return a */
+T *m44mulmn(T a[restrict], T const b[restrict static 16], T const c[restrict],
+            size_t n);
+
+#undef m44mulmnsoa
+#define m44mulmnsoa MANGLE(m44mulmnsoa)
+/* Same as m44mulmn, but with the n matrices in a and c in 16 arrays, one for
+   each element in column-major order, i.e. element k of c[i] is c[k][i] */
+void m44mulmnsoa(
+	T *const a[restrict static 16],
+	T const b[restrict static 16],
+	T const *const c[restrict static 16],
+	size_t n);
+
+#undef m44muln
+#define m44muln MANGLE(m44muln)
+/* Multiply n pairs of 4x4 matrices, a[i] = b[i]*c[i], and return a */
+T *m44muln(T a[restrict], T const b[restrict], T const c[restrict], size_t n);
+
+#undef m44mulnsoa
+#define m44mulnsoa MANGLE(m44mulnsoa)
+/* Same as m44muln, but with the matrices in 16 arrays each, like
+   m44mulmnsoa */
+void m44mulnsoa(
+	T *const a[restrict static 16],
+	T const *const b[restrict static 16],
+	T const *const c[restrict static 16],
+	size_t n);
+
+#undef v3normn
+#define v3normn MANGLE(v3normn)
+/* Normalize n 3-vectors in u and store in w. Null vectors are left as null
+   vectors. */
+T *v3normn(T w[restrict], T const u[restrict], size_t n);
+
+#undef v3normnsoa
+#define v3normnsoa MANGLE(v3normnsoa)
+/* Same as v3normn, but with each coordinate in a separate array */
+void v3normnsoa(
+	T wx[restrict], T wy[restrict], T wz[restrict],
+	T const ux[restrict], T const uy[restrict], T const uz[restrict],
+	size_t n);
+
+#undef qslerpn
+#define qslerpn MANGLE(qslerpn)
+/* Spherical linear interpolation of n quaternion pairs for time t, i.e.
+   dest[i] = qslerp(q0[i], q1[i], t). Falls back to linear interpolation when
+   the quaternions are (nearly) equal. */
+T *qslerpn(T dest[restrict], T const q0[restrict], T const q1[restrict], T t,
+           size_t n);
+
+#undef qslerpnsoa
+#define qslerpnsoa MANGLE(qslerpnsoa)
+/* Same as qslerpn, but with each component in a separate array */
+void qslerpnsoa(
+	T *const dest[restrict static 4],
+	T const *const q0[restrict static 4],
+	T const *const q1[restrict static 4],
+	T t,
+	size_t n);
+/* end gm header */
@@ -0,0 +1,2 @@
+
+#endif /* BATCH_H_INCLUDED */
@@ -91,3 +91,31 @@ mmul(T a[restrict static M*N], T const b [static M*N], T const c [static M*N])
 	a[3] = b[1]*c[2] + b[3]*c[3];
 	return a;
 }
+
+int misrot(T const a[static M*N])
+{
+	return fabsM(a[0]*a[0] + a[1]*a[1] - LIT(1.0)) <= EPSILON
+	    && fabsM(a[2]*a[2] + a[3]*a[3] - LIT(1.0)) <= EPSILON
+	    && fabsM(a[0]*a[2] + a[1]*a[3]) <= EPSILON;
+}
+
+T *minvrot(T dest[restrict static M*N], T const a[restrict static M*N])
+{
+	dest[0] = a[0];
+	dest[1] = a[2];
+	dest[2] = a[1];
+	dest[3] = a[3];
+	return dest;
+}
+
+T *minvaffine(
+	T dest[restrict static M*N],
+	T dest_t[restrict static 2],
+	T const a[restrict static M*N],
+	T const t[restrict static 2])
+{
+	(void)minv(dest, a);
+	dest_t[0] = -(dest[0]*t[0] + dest[2]*t[1]);
+	dest_t[1] = -(dest[1]*t[0] + dest[3]*t[1]);
+	return dest;
+}
@@ -36,4 +36,25 @@ T *mshearx(T a[static M*N], T s);
 #define msheary MAT(sheary)
 /* Transform vector u by a 2x2 matrix a and store in v and return it */
 T *msheary(T a[static M*N], T s);
+
+#undef misrot
+#define misrot MAT(isrot)
+/* Return non-zero if a is orthonormal (within some epsilon), i.e. a rotation
+   or reflection */
+int misrot(T const a[static M*N]);
+
+#undef minvrot
+#define minvrot MAT(invrot)
+/* Invert an orthonormal matrix (see misrot) by transposing it */
+T *minvrot(T dest[restrict static M*N], T const a[restrict static M*N]);
+
+#undef minvaffine
+#define minvaffine MAT(invaffine)
+/* Invert the 2D affine transformation x' = a*x + t, and store the inverse
+   matrix in dest and the inverse translation in dest_t */
+T *minvaffine(
+	T dest[restrict static M*N],
+	T dest_t[restrict static 2],
+	T const a[restrict static M*N],
+	T const t[restrict static 2]);
 /* end gm header */
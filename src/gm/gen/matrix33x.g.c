@@ -42,12 +42,17 @@ T mtrace(T const a[static M*N])
 
 T *minv(T dest[static M*N], T const A[static M*N])
 {
-	T det;
+	T adj[M*N], det;
 
 	det = mdet(A);
 	assert(det != LIT(0.));
 
-	return amuls(dest, M*N, mtranspose(dest, A), LIT(1.0)/det);
+	/* adjugate, i.e. the transposed cofactor matrix */
+	V3(cross)(adj + 0, A + 3, A + 6);
+	V3(cross)(adj + 3, A + 6, A + 0);
+	V3(cross)(adj + 6, A + 0, A + 3);
+
+	return amuls(dest, M*N, mtranspose(dest, adj), LIT(1.0)/det);
 }
 
 T * mpinv(T a[static M*N], T const b[static M*N])
@@ -137,3 +142,36 @@ mmul(T a[static M*N], T const b [static M*N], T const c [static M*N])
 	}
 	return a;
 }
+
+int misaffine(T const a[static M*N])
+{
+	return fabsM(a[2]) <= EPSILON
+	    && fabsM(a[5]) <= EPSILON
+	    && fabsM(a[8] - LIT(1.0)) <= EPSILON;
+}
+
+T *minvaffine(T dest[restrict static M*N], T const a[restrict static M*N])
+{
+#define A(row,col) a[(col*3)+row]
+#define D(row,col) dest[(col*3)+row]
+	T det, invdet;
+	T const t0 = A(0,2), t1 = A(1,2);
+
+	det = A(0,0)*A(1,1) - A(0,1)*A(1,0);
+	assert(det != LIT(0.));
+	invdet = LIT(1.0)/det;
+
+	D(0,0) = A(1,1) * invdet;
+	D(1,0) =-A(1,0) * invdet;
+	D(0,1) =-A(0,1) * invdet;
+	D(1,1) = A(0,0) * invdet;
+
+	D(0,2) = -(D(0,0)*t0 + D(0,1)*t1);
+	D(1,2) = -(D(1,0)*t0 + D(1,1)*t1);
+
+	D(2,0) = D(2,1) = LIT(0.0);
+	D(2,2) = LIT(1.0);
+#undef A
+#undef D
+	return dest;
+}
@@ -46,4 +46,16 @@ T *mmulv(T v[static N], T const b [static M*N], T const u [static N]);
 #define mquat MAT(quat)
 /* Initialize a rotation matrix from a quaternion */
 T *mquat(T dest[static M*N], T const q[4]);
+
+#undef misaffine
+#define misaffine MAT(isaffine)
+/* Return non-zero if the last row of a is [0 0 1] (within some epsilon),
+   i.e. if a represents a 2D affine transformation in homogeneous
+   coordinates */
+int misaffine(T const a[static M*N]);
+
+#undef minvaffine
+#define minvaffine MAT(invaffine)
+/* Invert a 2D affine transformation (see misaffine) */
+T *minvaffine(T dest[restrict static M*N], T const a[restrict static M*N]);
 /* end gm header */
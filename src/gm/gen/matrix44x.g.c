@@ -368,3 +368,83 @@ T *mquat(T dest[static M*N], T const q[static 4]) {
 
 	return dest;
 }
+
+int misaffine(T const a[static M*N])
+{
+	return fabsM(a[3]) <= EPSILON
+	    && fabsM(a[7]) <= EPSILON
+	    && fabsM(a[11]) <= EPSILON
+	    && fabsM(a[15] - LIT(1.0)) <= EPSILON;
+}
+
+int misrigid(T const a[static M*N])
+{
+	T const *x = a, *y = a + 4, *z = a + 8;
+
+	return misaffine(a)
+	    && fabsM(V3(dot)(x, x) - LIT(1.0)) <= EPSILON
+	    && fabsM(V3(dot)(y, y) - LIT(1.0)) <= EPSILON
+	    && fabsM(V3(dot)(z, z) - LIT(1.0)) <= EPSILON
+	    && fabsM(V3(dot)(x, y)) <= EPSILON
+	    && fabsM(V3(dot)(x, z)) <= EPSILON
+	    && fabsM(V3(dot)(y, z)) <= EPSILON;
+}
+
+T *minvaffine(T dest[restrict static M*N], T const a[restrict static M*N])
+{
+#define A(row,col) a[(col<<2)+row]
+#define D(row,col) dest[(col<<2)+row]
+	T c00, c01, c02, det, invdet;
+	T const t0 = A(0,3), t1 = A(1,3), t2 = A(2,3);
+
+	/* cofactors of the first column of the upper left 3x3 matrix */
+	c00 = A(1,1)*A(2,2) - A(1,2)*A(2,1);
+	c01 = A(1,2)*A(2,0) - A(1,0)*A(2,2);
+	c02 = A(1,0)*A(2,1) - A(1,1)*A(2,0);
+
+	det = A(0,0)*c00 + A(0,1)*c01 + A(0,2)*c02;
+	assert(det != LIT(0.));
+	invdet = LIT(1.0)/det;
+
+	/* inverse = transposed cofactor matrix / det */
+	D(0,0) = c00 * invdet;
+	D(1,0) = c01 * invdet;
+	D(2,0) = c02 * invdet;
+	D(0,1) = (A(0,2)*A(2,1) - A(0,1)*A(2,2)) * invdet;
+	D(1,1) = (A(0,0)*A(2,2) - A(0,2)*A(2,0)) * invdet;
+	D(2,1) = (A(0,1)*A(2,0) - A(0,0)*A(2,1)) * invdet;
+	D(0,2) = (A(0,1)*A(1,2) - A(0,2)*A(1,1)) * invdet;
+	D(1,2) = (A(0,2)*A(1,0) - A(0,0)*A(1,2)) * invdet;
+	D(2,2) = (A(0,0)*A(1,1) - A(0,1)*A(1,0)) * invdet;
+
+	/* translation = -(inverse * t) */
+	D(0,3) = -(D(0,0)*t0 + D(0,1)*t1 + D(0,2)*t2);
+	D(1,3) = -(D(1,0)*t0 + D(1,1)*t1 + D(1,2)*t2);
+	D(2,3) = -(D(2,0)*t0 + D(2,1)*t1 + D(2,2)*t2);
+
+	D(3,0) = D(3,1) = D(3,2) = LIT(0.0);
+	D(3,3) = LIT(1.0);
+#undef A
+#undef D
+	return dest;
+}
+
+T *minvrigid(T dest[restrict static M*N], T const a[restrict static M*N])
+{
+#define A(row,col) a[(col<<2)+row]
+#define D(row,col) dest[(col<<2)+row]
+	int i;
+	T const t0 = A(0,3), t1 = A(1,3), t2 = A(2,3);
+
+	for (i = 0; i < 3; i++) {
+		D(i,0) = A(0,i);
+		D(i,1) = A(1,i);
+		D(i,2) = A(2,i);
+		D(i,3) = -(A(0,i)*t0 + A(1,i)*t1 + A(2,i)*t2);
+	}
+	D(3,0) = D(3,1) = D(3,2) = LIT(0.0);
+	D(3,3) = LIT(1.0);
+#undef A
+#undef D
+	return dest;
+}
@@ -76,4 +76,29 @@ T *morthographic(T a[static M*N], T left, T right, T bottom, T top, T near, T fa
 #define mquat MAT(quat)
 /* Initialize a rotation matrix from a quaternion */
 T *mquat(T dest[static M*N], T const q[4]);
+
+#undef misaffine
+#define misaffine MAT(isaffine)
+/* Return non-zero if the last row of a is [0 0 0 1] (within some epsilon),
+   i.e. if a represents an affine transformation */
+int misaffine(T const a[static M*N]);
+
+#undef misrigid
+#define misrigid MAT(isrigid)
+/* Return non-zero if a is affine and its upper left 3x3 matrix is
+   orthonormal (within some epsilon), i.e. if a only rotates (or reflects)
+   and translates */
+int misrigid(T const a[static M*N]);
+
+#undef minvaffine
+#define minvaffine MAT(invaffine)
+/* Invert an affine transformation (see misaffine) by inverting the upper left
+   3x3 matrix and the translation separately */
+T *minvaffine(T dest[restrict static M*N], T const a[restrict static M*N]);
+
+#undef minvrigid
+#define minvrigid MAT(invrigid)
+/* Invert a rigid transformation (see misrigid) by transposing the rotation
+   and rotating the negated translation */
+T *minvrigid(T dest[restrict static M*N], T const a[restrict static M*N]);
 /* end gm header */
@@ -14,6 +14,12 @@
 #include "vector3x.g.h"
 #define V3(name) VECTOR_(v3,name)
 
+/* Restore quaternion names for the aliased vector functions */
+#undef L
+#define L 4
+#undef VECTOR_TAG
+#define VECTOR_TAG q
+
 T *qid(T dest[static 4])
 {
 	dest[0] = LIT(1.0);
@@ -83,6 +89,6 @@ T *qrot(T dest[static 3], T const u[static 3], T const q[static 4])
 	qconj(conj, q);
 	qmul(w, q, v);
 	qmul(v, w, conj);
-	return qcopy(dest, v + 1);
+	return V3(copy)(dest, v + 1);
 }
 
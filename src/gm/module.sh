@@ -80,11 +80,14 @@ do
   define_generic misc$S misc
   define_generic array$S array
   define_generic plane$S plane
+  define_generic batch$S batch
 
   define_ok_test matrix22$S test-gen/matrix.g.c -D'M=2' -D'N=2' $GENERIC_FLAGS
   define_ok_test matrix22x$S test-gen/matrix22x.g.c -D'M=2' -D'N=2' $GENERIC_FLAGS
+  define_ok_test matrix33x$S test-gen/matrix33x.g.c -D'M=3' -D'N=3' $GENERIC_FLAGS
   define_ok_test matrix44$S test-gen/matrix.g.c -D'M=4' -D'N=4' $GENERIC_FLAGS
   define_ok_test matrix44x$S test-gen/matrix44x.g.c -D'M=4' -D'N=4' $GENERIC_FLAGS
+  define_ok_test batch$S test-gen/batch.g.c $GENERIC_FLAGS
 done
 
 joined_header matrix matrix22 matrix22x matrix33 matrix33x matrix44 matrix44x
@@ -93,3 +96,4 @@ joined_header quaternion quaternion quaternionx
 joined_header misc misc
 joined_header array array
 joined_header plane plane
+joined_header batch batch
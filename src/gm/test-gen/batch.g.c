@@ -0,0 +1,255 @@
+#include <stdio.h>
+#include <stddef.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "ok/ok.h"
+#include "gm/matrix.h"
+#include "gm/vector.h"
+#include "gm/quaternion.h"
+#include "gm/array.h"
+#include "gm/misc.h"
+#include "../gen/generic.h"
+#include "../gen/batch.g.h"
+
+#define lengthof(arr) (sizeof (arr) / sizeof 0[arr])
+
+#define COUNT 37
+
+static T random_value(void)
+{
+	return (T)rand() / (T)RAND_MAX * LIT(20.0) - LIT(10.0);
+}
+
+static void random_values(T *dest, size_t n)
+{
+	size_t i;
+	for (i = 0; i < n; i++) {
+		dest[i] = random_value();
+	}
+}
+
+static void expect_nearly_equal(T const *a, T const *b, size_t n, char const *what)
+{
+	size_t i;
+	for (i = 0; i < n; i++) {
+		if (!MANGLE(fneareqe)(a[i], b[i], LIT(1e-4), LIT(1e-4))) {
+			printf("%s[%zu]: got "PFMTG", expected "PFMTG"\n",
+			       what, i, a[i], b[i]);
+			ok = -1;
+			return;
+		}
+	}
+}
+
+static T const affine[4*4] = {
+	LIT(0.0), LIT(2.0), LIT(0.0), LIT(0.0),
+	LIT(-1.0), LIT(0.0), LIT(0.0), LIT(0.0),
+	LIT(0.0), LIT(0.0), LIT(3.0), LIT(0.0),
+	LIT(5.0), LIT(-2.0), LIT(1.0), LIT(1.0),
+};
+
+int test_transform_points(void)
+{
+	T u[3*COUNT], v[3*COUNT], exp[3*COUNT];
+	size_t i;
+
+	random_values(u, lengthof(u));
+	for (i = 0; i < COUNT; i++) {
+		MANGLE(m44mulv3)(exp + 3*i, affine, u + 3*i);
+	}
+	(void)m44mulv3n(v, affine, u, COUNT);
+	expect_nearly_equal(v, exp, lengthof(exp), "aos");
+	return ok;
+}
+
+int test_transform_points_soa(void)
+{
+	T ux[COUNT], uy[COUNT], uz[COUNT], vx[COUNT], vy[COUNT], vz[COUNT];
+	T u[3], exp[3];
+	size_t i;
+
+	random_values(ux, COUNT);
+	random_values(uy, COUNT);
+	random_values(uz, COUNT);
+	m44mulv3nsoa(vx, vy, vz, affine, ux, uy, uz, COUNT);
+	for (i = 0; i < COUNT; i++) {
+		u[0] = ux[i], u[1] = uy[i], u[2] = uz[i];
+		MANGLE(m44mulv3)(exp, affine, u);
+		expect_nearly_equal(&vx[i], &exp[0], 1, "x");
+		expect_nearly_equal(&vy[i], &exp[1], 1, "y");
+		expect_nearly_equal(&vz[i], &exp[2], 1, "z");
+	}
+	return ok;
+}
+
+int test_transform_vectors(void)
+{
+	T u[4*COUNT], v[4*COUNT], exp[4*COUNT];
+	size_t i;
+
+	random_values(u, lengthof(u));
+	for (i = 0; i < COUNT; i++) {
+		MANGLE(m44mulv)(exp + 4*i, affine, u + 4*i);
+	}
+	(void)m44mulvn(v, affine, u, COUNT);
+	expect_nearly_equal(v, exp, lengthof(exp), "vec4");
+	return ok;
+}
+
+int test_multiply_matrices(void)
+{
+	T b[16*COUNT], c[16*COUNT], a[16*COUNT], exp[16*COUNT];
+	size_t i;
+
+	random_values(b, lengthof(b));
+	random_values(c, lengthof(c));
+
+	for (i = 0; i < COUNT; i++) {
+		MANGLE(m44mul)(exp + 16*i, b + 16*i, c + 16*i);
+	}
+	(void)m44muln(a, b, c, COUNT);
+	expect_nearly_equal(a, exp, lengthof(exp), "pairs");
+
+	for (i = 0; i < COUNT; i++) {
+		MANGLE(m44mul)(exp + 16*i, affine, c + 16*i);
+	}
+	(void)m44mulmn(a, affine, c, COUNT);
+	expect_nearly_equal(a, exp, lengthof(exp), "left");
+	return ok;
+}
+
+int test_multiply_matrices_soa(void)
+{
+	T b[16][COUNT], c[16][COUNT], a[16][COUNT], m[3][16], exp[16];
+	T const *bp[16], *cp[16];
+	T *ap[16];
+	size_t i;
+	int k;
+
+	for (k = 0; k < 16; k++) {
+		random_values(b[k], COUNT);
+		random_values(c[k], COUNT);
+		ap[k] = a[k], bp[k] = b[k], cp[k] = c[k];
+	}
+
+	m44mulnsoa(ap, bp, cp, COUNT);
+	for (i = 0; i < COUNT; i++) {
+		for (k = 0; k < 16; k++) {
+			m[0][k] = b[k][i], m[1][k] = c[k][i], m[2][k] = a[k][i];
+		}
+		MANGLE(m44mul)(exp, m[0], m[1]);
+		expect_nearly_equal(m[2], exp, 16, "pairs");
+	}
+
+	m44mulmnsoa(ap, affine, cp, COUNT);
+	for (i = 0; i < COUNT; i++) {
+		for (k = 0; k < 16; k++) {
+			m[1][k] = c[k][i], m[2][k] = a[k][i];
+		}
+		MANGLE(m44mul)(exp, affine, m[1]);
+		expect_nearly_equal(m[2], exp, 16, "left");
+	}
+	return ok;
+}
+
+int test_normalize(void)
+{
+	T u[3*COUNT], w[3*COUNT], exp[3*COUNT];
+	T ux[COUNT], uy[COUNT], uz[COUNT], wx[COUNT], wy[COUNT], wz[COUNT];
+	size_t i;
+
+	random_values(u, lengthof(u));
+	/* null vectors should stay null */
+	u[0] = u[1] = u[2] = LIT(0.0);
+	for (i = 0; i < COUNT; i++) {
+		if (MANGLE(v3trynorm)(exp + 3*i, u + 3*i)) {
+			MANGLE(v3zero)(exp + 3*i);
+		}
+		ux[i] = u[3*i + 0];
+		uy[i] = u[3*i + 1];
+		uz[i] = u[3*i + 2];
+	}
+	(void)v3normn(w, u, COUNT);
+	expect_nearly_equal(w, exp, lengthof(exp), "aos");
+
+	v3normnsoa(wx, wy, wz, ux, uy, uz, COUNT);
+	for (i = 0; i < COUNT; i++) {
+		expect_nearly_equal(&wx[i], &exp[3*i + 0], 1, "x");
+		expect_nearly_equal(&wy[i], &exp[3*i + 1], 1, "y");
+		expect_nearly_equal(&wz[i], &exp[3*i + 2], 1, "z");
+	}
+	return ok;
+}
+
+int test_slerp(void)
+{
+	T q0[4*COUNT], q1[4*COUNT], q[4*COUNT], exp[4*COUNT];
+	T axis[3], t;
+	size_t i;
+
+	for (i = 0; i < COUNT; i++) {
+		random_values(axis, 3);
+		MANGLE(v3norm)(axis, axis);
+		MANGLE(qaxisangle)(q0 + 4*i, random_value() / LIT(10.0), axis);
+		random_values(axis, 3);
+		MANGLE(v3norm)(axis, axis);
+		MANGLE(qaxisangle)(q1 + 4*i, random_value() / LIT(10.0), axis);
+	}
+	for (t = LIT(0.0); t <= LIT(1.0); t += LIT(0.25)) {
+		for (i = 0; i < COUNT; i++) {
+			MANGLE(qslerp)(exp + 4*i, q0 + 4*i, q1 + 4*i, t);
+		}
+		(void)qslerpn(q, q0, q1, t, COUNT);
+		expect_nearly_equal(q, exp, lengthof(exp), "slerp");
+	}
+
+	/* identical quaternions should not produce NaN */
+	(void)qslerpn(q, q0, q0, LIT(0.5), COUNT);
+	expect_nearly_equal(q, q0, lengthof(q), "identical");
+	return ok;
+}
+
+int test_slerp_soa(void)
+{
+	/* more than one block of quaternions */
+	enum { N = 3*COUNT };
+	T q0[4][N], q1[4][N], q[4][N], p[3][4], exp[4];
+	T const *q0p[4], *q1p[4];
+	T *qp[4];
+	T axis[3];
+	size_t i;
+	int k;
+
+	for (i = 0; i < N; i++) {
+		random_values(axis, 3);
+		MANGLE(v3norm)(axis, axis);
+		MANGLE(qaxisangle)(p[0], random_value() / LIT(10.0), axis);
+		random_values(axis, 3);
+		MANGLE(v3norm)(axis, axis);
+		MANGLE(qaxisangle)(p[1], random_value() / LIT(10.0), axis);
+		for (k = 0; k < 4; k++) {
+			q0[k][i] = p[0][k];
+			q1[k][i] = i % 5 ? p[1][k] : p[0][k];
+		}
+	}
+	for (k = 0; k < 4; k++) {
+		qp[k] = q[k], q0p[k] = q0[k], q1p[k] = q1[k];
+	}
+
+	qslerpnsoa(qp, q0p, q1p, LIT(0.25), N);
+	for (i = 0; i < N; i++) {
+		for (k = 0; k < 4; k++) {
+			p[0][k] = q0[k][i], p[1][k] = q1[k][i], p[2][k] = q[k][i];
+		}
+		if (i % 5) {
+			MANGLE(qslerp)(exp, p[0], p[1], LIT(0.25));
+			expect_nearly_equal(p[2], exp, 4, "slerp");
+		} else {
+			/* identical quaternions should not produce NaN */
+			expect_nearly_equal(p[2], p[0], 4, "identical");
+		}
+	}
+	return ok;
+}
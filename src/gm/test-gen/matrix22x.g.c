@@ -212,6 +212,42 @@ int test_invert_matrix(void)
 	return ok;
 }
 
+int test_rotation_inverse(void)
+{
+	T inv[2*2], exp[2*2];
+
+	if (!misrot(identity) || !misrot(rot_45)) {
+		fail_test("rotations should be orthonormal\n");
+	}
+	if (misrot(scale) || misrot(col_counted)) {
+		fail_test("non-rotations should not be orthonormal\n");
+	}
+
+	minvrot(inv, rot_45);
+	minv(exp, rot_45);
+	assert_equal(inv, exp, "rotation inverse vs general inverse");
+
+	return ok;
+}
+
+int test_affine_inverse(void)
+{
+	static const T t[2] = { LIT(3.0), LIT(-1.5) };
+	T inv[2*2], inv_t[2], x[2], y[2];
+
+	minvaffine(inv, inv_t, scale, t);
+
+	/* y = scale*x + t, then x = inv*y + inv_t */
+	x[0] = LIT(0.25);
+	x[1] = LIT(-7.0);
+	y[0] = scale[0]*x[0] + scale[2]*x[1] + t[0];
+	y[1] = scale[1]*x[0] + scale[3]*x[1] + t[1];
+	expect_equals(inv[0]*y[0] + inv[2]*y[1] + inv_t[0], x[0], "x");
+	expect_equals(inv[1]*y[0] + inv[3]*y[1] + inv_t[1], x[1], "y");
+
+	return ok;
+}
+
 int test_rotation_matrix(void)
 {
 	T mat[2*2];
@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "ok/ok.h"
+#include "gm/matrix.h"
+#include "../gen/generic.h"
+#include "../gen/matrix.g.h"
+#include "../gen/square-matrix.g.h"
+#include "../gen/matrix33x.g.h"
+#include "../gen/misc.g.h"
+
+#define lengthof(arr) (sizeof (arr) / sizeof 0[arr])
+
+static int assert_equale(
+	T const prod[static 9],
+	T const exp[static 9],
+	T reps,
+	T aeps,
+	const char *message)
+{
+	T diff[9];
+	if (!mneareqe(prod, exp, reps, aeps)) {
+		if (message) puts(message);
+		printf("Got:\n");
+		mprint(prod);
+
+		printf("Expected:\n");
+		mprint(exp);
+
+		printf("Difference:\n");
+		msube(diff, prod, exp);
+		mprint(diff);
+		ok = -1;
+		return -1;
+	} else {
+		return 0;
+	}
+}
+
+static int assert_equal(
+	T const prod[static 9],
+	T const exp[static 9],
+	const char *message)
+{
+	return assert_equale(prod, exp, EQ_REL_EPSILON, EQ_ABS_EPSILON, message);
+}
+
+static T const identity[3*3] = {
+	LIT(1.0), LIT(0.0), LIT(0.0),
+	LIT(0.0), LIT(1.0), LIT(0.0),
+	LIT(0.0), LIT(0.0), LIT(1.0)
+};
+
+/* a projective matrix with determinant 1, and its inverse */
+static T const projective[3*3] = {
+	LIT(1.0), LIT(0.0), LIT(5.0),
+	LIT(2.0), LIT(1.0), LIT(6.0),
+	LIT(3.0), LIT(4.0), LIT(0.0)
+};
+
+static T const projective_inv[3*3] = {
+	LIT(-24.0), LIT(20.0), LIT(-5.0),
+	LIT(18.0), LIT(-15.0), LIT(4.0),
+	LIT(5.0), LIT(-4.0), LIT(1.0)
+};
+
+/* scale, shear, and translate in 2D */
+static T const affine[3*3] = {
+	LIT(2.0), LIT(-1.0), LIT(0.0),
+	LIT(0.5), LIT(4.0), LIT(0.0),
+	LIT(3.0), LIT(-2.0), LIT(1.0)
+};
+
+int test_inverse(void)
+{
+	static const T (*invertible_matrices[])[3*3] = {
+		&identity,
+		&projective,
+		&affine
+	};
+
+	size_t i;
+	T inv[3*3], prod[3*3];
+	const T (*m)[3*3];
+
+	minv(inv, projective);
+	assert_equal(inv, projective_inv, "inverse of a known matrix");
+
+	for (i = 0; i < lengthof(invertible_matrices); i++) {
+		m = invertible_matrices[i];
+		minv(inv, *m);
+		mmul(prod, inv, *m);
+		assert_equal(prod, identity, "matrix x inverse");
+		mmul(prod, *m, inv);
+		assert_equal(prod, identity, "inverse x matrix");
+	}
+
+	return ok;
+}
+
+int test_classify_transform(void)
+{
+	if (!misaffine(identity) || !misaffine(affine)) {
+		fail_test("2D affine transformations should be affine\n");
+	}
+	if (misaffine(projective) || misaffine(projective_inv)) {
+		fail_test("projective matrices should not be affine\n");
+	}
+	return ok;
+}
+
+int test_affine_inverse(void)
+{
+	T inv[3*3], exp[3*3], prod[3*3];
+
+	minvaffine(inv, affine);
+	minv(exp, affine);
+	assert_equale(inv, exp, EPSILON, EPSILON, "affine inverse vs general inverse");
+	mmul(prod, inv, affine);
+	assert_equale(prod, identity, EPSILON, EPSILON, "matrix x affine inverse");
+
+	return ok;
+}
@@ -14,13 +14,15 @@
 
 #define lengthof(arr) (sizeof (arr) / sizeof 0[arr])
 
-static int assert_equal(
+static int assert_equale(
 	T const prod[static 16],
 	T const exp[static 16],
+	T reps,
+	T aeps,
 	const char *message)
 {
 	T diff[16];
-	if (!mneareq(prod, exp)) {
+	if (!mneareqe(prod, exp, reps, aeps)) {
 		if (message) puts(message);
 		printf("Got:\n");
 		mprint(prod);
@@ -38,6 +40,14 @@ static int assert_equal(
 	}
 }
 
+static int assert_equal(
+	T const prod[static 16],
+	T const exp[static 16],
+	const char *message)
+{
+	return assert_equale(prod, exp, EQ_REL_EPSILON, EQ_ABS_EPSILON, message);
+}
+
 static int vexpect_equalse(T val, T exp, T reps, T aeps, char const *fmt, va_list ap)
 {
 	if (!fneareqe(val, exp, reps, aeps)) {
@@ -233,6 +243,54 @@ int test_inverse(void)
 	return ok;
 }
 
+int test_classify_transform(void)
+{
+	T rigid[4*4], affine[4*4];
+
+	mmul(rigid, rot_y45, rot_z45);
+	rigid[12] = LIT(3.0);
+	rigid[13] = LIT(-2.0);
+	mmul(affine, rigid, scale);
+
+	if (!misaffine(identity) || !misrigid(identity)) {
+		fail_test("identity should be rigid\n");
+	}
+	if (!misaffine(rigid) || !misrigid(rigid)) {
+		fail_test("rotation and translation should be rigid\n");
+	}
+	if (!misaffine(affine) || misrigid(affine)) {
+		fail_test("scaled matrix should be affine but not rigid\n");
+	}
+	if (misaffine(col_counted) || misrigid(col_counted)) {
+		fail_test("projective matrix should not be affine\n");
+	}
+	return ok;
+}
+
+int test_affine_inverse(void)
+{
+	T m[4*4], t[4*4], inv[4*4], exp[4*4], prod[4*4];
+
+	mtranslate(t, LIT(1.0), LIT(-4.0), LIT(2.5));
+	mmul(prod, rot_y45, scale);
+	mmul(m, t, prod);
+
+	minvaffine(inv, m);
+	minv(exp, m);
+	assert_equale(inv, exp, EPSILON, EPSILON, "affine inverse vs general inverse");
+	mmul(prod, inv, m);
+	assert_equale(prod, identity, EPSILON, EPSILON, "matrix x affine inverse");
+
+	mmul(m, t, rot_z45);
+	minvrigid(inv, m);
+	minv(exp, m);
+	assert_equale(inv, exp, EPSILON, EPSILON, "rigid inverse vs general inverse");
+	mmul(prod, m, inv);
+	assert_equale(prod, identity, EPSILON, EPSILON, "rigid inverse x matrix");
+
+	return ok;
+}
+
 int test_pseudo_inverse(void)
 {
 	todo_test(0);
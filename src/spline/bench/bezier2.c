@@ -0,0 +1,74 @@
+/* Bézier evaluation benchmark. Evaluates points of a rational quadratic arc
+   one at a time and in batches, e.g.
+
+       target/bench/spline/bin/bezier2 [points]
+*/
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "tempo/tempo.h"
+#include "spline/bezier2.h"
+
+#include "bench.h"
+
+#define DEFAULT_POINTS 1000000
+#define BATCH_SIZE 1000
+
+static int run(size_t npoints)
+{
+	static float t[BATCH_SIZE], x[BATCH_SIZE], y[BATCH_SIZE];
+
+	float const arc[] = {
+		1.0f, 0.0f, 1.0f,
+		1.0f, 1.0f, 1.0/sqrt(2.0),
+		0.0f, 1.0f, 1.0f
+	};
+	struct bench_timer timer;
+	float p[2];
+	volatile float sink;
+	long usec[2];
+	size_t i, j, nbatches;
+
+	for (i = 0; i < BATCH_SIZE; i++) { t[i] = (float)i / BATCH_SIZE; }
+	nbatches = (npoints + BATCH_SIZE - 1) / BATCH_SIZE;
+
+	if (start_timer(&timer)) { return -1; }
+	for (i = 0; i < nbatches; i++) {
+		for (j = 0; j < BATCH_SIZE; j++) {
+			rbezier2(p, 2, arc, t[j]);
+			sink = p[0];
+		}
+	}
+	usec[0] = stop_timer(&timer);
+	if (start_timer(&timer)) { return -1; }
+	for (i = 0; i < nbatches; i++) {
+		rbezier2_n(x, y, arc, t, BATCH_SIZE);
+		sink = x[0];
+	}
+	usec[1] = stop_timer(&timer);
+	(void)sink;
+
+	printf("%zu points, one at a time: %.2f ms\n",
+	       nbatches * BATCH_SIZE, usec[0] * 1e-3);
+	printf("%zu points, in batches:    %.2f ms\n",
+	       nbatches * BATCH_SIZE, usec[1] * 1e-3);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t npoints;
+
+	npoints = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_POINTS;
+	if (argc > 2 || npoints == 0) {
+		fprintf(stderr, "usage: %s [points]\n", argv[0]);
+		return 2;
+	}
+	if (run(npoints)) {
+		fprintf(stderr, "%s: benchmark failed\n", argv[0]);
+		return 1;
+	}
+	return 0;
+}
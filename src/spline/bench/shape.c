@@ -0,0 +1,109 @@
+/* Shape simplification benchmark. Simplifies a shape made of a grid of
+   circles, which do not overlap, so the time is that of finding that no
+   outline intersects another, e.g.
+
+       target/bench/spline/bin/shape [circles per row]
+*/
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "tempo/tempo.h"
+#include "spline/shape.h"
+
+#include "bench.h"
+
+#define DEFAULT_GRID 100
+
+/* arcs through (x, y) +/- r, rotated by `a` radians */
+static void make_circle(
+	struct spline_segment dest[4],
+	float x,
+	float y,
+	float r,
+	float a)
+{
+	static float const unit[4][4] = {
+		{ 0.f, 1.f, 1.f, 1.f },
+		{ 1.f, 0.f, 1.f,-1.f },
+		{ 0.f,-1.f,-1.f,-1.f },
+		{-1.f, 0.f,-1.f, 1.f }
+	};
+	float c, s;
+	size_t i;
+
+	c = r * cosf(a);
+	s = r * sinf(a);
+	for (i = 0; i < 4; i++) {
+		dest[i].end[0] = x + c * unit[i][0] - s * unit[i][1];
+		dest[i].end[1] = y + s * unit[i][0] + c * unit[i][1];
+		dest[i].mid[0] = x + c * unit[i][2] - s * unit[i][3];
+		dest[i].mid[1] = y + s * unit[i][2] + c * unit[i][3];
+		dest[i].weight = 1.f;
+	}
+}
+
+static int run(size_t grid)
+{
+	struct spline_segment (*segments)[4];
+	struct spline_outline *outlines;
+	struct spline_shape s, *simplified;
+	struct bench_timer timer;
+	long usec;
+	size_t i, n, nseg;
+
+	n = grid * grid;
+	segments = malloc(n * sizeof *segments);
+	outlines = malloc(n * sizeof *outlines);
+	if (!segments || !outlines) {
+		free(segments);
+		free(outlines);
+		return -1;
+	}
+	for (i = 0; i < n; i++) {
+		make_circle(segments[i],
+			(float)(i % grid),
+			(float)(i / grid),
+			0.4f,
+			0.3f);
+		outlines[i].n = 4;
+		outlines[i].segments = segments[i];
+	}
+	s.n = n;
+	s.outlines = outlines;
+	if (start_timer(&timer)) {
+		free(outlines);
+		free(segments);
+		return -1;
+	}
+	simplified = spline_simplify_shape(&s);
+	usec = stop_timer(&timer);
+
+	for (nseg = i = 0; simplified && i < simplified->n; i++) {
+		nseg += simplified->outlines[i].n;
+	}
+	spline_free_shape(simplified);
+	free(outlines);
+	free(segments);
+	if (nseg != n * 4) { return -1; }
+	printf("%zu outlines, %zu segments: %.2f ms\n",
+	       n, n * 4, usec * 1e-3);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t grid;
+
+	grid = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_GRID;
+	if (argc > 2 || grid == 0) {
+		fprintf(stderr, "usage: %s [circles per row]\n", argv[0]);
+		return 2;
+	}
+	if (run(grid)) {
+		fprintf(stderr, "%s: benchmark failed\n", argv[0]);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,192 @@
+/* Delaunay triangulation benchmark. Triangulates one large set of random
+   points, and then many small sets one at a time, both with a new
+   triangulation for each set and with a reused workspace. Then it compares
+   inserting points one at a time to triangulating them from scratch, and
+   times adding and removing short constraints, e.g.
+
+       target/bench/spline/bin/triangulate [points [sets]]
+*/
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "tempo/tempo.h"
+#include "spline/triangulate.h"
+
+#include "bench.h"
+
+#define DEFAULT_POINTS 1000000
+#define DEFAULT_SETS 10000
+#define SET_POINTS 64
+#define LOCAL_POINTS 20000
+#define LOCAL_EDITS 1000
+
+static void random_points(float (*v)[2], size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		v[i][0] = frand(0.f, 1000.f);
+		v[i][1] = frand(0.f, 1000.f);
+	}
+}
+
+static int run_large(size_t n)
+{
+	float (*v)[2];
+	struct triangle_set *t;
+	struct bench_timer timer;
+	long usec;
+
+	if (v = malloc(n * sizeof *v), !v) { return -1; }
+	random_points(v, n);
+	if (start_timer(&timer)) { return free(v), -1; }
+	t = triangle_set_triangulate((float const (*)[2])v, n, NULL, 0);
+	usec = stop_timer(&timer);
+	free(v);
+	if (!t) { return -1; }
+	printf("%zu points, %zu triangles: %.1f ms (%.0f ns per point)\n",
+	       n, t->n, usec * 1e-3, usec * 1e3 / n);
+	triangle_set_free(t);
+	return 0;
+}
+
+static int run_small(size_t nsets)
+{
+	float (*v)[2];
+	struct triangle_workspace *w;
+	struct triangle_set *t;
+	struct bench_timer timer;
+	long usec[2];
+	size_t i, ntris;
+	int result;
+
+	v = malloc(nsets * SET_POINTS * sizeof *v);
+	w = triangle_workspace_make();
+	if (!v || !w) {
+		free(v);
+		triangle_workspace_free(w);
+		return -1;
+	}
+	random_points(v, nsets * SET_POINTS);
+
+	ntris = 0;
+	result = start_timer(&timer);
+	for (i = 0; !result && i < nsets; i++) {
+		t = triangle_set_triangulate(
+			(float const (*)[2])(v + i * SET_POINTS),
+			SET_POINTS, NULL, 0);
+		if (!t) { result = -1; break; }
+		ntris += t->n;
+		triangle_set_free(t);
+	}
+	if (!result) {
+		usec[0] = stop_timer(&timer);
+		result = start_timer(&timer);
+	}
+	for (i = 0; !result && i < nsets; i++) {
+		t = triangle_workspace_triangulate(
+			w, (float const (*)[2])(v + i * SET_POINTS),
+			SET_POINTS, NULL, 0);
+		if (!t) { result = -1; break; }
+		ntris -= t->n;
+	}
+	if (!result) { usec[1] = stop_timer(&timer); }
+	free(v);
+	triangle_workspace_free(w);
+	if (result || ntris != 0) { return -1; }
+
+	printf("%zu sets of %d points, new:       %.1f ms\n",
+	       nsets, SET_POINTS, usec[0] * 1e-3);
+	printf("%zu sets of %d points, workspace: %.1f ms\n",
+	       nsets, SET_POINTS, usec[1] * 1e-3);
+	return 0;
+}
+
+static int run_local(void)
+{
+	static float const bounds[] = { 0.f, 0.f, 1.f, 1.f };
+
+	float (*v)[2];
+	struct triangulation *t;
+	struct triangle_set *triangles;
+	struct bench_timer timer;
+	long usec[3];
+	size_t i, a, b, nedit;
+	int result;
+
+	v = malloc(LOCAL_POINTS * sizeof *v);
+	t = triangulation_make(bounds);
+	if (!v || !t) {
+		free(v);
+		if (t) { triangulation_free(t); }
+		return -1;
+	}
+	for (i = 0; i < LOCAL_POINTS; i++) {
+		v[i][0] = frand(0.f, 1.f);
+		v[i][1] = frand(0.f, 1.f);
+	}
+
+	result = start_timer(&timer);
+	for (i = 0; !result && i < LOCAL_POINTS; i++) {
+		if (triangulation_insert_point(t, v[i]) != (long)i) {
+			result = -1;
+		}
+	}
+	if (!result) {
+		usec[0] = stop_timer(&timer);
+		result = start_timer(&timer);
+	}
+	if (!result) {
+		triangles = triangle_set_triangulate(
+			(float const (*)[2])v, LOCAL_POINTS, NULL, 0);
+		usec[1] = stop_timer(&timer);
+		if (!triangles) { result = -1; }
+		triangle_set_free(triangles);
+	}
+	if (!result) { result = start_timer(&timer); }
+
+	/* add and remove short constraints, like edits of a small part */
+	for (nedit = 0; !result && nedit < LOCAL_EDITS; nedit++) {
+		do {
+			a = rand() % LOCAL_POINTS;
+			b = rand() % LOCAL_POINTS;
+		} while (fabsf(v[a][0] - v[b][0]) > .05f ||
+		         fabsf(v[a][1] - v[b][1]) > .05f);
+		if (triangulation_insert_edge(t, a, b) ||
+		    triangulation_remove_edge(t, a, b)) {
+			result = -1;
+		}
+	}
+	if (!result) { usec[2] = stop_timer(&timer); }
+	triangulation_free(t);
+	free(v);
+	if (result) { return -1; }
+
+	printf("%d points, incremental:  %.2f ms\n",
+	       LOCAL_POINTS, usec[0] * 1e-3);
+	printf("%d points, from scratch: %.2f ms\n",
+	       LOCAL_POINTS, usec[1] * 1e-3);
+	printf("%d constraint edits: %.3f ms each\n",
+	       LOCAL_EDITS, usec[2] * 1e-3 / LOCAL_EDITS);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t npoints, nsets;
+
+	npoints = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_POINTS;
+	nsets = argc > 2 ? strtoul(argv[2], NULL, 10) : DEFAULT_SETS;
+	if (argc > 3 || npoints < 3 || nsets == 0) {
+		fprintf(stderr, "usage: %s [points [sets]]\n", argv[0]);
+		return 2;
+	}
+	srand(1);
+	if (run_large(npoints) || run_small(nsets) || run_local()) {
+		fprintf(stderr, "%s: benchmark failed\n", argv[0]);
+		return 1;
+	}
+	return 0;
+}
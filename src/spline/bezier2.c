@@ -104,3 +104,166 @@ float rbezier2_norm_w1(float w0, float w1, float w2)
 {
 	return sqrtf((w1*w1)/(w0*w2));
 }
+
+/* The batch functions below evaluate points in single precision without
+   branches in their loops, so that a compiler can evaluate several at a
+   time with vector instructions. */
+
+void bezier2_n(
+	float *restrict x,
+	float *restrict y,
+	float const *p,
+	float const *restrict t,
+	size_t n)
+{
+	float x0, y0, x1, y1, x2, y2, u, s;
+	size_t i;
+
+	x0 = p[0]; y0 = p[1];
+	x1 = p[2]; y1 = p[3];
+	x2 = p[4]; y2 = p[5];
+	for (i = 0; i < n; i++) {
+		u = t[i];
+		s = 1.f - u;
+		x[i] = s*s*x0 + 2.f*s*u*x1 + u*u*x2;
+		y[i] = s*s*y0 + 2.f*s*u*y1 + u*u*y2;
+	}
+}
+
+void rbezier2_n(
+	float *restrict x,
+	float *restrict y,
+	float const *p,
+	float const *restrict t,
+	size_t n)
+{
+	float x0, y0, w0, x1, y1, w1, x2, y2, w2, u, s, a0, a1, a2, z;
+	size_t i;
+
+	x0 = p[0]; y0 = p[1]; w0 = p[2];
+	x1 = p[3]; y1 = p[4]; w1 = p[5];
+	x2 = p[6]; y2 = p[7]; w2 = p[8];
+	for (i = 0; i < n; i++) {
+		u = t[i];
+		s = 1.f - u;
+		a0 = w0*s*s;
+		a1 = w1*2.f*s*u;
+		a2 = w2*u*u;
+		z = 1.f / (a0 + a1 + a2);
+		x[i] = (a0*x0 + a1*x1 + a2*x2) * z;
+		y[i] = (a0*y0 + a1*y1 + a2*y2) * z;
+	}
+}
+
+void rbezier2_set_eval(
+	float *restrict x,
+	float *restrict y,
+	struct rbezier2_set const *set,
+	float const *restrict t,
+	size_t n)
+{
+	float const *restrict x0 = set->x0, *restrict y0 = set->y0;
+	float const *restrict x1 = set->x1, *restrict y1 = set->y1;
+	float const *restrict x2 = set->x2, *restrict y2 = set->y2;
+	float const *restrict w = set->w;
+	float u, s, a0, a1, a2, z;
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		u = t[i];
+		s = 1.f - u;
+		a0 = s*s;
+		a1 = w[i]*2.f*s*u;
+		a2 = u*u;
+		z = 1.f / (a0 + a1 + a2);
+		x[i] = (a0*x0[i] + a1*x1[i] + a2*x2[i]) * z;
+		y[i] = (a0*y0[i] + a1*y1[i] + a2*y2[i]) * z;
+	}
+}
+
+/* deepest subdivision when flattening, i.e. at most 2^16 lines per curve */
+#define MAX_FLATTEN_DEPTH 16
+
+/* A curve in standard form, with weights { 1, w, 1 }. The point at t = 1/2 is
+   the one furthest from the chord, at w / (1 + w) of the distance from the
+   chord to the control point. */
+struct conic
+{
+	double p0[2], p1[2], p2[2], w;
+	int depth;
+};
+
+static double chord_distance(struct conic const *c)
+{
+	double dx, dy, len;
+
+	dx = c->p2[0] - c->p0[0];
+	dy = c->p2[1] - c->p0[1];
+	len = sqrt(dx*dx + dy*dy);
+	if (len == 0.0) {
+		dx = c->p1[0] - c->p0[0];
+		dy = c->p1[1] - c->p0[1];
+		return sqrt(dx*dx + dy*dy);
+	}
+	return fabs((c->p1[0] - c->p0[0])*dy - (c->p1[1] - c->p0[1])*dx) / len;
+}
+
+/* split c at t = 1/2 into its first half, and the second half in d */
+static void halve_conic(struct conic *c, struct conic *d)
+{
+	double w, m[2];
+	int i;
+
+	w = c->w;
+	for (i = 0; i < 2; i++) {
+		m[i] = (c->p0[i] + 2.0*w*c->p1[i] + c->p2[i]) / (2.0 + 2.0*w);
+		d->p2[i] = c->p2[i];
+		d->p1[i] = (w*c->p1[i] + c->p2[i]) / (1.0 + w);
+		c->p1[i] = (c->p0[i] + w*c->p1[i]) / (1.0 + w);
+		c->p2[i] = d->p0[i] = m[i];
+	}
+	c->w = d->w = sqrt((1.0 + w) / 2.0);
+	c->depth = d->depth = c->depth + 1;
+}
+
+size_t rbezier2_flatten(
+	float (*dest)[2],
+	size_t max,
+	float const *p,
+	float tolerance)
+{
+	struct conic stack[MAX_FLATTEN_DEPTH + 1], *c;
+	size_t n, top;
+	int i;
+
+	c = stack;
+	for (i = 0; i < 2; i++) {
+		c->p0[i] = p[i];
+		c->p1[i] = p[3 + i];
+		c->p2[i] = p[6 + i];
+	}
+	c->w = p[5] > 0.f ? rbezier2_norm_w1(p[2], p[5], p[8]) : 0.0;
+	c->depth = 0;
+
+	/* depth-first with the first half on top, so that the points come in
+	   order */
+	n = 0;
+	top = 1;
+	while (top > 0) {
+		c = stack + top - 1;
+		if (c->depth < MAX_FLATTEN_DEPTH &&
+		    c->w / (1.0 + c->w) * chord_distance(c) > tolerance) {
+			c[1] = c[0];
+			halve_conic(c + 1, c);
+			top++;
+		} else {
+			if (n < max) {
+				dest[n][0] = c->p2[0];
+				dest[n][1] = c->p2[1];
+			}
+			n++;
+			top--;
+		}
+	}
+	return n;
+}
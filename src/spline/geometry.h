@@ -28,11 +28,83 @@ static inline double line2d_dist(struct line2d l, float2 p)
 	return X[l.n]*X[p] + Y[l.n]*Y[p] + l.c;
 }
 
+/* relative rounding error of a double, 2^-53 */
+#define HALF_ULP 1.1102230246251565e-16
+
+/* error bounds of the floating-point approximations of the predicates */
+#define CCW_BOUND ((3.0 + 16.0 * HALF_ULP) * HALF_ULP)
+#define ICC_BOUND ((10.0 + 96.0 * HALF_ULP) * HALF_ULP)
+
+/* Exact evaluation of the predicates below, for when the sign of the
+   approximation can not be trusted. */
+double orient2d_exact(float2 a, float2 b, float2 c);
+double incircle_exact(float2 a, float2 b, float2 c, float2 d);
+
+/* Exact orientation of three points: positive if a, b, and c are in
+   counterclockwise order, negative if clockwise, and zero if co-linear. The
+   magnitude is only approximately twice the area of the triangle. */
+static inline double orient2d(float2 a, float2 b, float2 c)
+{
+	double left, right, det, sum;
+
+	left = ((double)X[a] - X[c]) * ((double)Y[b] - Y[c]);
+	right = ((double)Y[a] - Y[c]) * ((double)X[b] - X[c]);
+	det = left - right;
+	/* the sign is right when the products have different signs */
+	if (left > 0.0) {
+		if (right <= 0.0) { return det; }
+		sum = left + right;
+	} else if (left < 0.0) {
+		if (right >= 0.0) { return det; }
+		sum = -left - right;
+	} else {
+		return det;
+	}
+	if (det >= CCW_BOUND * sum || -det >= CCW_BOUND * sum) { return det; }
+	return orient2d_exact(a, b, c);
+}
+
+/* Exact position of d relative to the circle through the counterclockwise
+   points a, b, and c: positive inside, negative outside, and zero on it. */
+static inline double incircle(float2 a, float2 b, float2 c, float2 d)
+{
+	double adx, ady, bdx, bdy, cdx, cdy;
+	double bc, cb, ca, ac, ab, ba;
+	double alift, blift, clift, det, permanent;
+
+	adx = (double)X[a] - X[d];
+	bdx = (double)X[b] - X[d];
+	cdx = (double)X[c] - X[d];
+	ady = (double)Y[a] - Y[d];
+	bdy = (double)Y[b] - Y[d];
+	cdy = (double)Y[c] - Y[d];
+
+	bc = bdx * cdy;
+	cb = cdx * bdy;
+	ca = cdx * ady;
+	ac = adx * cdy;
+	ab = adx * bdy;
+	ba = bdx * ady;
+	alift = adx * adx + ady * ady;
+	blift = bdx * bdx + bdy * bdy;
+	clift = cdx * cdx + cdy * cdy;
+
+	det = alift * (bc - cb) + blift * (ca - ac) + clift * (ab - ba);
+	/* sum of the magnitudes of the terms, without fabs from <math.h> */
+	permanent = ((bc < 0.0 ? -bc : bc) + (cb < 0.0 ? -cb : cb)) * alift
+	          + ((ca < 0.0 ? -ca : ca) + (ac < 0.0 ? -ac : ac)) * blift
+	          + ((ab < 0.0 ? -ab : ab) + (ba < 0.0 ? -ba : ba)) * clift;
+	if (det > ICC_BOUND * permanent || -det > ICC_BOUND * permanent) {
+		return det;
+	}
+	return incircle_exact(a, b, c, d);
+}
+
 static inline bool is_ccw(float2 a, float2 b, float2 c)
 {
 	/* counterclockwise 2D points if on the "left" side of the line going
 	   from b to c */
-	return line2d_det(a, b, c) > EPSILON;
+	return orient2d(a, b, c) > 0.0;
 }
 
 float *line2d_intersect(float *dest, struct line2d l0, struct line2d l1);
@@ -1,4 +1,4 @@
-require base gm adt
+require base gm adt tempo
 LDLIBS="-lm"
 
 define_ok_test test/bezier2.c
@@ -6,4 +6,9 @@ define_ok_test test/geometry.c
 define_ok_test test/quadedge.c
 define_ok_test test/segment.c
 define_ok_test test/shape.c
+define_ok_test test/stroke.c
 define_ok_test test/triangulate.c
+
+define_utility -c bench bench/bezier2.c
+define_utility -c bench bench/shape.c
+define_utility -c bench bench/triangulate.c
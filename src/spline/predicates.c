@@ -0,0 +1,152 @@
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "geometry.h"
+
+/* Orientation and in-circle tests after Shewchuk (1997), "Adaptive Precision
+   Floating-Point Arithmetic and Fast Robust Geometric Predicates". A plain
+   floating-point approximation is used when its error bound shows that its
+   sign is right, and otherwise the determinant is evaluated exactly as an
+   expansion: a sum of non-overlapping doubles ordered by magnitude, where the
+   sign of the largest component is the sign of the sum. The approximations
+   are inlined in geometry.h and only the exact fallbacks live here. */
+
+/* 2^ceil(p / 2) + 1 for the p = 53 bit mantissa of a double */
+#define SPLITTER 134217729.0
+
+/* x + y = a + b exactly, where x is the rounded sum */
+static void two_sum(double a, double b, double *x, double *y)
+{
+	double av, bv;
+
+	*x = a + b;
+	bv = *x - a;
+	av = *x - bv;
+	*y = (a - av) + (b - bv);
+}
+
+/* hi + lo = a, where both halves have at most 26 significant bits */
+static void split(double a, double *hi, double *lo)
+{
+	double c, big;
+
+	c = SPLITTER * a;
+	big = c - a;
+	*hi = c - big;
+	*lo = a - *hi;
+}
+
+/* x + y = a * b exactly, where x is the rounded product */
+static void two_product(double a, double b, double *x, double *y)
+{
+	double ahi, alo, bhi, blo, err;
+
+	*x = a * b;
+	split(a, &ahi, &alo);
+	split(b, &bhi, &blo);
+	err = *x - ahi * bhi;
+	err -= alo * bhi;
+	err -= ahi * blo;
+	*y = alo * blo - err;
+}
+
+/* Add b to the expansion e of n components and store the result in h, which
+   has room for n + 1 components and might be e. Return the length of h. */
+static size_t grow_expansion(size_t n, double const *e, double b, double *h)
+{
+	double q, hh;
+	size_t i, m;
+
+	q = b;
+	for (i = 0, m = 0; i < n; i++) {
+		two_sum(q, e[i], &q, &hh);
+		if (hh != 0.0) { h[m++] = hh; }
+	}
+	if (q != 0.0 || m == 0) { h[m++] = q; }
+	return m;
+}
+
+/* Multiply the expansion e of n components by b and store the result in h,
+   which has room for 2n components. Return the length of h. */
+static size_t scale_expansion(size_t n, double const *e, double b, double *h)
+{
+	double q, hh, sum, p1, p0;
+	size_t i, m;
+
+	m = 0;
+	two_product(e[0], b, &q, &hh);
+	if (hh != 0.0) { h[m++] = hh; }
+	for (i = 1; i < n; i++) {
+		two_product(e[i], b, &p1, &p0);
+		two_sum(q, p0, &sum, &hh);
+		if (hh != 0.0) { h[m++] = hh; }
+		two_sum(p1, sum, &q, &hh);
+		if (hh != 0.0) { h[m++] = hh; }
+	}
+	if (q != 0.0 || m == 0) { h[m++] = q; }
+	return m;
+}
+
+/* The determinant as an expansion of at most six components. Products of
+   single precision coordinates are exact in double precision. */
+static size_t orient2d_expansion(float2 a, float2 b, float2 c, double *h)
+{
+	double const terms[6] = {
+		(double)X[a] * Y[b], -(double)X[a] * Y[c],
+		(double)X[b] * Y[c], -(double)X[b] * Y[a],
+		(double)X[c] * Y[a], -(double)X[c] * Y[b]
+	};
+	size_t i, n;
+
+	for (i = 0, n = 0; i < 6; i++) { n = grow_expansion(n, h, terms[i], h); }
+	return n;
+}
+
+double orient2d_exact(float2 a, float2 b, float2 c)
+{
+	double e[6];
+
+	return e[orient2d_expansion(a, b, c, e) - 1];
+}
+
+/* add sign * (X[p]^2 + Y[p]^2) * e to the expansion h of n components */
+static size_t add_lifted(
+	size_t n,
+	double *h,
+	double sign,
+	float2 p,
+	size_t m,
+	double const *e)
+{
+	double lift[2], product[12];
+	size_t i, j, nlift, nproduct;
+
+	nlift = grow_expansion(0, NULL, sign * X[p] * X[p], lift);
+	nlift = grow_expansion(nlift, lift, sign * Y[p] * Y[p], lift);
+	for (i = 0; i < nlift; i++) {
+		nproduct = scale_expansion(m, e, lift[i], product);
+		for (j = 0; j < nproduct; j++) {
+			n = grow_expansion(n, h, product[j], h);
+		}
+	}
+	return n;
+}
+
+/* expand the 4x4 determinant with rows (x, y, x^2 + y^2, 1) along the lifted
+   column */
+double incircle_exact(float2 a, float2 b, float2 c, float2 d)
+{
+	double e[6], h[4 * 2 * 12];
+	size_t m, n;
+
+	n = 0;
+	m = orient2d_expansion(b, c, d, e);
+	n = add_lifted(n, h, 1.0, a, m, e);
+	m = orient2d_expansion(a, c, d, e);
+	n = add_lifted(n, h, -1.0, b, m, e);
+	m = orient2d_expansion(a, b, d, e);
+	n = add_lifted(n, h, 1.0, c, m, e);
+	m = orient2d_expansion(a, b, c, e);
+	n = add_lifted(n, h, -1.0, d, m, e);
+	return h[n - 1];
+}
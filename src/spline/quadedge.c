@@ -2,49 +2,81 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include "base/wbuf.h"
 
 #include "geometry.h"
 #include "quadedge.h"
 
-typedef eref quadedge[4];
+#define EDGE_ALIGN 64
 
 void init_eset(struct eset *set)
 {
 	wbuf_init(&set->edges);
-	wbuf_init(&set->data);
 	set->free = -1;
 }
 
 eref eset_max_edge(struct eset *set)
 {
-	return wbuf_nmemb(&set->edges, sizeof (quadedge));
+	return wbuf_nmemb(&set->edges, sizeof (struct quadedge));
 }
 
 void term_eset(struct eset *set)
 {
 	wbuf_term(&set->edges);
-	wbuf_term(&set->data);
 }
 
-void init_quadedge(eref *qe, float2 **data, eref e0)
+/* Make room for `size` more bytes of records. The records are kept 64-byte
+   aligned, so that two 32-byte records fill each cache line. Reallocating the
+   wbuf would not keep that alignment, so the set grows the block itself and
+   only allocates from it with the static wbuf functions. */
+static int eset_grow(struct eset *set, size_t size)
 {
-	qe[e0 + 0] = mkref(e0, 0);
-	qe[e0 + 1] = mkref(e0, 3);
-	qe[e0 + 2] = mkref(e0, 2);
-	qe[e0 + 3] = mkref(e0, 1);
+	size_t used, capacity;
+	void *p;
+
+	if (wbuf_available(&set->edges) >= size) { return 0; }
+	used = wbuf_size(&set->edges);
+	capacity = wbuf_capacity(&set->edges) * 2;
+	if (capacity < used + size) { capacity = used + size; }
+	capacity = (capacity + EDGE_ALIGN - 1) & ~(size_t)(EDGE_ALIGN - 1);
+	if (p = aligned_alloc(EDGE_ALIGN, capacity), !p) { return -1; }
+	if (used > 0) { (void)memcpy(p, set->edges.begin, used); }
+	wbuf_term(&set->edges);
+	wbuf_init_buffer(&set->edges, p, capacity);
+	(void)wbuf_salloc(&set->edges, used);
+	return 0;
+}
+
+int eset_reserve(struct eset *set, size_t n)
+{
+	return eset_grow(set, n * sizeof (struct quadedge));
+}
+
+void eset_clear(struct eset *set)
+{
+	wbuf_rewind(&set->edges);
+	set->free = -1;
+}
 
-	data[e0 >> 1] = 0;
-	data[(e0 >> 1) + 1] = 0;
+void init_quadedge(struct quadedge *qe, eref e0)
+{
+	qe->next[0] = mkref(e0, 0);
+	qe->next[1] = mkref(e0, 3);
+	qe->next[2] = mkref(e0, 2);
+	qe->next[3] = mkref(e0, 1);
+
+	qe->data[0] = 0;
+	qe->data[1] = 0;
 }
 
 /* allocate *n* empty subdivisions (edges) and store references (eref) in the
    *n* following arguments */
 int eset_alloc(struct eset *set, size_t n, ...)
 {
-	eref *alloc, *p, *edges, e0;
-	float2 **data;
+	struct quadedge *alloc, *edges;
+	eref e0;
 	size_t i, j, nfree;
 	va_list ap;
 
@@ -53,51 +85,49 @@ int eset_alloc(struct eset *set, size_t n, ...)
 	edges = set->edges.begin;
 	nfree = 0;
 	while (e0 >= 0 && nfree < n) {
-		e0 = edges[e0];
+		e0 = edges[e0 >> 2].next[0];
 		nfree++;
 	}
 	/* allocate the rest */
-	alloc = wbuf_alloc(&set->edges, (n - nfree) * sizeof (quadedge));
-	if (!alloc) { return -1; }
-	if (!wbuf_alloc(&set->data, (n - nfree) * sizeof (float2 *[2]))) {
-		return -1;
-	}
+	if (eset_grow(set, (n - nfree) * sizeof *alloc)) { return -1; }
+	alloc = wbuf_salloc(&set->edges, (n - nfree) * sizeof *alloc);
 	edges = set->edges.begin;
-	data = set->data.begin;
 
 	va_start(ap, n);
 	for (i = 0, j = 0; i < n; i++) {
 		if (j < nfree) {
 			e0 = set->free;
-			set->free = edges[e0];
-			p = edges + e0;
+			set->free = edges[e0 >> 2].next[0];
 			j++;
 		} else {
-			p = alloc + 4*(i - j);
-			e0 = p - edges;
+			e0 = (alloc + (i - j) - edges) * 4;
 		}
 		*va_arg(ap, eref *) = e0;
-		init_quadedge(edges, data, e0);
+		init_quadedge(edges + (e0 >> 2), e0);
 	}
 	va_end(ap);
 	return 0;
 }
 
+static void swap_next(struct eset *set, eref a, eref b)
+{
+	eref *pa, *pb, tmp;
+
+	pa = quadedge(set, a)->next + (a & 0x3);
+	pb = quadedge(set, b)->next + (b & 0x3);
+	tmp = *pa;
+	*pa = *pb;
+	*pb = tmp;
+}
+
 void eset_splice(struct eset *set, eref a, eref b)
 {
-	eref alpha, beta, tmp, *edges;
+	eref alpha, beta;
 
-	edges = set->edges.begin;
 	alpha = rot(onext(set, a));
 	beta = rot(onext(set, b));
-
-	tmp = edges[a];
-	edges[a] = edges[b];
-	edges[b] = tmp;
-
-	tmp = edges[alpha];
-	edges[alpha] = edges[beta];
-	edges[beta] = tmp;
+	swap_next(set, a, b);
+	swap_next(set, alpha, beta);
 }
 
 /* connect the destination of `a` to the origin of `b` with the new edge `c` so
@@ -115,7 +145,8 @@ void eset_delete(struct eset *set, eref e)
 	eset_splice(set, e, oprev(set, e));
 	eset_splice(set, sym(e), oprev(set, sym(e)));
 
-	/* add to free list */
-	((eref *)set->edges.begin)[e & ~0x3] = set->free;
+	/* add to free list, without end-points */
+	*org(set, e) = *dest(set, e) = NULL;
+	quadedge(set, e)->next[0] = set->free;
 	set->free = e & ~0x3;
 }
@@ -1,16 +1,32 @@
 typedef int eref;
 
+/* The four rotations of an edge and the origins of the edge and its
+   symmetric edge are kept together, so that following rot and sym from an
+   edge, and reading its org and dest, stays within one small record. */
+struct quadedge
+{
+	eref next[4];
+	float2 *data[2];
+};
+
 struct eset
 {
-	struct wbuf edges, data;
+	struct wbuf edges;
 	eref free;
 };
 
-void init_quadedge(eref *, float2 **data, eref e0);
+void init_quadedge(struct quadedge *, eref e0);
 
 void init_eset(struct eset *set);
 eref eset_max_edge(struct eset *set);
 int eset_alloc(struct eset *set, size_t n, ...);
+
+/* Make room for `n` more edges, so that allocating them does not reallocate
+   the set. Return zero on success. */
+int eset_reserve(struct eset *set, size_t n);
+
+/* Remove every edge, but keep the memory of the set for new edges. */
+void eset_clear(struct eset *set);
 void term_eset(struct eset *set);
 void eset_splice(struct eset *, eref a, eref b);
 void eset_connect(struct eset *, eref a, eref b, eref c);
@@ -21,11 +37,17 @@ static inline eref rot(eref e) { return mkref(e, e + 1); }
 static inline eref sym(eref e) { return mkref(e, e + 2); }
 static inline eref invrot(eref e) { return mkref(e, e + 3); }
 
-static inline eref onext(struct eset *set, eref e)
+static inline struct quadedge *quadedge(struct eset *set, eref e)
 {
 	assert(e >= 0);
-	assert((size_t)e < wbuf_nmemb(&set->edges, sizeof(eref)));
-	return ((eref *)set->edges.begin)[e];
+	assert((struct quadedge *)set->edges.begin + (e >> 2) <
+	       (struct quadedge *)set->edges.end);
+	return (struct quadedge *)set->edges.begin + (e >> 2);
+}
+
+static inline eref onext(struct eset *set, eref e)
+{
+	return quadedge(set, e)->next[e & 0x3];
 }
 
 static inline eref oprev(struct eset *set, eref e)
@@ -65,9 +87,7 @@ static inline eref rprev(struct eset *set, eref e)
 
 static inline float2 **org(struct eset *set, eref e)
 {
-	assert(e >= 0);
-	assert(((size_t)e >> 1) < wbuf_nmemb(&set->data, sizeof(float2*)));
-	return (float2 **)set->data.begin + (e >> 1);
+	return quadedge(set, e)->data + ((e >> 1) & 0x1);
 }
 
 static inline float2 **dest(struct eset *set, eref e)
@@ -92,6 +92,66 @@ void spline_free_shape(struct spline_shape *shape)
 	free(shape);
 }
 
+void spline_shape_bounds(float dest[4], struct spline_shape const *shape)
+{
+	size_t i, j, k;
+	struct spline_outline const *outline;
+	struct spline_segment const *segment;
+	float const *p;
+
+	dest[0] = dest[1] = HUGE_VALF;
+	dest[2] = dest[3] = -HUGE_VALF;
+	for (i = 0; i < shape->n; i++) {
+		outline = shape->outlines + i;
+		for (j = 0; j < outline->n; j++) {
+			segment = outline->segments + j;
+			for (k = 0; k < 2; k++) {
+				p = k ? segment->end : segment->mid;
+				if (p[0] < dest[0]) { dest[0] = p[0]; }
+				if (p[1] < dest[1]) { dest[1] = p[1]; }
+				if (p[0] > dest[2]) { dest[2] = p[0]; }
+				if (p[1] > dest[3]) { dest[3] = p[1]; }
+			}
+		}
+	}
+}
+
+long spline_flatten_outline(
+	struct wbuf *dest,
+	struct spline_outline const *outline,
+	float tolerance)
+{
+	struct spline_segment const *s, *t;
+	float p[9], (*q)[2];
+	size_t i, k, max;
+	long n;
+
+	assert(dest != NULL);
+	assert(outline != NULL);
+
+	for (i = 0, n = 0; i < outline->n; i++) {
+		s = outline->segments + i;
+		t = outline->segments + (i + 1) % outline->n;
+		p[0] = s->end[0]; p[1] = s->end[1]; p[2] = 1.f;
+		p[3] = s->mid[0]; p[4] = s->mid[1]; p[5] = s->weight;
+		p[6] = t->end[0]; p[7] = t->end[1]; p[8] = 1.f;
+
+		if (!wbuf_write(dest, s->end, sizeof s->end)) { return -1; }
+		q = dest->end;
+		max = wbuf_available(dest) / sizeof *q;
+		k = rbezier2_flatten(q, max, p, tolerance);
+		if (k > max) {
+			if (wbuf_reserve(dest, k * sizeof *q)) { return -1; }
+			q = dest->end;
+			(void)rbezier2_flatten(q, k, p, tolerance);
+		}
+		/* leave out the end-point, which starts the next segment */
+		(void)wbuf_alloc(dest, (k - 1) * sizeof *q);
+		n += k;
+	}
+	return n;
+}
+
 static bool split(struct mempool *pool, struct hull *t)
 {
 	enum { d = 3 };
@@ -200,51 +260,201 @@ static bool intersect(struct hull *t, struct hull *u)
 	return false;
 }
 
-static int intersect_with(
-	struct wbuf *buf,
-	struct hull *target,
-	struct hull **outlines,
-	size_t n)
+/* bounding box of a hull and its place among the outlines */
+struct hull_box
+{
+	float min[2], max[2];
+	size_t outline, index;
+	struct hull *hull;
+};
+
+/* pair of hulls which might intersect */
+struct candidate
+{
+	size_t key[4];
+	struct hull *t, *u;
+};
+
+static int box_cmp(void const *a, void const *b)
+{
+	struct hull_box const *l = a, *r = b;
+
+	if (l->min[0] < r->min[0]) { return -1; }
+	if (l->min[0] > r->min[0]) { return 1; }
+	if (l->outline != r->outline) { return l->outline < r->outline ? -1 : 1; }
+	if (l->index != r->index) { return l->index < r->index ? -1 : 1; }
+	return 0;
+}
+
+static int candidate_cmp(void const *a, void const *b)
 {
+	struct candidate const *l = a, *r = b;
 	size_t i;
-	struct hull *t;
-	struct intersection *isec;
 
-	for (i = 0; i < n; i++) {
-		t = outlines[i];
-		if (!t) continue;
-		do {
-			if (intersect(t, target)) {
-				isec = wbuf_alloc(buf, sizeof *isec);
-				if (!isec) { return -1; }
-				isec->t = target;
-				isec->u = t;
-			}
-			t = next(t);
-		} while (t != outlines[i]);
+	for (i = 0; i < length_of(l->key); i++) {
+		if (l->key[i] != r->key[i]) {
+			return l->key[i] < r->key[i] ? -1 : 1;
+		}
 	}
 	return 0;
 }
 
+/* widen a bit, so that rounding never separates touching boxes */
+static float widen(float x, float direction)
+{
+	return x + direction * (fabsf(x) * 1e-6f + 1e-30f);
+}
+
+static void init_hull_box(
+	struct hull_box *box,
+	struct hull *t,
+	size_t outline,
+	size_t index)
+{
+	float const *p[3];
+	size_t i, j;
+
+	p[0] = t->s.end;
+	p[1] = t->s.mid;
+	p[2] = next(t)->s.end;
+	for (j = 0; j < 2; j++) {
+		box->min[j] = box->max[j] = p[0][j];
+		for (i = 1; i < 3; i++) {
+			if (p[i][j] < box->min[j]) { box->min[j] = p[i][j]; }
+			if (p[i][j] > box->max[j]) { box->max[j] = p[i][j]; }
+		}
+		box->min[j] = widen(box->min[j], -1.f);
+		box->max[j] = widen(box->max[j], 1.f);
+	}
+	box->outline = outline;
+	box->index = index;
+	box->hull = t;
+}
+
+static int push_candidate(
+	struct wbuf *buf,
+	struct hull_box const *t,
+	struct hull_box const *u)
+{
+	struct candidate *c;
+
+	c = wbuf_alloc(buf, sizeof *c);
+	if (!c) { return -1; }
+	c->key[0] = t->outline;
+	c->key[1] = t->index;
+	c->key[2] = u->outline;
+	c->key[3] = u->index;
+	c->t = t->hull;
+	c->u = u->hull;
+	return 0;
+}
+
+/* Hulls are compared with those of the same and of earlier outlines, so
+   that hulls in the same outline are compared both ways, and with
+   themselves */
+static int push_candidates(
+	struct wbuf *buf,
+	struct hull_box const *a,
+	struct hull_box const *b)
+{
+	if (a->outline == b->outline) {
+		if (push_candidate(buf, a, b)) { return -1; }
+		return push_candidate(buf, b, a);
+	} else if (a->outline > b->outline) {
+		return push_candidate(buf, a, b);
+	} else {
+		return push_candidate(buf, b, a);
+	}
+}
+
+/* Sweep a line along the x-axis over the hull bounding boxes, and collect
+   the pairs of hulls whose boxes overlap, which are the only ones that can
+   intersect */
+static int sweep_and_prune(
+	struct wbuf *candidates,
+	struct hull_box *boxes,
+	size_t n)
+{
+	size_t i, j, k, *active, nactive;
+	struct hull_box const *a, *b;
+	int result;
+
+	active = malloc(n * sizeof *active + 1);
+	if (!active) { return -1; }
+
+	qsort(boxes, n, sizeof *boxes, box_cmp);
+	result = 0;
+	nactive = 0;
+	for (i = 0; i < n && !result; i++) {
+		b = boxes + i;
+		result = push_candidate(candidates, b, b);
+		for (j = k = 0; j < nactive && !result; j++) {
+			a = boxes + active[j];
+			if (a->max[0] < b->min[0]) { continue; }
+			active[k++] = active[j];
+			if (a->max[1] < b->min[1] || b->max[1] < a->min[1]) {
+				continue;
+			}
+			result = push_candidates(candidates, a, b);
+		}
+		nactive = k;
+		active[nactive++] = i;
+	}
+	free(active);
+	return result;
+}
+
+/* push each pair of intersecting hulls onto `buf` */
 static int find_intersections(
 	struct wbuf *buf,
 	struct hull **outlines,
 	size_t n)
 {
-	size_t i;
+	size_t i, j, m;
 	struct hull *t;
+	struct hull_box *boxes;
+	struct candidate *c, *end;
+	struct intersection *isec;
+	struct wbuf candidates;
+	int result;
 
-	for (i = 0; i < n; i++) {
+	for (m = i = 0; i < n; i++) {
+		if (outlines[i]) { m += clist_length(&outlines[i]->list); }
+	}
+	boxes = malloc(m * sizeof *boxes + 1);
+	if (!boxes) { return -1; }
+	for (m = i = 0; i < n; i++) {
 		t = outlines[i];
 		if (!t) { continue; }
+		j = 0;
 		do {
-			if (intersect_with(buf, t, outlines, i + 1)) {
-				return -1;
-			}
+			init_hull_box(boxes + m++, t, i, j++);
 			t = next(t);
 		} while (t != outlines[i]);
 	}
-	return 0;
+
+	/* test candidates in the order of comparing every hull with every
+	   other one, which decides the order of subdivision */
+	wbuf_init(&candidates);
+	result = sweep_and_prune(&candidates, boxes, m);
+	free(boxes);
+	if (!result) {
+		c = candidates.begin;
+		end = candidates.end;
+		if (c != end) { qsort(c, end - c, sizeof *c, candidate_cmp); }
+		for (; c != end && !result; c++) {
+			if (!intersect(c->u, c->t)) { continue; }
+			isec = wbuf_alloc(buf, sizeof *isec);
+			if (!isec) {
+				result = -1;
+				break;
+			}
+			isec->t = c->t;
+			isec->u = c->u;
+		}
+	}
+	wbuf_term(&candidates);
+	return result;
 }
 
 static struct hull *select_which_to_split(struct hull *t, struct hull *u)
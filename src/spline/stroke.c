@@ -0,0 +1,799 @@
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdalign.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include "base/wbuf.h"
+#include "base/mem.h"
+#include "spline/shape.h"
+#include "spline/stroke.h"
+
+/* deepest halving of a segment while approximating its offset curves */
+#define MAX_OFFSET_DEPTH 16
+
+/* deepest halving of two pieces while looking for their intersection */
+#define MAX_TRIM_DEPTH 32
+
+/* number of pieces on each side of a corner searched for an intersection */
+#define MAX_TRIM_PIECES 8
+
+#define PI 3.14159265358979323846
+
+/* Rational quadratic Bézier curve in homogeneous coordinates (x w, y w, w),
+   which can be split and evaluated without normalizing the weights, so that
+   the parameter of a part maps linearly onto the whole */
+struct conic
+{
+	double p[3][3];
+};
+
+/* range of pieces which make up the offset curve of a segment */
+struct run
+{
+	size_t begin, end;
+};
+
+/* corner between two segments and the unit tangents on either side */
+struct joint
+{
+	double p[2], ta[2], tb[2];
+};
+
+/* one side of the stroke, at signed distance `offset` to the left of the
+   outline */
+struct side
+{
+	struct wbuf pieces;
+	struct run *runs;
+	bool *trimmed;
+	double offset;
+};
+
+/* writes consecutive curves as segments, where the end-point of each is the
+   start of the next, and connects the curves with lines when they do not
+   meet */
+struct emitter
+{
+	struct wbuf *dest;
+	double first[2], last[2], eps;
+	size_t n;
+};
+
+static double dot(double const a[2], double const b[2])
+{
+	return a[0]*b[0] + a[1]*b[1];
+}
+
+static double cross(double const a[2], double const b[2])
+{
+	return a[0]*b[1] - a[1]*b[0];
+}
+
+static double dist(double const a[2], double const b[2])
+{
+	return hypot(a[0] - b[0], a[1] - b[1]);
+}
+
+/* dest = a + s * left(v), where left(v) is v turned a quarter to the left */
+static void offset_point(
+	double dest[2],
+	double const a[2],
+	double const v[2],
+	double s)
+{
+	double x = a[0] - s * v[1], y = a[1] + s * v[0];
+	dest[0] = x;
+	dest[1] = y;
+}
+
+static void normalize(double v[2])
+{
+	double len = hypot(v[0], v[1]);
+	if (len > 0.0) {
+		v[0] /= len;
+		v[1] /= len;
+	}
+}
+
+static void project(double dest[2], double const p[3])
+{
+	dest[0] = p[0] / p[2];
+	dest[1] = p[1] / p[2];
+}
+
+static void lift(double dest[3], double const p[2], double w)
+{
+	dest[0] = p[0] * w;
+	dest[1] = p[1] * w;
+	dest[2] = w;
+}
+
+static void lerp3(
+	double dest[3],
+	double const a[3],
+	double const b[3],
+	double t)
+{
+	int i;
+	for (i = 0; i < 3; i++) { dest[i] = a[i] + (b[i] - a[i]) * t; }
+}
+
+static void make_conic(
+	struct conic *c,
+	double const p0[2],
+	double const p1[2],
+	double w,
+	double const p2[2])
+{
+	lift(c->p[0], p0, 1.0);
+	lift(c->p[1], p1, w);
+	lift(c->p[2], p2, 1.0);
+}
+
+/* weight of the control point when the end-points have weight one */
+static double norm_weight(struct conic const *c)
+{
+	return c->p[1][2] / sqrt(c->p[0][2] * c->p[2][2]);
+}
+
+/* split c at t into a, the part before, and b, the part after, either of
+   which may be c or NULL */
+static void split_conic(
+	struct conic *a,
+	struct conic *b,
+	struct conic const *c,
+	double t)
+{
+	double q0[3], q2[3], m[3];
+	struct conic s = *c;
+
+	lerp3(q0, s.p[0], s.p[1], t);
+	lerp3(q2, s.p[1], s.p[2], t);
+	lerp3(m, q0, q2, t);
+	if (a) {
+		(void)memcpy(a->p[0], s.p[0], sizeof a->p[0]);
+		(void)memcpy(a->p[1], q0, sizeof a->p[1]);
+		(void)memcpy(a->p[2], m, sizeof a->p[2]);
+	}
+	if (b) {
+		(void)memcpy(b->p[0], m, sizeof b->p[0]);
+		(void)memcpy(b->p[1], q2, sizeof b->p[1]);
+		(void)memcpy(b->p[2], s.p[2], sizeof b->p[2]);
+	}
+}
+
+static void reverse_conic(struct conic *dest, struct conic const *c)
+{
+	struct conic s = *c;
+
+	(void)memcpy(dest->p[0], s.p[2], sizeof dest->p[0]);
+	(void)memcpy(dest->p[1], s.p[1], sizeof dest->p[1]);
+	(void)memcpy(dest->p[2], s.p[0], sizeof dest->p[2]);
+}
+
+/* point of c at t and the unit tangent there, or along the chord where the
+   curve stands still */
+static void eval_conic(
+	double pt[2],
+	double tangent[2],
+	struct conic const *c,
+	double t)
+{
+	double q0[3], q2[3], m[3], a[2], b[2];
+
+	lerp3(q0, c->p[0], c->p[1], t);
+	lerp3(q2, c->p[1], c->p[2], t);
+	lerp3(m, q0, q2, t);
+	if (pt) { project(pt, m); }
+	if (tangent) {
+		project(a, q0);
+		project(b, q2);
+		if (a[0] == b[0] && a[1] == b[1]) {
+			project(a, c->p[0]);
+			project(b, c->p[2]);
+		}
+		tangent[0] = b[0] - a[0];
+		tangent[1] = b[1] - a[1];
+		normalize(tangent);
+	}
+}
+
+/* Append pieces which approximate the curve at signed distance `o` to the
+   left of c. The control point of a piece is where the tangents of its
+   offset end-points meet, and the weight is that of c, which is exact for
+   circular arcs, and otherwise c is halved until the pieces are within
+   `tolerance` of the offset curve. */
+static int offset_conic(
+	struct wbuf *dest,
+	struct conic const *c,
+	double o,
+	double tolerance,
+	int depth)
+{
+	static double const ts[] = { 0.25, 0.5, 0.75 };
+
+	struct conic q, a, b;
+	double p0[2], p2[2], t0[2], t2[2], q0[2], q1[2], q2[2];
+	double pt[2], tn[2], approx[2], d[2], denom, s, u;
+	bool valid;
+	size_t i;
+
+	eval_conic(p0, t0, c, 0.0);
+	eval_conic(p2, t2, c, 1.0);
+	offset_point(q0, p0, t0, o);
+	offset_point(q2, p2, t2, o);
+
+	/* a piece should turn less than a quarter, and its control point
+	   should be ahead of both end-points */
+	denom = cross(t0, t2);
+	valid = dot(t0, t2) >= 0.0;
+	if (fabs(denom) < 1e-12) {
+		q1[0] = (q0[0] + q2[0]) * 0.5;
+		q1[1] = (q0[1] + q2[1]) * 0.5;
+	} else {
+		d[0] = q2[0] - q0[0];
+		d[1] = q2[1] - q0[1];
+		s = cross(d, t2) / denom;
+		u = cross(t0, d) / denom;
+		q1[0] = q0[0] + s * t0[0];
+		q1[1] = q0[1] + s * t0[1];
+		valid = valid && s >= 0.0 && u >= 0.0;
+	}
+	if (valid) {
+		make_conic(&q, q0, q1, norm_weight(c), q2);
+	} else {
+		/* a straight line, unless it is halved further */
+		q1[0] = (q0[0] + q2[0]) * 0.5;
+		q1[1] = (q0[1] + q2[1]) * 0.5;
+		make_conic(&q, q0, q1, 1.0, q2);
+	}
+
+	for (i = 0; valid && i < sizeof ts / sizeof *ts; i++) {
+		eval_conic(pt, tn, c, ts[i]);
+		offset_point(pt, pt, tn, o);
+		eval_conic(approx, NULL, &q, ts[i]);
+		d[0] = approx[0] - pt[0];
+		d[1] = approx[1] - pt[1];
+		valid = fabs(cross(tn, d)) <= tolerance;
+	}
+
+	if (!valid && depth < MAX_OFFSET_DEPTH) {
+		split_conic(&a, &b, c, 0.5);
+		if (offset_conic(dest, &a, o, tolerance, depth + 1)) {
+			return -1;
+		}
+		return offset_conic(dest, &b, o, tolerance, depth + 1);
+	}
+	return wbuf_write(dest, &q, sizeof q) ? 0 : -1;
+}
+
+static void bounds(double box[4], struct conic const *c)
+{
+	double p[2];
+	int i;
+
+	box[0] = box[1] = HUGE_VAL;
+	box[2] = box[3] = -HUGE_VAL;
+	for (i = 0; i < 3; i++) {
+		project(p, c->p[i]);
+		box[0] = fmin(box[0], p[0]);
+		box[1] = fmin(box[1], p[1]);
+		box[2] = fmax(box[2], p[0]);
+		box[3] = fmax(box[3], p[1]);
+	}
+}
+
+/* Find the parameters in t of a point where a and b meet by halving both
+   curves where their bounding boxes overlap, preferring points late on a and
+   early on b. Each part lies in the bounding box of its control points. */
+static bool find_intersection(
+	double t[2],
+	struct conic const *a,
+	double a0, double a1,
+	struct conic const *b,
+	double b0, double b1,
+	double tolerance,
+	int depth)
+{
+	struct conic ah[2], bh[2];
+	double abox[4], bbox[4], am, bm;
+	int i, j;
+
+	bounds(abox, a);
+	bounds(bbox, b);
+	if (abox[2] < bbox[0] || bbox[2] < abox[0] ||
+	    abox[3] < bbox[1] || bbox[3] < abox[1]) {
+		return false;
+	}
+	am = (a0 + a1) * 0.5;
+	bm = (b0 + b1) * 0.5;
+	if (depth >= MAX_TRIM_DEPTH ||
+	    (fmax(abox[2] - abox[0], abox[3] - abox[1]) <= tolerance &&
+	     fmax(bbox[2] - bbox[0], bbox[3] - bbox[1]) <= tolerance)) {
+		t[0] = am;
+		t[1] = bm;
+		return true;
+	}
+	split_conic(ah + 0, ah + 1, a, 0.5);
+	split_conic(bh + 0, bh + 1, b, 0.5);
+	for (i = 1; i >= 0; i--) {
+		for (j = 0; j < 2; j++) {
+			if (find_intersection(
+				t,
+				ah + i, i ? am : a0, i ? a1 : am,
+				bh + j, j ? bm : b0, j ? b1 : bm,
+				tolerance, depth + 1)) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+/* Cut the offset curves of two segments on the inner side of the corner
+   between them where they intersect, so that the outline does not cross
+   itself there. Return whether they intersect near the corner. */
+static bool trim(struct conic *pieces, struct run *a, struct run *b, double tol)
+{
+	size_t i, j;
+	double t[2], p[2], q[2];
+
+	for (i = a->end; i > a->begin && a->end - i < MAX_TRIM_PIECES; i--) {
+		for (j = b->begin; j < b->end && j - b->begin < MAX_TRIM_PIECES;
+		     j++) {
+			if (!find_intersection(t, pieces + i - 1, 0.0, 1.0,
+			                       pieces + j, 0.0, 1.0, tol, 0)) {
+				continue;
+			}
+			split_conic(pieces + i - 1, NULL, pieces + i - 1, t[0]);
+			split_conic(NULL, pieces + j, pieces + j, t[1]);
+
+			/* meet half-way between the approximations */
+			project(p, pieces[i - 1].p[2]);
+			project(q, pieces[j].p[0]);
+			p[0] = (p[0] + q[0]) * 0.5;
+			p[1] = (p[1] + q[1]) * 0.5;
+			lift(pieces[i - 1].p[2], p, pieces[i - 1].p[2][2]);
+			lift(pieces[j].p[0], p, pieces[j].p[0][2]);
+
+			a->end = i;
+			b->begin = j;
+			return true;
+		}
+	}
+	return false;
+}
+
+/* a line from p, written like other straight segments with the control
+   point at the end-point and a zero weight */
+static int write_line(struct emitter *e, double const p[2])
+{
+	struct spline_segment *s;
+
+	s = wbuf_alloc(e->dest, sizeof *s);
+	if (!s) { return -1; }
+	s->end[0] = s->mid[0] = p[0];
+	s->end[1] = s->mid[1] = p[1];
+	s->weight = 0.f;
+	e->n++;
+	return 0;
+}
+
+/* continue the outline at p, with a line from the last point if needed */
+static int line_to(struct emitter *e, double const p[2])
+{
+	if (e->n == 0) {
+		(void)memcpy(e->first, p, sizeof e->first);
+	} else if (dist(e->last, p) > e->eps && write_line(e, e->last)) {
+		return -1;
+	}
+	(void)memcpy(e->last, p, sizeof e->last);
+	return 0;
+}
+
+static int emit_conic(struct emitter *e, struct conic const *c)
+{
+	struct spline_segment *s;
+	double p[2], q[2], a[2], b[2];
+
+	project(p, c->p[0]);
+	if (line_to(e, p)) { return -1; }
+	project(q, c->p[1]);
+	project(e->last, c->p[2]);
+
+	/* pieces of straight segments are lines */
+	a[0] = q[0] - p[0];
+	a[1] = q[1] - p[1];
+	b[0] = e->last[0] - p[0];
+	b[1] = e->last[1] - p[1];
+	if (fabs(cross(a, b)) <= e->eps * dist(p, e->last)) {
+		return write_line(e, p);
+	}
+
+	s = wbuf_alloc(e->dest, sizeof *s);
+	if (!s) { return -1; }
+	s->end[0] = p[0];
+	s->end[1] = p[1];
+	s->mid[0] = q[0];
+	s->mid[1] = q[1];
+	s->weight = norm_weight(c);
+	e->n++;
+	return 0;
+}
+
+/* circular arc from the last point around `centre` by `angle` radians, in
+   parts of at most a quarter turn */
+static int arc_to(struct emitter *e, double const centre[2], double angle)
+{
+	struct conic c;
+	double r, a0, a1, half, p1[2], p2[2];
+	int i, k;
+
+	r = dist(e->last, centre);
+	k = (int)ceil(fabs(angle) / (PI * 0.5) - 1e-9);
+	if (k < 1) { return 0; }
+	a0 = atan2(e->last[1] - centre[1], e->last[0] - centre[0]);
+	half = angle / k * 0.5;
+	for (i = 0; i < k; i++) {
+		a1 = a0 + 2.0 * half;
+		p1[0] = centre[0] + r / cos(half) * cos(a0 + half);
+		p1[1] = centre[1] + r / cos(half) * sin(a0 + half);
+		p2[0] = centre[0] + r * cos(a1);
+		p2[1] = centre[1] + r * sin(a1);
+		make_conic(&c, e->last, p1, cos(half), p2);
+		if (emit_conic(e, &c)) { return -1; }
+		a0 = a1;
+	}
+	return 0;
+}
+
+static int emit_join(
+	struct emitter *e,
+	struct joint const *j,
+	struct side const *side,
+	bool trimmed,
+	double const next[2],
+	struct spline_stroke const *stroke)
+{
+	double na[2], nb[2], m[2], d, angle;
+
+	offset_point(na, j->p, j->ta, side->offset);
+	offset_point(nb, j->p, j->tb, side->offset);
+	if (dist(na, nb) <= stroke->tolerance) {
+		/* smooth enough for the offset curves to meet */
+		return 0;
+	}
+	if (cross(j->ta, j->tb) * side->offset > 0.0) {
+		/* inner side, connected through the corner unless trimmed */
+		return trimmed ? 0 : line_to(e, j->p);
+	}
+	switch (stroke->join) {
+	case SPLINE_JOIN_MITER:
+		d = dot(j->ta, j->tb);
+		if (1.0 + d > 0.0 &&
+		    sqrt(2.0 / (1.0 + d)) <= stroke->miter_limit) {
+			m[0] = j->p[0] + (na[0] + nb[0] - 2.0*j->p[0]) / (1.0 + d);
+			m[1] = j->p[1] + (na[1] + nb[1] - 2.0*j->p[1]) / (1.0 + d);
+			return line_to(e, m);
+		}
+		return 0;
+	case SPLINE_JOIN_ROUND:
+		na[0] = e->last[0] - j->p[0];
+		na[1] = e->last[1] - j->p[1];
+		nb[0] = next[0] - j->p[0];
+		nb[1] = next[1] - j->p[1];
+		angle = atan2(cross(na, nb), dot(na, nb));
+		return arc_to(e, j->p, angle);
+	case SPLINE_JOIN_BEVEL:
+	default:
+		return 0;
+	}
+}
+
+/* close an open outline at p, going from the last point to `next` on the
+   other side, where `out` is the unit tangent pointing away from the outline */
+static int emit_cap(
+	struct emitter *e,
+	double const p[2],
+	double const out[2],
+	double const next[2],
+	double half_width,
+	enum spline_cap cap)
+{
+	double q[2];
+
+	switch (cap) {
+	case SPLINE_CAP_SQUARE:
+		q[0] = e->last[0] + out[0] * half_width;
+		q[1] = e->last[1] + out[1] * half_width;
+		if (line_to(e, q)) { return -1; }
+		q[0] = next[0] + out[0] * half_width;
+		q[1] = next[1] + out[1] * half_width;
+		return line_to(e, q);
+	case SPLINE_CAP_ROUND:
+		return arc_to(e, p, -PI);
+	case SPLINE_CAP_BUTT:
+	default:
+		return 0;
+	}
+}
+
+static struct conic *pieces_of(struct side const *side)
+{
+	return side->pieces.begin;
+}
+
+/* first point of run i, or its last point when it is walked backwards */
+static void run_start(
+	double dest[2],
+	struct side const *side,
+	size_t i,
+	bool reverse)
+{
+	struct conic const *c = pieces_of(side);
+	struct run const *r = side->runs + i;
+
+	if (reverse) {
+		project(dest, c[r->end - 1].p[2]);
+	} else {
+		project(dest, c[r->begin].p[0]);
+	}
+}
+
+static int emit_run(
+	struct emitter *e,
+	struct side const *side,
+	size_t i,
+	bool reverse)
+{
+	struct conic const *c = pieces_of(side);
+	struct run const *r = side->runs + i;
+	struct conic rev;
+	size_t k;
+
+	for (k = r->begin; k < r->end; k++) {
+		if (reverse) {
+			reverse_conic(&rev, c + r->end - 1 - (k - r->begin));
+			if (emit_conic(e, &rev)) { return -1; }
+		} else {
+			if (emit_conic(e, c + k)) { return -1; }
+		}
+	}
+	return 0;
+}
+
+/* Emit the runs of a side in order, or backwards, with the joins between
+   them. The joint i is at the start of segment i. */
+static int emit_side(
+	struct emitter *e,
+	struct side const *side,
+	struct joint const *joints,
+	size_t m,
+	bool closed,
+	bool reverse,
+	struct spline_stroke const *stroke)
+{
+	size_t i, j, k, v;
+	double next[2];
+
+	for (k = 0; k < m; k++) {
+		i = reverse ? m - 1 - k : k;
+		if (emit_run(e, side, i, reverse)) { return -1; }
+		if (!closed && k + 1 == m) { break; }
+		j = reverse ? (i + m - 1) % m : (i + 1) % m;
+		v = reverse ? i : j;
+		run_start(next, side, j, reverse);
+		if (emit_join(e, joints + v, side, side->trimmed[v], next, stroke)) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int make_side(
+	struct side *side,
+	struct conic const *conics,
+	size_t m,
+	bool closed,
+	double offset,
+	double tolerance)
+{
+	struct conic *c;
+	size_t i, j;
+	double na[2], nb[2], ta[2], tb[2], p[2];
+
+	side->offset = offset;
+	for (i = 0; i < m; i++) {
+		side->runs[i].begin = wbuf_size(&side->pieces) / sizeof *c;
+		if (offset_conic(&side->pieces, conics + i, offset, tolerance, 0)) {
+			return -1;
+		}
+		side->runs[i].end = wbuf_size(&side->pieces) / sizeof *c;
+	}
+
+	/* trim the inner side of each corner */
+	c = pieces_of(side);
+	for (j = 0; j < m; j++) {
+		side->trimmed[j] = false;
+		if (j == 0 && (!closed || m < 2)) { continue; }
+		i = (j + m - 1) % m;
+		eval_conic(p, ta, conics + i, 1.0);
+		eval_conic(NULL, tb, conics + j, 0.0);
+		offset_point(na, p, ta, offset);
+		offset_point(nb, p, tb, offset);
+		if (dist(na, nb) <= tolerance || cross(ta, tb) * offset <= 0.0) {
+			continue;
+		}
+		side->trimmed[j] = trim(c, side->runs + i, side->runs + j,
+		                        tolerance * 1e-3);
+	}
+	return 0;
+}
+
+static struct spline_shape *make_stroke_block(
+	struct spline_segment const *segments,
+	size_t const *lengths,
+	size_t n)
+{
+	typedef struct spline_outline o;
+	typedef struct spline_segment s;
+
+	struct spline_shape *result;
+	struct spline_outline *outlines;
+	struct spline_segment *dest;
+	struct memblk blk[3];
+	size_t i, total;
+
+	for (i = 0, total = 0; i < n; i++) { total += lengths[i]; }
+	if (memblk_init(blk + 0, 1, sizeof *result)) { return NULL; }
+	if (memblk_push(blk + 1, n, sizeof(o), alignof(o))) { return NULL; }
+	if (memblk_push(blk + 2, total, sizeof(s), alignof(s))) { return NULL; }
+
+	result = malloc(blk[2].extent);
+	if (!result) { return NULL; }
+	outlines = memblk_offset(result, blk[1]);
+	dest = memblk_offset(result, blk[2]);
+	if (total > 0) { (void)memcpy(dest, segments, total * sizeof *dest); }
+
+	result->n = n;
+	result->outlines = outlines;
+	for (i = 0; i < n; i++) {
+		outlines[i].n = lengths[i];
+		outlines[i].segments = dest;
+		dest += lengths[i];
+	}
+	return result;
+}
+
+/* the segments of `outline` to stroke, leaving out those which are a single
+   point, or -1 on failure */
+static long make_conics(
+	struct conic **dest,
+	struct spline_outline const *outline,
+	bool closed)
+{
+	struct spline_segment const *s, *t;
+	struct conic *c;
+	double p0[2], p1[2], p2[2], w;
+	size_t i, n, m;
+
+	n = outline->n;
+	if (!closed && n > 0) { n--; }
+	c = malloc(n * sizeof *c + 1);
+	if (!c) { return -1; }
+	for (i = 0, m = 0; i < n; i++) {
+		s = outline->segments + i;
+		t = outline->segments + (i + 1) % outline->n;
+		p0[0] = s->end[0]; p0[1] = s->end[1];
+		p1[0] = s->mid[0]; p1[1] = s->mid[1];
+		p2[0] = t->end[0]; p2[1] = t->end[1];
+		w = s->weight;
+		if (!(w > 0.f)) {
+			p1[0] = (p0[0] + p2[0]) * 0.5;
+			p1[1] = (p0[1] + p2[1]) * 0.5;
+			w = 1.0;
+		}
+		if (p0[0] == p1[0] && p0[0] == p2[0] &&
+		    p0[1] == p1[1] && p0[1] == p2[1]) {
+			continue;
+		}
+		make_conic(c + m++, p0, p1, w, p2);
+	}
+	*dest = c;
+	return (long)m;
+}
+
+struct spline_shape *spline_stroke_outline(
+	struct spline_outline const *outline,
+	int closed,
+	struct spline_stroke const *stroke)
+{
+	struct spline_shape *result;
+	struct conic *conics;
+	struct joint *joints;
+	struct side sides[2];
+	struct emitter e;
+	struct wbuf segments;
+	double h, out[2], p[2], next[2];
+	size_t i, j, m, lengths[2], n;
+	long nconics;
+
+	assert(outline != NULL);
+	assert(stroke != NULL);
+	assert(stroke->tolerance > 0.f);
+
+	nconics = make_conics(&conics, outline, closed);
+	if (nconics < 0) { return NULL; }
+	m = (size_t)nconics;
+	h = stroke->width * 0.5;
+
+	result = NULL;
+	wbuf_init(&segments);
+	for (i = 0; i < 2; i++) {
+		wbuf_init(&sides[i].pieces);
+		sides[i].runs = malloc(m * sizeof *sides[i].runs + 1);
+		sides[i].trimmed = malloc(m * sizeof *sides[i].trimmed + 1);
+	}
+	joints = malloc(m * sizeof *joints + 1);
+	if (!joints) { goto fail; }
+	for (i = 0; i < 2; i++) {
+		if (!sides[i].runs || !sides[i].trimmed) { goto fail; }
+		if (make_side(sides + i, conics, m, closed, i ? -h : h,
+		              stroke->tolerance)) {
+			goto fail;
+		}
+	}
+	for (j = 0; j < m; j++) {
+		i = (j + m - 1) % m;
+		eval_conic(joints[j].p, joints[j].ta, conics + i, 1.0);
+		eval_conic(NULL, joints[j].tb, conics + j, 0.0);
+	}
+
+	e.dest = &segments;
+	e.eps = stroke->tolerance * 0.01;
+	n = 0;
+	if (m == 0) {
+		/* nothing but points */
+	} else if (closed) {
+		for (i = 0; i < 2; i++) {
+			e.n = 0;
+			if (emit_side(&e, sides + i, joints, m, true, i,
+			              stroke)) {
+				goto fail;
+			}
+			if (line_to(&e, e.first)) { goto fail; }
+			lengths[n++] = e.n;
+		}
+	} else {
+		e.n = 0;
+		if (emit_side(&e, sides + 0, joints, m, false, false, stroke)) {
+			goto fail;
+		}
+		eval_conic(p, out, conics + m - 1, 1.0);
+		run_start(next, sides + 1, m - 1, true);
+		if (emit_cap(&e, p, out, next, h, stroke->cap)) { goto fail; }
+		if (emit_side(&e, sides + 1, joints, m, false, true, stroke)) {
+			goto fail;
+		}
+		eval_conic(p, out, conics + 0, 0.0);
+		out[0] = -out[0];
+		out[1] = -out[1];
+		if (emit_cap(&e, p, out, e.first, h, stroke->cap)) { goto fail; }
+		if (line_to(&e, e.first)) { goto fail; }
+		lengths[n++] = e.n;
+	}
+	result = make_stroke_block(segments.begin, lengths, n);
+
+fail:	for (i = 0; i < 2; i++) {
+		wbuf_term(&sides[i].pieces);
+		free(sides[i].runs);
+		free(sides[i].trimmed);
+	}
+	wbuf_term(&segments);
+	free(joints);
+	free(conics);
+	return result;
+}
@@ -1,10 +1,13 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <stddef.h>
 #include <math.h>
 
 #include "ok/ok.h"
+#include "base/mem.h"
 #include "gm/misc.h"
 #include "spline/bezier2.h"
+#include "test.h"
 
 int test_interpolate_endpoints_at_t0_and_t1(void)
 {
@@ -131,3 +134,131 @@ int test_subdivide_a_quadratic_bezier_curve(void)
 
 	return ok;
 }
+
+#define BATCH_SIZE 1000
+
+static float uniform(float lo, float hi)
+{
+	return lo + (float)rand() / RAND_MAX * (hi - lo);
+}
+
+int test_evaluate_points_in_batches(void)
+{
+	static float x0[BATCH_SIZE], y0[BATCH_SIZE], x1[BATCH_SIZE];
+	static float y1[BATCH_SIZE], x2[BATCH_SIZE], y2[BATCH_SIZE];
+	static float w[BATCH_SIZE], t[BATCH_SIZE];
+	static float x[BATCH_SIZE], y[BATCH_SIZE];
+
+	struct rbezier2_set set = { x0, y0, x1, y1, x2, y2, w };
+	float p[9], q[6], expected[2];
+	size_t i;
+
+	srand(1);
+	for (i = 0; i < 9; i++) { p[i] = uniform(-10.f, 10.f); }
+	p[2] = 1.f;
+	p[5] = 0.5f;
+	p[8] = 2.f;
+	for (i = 0; i < 6; i++) { q[i] = uniform(-10.f, 10.f); }
+	for (i = 0; i < BATCH_SIZE; i++) {
+		t[i] = (float)i / (BATCH_SIZE - 1);
+		x0[i] = uniform(-10.f, 10.f);
+		y0[i] = uniform(-10.f, 10.f);
+		x1[i] = uniform(-10.f, 10.f);
+		y1[i] = uniform(-10.f, 10.f);
+		x2[i] = uniform(-10.f, 10.f);
+		y2[i] = uniform(-10.f, 10.f);
+		w[i] = uniform(0.1f, 2.f);
+	}
+
+	/* one curve at many parameters */
+	bezier2_n(x, y, q, t, BATCH_SIZE);
+	for (i = 0; i < BATCH_SIZE; i++) {
+		bezier2(expected, 2, q, t[i]);
+		if (!fneareqef(x[i], expected[0], 1e-5f, 1e-5f) ||
+		    !fneareqef(y[i], expected[1], 1e-5f, 1e-5f)) {
+			fail_test("bezier2_n differs at t=%f\n", t[i]);
+		}
+	}
+	rbezier2_n(x, y, p, t, BATCH_SIZE);
+	for (i = 0; i < BATCH_SIZE; i++) {
+		rbezier2(expected, 2, p, t[i]);
+		if (!fneareqef(x[i], expected[0], 1e-5f, 1e-5f) ||
+		    !fneareqef(y[i], expected[1], 1e-5f, 1e-5f)) {
+			fail_test("rbezier2_n differs at t=%f\n", t[i]);
+		}
+	}
+
+	/* many curves at once */
+	rbezier2_set_eval(x, y, &set, t, BATCH_SIZE);
+	for (i = 0; i < BATCH_SIZE; i++) {
+		p[0] = x0[i]; p[1] = y0[i]; p[2] = 1.f;
+		p[3] = x1[i]; p[4] = y1[i]; p[5] = w[i];
+		p[6] = x2[i]; p[7] = y2[i]; p[8] = 1.f;
+		rbezier2(expected, 2, p, t[i]);
+		if (!fneareqef(x[i], expected[0], 1e-5f, 1e-5f) ||
+		    !fneareqef(y[i], expected[1], 1e-5f, 1e-5f)) {
+			fail_test("rbezier2_set_eval differs for curve %zu\n", i);
+		}
+	}
+	return ok;
+}
+
+int test_flatten_a_circular_arc_within_tolerance(void)
+{
+	static float const tolerance[] = { 1.f, 0.1f, 0.01f, 0.001f };
+
+	/* a quarter of a circle of radius 100 */
+	float const arc[] = {
+		100.0f,   0.0f, 1.0f,
+		100.0f, 100.0f, 1.0/sqrt(2.0),
+		  0.0f, 100.0f, 1.0f
+	};
+	float const line[] = {
+		0.0f, 0.0f, 1.0f,
+		1.0f, 2.0f, 1.0f,
+		2.0f, 4.0f, 1.0f
+	};
+	float points[1024][2], chord, sagitta;
+	double r;
+	size_t i, j, n, prev;
+
+	prev = 0;
+	for (i = 0; i < length_of(tolerance); i++) {
+		n = rbezier2_flatten(points, length_of(points), arc,
+		                     tolerance[i]);
+		if (n > length_of(points)) { fail_test("Too many points\n"); }
+		if (n <= prev) {
+			fail_test("Expected more points for a lower tolerance\n");
+		}
+		prev = n;
+		if (points[n - 1][0] != arc[6] || points[n - 1][1] != arc[7]) {
+			fail_test("Expected the polyline to end at p2\n");
+		}
+		for (j = 0; j < n; j++) {
+			/* every point is on the circle */
+			r = hypot(points[j][0], points[j][1]);
+			if (fabs(r - 100.0) > 1e-3) {
+				fail_test("Point %zu is off the arc by %f\n",
+				          j, r - 100.0);
+			}
+			/* and no line is too far inside of it */
+			chord = j ? hypot(points[j][0] - points[j - 1][0],
+			                  points[j][1] - points[j - 1][1])
+			          : hypot(points[j][0] - arc[0],
+			                  points[j][1] - arc[1]);
+			sagitta = 100.0 - sqrt(1e4 - chord*chord/4.0);
+			if (sagitta > tolerance[i] * 1.001f) {
+				fail_test("Line %zu is %f from the arc\n",
+				          j, sagitta);
+			}
+		}
+	}
+
+	/* a straight curve is a single line, and only the count is returned
+	   when there is no room */
+	assert_true(rbezier2_flatten(points, 1, line, 0.01f) == 1);
+	n = rbezier2_flatten(NULL, 0, arc, 0.01f);
+	assert_true(n == rbezier2_flatten(points, length_of(points), arc, 0.01f));
+
+	return ok;
+}
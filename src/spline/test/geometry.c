@@ -64,3 +64,68 @@ int test_signed_distance_from_point_to_line(void)
 #undef dist
 	return ok;
 }
+
+static int sign(double x)
+{
+	return (x > 0.0) - (x < 0.0);
+}
+
+int test_exact_orientation_near_a_line(void)
+{
+	typedef float xy[XY];
+
+	xy q = { 12.0f, 12.0f };
+	xy r = { 24.0f, 24.0f };
+	xy p;
+	int i, j;
+
+	/* a grid of the closest floating-point numbers around a point on the
+	   line y = x, where the sign of a rounded determinant is noise */
+	X[p] = 0.5f;
+	for (i = 0; i < 32; i++) {
+		Y[p] = 0.5f;
+		for (j = 0; j < 32; j++) {
+			if (sign(orient2d(q, r, p)) != sign(Y[p] - X[p])) {
+				fail_test("Wrong orientation at (%d, %d)\n",
+				          i, j);
+			}
+			if (sign(orient2d(p, q, r)) != sign(Y[p] - X[p])) {
+				fail_test("Rotated orientation differs at "
+				          "(%d, %d)\n", i, j);
+			}
+			Y[p] = nextafterf(Y[p], 1.0f);
+		}
+		X[p] = nextafterf(X[p], 1.0f);
+	}
+	return ok;
+}
+
+int test_exact_incircle_of_cocircular_points(void)
+{
+	/* integer points on a circle of radius 25, moved away from the
+	   origin so that the approximation is not enough */
+	typedef float xy[XY];
+
+	float const o = 1000.0f;
+	xy a = { o + 25.0f, o };
+	xy b = { o, o + 25.0f };
+	xy c = { o - 25.0f, o };
+	xy d = { o + 7.0f, o + 24.0f };
+	xy e = { o - 20.0f, o - 15.0f };
+
+	assert_true(incircle(a, b, c, d) == 0.0);
+	assert_true(incircle(a, b, c, e) == 0.0);
+	assert_true(incircle(b, c, a, e) == 0.0);
+
+	/* nudged inside and outside by one unit in the last place */
+	Y[d] = nextafterf(Y[d], o);
+	assert_true(incircle(a, b, c, d) > 0.0);
+	Y[d] = nextafterf(nextafterf(Y[d], 2*o), 2*o);
+	assert_true(incircle(a, b, c, d) < 0.0);
+	X[e] = nextafterf(X[e], o);
+	assert_true(incircle(a, b, c, e) > 0.0);
+	assert_false(point2d_in_circle(a, b, c, d));
+	assert_true(point2d_in_circle(a, b, c, e));
+
+	return ok;
+}
@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <string.h>
@@ -97,19 +98,18 @@ int test_traverse_edges_connected_to_a_vertex_or_around_a_face(void)
 	enum { a, b, c, d, e, f, g, h };
 
 	/* Based on Fig. 7. from Guibas & Stolfi (1985) */
-	eref edges[] = {
-		[a*4] = ref(g, 3), ref(g, 2), ref(a, 2), ref(a, 1),
-		[b*4] = ref(h, 3), ref(a, 0), ref(a, 3), ref(c, 2),
-		[c*4] = ref(d, 3), ref(b, 0), ref(b, 3), ref(b, 2),
-		[d*4] = ref(c, 3), ref(h, 0), ref(c, 1), ref(c, 0),
-		[e*4] = ref(d, 0), ref(e, 3), ref(e, 2), ref(d, 1),
-		[f*4] = ref(e, 0), ref(g, 1), ref(h, 1), ref(e, 1),
-		[g*4] = ref(f, 2), ref(f, 1), ref(f, 0), ref(h, 2),
-		[h*4] = ref(f, 3), ref(g, 0), ref(b, 1), ref(d, 2)
+	struct quadedge edges[] = {
+		[a] = { { ref(g, 3), ref(g, 2), ref(a, 2), ref(a, 1) } },
+		[b] = { { ref(h, 3), ref(a, 0), ref(a, 3), ref(c, 2) } },
+		[c] = { { ref(d, 3), ref(b, 0), ref(b, 3), ref(b, 2) } },
+		[d] = { { ref(c, 3), ref(h, 0), ref(c, 1), ref(c, 0) } },
+		[e] = { { ref(d, 0), ref(e, 3), ref(e, 2), ref(d, 1) } },
+		[f] = { { ref(e, 0), ref(g, 1), ref(h, 1), ref(e, 1) } },
+		[g] = { { ref(f, 2), ref(f, 1), ref(f, 0), ref(h, 2) } },
+		[h] = { { ref(f, 3), ref(g, 0), ref(b, 1), ref(d, 2) } }
 	};
 	struct eset set = {
 		{ edges, edges + length_of(edges), NULL },
-		{ NULL, NULL, NULL },
 		0
 	};
 
@@ -193,3 +193,43 @@ int test_connect_points(void)
 
 	return ok;
 }
+
+int test_reserve_and_reuse_edges(void)
+{
+	float2 p = { 1.0f, 2.0f };
+	struct eset set;
+	void *begin;
+	eref a, b, c;
+	size_t i;
+
+	init_eset(&set);
+	if (eset_reserve(&set, 100)) { fail_test("allocation failure"); }
+	begin = set.edges.begin;
+	assert_true((uintptr_t)begin % 64 == 0);
+	for (i = 0; i < 100; i++) {
+		if (eset_alloc(&set, 1, &a)) { fail_test("allocation failure"); }
+	}
+	assert_true(set.edges.begin == begin);
+	assert_eq(eset_max_edge(&set), 100);
+
+	/* deleted edges lose their end-points and are allocated again */
+	*org(&set, a) = *dest(&set, a) = &p;
+	eset_delete(&set, a);
+	assert_true(*org(&set, a) == NULL && *dest(&set, a) == NULL);
+	if (eset_alloc(&set, 2, &b, &c)) { fail_test("allocation failure"); }
+	assert_eq(b, a);
+	assert_eq(eset_max_edge(&set), 101);
+	assert_true((uintptr_t)set.edges.begin % 64 == 0);
+
+	/* clearing the set keeps its memory */
+	begin = set.edges.begin;
+	eset_clear(&set);
+	assert_eq(eset_max_edge(&set), 0);
+	if (eset_alloc(&set, 1, &a)) { fail_test("allocation failure"); }
+	assert_eq(a, 0);
+	assert_true(set.edges.begin == begin);
+
+	term_eset(&set);
+
+	return ok;
+}
@@ -1,7 +1,9 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
 
 #include "ok/ok.h"
+#include "base/wbuf.h"
 #include "spline/shape.h"
 #include "test.h"
 
@@ -58,3 +60,140 @@ int test_simplify_simple_concave_shape(void)
 
 	return ok;
 }
+
+int test_shape_bounds_include_all_control_points(void)
+{
+	struct spline_shape s = {
+		.n = 2,
+		.outlines = (struct spline_outline[]) {
+			{
+				.n = 2,
+				.segments = (struct spline_segment[]) {
+					{ {-1.f, 0.f }, {-1.f, 3.f }, 1.f },
+					{ { 0.f, 1.f }, {-0.9f, 0.9f }, 1.f }
+				}
+			},
+			{
+				.n = 1,
+				.segments = (struct spline_segment[]) {
+					{ { 2.f,-2.f }, { 0.f, 0.f }, 1.f }
+				}
+			}
+		}
+	};
+	struct spline_shape empty = { 0, NULL };
+	float bounds[4];
+
+	spline_shape_bounds(bounds, &s);
+	check(bounds[0] == -1.f);
+	check(bounds[1] == -2.f);
+	check(bounds[2] == 2.f);
+	check(bounds[3] == 3.f);
+
+	spline_shape_bounds(bounds, &empty);
+	check(bounds[0] > bounds[2]);
+	check(bounds[1] > bounds[3]);
+
+	return ok;
+}
+
+/* arcs through (x, y) +/- r, rotated by `a` radians, which need no
+   simplification on their own */
+static void make_circle(
+	struct spline_segment dest[4],
+	float x,
+	float y,
+	float r,
+	float a)
+{
+	static float const unit[4][4] = {
+		{ 0.f, 1.f, 1.f, 1.f },
+		{ 1.f, 0.f, 1.f,-1.f },
+		{ 0.f,-1.f,-1.f,-1.f },
+		{-1.f, 0.f,-1.f, 1.f }
+	};
+	float c, s;
+	size_t i;
+
+	c = r * cosf(a);
+	s = r * sinf(a);
+	for (i = 0; i < 4; i++) {
+		dest[i].end[0] = x + c * unit[i][0] - s * unit[i][1];
+		dest[i].end[1] = y + s * unit[i][0] + c * unit[i][1];
+		dest[i].mid[0] = x + c * unit[i][2] - s * unit[i][3];
+		dest[i].mid[1] = y + s * unit[i][2] + c * unit[i][3];
+		dest[i].weight = 1.f;
+	}
+}
+
+int test_simplify_overlapping_outlines(void)
+{
+	struct spline_segment segments[3][4];
+	struct spline_outline outlines[3] = {
+		{ 4, segments[0] }, { 4, segments[1] }, { 4, segments[2] }
+	};
+	struct spline_shape s = { 3, outlines };
+	struct spline_shape *simplified;
+
+	/* the first two overlap, and the third is far away */
+	make_circle(segments[0], 0.f, 0.f, 1.f, 0.3f);
+	make_circle(segments[1], 1.5f, 0.5f, 1.f, 0.9f);
+	make_circle(segments[2], 10.f, 10.f, 1.f, 0.3f);
+
+	simplified = spline_simplify_shape(&s);
+	check(simplified != NULL);
+	check(simplified->n == 3);
+	check(simplified->outlines[0].n + simplified->outlines[1].n > 8);
+	check(simplified->outlines[2].n == 4);
+	spline_free_shape(simplified);
+
+	return ok;
+}
+
+int test_flatten_outline_to_polyline(void)
+{
+	struct spline_segment circle[4];
+	struct spline_outline square = {
+		.n = 4,
+		.segments = (struct spline_segment[]) {
+			{ { 0.f, 0.f }, { 1.f, 0.f }, 1.f },
+			{ { 2.f, 0.f }, { 2.f, 1.f }, 1.f },
+			{ { 2.f, 2.f }, { 1.f, 2.f }, 1.f },
+			{ { 0.f, 2.f }, { 0.f, 1.f }, 1.f },
+		}
+	};
+	struct spline_outline outline = { 4, circle };
+	struct wbuf buf;
+	float (*p)[2];
+	double r;
+	long i, n;
+
+	/* straight segments are single lines from one end-point to the
+	   next */
+	wbuf_init(&buf);
+	n = spline_flatten_outline(&buf, &square, 0.01f);
+	check(n == 4);
+	check(wbuf_size(&buf) == 4 * sizeof *p);
+	p = buf.begin;
+	for (i = 0; i < 4; i++) {
+		check(p[i][0] == square.segments[i].end[0]);
+		check(p[i][1] == square.segments[i].end[1]);
+	}
+
+	/* points on a circle, appended after the square */
+	make_circle(circle, 0.f, 0.f, 10.f, 0.f);
+	for (i = 0; i < 4; i++) { circle[i].weight = 1.f / sqrtf(2.f); }
+	n = spline_flatten_outline(&buf, &outline, 0.01f);
+	check(n > 16);
+	check(wbuf_size(&buf) == (size_t)(n + 4) * sizeof *p);
+	p = (float (*)[2])buf.begin + 4;
+	for (i = 0; i < n; i++) {
+		r = hypot(p[i][0], p[i][1]);
+		if (fabs(r - 10.0) > 1e-4) {
+			fail_test("Point %ld is %f from the circle\n", i, r);
+		}
+	}
+	wbuf_term(&buf);
+
+	return ok;
+}
@@ -0,0 +1,335 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "ok/ok.h"
+#include "base/wbuf.h"
+#include "spline/shape.h"
+#include "spline/stroke.h"
+
+#define check(cond) do { if (!(cond)) fail_test(#cond " failed\n"); } while (0)
+
+#define TOLERANCE 0.01f
+
+typedef float xy[2];
+
+/* flatten every outline of `shape` into `buf` and return the number of
+   points of each in `lengths` */
+static size_t flatten(
+	struct wbuf *buf,
+	size_t *lengths,
+	struct spline_shape const *shape)
+{
+	size_t i;
+	long n;
+
+	wbuf_init(buf);
+	for (i = 0; i < shape->n; i++) {
+		n = spline_flatten_outline(buf, shape->outlines + i, TOLERANCE);
+		if (n < 0) { bail_out("Out of memory\n"); }
+		lengths[i] = (size_t)n;
+	}
+	return wbuf_size(buf) / sizeof(xy);
+}
+
+static double segment_distance(
+	float const p[2],
+	float const a[2],
+	float const b[2])
+{
+	double dx, dy, t;
+
+	dx = b[0] - a[0];
+	dy = b[1] - a[1];
+	t = (p[0] - a[0])*dx + (p[1] - a[1])*dy;
+	t = dx*dx + dy*dy > 0.0 ? t / (dx*dx + dy*dy) : 0.0;
+	t = t < 0.0 ? 0.0 : t > 1.0 ? 1.0 : t;
+	return hypot(a[0] + t*dx - p[0], a[1] + t*dy - p[1]);
+}
+
+/* distance from p to the open polyline of n points */
+static double polyline_distance(float const p[2], xy const *line, size_t n)
+{
+	double d, min;
+	size_t i;
+
+	min = HUGE_VAL;
+	for (i = 0; i + 1 < n; i++) {
+		d = segment_distance(p, line[i], line[i + 1]);
+		if (d < min) { min = d; }
+	}
+	return min;
+}
+
+/* a straight segment, with its control point at its end-point */
+static bool is_line(struct spline_segment const *s)
+{
+	return s->weight == 0.f &&
+	       s->mid[0] == s->end[0] && s->mid[1] == s->end[1];
+}
+
+/* even-odd rule for the closed polygons of `lengths` points each */
+static bool is_inside(
+	float const p[2],
+	xy *pts,
+	size_t const *lengths,
+	size_t n)
+{
+	size_t i, j, k;
+	float const *a, *b;
+	bool inside;
+	double x;
+
+	inside = false;
+	for (i = 0; i < n; pts += lengths[i++]) {
+		for (j = 0; j < lengths[i]; j++) {
+			k = (j + 1) % lengths[i];
+			a = pts[j];
+			b = pts[k];
+			if ((a[1] > p[1]) == (b[1] > p[1])) { continue; }
+			x = (p[1] - a[1]) * (b[0] - a[0]) / (b[1] - a[1]);
+			if (p[0] < a[0] + x) { inside = !inside; }
+		}
+	}
+	return inside;
+}
+
+int test_stroke_a_line_with_caps(void)
+{
+	struct spline_segment line[] = {
+		{ { 0.f, 0.f }, { 5.f, 0.f }, 1.f },
+		{ { 10.f, 0.f }, { 0.f, 0.f }, 1.f }
+	};
+	struct spline_outline outline = { 2, line };
+	struct spline_stroke stroke = { 2.f, SPLINE_JOIN_MITER, SPLINE_CAP_BUTT,
+	                                4.f, TOLERANCE };
+	struct spline_shape *shape;
+	struct wbuf buf;
+	size_t i, n, lengths[1];
+	float box[4];
+	xy *p;
+
+	shape = spline_stroke_outline(&outline, 0, &stroke);
+	if (!shape) { bail_out("Out of memory\n"); }
+	spline_shape_bounds(box, shape);
+	check(shape->n == 1);
+	check(shape->outlines[0].n == 4);
+	check(box[0] == 0.f && box[1] == -1.f);
+	check(box[2] == 10.f && box[3] == 1.f);
+	spline_free_shape(shape);
+
+	stroke.cap = SPLINE_CAP_SQUARE;
+	shape = spline_stroke_outline(&outline, 0, &stroke);
+	if (!shape) { bail_out("Out of memory\n"); }
+	spline_shape_bounds(box, shape);
+	check(shape->n == 1);
+	check(box[0] == -1.f && box[1] == -1.f);
+	check(box[2] == 11.f && box[3] == 1.f);
+	spline_free_shape(shape);
+
+	/* every point of round caps is half the width from the line */
+	stroke.cap = SPLINE_CAP_ROUND;
+	shape = spline_stroke_outline(&outline, 0, &stroke);
+	if (!shape) { bail_out("Out of memory\n"); }
+	check(shape->n == 1);
+	n = flatten(&buf, lengths, shape);
+	p = buf.begin;
+	check(n > 8);
+	for (i = 0; i < n; i++) {
+		if (fabs(segment_distance(p[i], line[0].end, line[1].end) - 1.0)
+		    > 1e-5) {
+			fail_test("Point %zu (%f, %f) is off\n",
+			          i, p[i][0], p[i][1]);
+		}
+	}
+	wbuf_term(&buf);
+	spline_free_shape(shape);
+
+	return ok;
+}
+
+int test_stroke_a_circle_exactly(void)
+{
+	float const w = 1.f / sqrtf(2.f);
+	struct spline_segment circle[] = {
+		{ { 10.f, 0.f }, { 10.f, 10.f }, w },
+		{ { 0.f, 10.f }, { -10.f, 10.f }, w },
+		{ { -10.f, 0.f }, { -10.f, -10.f }, w },
+		{ { 0.f, -10.f }, { 10.f, -10.f }, w }
+	};
+	struct spline_outline outline = { 4, circle };
+	struct spline_stroke stroke = { 2.f, SPLINE_JOIN_BEVEL, SPLINE_CAP_BUTT,
+	                                4.f, TOLERANCE };
+	struct spline_shape *shape;
+	struct wbuf buf;
+	size_t i, j, lengths[2];
+	double r[2];
+	xy *p;
+
+	shape = spline_stroke_outline(&outline, 1, &stroke);
+	if (!shape) { bail_out("Out of memory\n"); }
+	check(shape->n == 2);
+	check(shape->outlines[0].n == 4);
+	check(shape->outlines[1].n == 4);
+
+	/* concentric circles, without halving any segment */
+	(void)flatten(&buf, lengths, shape);
+	p = buf.begin;
+	r[0] = hypot(p[0][0], p[0][1]);
+	r[1] = hypot(p[lengths[0]][0], p[lengths[0]][1]);
+	check(fabs(fabs(r[0] - r[1]) - 2.0) < 1e-5);
+	for (i = 0; i < 2; i++) {
+		for (j = 0; j < lengths[i]; j++, p++) {
+			if (fabs(hypot(p[0][0], p[0][1]) - r[i]) > 1e-4) {
+				fail_test("Point %zu of outline %zu is off\n",
+				          j, i);
+			}
+		}
+	}
+	wbuf_term(&buf);
+	spline_free_shape(shape);
+
+	return ok;
+}
+
+int test_trim_the_inner_corners_of_a_square(void)
+{
+	static enum spline_join const joins[] = {
+		SPLINE_JOIN_MITER, SPLINE_JOIN_BEVEL, SPLINE_JOIN_ROUND
+	};
+	static size_t const outer_length[] = { 12, 8, 8 };
+
+	struct spline_segment square[] = {
+		{ { -10.f, -10.f }, { 0.f, -10.f }, 1.f },
+		{ { 10.f, -10.f }, { 10.f, 0.f }, 1.f },
+		{ { 10.f, 10.f }, { 0.f, 10.f }, 1.f },
+		{ { -10.f, 10.f }, { -10.f, 0.f }, 1.f }
+	};
+	struct spline_outline outline = { 4, square };
+	struct spline_stroke stroke = { 2.f, SPLINE_JOIN_MITER, SPLINE_CAP_BUTT,
+	                                4.f, TOLERANCE };
+	struct spline_shape *shape;
+	struct wbuf buf;
+	size_t i, j, k, lengths[2];
+	float box[4];
+	double d;
+	xy *p;
+
+	for (k = 0; k < sizeof joins / sizeof *joins; k++) {
+		stroke.join = joins[k];
+		shape = spline_stroke_outline(&outline, 1, &stroke);
+		if (!shape) { bail_out("Out of memory\n"); }
+		check(shape->n == 2);
+
+		/* the left side is inside the counter-clockwise square */
+		check(shape->outlines[0].n == 4);
+		check(shape->outlines[1].n == outer_length[k]);
+		(void)flatten(&buf, lengths, shape);
+		p = buf.begin;
+		for (i = 0; i < 2; i++) {
+			for (j = 0; j < lengths[i]; j++, p++) {
+				d = fmax(fabs(p[0][0]), fabs(p[0][1]));
+				d = i ? d - 11.0 : fabs(d - 9.0);
+				if (d > 1e-4) {
+					fail_test("Point %zu of outline %zu "
+					          "is off\n", j, i);
+				}
+			}
+		}
+		wbuf_term(&buf);
+
+		/* and the sides and corners are lines, unless round */
+		for (i = 0; joins[k] != SPLINE_JOIN_ROUND && i < 2; i++) {
+			for (j = 0; j < shape->outlines[i].n; j++) {
+				if (!is_line(shape->outlines[i].segments + j)) {
+					fail_test("Segment %zu of outline %zu "
+					          "is not a line\n", j, i);
+				}
+			}
+		}
+
+		spline_shape_bounds(box, shape);
+		check(box[0] == -11.f && box[1] == -11.f);
+		check(box[2] == 11.f && box[3] == 11.f);
+		spline_free_shape(shape);
+	}
+
+	return ok;
+}
+
+int test_stroke_curves_within_tolerance(void)
+{
+	struct spline_segment path[] = {
+		{ { 0.f, 0.f }, { 10.f, 10.f }, 0.5f },
+		{ { 20.f, 0.f }, { 20.f, -5.f }, 1.f },
+		{ { 20.f, -10.f }, { 10.f, -20.f }, 1.5f },
+		{ { 0.f, -10.f }, { 5.f, -5.f }, 0.8f }
+	};
+	struct spline_outline outline = { 4, path };
+	struct spline_stroke stroke = { 2.f, SPLINE_JOIN_ROUND, SPLINE_CAP_ROUND,
+	                                4.f, TOLERANCE };
+	struct spline_shape *shape;
+	struct wbuf centre, buf;
+	size_t i, k, n, m, lengths[2];
+	float q[2];
+	double d, nx, ny, len;
+	xy *c, *p;
+	int closed;
+
+	for (closed = 0; closed < 2; closed++) {
+		shape = spline_stroke_outline(&outline, closed, &stroke);
+		if (!shape) { bail_out("Out of memory\n"); }
+		check(shape->n == (size_t)(closed ? 2 : 1));
+
+		/* a fine polyline of the path, closed or not */
+		wbuf_init(&centre);
+		if (spline_flatten_outline(&centre, &outline, 1e-4f) < 0) {
+			bail_out("Out of memory\n");
+		}
+		if (closed && !wbuf_write(&centre, path[0].end, sizeof(xy))) {
+			bail_out("Out of memory\n");
+		}
+		c = centre.begin;
+		m = wbuf_size(&centre) / sizeof *c;
+		while (!closed && (c[m-1][0] != path[3].end[0] ||
+		                   c[m-1][1] != path[3].end[1])) {
+			/* leave out the last segment */
+			m--;
+		}
+
+		/* the boundary is half the width from the path */
+		n = flatten(&buf, lengths, shape);
+		p = buf.begin;
+		for (i = 0; i < n; i++) {
+			d = polyline_distance(p[i], (xy const *)c, m);
+			if (fabs(d - 1.0) > 3.0 * TOLERANCE) {
+				fail_test("Point %zu (%f, %f) is %f away\n",
+				          i, p[i][0], p[i][1], d);
+			}
+		}
+
+		/* and the stroke covers the path without holes */
+		for (i = 0; i + 1 < m; i++) {
+			nx = c[i][1] - c[i+1][1];
+			ny = c[i+1][0] - c[i][0];
+			len = hypot(nx, ny);
+			if (len == 0.0) { continue; }
+			for (k = 0; k < 3; k++) {
+				d = (k - 1.0) * 0.5 / len;
+				q[0] = c[i][0] + nx * d;
+				q[1] = c[i][1] + ny * d;
+				p = buf.begin;
+				if (!is_inside(q, p, lengths, shape->n)) {
+					fail_test("(%f, %f) is not covered\n",
+					          q[0], q[1]);
+				}
+			}
+		}
+		wbuf_term(&buf);
+		wbuf_term(&centre);
+		spline_free_shape(shape);
+	}
+
+	return ok;
+}
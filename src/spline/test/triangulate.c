@@ -265,14 +265,14 @@ int test_triangulate_polygon(void)
 	for (i = 0; i < length_of(cases); i++) {
 		vertices = cases[i].vertices;
 		nvertex = cases[i].nvertex;
+		eset_clear(&set);
 		edge = simple_polygon(&set, vertices, nvertex);
 		ntriangles = triangulate_polygon(&set, edge);
 		if (ntriangles < 0) {
 			fail_test("%s: triangulation failed\n", cases[i].name);
 		}
 		nedge = ntriangles + nvertex;
-		triangle_set = make_triangles(&set, edge, nedge, vertices,
-		                               nvertex);
+		triangle_set = make_triangles(&set, nedge, vertices, nvertex);
 		if (triangle_set->n != cases[i].expected_triangles) {
 			fail_test("%s: expected %zd triangles, got %zd\n",
 			          cases[i].name,
@@ -316,14 +316,16 @@ int test_apply_constraints(void)
 	};
 
 	struct eset set[1];
+	struct wbuf buf;
 	eref e, le, re, *emap;
 	int edges;
 
 	init_eset(set);
+	wbuf_init(&buf);
 
 	edges = delauney(set, spine, length_of(points), &le, &re);
 	if (edges < 0) { fail_test("delauney\n"); }
-	emap = make_emap(set, le, points, length_of(points));
+	emap = make_emap(&buf, set, le, points, length_of(points));
 	if (!emap) { fail_test("malloc\n"); }
 	if (add_constrained_edge(set, A, J, points, emap) != J) {
 		fail_test("constrain\n");
@@ -343,8 +345,381 @@ int test_apply_constraints(void)
 	} while (e != emap[J]);
 	if (ok) { fail_test("vertex J is not connected to A\n"); }
 
-	free(emap);
+	wbuf_term(&buf);
 	term_eset(set);
 
 	return ok;
 }
+
+#define INCREMENTAL_POINTS 2000
+#define SET_POINTS 64
+
+static float frand(float lo, float hi)
+{
+	return lo + (float)rand() / RAND_MAX * (hi - lo);
+}
+
+static bool has_edge(struct triangle_set const *t, unsigned a, unsigned b)
+{
+	size_t i;
+	int j;
+	unsigned const *p;
+
+	for (i = 0; i < t->n; i++) {
+		p = t->indices[i];
+		for (j = 0; j < 3; j++) {
+			if ((p[j] == a && p[(j + 1) % 3] == b) ||
+			    (p[j] == b && p[(j + 1) % 3] == a)) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+int test_insert_points_incrementally(void)
+{
+	static float const bounds[] = { 0.f, 0.f, 100.f, 100.f };
+
+	float (*v)[2];
+	struct triangulation *t;
+	struct triangle_set *triangles;
+	size_t i;
+	long index;
+
+	v = malloc(INCREMENTAL_POINTS * sizeof *v);
+	t = triangulation_make(bounds);
+	if (!v || !t) { bail_out("Out of memory\n"); }
+
+	srand(1);
+	for (i = 0; i < INCREMENTAL_POINTS; i++) {
+		v[i][X] = frand(0.f, 100.f);
+		v[i][Y] = frand(0.f, 100.f);
+		index = triangulation_insert_point(t, v[i]);
+		if (index != (long)i) {
+			fail_test("Point %zu: got index %ld\n", i, index);
+		}
+	}
+	if (triangulation_insert_point(t, v[10]) != 10) {
+		fail_test("Expected the index of the earlier point\n");
+	}
+	if (triangulation_insert_point(t, (float[]){ 101.f, 50.f }) >= 0) {
+		fail_test("Expected failure outside of the bounds\n");
+	}
+
+	triangles = triangulation_triangles(t);
+	if (!triangles) { fail_test("No triangles\n"); }
+	check_delauney("incremental", (float2 *)v, INCREMENTAL_POINTS,
+	               triangles);
+
+	triangle_set_free(triangles);
+	triangulation_free(t);
+	free(v);
+	return ok;
+}
+
+int test_insert_and_remove_constraints(void)
+{
+	static float const bounds[] = { 0.f, 0.f, 100.f, 100.f };
+	enum { NSTAR = 24, NPOINTS = NSTAR + 400 };
+
+	float (*v)[2], a, r;
+	struct triangulation *t;
+	struct triangle_set *triangles;
+	size_t i;
+
+	v = malloc(NPOINTS * sizeof *v);
+	t = triangulation_make(bounds);
+	if (!v || !t) { bail_out("Out of memory\n"); }
+
+	/* a star among random points */
+	srand(2);
+	for (i = 0; i < NPOINTS; i++) {
+		if (i < NSTAR) {
+			a = 2.f * 3.14159265f * i / NSTAR;
+			r = i % 2 ? 15.f : 45.f;
+			v[i][X] = 50.f + r * cosf(a);
+			v[i][Y] = 50.f + r * sinf(a);
+		} else {
+			v[i][X] = frand(0.f, 100.f);
+			v[i][Y] = frand(0.f, 100.f);
+		}
+		if (triangulation_insert_point(t, v[i]) != (long)i) {
+			fail_test("Could not insert point %zu\n", i);
+		}
+	}
+	for (i = 0; i < NSTAR; i++) {
+		if (triangulation_insert_edge(t, i, (i + 1) % NSTAR)) {
+			fail_test("Could not insert edge %zu\n", i);
+		}
+	}
+	if (!triangulation_insert_edge(t, 0, NSTAR / 4)) {
+		fail_test("Expected failure to cross a constraint\n");
+	}
+
+	triangles = triangulation_triangles(t);
+	if (!triangles) { fail_test("No triangles\n"); }
+	for (i = 0; i < NSTAR; i++) {
+		if (!has_edge(triangles, i, (i + 1) % NSTAR)) {
+			fail_test("Missing edge %zu\n", i);
+		}
+	}
+	for (i = 0; i < triangles->n; i++) {
+		if (!is_ccw(v[triangles->indices[i][0]],
+		            v[triangles->indices[i][1]],
+		            v[triangles->indices[i][2]])) {
+			fail_test("Triangle %zu is not counterclockwise\n", i);
+		}
+	}
+	triangle_set_free(triangles);
+
+	/* back to the unconstrained triangulation */
+	for (i = 0; i < NSTAR; i++) {
+		if (triangulation_remove_edge(t, (i + 1) % NSTAR, i)) {
+			fail_test("Could not remove edge %zu\n", i);
+		}
+	}
+	if (!triangulation_remove_edge(t, 0, 1)) {
+		fail_test("Expected failure to remove a removed edge\n");
+	}
+	triangles = triangulation_triangles(t);
+	if (!triangles) { fail_test("No triangles\n"); }
+	check_delauney("removed constraints", (float2 *)v, NPOINTS, triangles);
+
+	triangle_set_free(triangles);
+	triangulation_free(t);
+	free(v);
+	return ok;
+}
+
+int test_split_constraints_at_points(void)
+{
+	static float const bounds[] = { 0.f, 0.f, 100.f, 100.f };
+	static float const v[][2] = {
+		{ 10.f, 50.f }, { 90.f, 50.f }, { 50.f, 50.f },
+		{ 40.f, 10.f }, { 40.f, 90.f }, { 30.f, 50.f }
+	};
+
+	struct triangulation *t;
+	struct triangle_set *triangles;
+	size_t i;
+
+	if (t = triangulation_make(bounds), !t) { bail_out("Out of memory\n"); }
+	for (i = 0; i < 5; i++) { (void)triangulation_insert_point(t, v[i]); }
+
+	/* through point 2, and then point 5 on the constraint */
+	if (triangulation_insert_edge(t, 0, 1)) {
+		fail_test("Could not insert edge\n");
+	}
+	if (triangulation_insert_point(t, v[5]) != 5) {
+		fail_test("Could not insert point on the edge\n");
+	}
+	triangles = triangulation_triangles(t);
+	if (!triangles) { fail_test("No triangles\n"); }
+	if (!has_edge(triangles, 0, 5) || !has_edge(triangles, 5, 2) ||
+	    !has_edge(triangles, 2, 1)) {
+		fail_test("Expected the edge to be split\n");
+	}
+	triangle_set_free(triangles);
+
+	if (!triangulation_insert_edge(t, 3, 4)) {
+		fail_test("Expected failure to cross a constraint\n");
+	}
+	if (triangulation_insert_edge(t, 1, 0) ||
+	    triangulation_remove_edge(t, 0, 1) ||
+	    !triangulation_insert_edge(t, 3, 4)) {
+		fail_test("Expected the edge to remain once\n");
+	}
+	if (triangulation_remove_edge(t, 1, 0) ||
+	    !triangulation_remove_edge(t, 1, 0)) {
+		fail_test("Expected the edge to be removed\n");
+	}
+
+	triangulation_free(t);
+	return ok;
+}
+
+int test_reuse_a_workspace(void)
+{
+	float v[4][SET_POINTS][2];
+	struct triangle_workspace *w;
+	struct triangle_set *expected, *actual;
+	size_t i, j, k;
+
+	w = triangle_workspace_make();
+	if (!w) { bail_out("Out of memory\n"); }
+
+	/* sets of decreasing size, so that the workspace is larger than
+	   necessary for all but the first */
+	srand(3);
+	for (i = 0; i < length_of(v); i++) {
+		for (j = 0; j < SET_POINTS; j++) {
+			v[i][j][X] = frand(0.f, 100.f);
+			v[i][j][Y] = frand(0.f, 100.f);
+		}
+	}
+	for (i = 0; i < length_of(v); i++) {
+		k = SET_POINTS >> i;
+		expected = triangle_set_triangulate((float2 *)v[i], k, NULL, 0);
+		actual = triangle_workspace_triangulate(w, (float2 *)v[i], k,
+		                                        NULL, 0);
+		if (!expected || !actual) { fail_test("No triangles\n"); }
+		if (actual->n != expected->n ||
+		    memcmp(actual->indices, expected->indices,
+		           actual->n * sizeof *actual->indices)) {
+			fail_test("Set %zu: different triangles\n", i);
+		}
+		check_delauney("workspace", (float2 *)v[i], k, actual);
+		triangle_set_free(expected);
+	}
+
+	triangle_workspace_free(w);
+	return ok;
+}
+
+#define GRID_SIZE 16
+#define CIRCLE_POINTS 20
+
+/* a square grid of integer points, where most quadrilaterals have all four
+   corners on a circle and many triples of points are co-linear */
+static void make_grid(float (*v)[2])
+{
+	size_t i, j;
+
+	for (i = 0; i < GRID_SIZE; i++) {
+		for (j = 0; j < GRID_SIZE; j++) {
+			v[i*GRID_SIZE + j][X] = j;
+			v[i*GRID_SIZE + j][Y] = i;
+		}
+	}
+}
+
+/* all integer points on a circle of radius 25 */
+static size_t make_circle(float (*v)[2])
+{
+	static int const pythagorean[][2] = {
+		{ 25, 0 }, { 24, 7 }, { 20, 15 }, { 15, 20 }, { 7, 24 }
+	};
+	size_t i, j, n;
+	int x, y, t;
+
+	for (j = 0, n = 0; j < length_of(pythagorean); j++) {
+		x = pythagorean[j][0];
+		y = pythagorean[j][1];
+		/* rotate a quarter of a turn at a time */
+		for (i = 0; i < 4; i++, n++) {
+			v[n][X] = 100 + x;
+			v[n][Y] = 100 + y;
+			t = x;
+			x = -y;
+			y = t;
+		}
+	}
+	return n;
+}
+
+int test_triangulate_degenerate_points(void)
+{
+	static unsigned const diagonal[][2] = {
+		{ 0, GRID_SIZE*GRID_SIZE - 1 }
+	};
+
+	float v[GRID_SIZE*GRID_SIZE][2], circle[CIRCLE_POINTS][2];
+	struct triangle_set *t;
+	size_t i, n;
+
+	make_grid(v);
+	t = triangle_set_triangulate((float2 *)v, length_of(v), NULL, 0);
+	if (!t) { fail_test("Grid was not triangulated\n"); }
+	if (t->n != 2 * (GRID_SIZE - 1) * (GRID_SIZE - 1)) {
+		fail_test("Grid: expected %d triangles, got %zu\n",
+		          2 * (GRID_SIZE - 1) * (GRID_SIZE - 1), t->n);
+	}
+	check_delauney("grid", (float2 *)v, length_of(v), t);
+	triangle_set_free(t);
+
+	/* the constraint goes through every point on the diagonal */
+	t = triangle_set_triangulate((float2 *)v, length_of(v), diagonal, 1);
+	if (!t) { fail_test("Constrained grid was not triangulated\n"); }
+	for (i = 0; i + 1 < GRID_SIZE; i++) {
+		if (!has_edge(t, i*(GRID_SIZE + 1), (i + 1)*(GRID_SIZE + 1))) {
+			fail_test("Missing diagonal edge %zu\n", i);
+		}
+	}
+	triangle_set_free(t);
+
+	n = make_circle(circle);
+	t = triangle_set_triangulate((float2 *)circle, n, NULL, 0);
+	if (!t) { fail_test("Circle was not triangulated\n"); }
+	if (t->n != n - 2) {
+		fail_test("Circle: expected %zu triangles, got %zu\n",
+		          n - 2, t->n);
+	}
+	check_delauney("circle", (float2 *)circle, n, t);
+	triangle_set_free(t);
+
+	return ok;
+}
+
+int test_insert_degenerate_points_incrementally(void)
+{
+	static float const bounds[] = { 0.f, 0.f, 150.f, 150.f };
+
+	float v[GRID_SIZE*GRID_SIZE][2], grid[GRID_SIZE*GRID_SIZE][2];
+	float circle[CIRCLE_POINTS][2];
+	struct triangulation *t;
+	struct triangle_set *triangles;
+	size_t i, n;
+
+	/* insert the grid points in a scrambled order */
+	make_grid(grid);
+	for (i = 0; i < length_of(v); i++) {
+		(void)memcpy(v[i], grid[(i * 37) % length_of(v)], sizeof *v);
+	}
+	t = triangulation_make(bounds);
+	if (!t) { bail_out("Out of memory\n"); }
+	for (i = 0; i < length_of(v); i++) {
+		if (triangulation_insert_point(t, v[i]) != (long)i) {
+			fail_test("Grid point %zu was not inserted\n", i);
+		}
+	}
+	triangles = triangulation_triangles(t);
+	if (!triangles) { fail_test("No grid triangles\n"); }
+	if (triangles->n != 2 * (GRID_SIZE - 1) * (GRID_SIZE - 1)) {
+		fail_test("Grid: expected %d triangles, got %zu\n",
+		          2 * (GRID_SIZE - 1) * (GRID_SIZE - 1),
+		          triangles->n);
+	}
+	check_delauney("incremental grid", (float2 *)v, length_of(v),
+	               triangles);
+	triangle_set_free(triangles);
+	triangulation_free(t);
+
+	n = make_circle(circle);
+	t = triangulation_make(bounds);
+	if (!t) { bail_out("Out of memory\n"); }
+	for (i = 0; i < n; i++) {
+		if (triangulation_insert_point(t, circle[i]) != (long)i) {
+			fail_test("Circle point %zu was not inserted\n", i);
+		}
+	}
+	/* a constraint across the circle and one along its rim */
+	if (triangulation_insert_edge(t, 0, n / 2) ||
+	    triangulation_insert_edge(t, 1, 2)) {
+		fail_test("Could not constrain the circle\n");
+	}
+	triangles = triangulation_triangles(t);
+	if (!triangles) { fail_test("No circle triangles\n"); }
+	if (triangles->n != n - 2) {
+		fail_test("Circle: expected %zu triangles, got %zu\n",
+		          n - 2, triangles->n);
+	}
+	if (!has_edge(triangles, 0, n / 2)) {
+		fail_test("Missing constraint across the circle\n");
+	}
+	check_delauney("incremental circle", (float2 *)circle, n, triangles);
+	triangle_set_free(triangles);
+	triangulation_free(t);
+
+	return ok;
+}
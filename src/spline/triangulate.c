@@ -42,7 +42,7 @@ static int triangulate_polygon(struct eset *set, eref s)
 	eref a, b, c, d, e, end;
 	float2 *p0, *p1, *p2, *p;
 	double max_dist, dist;
-	struct line2d perim[3];
+	struct line2d diagonal;
 
 	a = s;
 	b = lnext(set, a);
@@ -65,17 +65,17 @@ static int triangulate_polygon(struct eset *set, eref s)
 	}
 	if (eset_alloc(set, 1, &e)) { return -2; }
 	/* find diagonal or create an edge from dest(a) to org(b) */
-	perim[0] = make_line2d(*p1, *p0);
-	perim[1] = make_line2d(*p2, *p1);
-	perim[2] = make_line2d(*p0, *p2);
+	diagonal = make_line2d(*p0, *p2);
 	max_dist = -1.0;
 	c = b;
 	end = lprev(set, a);
 	while (c = lnext(set, c), c != end) {
 		p = *dest(set, c);
-		if (point2d_in_triangle(perim, *p)) {
-			/* candidate found */
-			dist = line2d_dist(perim[2], *p);
+		if (!is_ccw(*p, *p1, *p0) &&
+		    !is_ccw(*p, *p2, *p1) &&
+		    !is_ccw(*p, *p0, *p2)) {
+			/* candidate found, within or on the triangle */
+			dist = line2d_dist(diagonal, *p);
 			if (dist > max_dist) {
 				max_dist = dist;
 				d = c;
@@ -283,28 +283,33 @@ static bool push_triangle(
 	return true;
 }
 
-static struct triangle_set *make_triangles(
+/* Write the counterclockwise triangles of the set to `dest`, visiting the
+   edges in the order in which they are stored rather than by following them
+   around the triangulation, and return the number of triangles. The bit map
+   `left` must be cleared and have room for two bits per quad-edge. */
+static size_t find_triangles(
 	struct eset *set,
-	eref e,
-	size_t nedges,
+	void *left,
 	float2 *vertices,
-	size_t nvert)
+	triangle_indices *dest)
 {
-	eref a, b, *stack, *top;
-	void *origin, *left;
-	size_t ntris, nstack, nbits;
-	struct triangle_set *t;
+	eref e, end;
 	triangle_indices *p;
-	struct memblk blk[2];
 
-	assert(set != NULL);
-	assert(nvert >= 2);
+	end = eset_max_edge(set) * 4;
+	for (e = 0, p = dest; e < end; e += 2) {
+		/* deleted edges have no end-points */
+		if (!*org(set, e)) { continue; }
+		if (push_triangle(set, left, vertices, e, p)) { p++; }
+	}
+	return p - dest;
+}
 
-	/* is there even a single triangle? */
-	if (nedges < nvert) { return NULL; }
+static struct triangle_set *new_triangle_set(size_t ntris)
+{
+	struct triangle_set *t;
+	struct memblk blk[2];
 
-	/* by euler's characteristic (ignoring the exterior face) */
-	ntris = nedges - nvert + 1;
         if (memblk_init(blk+0, 1, sizeof(*t))) { return NULL; }
         if (memblk_push(blk+1, ntris, sizeof(*t->indices), alignof(*t->indices))) {
                 return NULL;
@@ -312,37 +317,31 @@ static struct triangle_set *make_triangles(
         if (t = malloc(blk[1].extent), !t) { return NULL; }
 	t->n = ntris;
         t->indices = memblk_offset(t, blk[1]);
+	return t;
+}
 
-	/* stack to keep one outgoing edge of a vertex and a bit map for
-	   visited ones */
-	nstack = sizeof(eref) * (nvert - 1);
-	nbits = bits_size(eset_max_edge(set)*2);
-	top = stack = malloc(nstack + nbits*2);
-	if (!top) { return free(t), NULL; }
-	origin = memset((char *)stack + nstack, 0, nbits*2);
-	left = (char *)stack + nstack + nbits;
-
-	/* push starting edge */
-	*top++ = e;
-	mark_orbit(origin, set, e, onext);
-
-	/* visit every vertex */
-	p = t->indices;
-	do {
-		a = *--top;
-		b = a;
-		do {
-			/* for each outgoing edge */
-			b = onext(set, b);
-			if (push_triangle(set, left, vertices, b, p)) { p++; }
-			if (!bits_get(origin, sym(b) >> 1)) {
-				*top++ = sym(b);
-				mark_orbit(origin, set, sym(b), onext);
-			}
-		} while (b != a);
-	} while (top != stack);
-	t->n = p - t->indices;
-	free(stack);
+static struct triangle_set *make_triangles(
+	struct eset *set,
+	size_t nedges,
+	float2 *vertices,
+	size_t nvert)
+{
+	void *left;
+	struct triangle_set *t;
+
+	assert(set != NULL);
+	assert(nvert >= 2);
+
+	/* is there even a single triangle? */
+	if (nedges < nvert) { return NULL; }
+
+	/* by euler's characteristic (ignoring the exterior face) */
+	t = new_triangle_set(nedges - nvert + 1);
+	if (!t) { return NULL; }
+	left = calloc(bits_size(eset_max_edge(set)*2), 1);
+	if (!left) { return free(t), NULL; }
+	t->n = find_triangles(set, left, vertices, t->indices);
+	free(left);
 	return t;
 }
 
@@ -366,12 +365,16 @@ static int vertex_cmp(void const *a, void const *b)
 	return res ? res : axis_cmp(va, vb, Y);
 }
 
-static float2 **sorted_vertices(float2 *vertices, size_t nmemb)
+static float2 **sorted_vertices(
+	struct wbuf *buf,
+	float2 *vertices,
+	size_t nmemb)
 {
 	float2 **v;
 	size_t i;
 
-	v = malloc(nmemb * sizeof *v);
+	wbuf_rewind(buf);
+	v = wbuf_alloc(buf, nmemb * sizeof *v);
 	if (!v) { return NULL; }
 	for (i = 0; i < nmemb; i++) { v[i] = vertices + i; }
 	qsort(v, nmemb, sizeof *v, vertex_cmp);
@@ -381,10 +384,10 @@ static float2 **sorted_vertices(float2 *vertices, size_t nmemb)
 /* Create edge from *(vertices + from) to *(vertices + to), removing any edges
    that gets in the way. It is assumed that edge is part of a triangulation
    which forms a convex hull of the points, such that only internal edges can
-   be removed. If the edge to be created is too close to a point, then fail by
-   returning the index of the point that is too close. The triangulation has
-   likely already been botched at this point. Return negative on memory
-   allocation error. Return `to` on success. */
+   be removed. If the edge passes through a point, then the edge to that point
+   is created instead and the index of the point is returned, from which the
+   rest of the edge can be created. Return negative on memory allocation
+   error. Return `to` on success. */
 static ptrdiff_t add_constrained_edge(
 	struct eset *set,
 	ptrdiff_t from,
@@ -393,8 +396,7 @@ static ptrdiff_t add_constrained_edge(
 	eref *emap)
 {
 	eref e, start, next, new_edge;
-	float2 *source, *target;
-	struct line2d l;
+	float2 *source, *target, *p;
 	double next_dist, dist;
 	ptrdiff_t v;
 
@@ -402,27 +404,39 @@ static ptrdiff_t add_constrained_edge(
 	source = *org(set, next);
 	target = vertices + to;
 	if (source == target) { return to; }
-	l = make_line2d(*source, *target);
 
 	/* Find edge to vertex left of the new edge. In a counter-clockwise
 	   order, the edge to the first vertex on the negative side of the line
 	   where the previous one was on the positive side is the closest one
-	   to the left. */
+	   to the left. Distances are signed like those of a line from source
+	   to target, positive to the right. */
 	dist = next_dist = -1.0;
 	while (dist < 0.0 || next_dist > 0.0) {
 		e = next;
 		dist = next_dist;
 		next = onext(set, e);
-		if (*dest(set, next) == target) { return to; }
-		next_dist = line2d_dist(l, **dest(set, next));
-		/* FIXME: if next_dist is too close to line, fail */
+		p = *dest(set, next);
+		if (p == target) { return to; }
+		next_dist = orient2d(*target, *source, *p);
+		if (next_dist == 0.0) {
+			/* on the line, either along the edge or behind it */
+			if ((X[*p] - X[*source])*(X[*target] - X[*source]) +
+			    (Y[*p] - Y[*source])*(Y[*target] - Y[*source]) > 0.0) {
+				return p - vertices;
+			}
+			next_dist = -1.0;
+		}
 	}
 	start = e;
 
 	/* follow the orbit of lnext removing any crossing edges on the way */
 	while (next = lnext(set, e), *dest(set, next) != target) {
-		dist = line2d_dist(l, **dest(set, next));
-		/* FIXME: if dist is too close to line, fail */
+		dist = orient2d(*target, *source, **dest(set, next));
+		if (dist == 0.0) {
+			/* the edge passes through the point, so end it there */
+			target = *dest(set, next);
+			break;
+		}
 		if (dist < 0.0) {
 			/* make sure it's not part of emap */
 			v = *org(set, next) - vertices;
@@ -447,10 +461,11 @@ static ptrdiff_t add_constrained_edge(
 	if (triangulate_polygon(set, new_edge) < 0) { return -2; }
 	if (triangulate_polygon(set, sym(new_edge)) < 0) { return -3; }
 
-	return to;
+	return target - vertices;
 }
 
 static eref *make_emap(
+	struct wbuf *buf,
 	struct eset *set,
 	eref edge,
 	float2 *vertices,
@@ -461,7 +476,8 @@ static eref *make_emap(
 
 	/* stack of edges for traversing graph, and use emap to keep track
 	   of which vertices have been visited */
-	emap = malloc(sizeof(eref) * (2*vertex_count - 1));
+	wbuf_rewind(buf);
+	emap = wbuf_alloc(buf, sizeof(eref) * (2*vertex_count - 1));
 	if (!emap) { return NULL; }
 	top = stack = emap + vertex_count;
 	for (i = 0; i < vertex_count; i++) { emap[i] = -1; }
@@ -486,6 +502,7 @@ static eref *make_emap(
 }
 
 static int add_constraints(
+	struct wbuf *buf,
 	struct eset *set,
 	eref edge,
 	float2 *vertices,
@@ -493,66 +510,135 @@ static int add_constraints(
 	unsigned const (*constraints)[2],
 	size_t constraint_count)
 {
-	int res;
 	eref *emap;
 	size_t i;
-	unsigned o, n, d;
+	unsigned o, d;
+	ptrdiff_t n;
 
 	assert(set != NULL);
 	assert(constraints != NULL);
 	assert(constraint_count > 0);
 
 	/* check all constraints */
-	res = 0;
-	emap = make_emap(set, edge, vertices, vertex_count);
+	emap = make_emap(buf, set, edge, vertices, vertex_count);
 	if (!emap) { return -1; }
 	for (i = 0; i < constraint_count; i++) {
 		o = constraints[i][0];
 		d = constraints[i][1];
 		if (o == d) { continue; }
-		if (o >= vertex_count || d >= vertex_count) {
-			res = -1;
-			goto fail;
-		}
-		n = add_constrained_edge(set, o, d, vertices, emap);
-		if (n != d) {
-			res = -1;
-			goto fail;
-		}
+		if (o >= vertex_count || d >= vertex_count) { return -1; }
+		/* one part at a time if the edge passes through points */
+		do {
+			n = add_constrained_edge(set, o, d, vertices, emap);
+			if (n < 0) { return -1; }
+			o = n;
+		} while (o != d);
 	}
-fail:	free(emap);
+	return 0;
+}
 
-	return res;
+/* memory kept between calls of triangle_workspace_triangulate */
+struct triangle_workspace
+{
+	struct eset set;
+	struct wbuf sorted, scratch, indices;
+	struct triangle_set triangles;
+};
+
+static void init_workspace(struct triangle_workspace *w)
+{
+	init_eset(&w->set);
+	wbuf_init(&w->sorted);
+	wbuf_init(&w->scratch);
+	wbuf_init(&w->indices);
 }
 
-struct triangle_set *triangle_set_triangulate(
+static void term_workspace(struct triangle_workspace *w)
+{
+	term_eset(&w->set);
+	wbuf_term(&w->sorted);
+	wbuf_term(&w->scratch);
+	wbuf_term(&w->indices);
+}
+
+struct triangle_workspace *triangle_workspace_make(void)
+{
+	struct triangle_workspace *w;
+
+	if (w = malloc(sizeof *w), !w) { return NULL; }
+	init_workspace(w);
+	return w;
+}
+
+void triangle_workspace_free(struct triangle_workspace *w)
+{
+	if (w) { term_workspace(w); }
+	free(w);
+}
+
+struct triangle_set *triangle_workspace_triangulate(
+	struct triangle_workspace *w,
 	float2 *vertices,
 	size_t nvert,
 	unsigned const (*edges)[2],
 	size_t nedge)
 {
 	eref le, re;
-	struct eset set;
 	float2 **v;
-	struct triangle_set *res;
-	int final_edges, err;
+	triangle_indices *indices;
+	void *left;
+	size_t nbits;
+	int final_edges;
+
+	assert(w != NULL);
 
 	if (nvert < 3) { return NULL; }
-	v = sorted_vertices(vertices, nvert);
+	v = sorted_vertices(&w->sorted, vertices, nvert);
 	if (!v) { return NULL; }
-	init_eset(&set);
-	final_edges = delauney(&set, v, nvert, &le, &re);
-	free(v);
-	err = 0;
-	res = NULL;
-	if (final_edges <= 0) { err = -1; }
-	if (err == 0 && edges && nedge > 0) {
-		err = add_constraints(&set, le, vertices, nvert, edges, nedge);
+
+	/* a triangulation of n points has fewer than 3n edges */
+	eset_clear(&w->set);
+	if (eset_reserve(&w->set, 3 * nvert)) { return NULL; }
+	final_edges = delauney(&w->set, v, nvert, &le, &re);
+	if (final_edges <= 0) { return NULL; }
+	if (edges && nedge > 0 &&
+	    add_constraints(&w->scratch, &w->set, le, vertices, nvert,
+	                    edges, nedge)) {
+		return NULL;
 	}
-	if (err == 0) {
-		res = make_triangles(&set, le, final_edges, vertices, nvert);
+	if ((size_t)final_edges < nvert) { return NULL; }
+
+	/* by euler's characteristic (ignoring the exterior face) */
+	wbuf_rewind(&w->indices);
+	indices = wbuf_alloc(&w->indices,
+	                     (final_edges - nvert + 1) * sizeof *indices);
+	nbits = bits_size(eset_max_edge(&w->set)*2);
+	wbuf_rewind(&w->scratch);
+	left = wbuf_alloc(&w->scratch, nbits);
+	if (!indices || !left) { return NULL; }
+	(void)memset(left, 0, nbits);
+
+	w->triangles.n = find_triangles(&w->set, left, vertices, indices);
+	w->triangles.indices = indices;
+	return &w->triangles;
+}
+
+struct triangle_set *triangle_set_triangulate(
+	float2 *vertices,
+	size_t nvert,
+	unsigned const (*edges)[2],
+	size_t nedge)
+{
+	struct triangle_workspace w;
+	struct triangle_set *t, *res;
+
+	init_workspace(&w);
+	res = NULL;
+	t = triangle_workspace_triangulate(&w, vertices, nvert, edges, nedge);
+	if (t && (res = new_triangle_set(t->n))) {
+		(void)memcpy(res->indices, t->indices, t->n * sizeof *t->indices);
 	}
-	term_eset(&set);
+	term_workspace(&w);
 	return res;
 }
 
@@ -560,3 +646,574 @@ void triangle_set_free(struct triangle_set *set)
 {
 	free(set);
 }
+
+/* flags kept for each quad-edge of a triangulation */
+#define LIVE 0x80
+#define CONSTRAINTS 0x7f
+
+/* the first points of a triangulation are the corners of a box around its
+   bounds, which keeps every inserted point inside a triangle */
+#define CORNERS 4
+
+struct triangulation
+{
+	struct eset set;
+	float (*vertices)[2];
+	size_t nvert, capacity, nedges;
+
+	/* one flag byte per quad-edge, edges to check for the delauney
+	   property, and edges crossed by a new constraint */
+	struct wbuf marks, queue, crossing;
+
+	/* starting point for locating points */
+	eref last;
+	float bounds[4];
+};
+
+static float2 *vertex(struct triangulation *t, size_t i)
+{
+	return (float2 *)t->vertices + i;
+}
+
+static unsigned char *edge_mark(struct triangulation *t, eref e)
+{
+	return (unsigned char *)t->marks.begin + (e >> 2);
+}
+
+static bool is_same_point(float2 a, float2 b)
+{
+	return X[a] == X[b] && Y[a] == Y[b];
+}
+
+static bool is_inside(float a, float p, float b)
+{
+	return (a < p && p < b) || (b < p && p < a);
+}
+
+/* is p on the line segment from a to b, excluding its end-points? */
+static bool is_between(float2 a, float2 p, float2 b)
+{
+	if (orient2d(a, b, p) != 0.0) { return false; }
+	return X[a] != X[b] ? is_inside(X[a], X[p], X[b])
+	                    : is_inside(Y[a], Y[p], Y[b]);
+}
+
+static int new_edge(struct triangulation *t, eref *e)
+{
+	size_t n, m;
+	void *p;
+
+	if (eset_alloc(&t->set, 1, e)) { return -1; }
+	n = eset_max_edge(&t->set);
+	m = wbuf_size(&t->marks);
+	if (m < n) {
+		if (p = wbuf_alloc(&t->marks, n - m), !p) { return -1; }
+		(void)memset(p, 0, n - m);
+	}
+	*edge_mark(t, *e) = LIVE;
+	t->nedges++;
+	return 0;
+}
+
+static void delete_edge(struct triangulation *t, eref e)
+{
+	*edge_mark(t, e) = 0;
+	eset_delete(&t->set, e);
+	t->nedges--;
+}
+
+static int push_edge(struct triangulation *t, eref e)
+{
+	return wbuf_write(&t->queue, &e, sizeof e) ? 0 : -1;
+}
+
+/* push the edges of the face on the left of e, except e itself */
+static int push_face(struct triangulation *t, eref e)
+{
+	eref f;
+
+	for (f = lnext(&t->set, e); f != e; f = lnext(&t->set, f)) {
+		if (push_edge(t, f)) { return -1; }
+	}
+	return 0;
+}
+
+/* make room for another vertex, moving the end-points of every edge if the
+   vertex array is reallocated */
+static int reserve_vertex(struct triangulation *t)
+{
+	float (*v)[2];
+	float2 **data;
+	eref e, end;
+
+	if (t->nvert < t->capacity) { return 0; }
+	v = malloc(t->capacity * 2 * sizeof *v);
+	if (!v) { return -1; }
+	(void)memcpy(v, t->vertices, t->nvert * sizeof *v);
+	end = eset_max_edge(&t->set) * 4;
+	for (e = 0; e < end; e += 2) {
+		data = org(&t->set, e);
+		if (*data) { *data = (float2 *)v + (*data - vertex(t, 0)); }
+	}
+	free(t->vertices);
+	t->vertices = v;
+	t->capacity *= 2;
+	return 0;
+}
+
+/* swap edge e for the other diagonal of the quadrilateral formed by the
+   triangles on either side of it */
+static void flip(struct eset *set, eref e)
+{
+	eref a, b;
+
+	a = oprev(set, e);
+	b = oprev(set, sym(e));
+	eset_splice(set, e, a);
+	eset_splice(set, sym(e), b);
+	eset_splice(set, e, lnext(set, a));
+	eset_splice(set, sym(e), lnext(set, b));
+	*org(set, e) = *dest(set, a);
+	*dest(set, e) = *dest(set, b);
+}
+
+static bool is_triangle(struct eset *set, eref e)
+{
+	return lnext(set, lnext(set, lnext(set, e))) == e;
+}
+
+/* flip queued edges, and in turn the edges around flipped ones, until the
+   triangles on either side of every unconstrained edge are delauney (Lawson's
+   algorithm) */
+static int legalize(struct triangulation *t)
+{
+	struct eset *set;
+	float2 *a, *b, *c, *d;
+	eref e;
+
+	set = &t->set;
+	while (!wbuf_pop(&t->queue, &e, sizeof e)) {
+		/* deleted or constrained since it was queued? */
+		if (*edge_mark(t, e) != LIVE) { continue; }
+		if (!is_triangle(set, e) || !is_triangle(set, sym(e))) {
+			continue;
+		}
+		a = *org(set, e);
+		b = *dest(set, e);
+		c = *dest(set, lnext(set, e));
+		d = *dest(set, lnext(set, sym(e)));
+		if (!point2d_in_circle(*a, *b, *c, *d)) { continue; }
+		/* only a convex quadrilateral can be flipped */
+		if (!is_ccw(*d, *b, *c) || !is_ccw(*c, *a, *d)) { continue; }
+		flip(set, e);
+		if (push_edge(t, lnext(set, e)) ||
+		    push_edge(t, lprev(set, e)) ||
+		    push_edge(t, lnext(set, sym(e))) ||
+		    push_edge(t, lprev(set, sym(e)))) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/* find the edge which has p as origin or on the boundary of the triangle on
+   its left by looking at every triangle */
+static eref search(struct triangulation *t, float2 p)
+{
+	struct eset *set;
+	eref e, end;
+
+	set = &t->set;
+	end = eset_max_edge(set) * 4;
+	for (e = 0; e < end; e += 2) {
+		if (!(*edge_mark(t, e) & LIVE)) { continue; }
+		if (is_same_point(p, **org(set, e))) { return e; }
+		if (is_triangle(set, e) &&
+		    !is_right_of(set, p, e) &&
+		    !is_right_of(set, p, lnext(set, e)) &&
+		    !is_right_of(set, p, lprev(set, e))) {
+			return e;
+		}
+	}
+	return -1;
+}
+
+/* Find an edge which has p as an end-point, or on the boundary of the triangle
+   on its left, by walking towards p from the last edge (Guibas & Stolfi). A
+   walk in a constrained triangulation might go in circles, and in that case
+   every triangle is searched instead. */
+static eref locate(struct triangulation *t, float2 p)
+{
+	struct eset *set;
+	eref e;
+	size_t i;
+
+	set = &t->set;
+	e = t->last;
+	for (i = 0; i < t->nedges; i++) {
+		if (is_same_point(p, **org(set, e)) ||
+		    is_same_point(p, **dest(set, e))) {
+			return e;
+		} else if (is_right_of(set, p, e)) {
+			e = sym(e);
+		} else if (!is_right_of(set, p, onext(set, e))) {
+			e = onext(set, e);
+		} else if (!is_right_of(set, p, dprev(set, e))) {
+			e = dprev(set, e);
+		} else {
+			return e;
+		}
+	}
+	return search(t, p);
+}
+
+/* find an edge with v as origin */
+static eref vertex_edge(struct triangulation *t, float2 *v)
+{
+	eref e;
+
+	if (e = locate(t, *v), e < 0) { return -1; }
+	if (*org(&t->set, e) == v) { return e; }
+	if (*dest(&t->set, e) == v) { return sym(e); }
+	return -1;
+}
+
+struct triangulation *triangulation_make(float const bounds[4])
+{
+	struct triangulation *t;
+	struct eset *set;
+	float m, (*c)[2];
+	eref e[5];
+	int i;
+
+	assert(bounds != NULL);
+
+	if (t = malloc(sizeof *t), !t) { return NULL; }
+	t->capacity = 64;
+	if (t->vertices = malloc(t->capacity * sizeof *t->vertices),
+	    !t->vertices) {
+		free(t);
+		return NULL;
+	}
+	set = &t->set;
+	init_eset(set);
+	wbuf_init(&t->marks);
+	wbuf_init(&t->queue);
+	wbuf_init(&t->crossing);
+	t->nvert = CORNERS;
+	t->nedges = 0;
+	(void)memcpy(t->bounds, bounds, sizeof t->bounds);
+
+	/* a margin keeps the corners from cutting into the triangulation of
+	   the points along the bounds */
+	m = fmaxf(bounds[2] - bounds[0], bounds[3] - bounds[1]) + 1.f;
+	c = t->vertices;
+	c[0][X] = c[3][X] = bounds[0] - m;
+	c[0][Y] = c[1][Y] = bounds[1] - m;
+	c[1][X] = c[2][X] = bounds[2] + m;
+	c[2][Y] = c[3][Y] = bounds[3] + m;
+
+	/* two triangles in a counter-clockwise box */
+	for (i = 0; i < 5; i++) {
+		if (new_edge(t, e + i)) {
+			triangulation_free(t);
+			return NULL;
+		}
+	}
+	for (i = 0; i < 3; i++) {
+		*org(set, e[i]) = vertex(t, i);
+		*dest(set, e[i]) = vertex(t, i + 1);
+	}
+	eset_splice(set, sym(e[0]), e[1]);
+	eset_splice(set, sym(e[1]), e[2]);
+	eset_connect(set, e[2], e[0], e[3]);
+	eset_connect(set, e[1], e[0], e[4]);
+	t->last = e[0];
+	return t;
+}
+
+void triangulation_free(struct triangulation *t)
+{
+	if (!t) { return; }
+	term_eset(&t->set);
+	wbuf_term(&t->marks);
+	wbuf_term(&t->queue);
+	wbuf_term(&t->crossing);
+	free(t->vertices);
+	free(t);
+}
+
+long triangulation_insert_point(struct triangulation *t, float const p[2])
+{
+	struct eset *set;
+	float2 *v, *a, *b, *first;
+	eref e, f, base, start;
+	unsigned char constraints;
+	int i;
+
+	assert(t != NULL);
+	assert(p != NULL);
+
+	if (!(X[p] >= t->bounds[0] && X[p] <= t->bounds[2] &&
+	      Y[p] >= t->bounds[1] && Y[p] <= t->bounds[3])) {
+		return -1;
+	}
+	set = &t->set;
+	if (e = locate(t, p), e < 0) { return -1; }
+	if (is_same_point(p, **org(set, e))) {
+		return *org(set, e) - vertex(t, CORNERS);
+	} else if (is_same_point(p, **dest(set, e))) {
+		return *dest(set, e) - vertex(t, CORNERS);
+	}
+	if (reserve_vertex(t)) { return -1; }
+	(void)memcpy(t->vertices[t->nvert], p, sizeof *t->vertices);
+	v = vertex(t, t->nvert);
+
+	/* a point on an edge is inserted into the quadrilateral formed by
+	   removing it, and any constraint is split in two */
+	a = b = NULL;
+	constraints = 0;
+	for (i = 0, f = e; i < 3; i++, f = lnext(set, f)) {
+		if (!is_ccw(p, **org(set, f), **dest(set, f))) { break; }
+	}
+	if (i < 3) {
+		a = *org(set, f);
+		b = *dest(set, f);
+		constraints = *edge_mark(t, f) & CONSTRAINTS;
+		e = oprev(set, f);
+		t->last = e;
+		delete_edge(t, f);
+	}
+
+	/* the edges of the surrounding polygon might not be delauney after
+	   connecting the point to its corners */
+	wbuf_rewind(&t->queue);
+	if (push_edge(t, e) || push_face(t, e)) { return -1; }
+	if (new_edge(t, &base)) { return -1; }
+	first = *org(set, e);
+	*org(set, base) = first;
+	*dest(set, base) = v;
+	eset_splice(set, base, e);
+	start = base;
+	do {
+		if (new_edge(t, &f)) { return -1; }
+		eset_connect(set, e, sym(base), f);
+		base = f;
+		e = oprev(set, base);
+	} while (lnext(set, e) != start);
+	t->nvert++;
+
+	if (constraints) {
+		f = sym(start);
+		do {
+			if (*dest(set, f) == a || *dest(set, f) == b) {
+				*edge_mark(t, f) |= constraints;
+			}
+			f = onext(set, f);
+		} while (f != sym(start));
+	}
+	t->last = sym(start);
+	if (legalize(t)) { return -1; }
+	return v - vertex(t, CORNERS);
+}
+
+static int add_constraint(struct triangulation *t, eref e)
+{
+	unsigned char *mark = edge_mark(t, e);
+
+	if ((*mark & CONSTRAINTS) == CONSTRAINTS) { return -1; }
+	++*mark;
+	return 0;
+}
+
+/* can e be flipped, i.e. is the quadrilateral formed by the triangles on
+   either side of it convex? */
+static bool is_flippable(struct eset *set, eref e)
+{
+	float2 *a, *b, *c, *d;
+
+	if (!is_triangle(set, e) || !is_triangle(set, sym(e))) { return false; }
+	a = *org(set, e);
+	b = *dest(set, e);
+	c = *dest(set, lnext(set, e));
+	d = *dest(set, lnext(set, sym(e)));
+	return is_ccw(*d, *b, *c) && is_ccw(*c, *a, *d);
+}
+
+/* does e cross the line through va and vb? */
+static bool is_crossing(struct eset *set, eref e, float2 *va, float2 *vb)
+{
+	double o, d;
+
+	o = orient2d(*va, *vb, **org(set, e));
+	d = orient2d(*va, *vb, **dest(set, e));
+	return (o > 0.0 && d < 0.0) || (o < 0.0 && d > 0.0);
+}
+
+/* Constrain the edge from va towards vb to the first point on the way, by
+   flipping the edges crossing it until it is part of the triangulation
+   (Sloan, 1993). Return the point, or NULL on failure. */
+static float2 *insert_edge_part(
+	struct triangulation *t,
+	float2 *va,
+	float2 *vb)
+{
+	struct eset *set;
+	float2 *w;
+	eref e, start, x, y;
+	size_t head, stuck;
+	bool side;
+
+	set = &t->set;
+	if (e = vertex_edge(t, va), e < 0) { return NULL; }
+
+	/* find the edge along the way, or the triangle which is entered */
+	start = e;
+	while (w = *dest(set, e), w != vb && !is_between(*va, *w, *vb)) {
+		if (is_ccw(*vb, *va, *w) &&
+		    is_ccw(*vb, **dest(set, onext(set, e)), *va)) {
+			break;
+		}
+		e = onext(set, e);
+		if (e == start) { return NULL; }
+	}
+	if (w == vb || is_between(*va, *w, *vb)) {
+		return add_constraint(t, e) ? NULL : w;
+	}
+
+	/* collect the crossed edges until the next point is reached */
+	wbuf_rewind(&t->crossing);
+	x = lnext(set, e);
+	while (1) {
+		if (*edge_mark(t, x) & CONSTRAINTS) { return NULL; }
+		if (!wbuf_write(&t->crossing, &x, sizeof x)) { return NULL; }
+		y = sym(x);
+		w = *dest(set, lnext(set, y));
+		if (w == vb || is_between(*va, *w, *vb)) { break; }
+		side = is_ccw(*w, *va, *vb);
+		if (side == is_ccw(**dest(set, y), *va, *vb)) {
+			x = lprev(set, y);
+		} else {
+			x = lnext(set, y);
+		}
+	}
+
+	/* flip crossing edges in convex quadrilaterals until none are left,
+	   and queue the new edges which are not crossing */
+	wbuf_rewind(&t->queue);
+	head = stuck = 0;
+	while (head < wbuf_nmemb(&t->crossing, sizeof x)) {
+		x = ((eref *)t->crossing.begin)[head++];
+		if (is_flippable(set, x)) {
+			flip(set, x);
+			stuck = 0;
+			if (!is_crossing(set, x, va, w)) {
+				if (push_edge(t, x)) { return NULL; }
+				continue;
+			}
+		} else if (++stuck > wbuf_nmemb(&t->crossing, sizeof x) - head) {
+			return NULL;
+		}
+		if (!wbuf_write(&t->crossing, &x, sizeof x)) { return NULL; }
+	}
+
+	/* one of the new edges is the constrained one */
+	for (e = start; *dest(set, e) != w; ) {
+		if (e = onext(set, e), e == start) { return NULL; }
+	}
+	if (add_constraint(t, e)) { return NULL; }
+	t->last = e;
+	return legalize(t) ? NULL : w;
+}
+
+/* find the constraint edge from va towards vb */
+static eref find_constraint(struct triangulation *t, float2 *va, float2 *vb)
+{
+	struct eset *set;
+	float2 *w;
+	eref e, start;
+
+	set = &t->set;
+	if (e = vertex_edge(t, va), e < 0) { return -1; }
+	start = e;
+	do {
+		w = *dest(set, e);
+		if ((*edge_mark(t, e) & CONSTRAINTS) &&
+		    (w == vb || is_between(*va, *w, *vb))) {
+			return e;
+		}
+		e = onext(set, e);
+	} while (e != start);
+	return -1;
+}
+
+static int remove_edge(struct triangulation *t, float2 *va, float2 *vb)
+{
+	float2 *v;
+	eref e;
+
+	/* check every part before changing anything */
+	for (v = va; v != vb; v = *dest(&t->set, e)) {
+		if (e = find_constraint(t, v, vb), e < 0) { return -1; }
+	}
+	wbuf_rewind(&t->queue);
+	for (v = va; v != vb; v = *dest(&t->set, e)) {
+		e = find_constraint(t, v, vb);
+		--*edge_mark(t, e);
+		if (push_edge(t, e)) { return -1; }
+	}
+	return legalize(t);
+}
+
+int triangulation_insert_edge(struct triangulation *t, size_t a, size_t b)
+{
+	float2 *va, *vb, *v, *next;
+
+	assert(t != NULL);
+
+	if (a >= t->nvert - CORNERS || b >= t->nvert - CORNERS) { return -1; }
+	va = vertex(t, a + CORNERS);
+	vb = vertex(t, b + CORNERS);
+	for (v = va; v != vb; v = next) {
+		if (next = insert_edge_part(t, v, vb), !next) {
+			/* undo the parts which were inserted */
+			(void)remove_edge(t, va, v);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+int triangulation_remove_edge(struct triangulation *t, size_t a, size_t b)
+{
+	assert(t != NULL);
+
+	if (a >= t->nvert - CORNERS || b >= t->nvert - CORNERS) { return -1; }
+	if (a == b) { return 0; }
+	return remove_edge(t, vertex(t, a + CORNERS), vertex(t, b + CORNERS));
+}
+
+struct triangle_set *triangulation_triangles(struct triangulation *t)
+{
+	struct triangle_set *res;
+	unsigned *p;
+	size_t i, n;
+	int j;
+
+	assert(t != NULL);
+
+	res = make_triangles(&t->set, t->nedges, vertex(t, 0), t->nvert);
+	if (!res) { return NULL; }
+
+	/* leave out the triangles at the corners of the box */
+	for (i = 0, n = 0; i < res->n; i++) {
+		p = res->indices[i];
+		if (p[0] < CORNERS || p[1] < CORNERS || p[2] < CORNERS) {
+			continue;
+		}
+		for (j = 0; j < 3; j++) { res->indices[n][j] = p[j] - CORNERS; }
+		n++;
+	}
+	res->n = n;
+	return res;
+}
@@ -0,0 +1,7 @@
+# fixed-size pool of worker threads for parallel loops
+if contains "$TAGS" posix; then
+  define_source posix/*.c
+  LDLIBS=-lpthread
+fi
+
+define_ok_test test/tpool.c
@@ -0,0 +1,169 @@
+#undef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "tpool/tpool.h"
+
+struct tpool
+{
+	pthread_mutex_t lock;
+	pthread_cond_t work, done;
+	pthread_t *threads;
+	unsigned nthreads, size;
+	int quit;
+
+	/* current loop, protected by lock */
+	void (*fn)(void *arg, size_t i);
+	void *arg;
+	size_t n, next, finished;
+};
+
+/* Run iterations of the current loop until there are none left. Called with
+   the lock held, and returns with the lock held. */
+static void run_iterations(struct tpool *pool)
+{
+	void (*fn)(void *arg, size_t i);
+	void *arg;
+	size_t i;
+
+	while (pool->next < pool->n) {
+		i = pool->next++;
+		fn = pool->fn;
+		arg = pool->arg;
+		(void)pthread_mutex_unlock(&pool->lock);
+		fn(arg, i);
+		(void)pthread_mutex_lock(&pool->lock);
+		if (++pool->finished == pool->n) {
+			(void)pthread_cond_signal(&pool->done);
+		}
+	}
+}
+
+static void *worker(void *p)
+{
+	struct tpool *pool = p;
+
+	(void)pthread_mutex_lock(&pool->lock);
+	while (!pool->quit) {
+		run_iterations(pool);
+		if (!pool->quit) {
+			(void)pthread_cond_wait(&pool->work, &pool->lock);
+		}
+	}
+	(void)pthread_mutex_unlock(&pool->lock);
+	return NULL;
+}
+
+static void stop_workers(struct tpool *pool)
+{
+	unsigned i;
+
+	(void)pthread_mutex_lock(&pool->lock);
+	pool->quit = 1;
+	(void)pthread_cond_broadcast(&pool->work);
+	(void)pthread_mutex_unlock(&pool->lock);
+	for (i = 0; i < pool->nthreads; i++) {
+		(void)pthread_join(pool->threads[i], NULL);
+	}
+	pool->nthreads = 0;
+}
+
+struct tpool *tpool_make(unsigned nthreads)
+{
+	struct tpool *pool;
+	long ncpu;
+
+	if (nthreads == 0) {
+		ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+		nthreads = ncpu > 0 ? (unsigned)ncpu : 1;
+	}
+
+	pool = malloc(sizeof *pool);
+	if (!pool) { return NULL; }
+	pool->threads = malloc((nthreads - 1) * sizeof *pool->threads + 1);
+	if (!pool->threads) { goto fail_threads; }
+	if (pthread_mutex_init(&pool->lock, NULL)) { goto fail_lock; }
+	if (pthread_cond_init(&pool->work, NULL)) { goto fail_work; }
+	if (pthread_cond_init(&pool->done, NULL)) { goto fail_done; }
+
+	pool->size = nthreads;
+	pool->quit = 0;
+	pool->fn = NULL;
+	pool->arg = NULL;
+	pool->n = pool->next = pool->finished = 0;
+
+	/* the calling thread is the first one of the pool */
+	for (pool->nthreads = 0; pool->nthreads < nthreads - 1; pool->nthreads++) {
+		if (pthread_create(
+				pool->threads + pool->nthreads,
+				NULL,
+				worker,
+				pool)) {
+			goto fail_create;
+		}
+	}
+	return pool;
+
+fail_create:
+	stop_workers(pool);
+	(void)pthread_cond_destroy(&pool->done);
+fail_done:
+	(void)pthread_cond_destroy(&pool->work);
+fail_work:
+	(void)pthread_mutex_destroy(&pool->lock);
+fail_lock:
+	free(pool->threads);
+fail_threads:
+	free(pool);
+	return NULL;
+}
+
+void tpool_free(struct tpool *pool)
+{
+	if (!pool) { return; }
+	stop_workers(pool);
+	(void)pthread_cond_destroy(&pool->done);
+	(void)pthread_cond_destroy(&pool->work);
+	(void)pthread_mutex_destroy(&pool->lock);
+	free(pool->threads);
+	free(pool);
+}
+
+unsigned tpool_size(struct tpool const *pool)
+{
+	return pool ? pool->size : 1;
+}
+
+void tpool_run(
+	struct tpool *pool,
+	size_t n,
+	void fn(void *arg, size_t i),
+	void *arg)
+{
+	size_t i;
+
+	if (!pool || pool->nthreads == 0 || n <= 1) {
+		for (i = 0; i < n; i++) { fn(arg, i); }
+		return;
+	}
+
+	(void)pthread_mutex_lock(&pool->lock);
+	assert(pool->next == pool->n && "tpool_run called concurrently");
+	pool->fn = fn;
+	pool->arg = arg;
+	pool->n = n;
+	pool->next = 0;
+	pool->finished = 0;
+	(void)pthread_cond_broadcast(&pool->work);
+
+	run_iterations(pool);
+	while (pool->finished < pool->n) {
+		(void)pthread_cond_wait(&pool->done, &pool->lock);
+	}
+	(void)pthread_mutex_unlock(&pool->lock);
+}
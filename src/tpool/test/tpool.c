@@ -0,0 +1,73 @@
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "ok/ok.h"
+#include "tpool/tpool.h"
+
+#define COUNT 1000
+
+static void square(void *arg, size_t i)
+{
+	size_t *result = arg;
+	result[i] = i * i;
+}
+
+static int check_squares(struct tpool *pool, size_t n)
+{
+	size_t result[COUNT], i;
+
+	for (i = 0; i < n; i++) { result[i] = 0; }
+	tpool_run(pool, n, square, result);
+	for (i = 0; i < n; i++) {
+		if (result[i] != i * i) {
+			fail_test("%zu: expected %zu, got %zu\n", i, i * i, result[i]);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+int test_run_loop_without_pool(void)
+{
+	if (tpool_size(NULL) != 1) { fail_test("NULL pool size\n"); }
+	return check_squares(NULL, COUNT);
+}
+
+int test_run_loop_on_single_thread(void)
+{
+	struct tpool *pool;
+
+	pool = tpool_make(1);
+	if (!pool) { bail_out("tpool_make failed\n"); }
+	if (tpool_size(pool) != 1) { fail_test("pool size\n"); }
+	(void)check_squares(pool, COUNT);
+	tpool_free(pool);
+	return ok;
+}
+
+int test_run_many_loops_on_many_threads(void)
+{
+	struct tpool *pool;
+	size_t n;
+
+	pool = tpool_make(4);
+	if (!pool) { bail_out("tpool_make failed\n"); }
+	if (tpool_size(pool) != 4) { fail_test("pool size\n"); }
+	for (n = 0; n <= COUNT && ok == 0; n += 37) {
+		(void)check_squares(pool, n);
+	}
+	tpool_free(pool);
+	return ok;
+}
+
+int test_default_pool_size(void)
+{
+	struct tpool *pool;
+
+	pool = tpool_make(0);
+	if (!pool) { bail_out("tpool_make failed\n"); }
+	if (tpool_size(pool) < 1) { fail_test("pool size\n"); }
+	(void)check_squares(pool, COUNT);
+	tpool_free(pool);
+	return ok;
+}
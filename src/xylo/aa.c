@@ -1,7 +1,29 @@
+#include <assert.h>
+#include <stddef.h>
+
 #include "glapi/core.h"
+#include "tempo/tempo.h"
 #include "types.h"
+#include "aa.h"
 #include "xylo/aa.h"
 
+/* weight of a new drawing time in the smoothed average */
+#define SMOOTHING 0.25
+
+/* consecutive frames with time to spare before raising the quality */
+#define UPGRADE_FRAMES 30
+
+/* share of the budget a better mode is expected to use at most before
+   switching to it, which leaves a margin against switching back */
+#define UPGRADE_HEADROOM 0.8
+
+/* fill cost of each fixed mode relative to XYLO_AA_NONE */
+static double const mode_cost[] = {
+	[XYLO_AA_NONE] = 1.0,
+	[XYLO_AA_QUINCUNX] = 2.0,
+	[XYLO_AA_RGSS] = 4.0
+};
+
 enum xylo_aa xylo_get_aa(struct xylo *xylo)
 {
 	return xylo->aa;
@@ -11,3 +33,168 @@ void xylo_set_aa(struct xylo *xylo, enum xylo_aa aa)
 {
 	xylo->aa = aa;
 }
+
+void xylo_set_aa_budget(struct xylo *xylo, unsigned long usec)
+{
+	assert(xylo != NULL);
+	xylo_init_aa_governor(&xylo->governor, usec);
+}
+
+enum xylo_aa xylo_get_current_aa(struct xylo *xylo)
+{
+	assert(xylo != NULL);
+	return xylo->current_aa;
+}
+
+void xylo_init_aa_governor(
+	struct xylo_aa_governor *governor,
+	unsigned long budget)
+{
+	assert(governor != NULL);
+	governor->budget = budget;
+	governor->average = -1.0;
+	governor->mode = XYLO_AA_RGSS;
+	governor->calm = 0;
+}
+
+static void switch_mode(struct xylo_aa_governor *governor, int mode)
+{
+	/* a guess until the new mode has been measured */
+	governor->average *= mode_cost[mode] / mode_cost[governor->mode];
+	governor->mode = mode;
+	governor->calm = 0;
+}
+
+int xylo_aa_governor_update(
+	struct xylo_aa_governor *governor,
+	int mode,
+	double usec)
+{
+	double budget, next;
+
+	assert(governor != NULL);
+
+	/* measured before the latest switch */
+	if (mode != governor->mode) { return governor->mode; }
+
+	if (governor->average < 0.0) {
+		governor->average = usec;
+	} else {
+		governor->average += (usec - governor->average) * SMOOTHING;
+	}
+
+	budget = governor->budget;
+	if (governor->average > budget) {
+		if (mode > XYLO_AA_NONE) { switch_mode(governor, mode - 1); }
+		governor->calm = 0;
+	} else if (mode < XYLO_AA_RGSS) {
+		next = governor->average * mode_cost[mode + 1] / mode_cost[mode];
+		if (next > budget * UPGRADE_HEADROOM) {
+			governor->calm = 0;
+		} else if (++governor->calm >= UPGRADE_FRAMES) {
+			switch_mode(governor, mode + 1);
+		}
+	}
+	return governor->mode;
+}
+
+void xylo_init_aa_timer(
+	struct gl_core33 const *restrict gl,
+	struct xylo_aa_timer *timer)
+{
+	size_t i;
+
+	assert(gl != NULL);
+	assert(timer != NULL);
+
+	gl->GenQueries(AA_TIMER_RING, timer->queries);
+	gl->GetQueryiv(GL_TIME_ELAPSED, GL_QUERY_COUNTER_BITS, &timer->bits);
+	for (i = 0; i < AA_TIMER_RING; i++) { timer->modes[i] = -1; }
+	timer->next = 0;
+	timer->clock = timer->bits ? NULL : pfclock_make();
+	timer->start = 0;
+}
+
+void xylo_term_aa_timer(
+	struct gl_core33 const *restrict gl,
+	struct xylo_aa_timer *timer)
+{
+	assert(gl != NULL);
+	assert(timer != NULL);
+
+	gl->DeleteQueries(AA_TIMER_RING, timer->queries);
+	if (timer->clock) { pfclock_free(timer->clock); }
+}
+
+void xylo_aa_timer_begin(
+	struct gl_core33 const *restrict gl,
+	struct xylo_aa_timer *timer,
+	int mode)
+{
+	unsigned slot;
+
+	assert(gl != NULL);
+	assert(timer != NULL);
+
+	if (timer->bits) {
+		/* a query still pending after a full ring is dropped */
+		slot = timer->next;
+		timer->modes[slot] = mode;
+		gl->BeginQuery(GL_TIME_ELAPSED, timer->queries[slot]);
+	} else if (timer->clock) {
+		timer->start = pfclock_usec(timer->clock);
+	}
+}
+
+void xylo_aa_timer_end(
+	struct gl_core33 const *restrict gl,
+	struct xylo_aa_timer *timer,
+	struct xylo_aa_governor *governor,
+	int mode)
+{
+	assert(gl != NULL);
+	assert(timer != NULL);
+	assert(governor != NULL);
+
+	if (timer->bits) {
+		gl->EndQuery(GL_TIME_ELAPSED);
+		timer->next = (timer->next + 1) % AA_TIMER_RING;
+	} else if (timer->clock) {
+		(void)xylo_aa_governor_update(governor, mode,
+			pfclock_usec(timer->clock) - timer->start);
+	}
+}
+
+void xylo_aa_timer_poll(
+	struct gl_core33 const *restrict gl,
+	struct xylo_aa_timer *timer,
+	struct xylo_aa_governor *governor)
+{
+	GLuint64 nsec;
+	GLuint available;
+	unsigned i, slot;
+
+	assert(gl != NULL);
+	assert(timer != NULL);
+	assert(governor != NULL);
+
+	if (!timer->bits) { return; }
+
+	/* oldest first */
+	for (i = 0; i < AA_TIMER_RING; i++) {
+		slot = (timer->next + i) % AA_TIMER_RING;
+		if (timer->modes[slot] < 0) { continue; }
+		gl->GetQueryObjectuiv(
+			timer->queries[slot],
+			GL_QUERY_RESULT_AVAILABLE,
+			&available);
+		if (!available) { break; }
+		gl->GetQueryObjectui64v(
+			timer->queries[slot],
+			GL_QUERY_RESULT,
+			&nsec);
+		(void)xylo_aa_governor_update(governor, timer->modes[slot],
+			nsec * 1e-3);
+		timer->modes[slot] = -1;
+	}
+}
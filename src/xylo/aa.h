@@ -43,3 +43,49 @@ void xylo_rgss_set_tex_unit(
 	struct xylo_rgss *rgss,
 	struct gl_core33 const *restrict gl,
 	GLuint unit);
+
+struct xylo_aa_governor;
+struct xylo_aa_timer;
+
+void xylo_init_aa_governor(
+	struct xylo_aa_governor *governor,
+	unsigned long budget);
+
+/* Feed the drawing time `usec` of a frame drawn in `mode` to `governor` and
+   return the mode to draw the next frame in. The quality drops a level as
+   soon as the smoothed drawing time exceeds the budget, and rises a level
+   once the better mode is expected to fit with a margin for a number of
+   consecutive frames. Times measured in another mode than the current one
+   are ignored. */
+int xylo_aa_governor_update(
+	struct xylo_aa_governor *governor,
+	int mode,
+	double usec);
+
+void xylo_init_aa_timer(
+	struct gl_core33 const *restrict gl,
+	struct xylo_aa_timer *timer);
+
+void xylo_term_aa_timer(
+	struct gl_core33 const *restrict gl,
+	struct xylo_aa_timer *timer);
+
+/* start timing drawing in `mode` */
+void xylo_aa_timer_begin(
+	struct gl_core33 const *restrict gl,
+	struct xylo_aa_timer *timer,
+	int mode);
+
+/* stop timing, and update `governor` right away if CPU time is used */
+void xylo_aa_timer_end(
+	struct gl_core33 const *restrict gl,
+	struct xylo_aa_timer *timer,
+	struct xylo_aa_governor *governor,
+	int mode);
+
+/* update `governor` with the GPU times which are available, without
+   waiting for the rest */
+void xylo_aa_timer_poll(
+	struct gl_core33 const *restrict gl,
+	struct xylo_aa_timer *timer,
+	struct xylo_aa_governor *governor);
@@ -0,0 +1,32 @@
+/* Helpers shared by the benchmarks, which include <stdlib.h> and
+   "tempo/tempo.h" first */
+
+/* a running timer, see `start_timer` */
+struct bench_timer
+{
+	struct pfclock *clock;
+	usec64 t0;
+};
+
+static inline float frand(float lo, float hi)
+{
+	return lo + (float)rand() / RAND_MAX * (hi - lo);
+}
+
+/* Start timing with `timer`. Return non-zero on failure. */
+static inline int start_timer(struct bench_timer *timer)
+{
+	if (timer->clock = pfclock_make(), !timer->clock) { return -1; }
+	timer->t0 = pfclock_usec(timer->clock);
+	return 0;
+}
+
+/* Stop `timer`, and return the elapsed time in microseconds */
+static inline long stop_timer(struct bench_timer *timer)
+{
+	usec64 t1;
+
+	t1 = pfclock_usec(timer->clock);
+	pfclock_free(timer->clock);
+	return (long)(t1 - timer->t0);
+}
@@ -0,0 +1,167 @@
+/* Triangle classification benchmark. Triangulates a square with a grid of
+   quadrilateral holes, and classifies its triangles as inside or outside by
+   flood fill and by casting a ray from each of them, e.g.
+
+       target/bench/xylo/bin/classify [holes per row]
+*/
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "glapi/core.h"
+#include "spline/triangulate.h"
+#include "tempo/tempo.h"
+
+#include "../mesh.h"
+#include "bench.h"
+
+#define DEFAULT_HOLES 50
+
+struct polygon
+{
+	size_t nv, ne;
+	float (*vertices)[2];
+	unsigned (*edges)[2];
+};
+
+/* Vertices and boundary edges of a square with `n` by `n` holes, each a
+   jittered quadrilateral in its own cell. Return non-zero on failure. */
+static int make_polygon(struct polygon *p, size_t n)
+{
+	static float const corners[4][2] = {
+		{ -1.f, -1.f }, { 1.f, -1.f }, { 1.f, 1.f }, { -1.f, 1.f }
+	};
+
+	size_t i, j, k, first;
+	float cell, x, y;
+
+	p->nv = p->ne = (n * n + 1) * 4;
+	p->vertices = malloc(p->nv * sizeof *p->vertices);
+	p->edges = malloc(p->ne * sizeof *p->edges);
+	if (!p->vertices || !p->edges) {
+		free(p->vertices);
+		free(p->edges);
+		return -1;
+	}
+	cell = 2.f / (n + 1);
+	for (first = i = 0; i <= n * n; i++, first += 4) {
+		x = (i % n + 1) * cell - 1.f;
+		y = (i / n + 1) * cell - 1.f;
+		for (k = 0; k < 4; k++) {
+			j = first + k;
+			if (i == n * n) {
+				/* the square itself */
+				p->vertices[j][0] = corners[k][0];
+				p->vertices[j][1] = corners[k][1];
+			} else {
+				p->vertices[j][0] = x + corners[k][0] * cell *
+					frand(0.2f, 0.4f);
+				p->vertices[j][1] = y + corners[k][1] * cell *
+					frand(0.2f, 0.4f);
+			}
+			p->edges[j][0] = j;
+			p->edges[j][1] = first + (k + 1) % 4;
+		}
+	}
+	return 0;
+}
+
+/* even-odd rule by casting a ray from the barycenter of each triangle */
+static bool ray_cast(
+	struct polygon const *p,
+	struct triangle_set const *t,
+	size_t i)
+{
+	float x, y, (*a)[2], (*b)[2];
+	unsigned const *tri;
+	bool inside;
+	size_t j;
+
+	tri = t->indices[i];
+	x = (p->vertices[tri[0]][0] + p->vertices[tri[1]][0] +
+	     p->vertices[tri[2]][0]) / 3.0;
+	y = (p->vertices[tri[0]][1] + p->vertices[tri[1]][1] +
+	     p->vertices[tri[2]][1]) / 3.0;
+	inside = false;
+	for (j = 0; j < p->ne; j++) {
+		a = p->vertices + p->edges[j][0];
+		b = p->vertices + p->edges[j][1];
+		if (((*a)[1] > y) == ((*b)[1] > y)) { continue; }
+		if (x < (*a)[0] + ((*b)[0] - (*a)[0]) *
+		         (y - (*a)[1]) / ((*b)[1] - (*a)[1])) {
+			inside = !inside;
+		}
+	}
+	return inside;
+}
+
+static int run(struct polygon *p)
+{
+	struct triangle_set *t;
+	struct bench_timer timer;
+	bool *inside, *expected;
+	long fill_usec, ray_usec;
+	size_t i, ndiff;
+	int result;
+
+	t = triangle_set_triangulate(
+		(float const (*)[2])p->vertices, p->nv,
+		(unsigned const (*)[2])p->edges, p->ne);
+	if (!t) { return -1; }
+	inside = malloc(t->n * sizeof *inside * 2 + 1);
+	result = inside ? start_timer(&timer) : -1;
+	if (!result) {
+		result = xylo_classify_triangles(
+			inside, t, p->edges, p->ne, p->vertices);
+		fill_usec = stop_timer(&timer);
+	}
+	if (!result) { result = start_timer(&timer); }
+	if (!result) {
+		expected = inside + t->n;
+		for (i = 0; i < t->n; i++) {
+			expected[i] = ray_cast(p, t, i);
+		}
+		ray_usec = stop_timer(&timer);
+
+		for (ndiff = i = 0; i < t->n; i++) {
+			if (inside[i] != expected[i]) { ndiff++; }
+		}
+		printf("%zu vertices, %zu triangles\n", p->nv, t->n);
+		printf("flood fill: %10.2f ms\n", fill_usec * 1e-3);
+		printf("ray casts:  %10.2f ms\n", ray_usec * 1e-3);
+		if (ndiff > 0) {
+			printf("%zu triangles classified differently\n", ndiff);
+			result = -1;
+		}
+	}
+	free(inside);
+	triangle_set_free(t);
+	return result;
+}
+
+int main(int argc, char *argv[])
+{
+	struct polygon p;
+	size_t nholes;
+	int result;
+
+	nholes = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_HOLES;
+	if (argc > 2 || nholes == 0) {
+		fprintf(stderr, "usage: %s [holes per row]\n", argv[0]);
+		return 2;
+	}
+	srand(4);
+	if (make_polygon(&p, nholes)) {
+		fprintf(stderr, "%s: out of memory\n", argv[0]);
+		return 1;
+	}
+	result = run(&p);
+	free(p.vertices);
+	free(p.edges);
+	if (result) {
+		fprintf(stderr, "%s: benchmark failed\n", argv[0]);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,243 @@
+/* Draw tree bounding volume hierarchy benchmark. Scatters many outline leaves
+   over a square world, and times building the hierarchy, compiling all leaves
+   into draw commands against querying and compiling only those in a view of
+   about 1% of the world, and updating the hierarchy after moving 1% of the
+   leaves, e.g.
+
+       target/bench/xylo/bin/dbvh [leaves [rounds]]
+*/
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "base/mem.h"
+#include "base/gbuf.h"
+#include "base/wbuf.h"
+#include "glapi/core.h"
+#include "tempo/tempo.h"
+#include "xylo/draw.h"
+#include "xylo/dbvh.h"
+
+#include "../types.h"
+#include "bench.h"
+
+#define GROUP_SIZE 16
+#define WORLD_SIZE 1000.f
+#define DEFAULT_LEAVES 100000
+#define DEFAULT_ROUNDS 20
+
+/* A two-level draw tree of outline leaves scattered over the world, in groups
+   of GROUP_SIZE */
+struct scene
+{
+	size_t n, ngroups;
+	struct xylo_outline *outlines;
+	struct xylo_doutline *leaves;
+	struct xylo_dlist root, *groups;
+};
+
+static void place(struct xylo_doutline *leaf)
+{
+	float a, s;
+
+	a = frand(0.f, 6.2832f);
+	s = frand(0.5f, 2.f);
+	leaf->transform.m22[0] = s * cosf(a);
+	leaf->transform.m22[1] = s * sinf(a);
+	leaf->transform.m22[2] = -s * sinf(a);
+	leaf->transform.m22[3] = s * cosf(a);
+	leaf->transform.pos[0] = frand(0.f, WORLD_SIZE);
+	leaf->transform.pos[1] = frand(0.f, WORLD_SIZE);
+}
+
+static int make_scene(struct scene *scene, size_t n)
+{
+	struct xylo_outline *outline;
+	size_t i;
+
+	scene->n = n;
+	scene->ngroups = (n + GROUP_SIZE - 1) / GROUP_SIZE;
+	scene->outlines = calloc(n, sizeof *scene->outlines);
+	scene->leaves = malloc(n * sizeof *scene->leaves);
+	scene->groups = malloc(scene->ngroups * sizeof *scene->groups);
+	if (!scene->outlines || !scene->leaves || !scene->groups) {
+		free(scene->outlines);
+		free(scene->leaves);
+		free(scene->groups);
+		return -1;
+	}
+	xylo_init_dlist(&scene->root);
+	for (i = 0; i < scene->ngroups; i++) {
+		xylo_init_dlist(scene->groups + i);
+		if (xylo_dlist_append(&scene->root, &scene->groups[i].draw)) {
+			return -1;
+		}
+	}
+	for (i = 0; i < n; i++) {
+		outline = scene->outlines + i;
+		outline->bounds[0] = frand(-5.f, 0.f);
+		outline->bounds[1] = frand(-5.f, 0.f);
+		outline->bounds[2] = frand(0.f, 5.f);
+		outline->bounds[3] = frand(0.f, 5.f);
+		xylo_init_doutline(scene->leaves + i, outline);
+		scene->leaves[i].id = i;
+		place(scene->leaves + i);
+		if (xylo_dlist_append(scene->groups + i / GROUP_SIZE,
+		                      &scene->leaves[i].draw)) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static void term_scene(struct scene *scene)
+{
+	size_t i;
+
+	for (i = 0; i < scene->n; i++) {
+		xylo_term_doutline(scene->leaves + i);
+	}
+	for (i = 0; i < scene->ngroups; i++) {
+		xylo_term_dlist(scene->groups + i);
+	}
+	xylo_term_dlist(&scene->root);
+	free(scene->outlines);
+	free(scene->leaves);
+	free(scene->groups);
+}
+
+/* time building `bvh` for `scene`, or -1 on failure */
+static long time_build(struct xylo_dbvh *bvh, struct scene *scene)
+{
+	struct bench_timer timer;
+	long usec;
+	int result;
+
+	if (start_timer(&timer)) { return -1; }
+	result = xylo_dbvh_build(bvh, &scene->root.draw);
+	usec = stop_timer(&timer);
+	return result ? -1 : usec;
+}
+
+/* time compiling all leaves of `scene`, or -1 on failure */
+static long time_compile(
+	struct xylo_dcmds *cmds,
+	struct scene *scene,
+	size_t nrounds)
+{
+	struct bench_timer timer;
+	long usec;
+	size_t i;
+	int result;
+
+	if (start_timer(&timer)) { return -1; }
+	for (result = 0, i = 0; !result && i < nrounds; i++) {
+		result = xylo_dcmds_compile(cmds, &scene->root.draw);
+	}
+	usec = stop_timer(&timer);
+	return result ? -1 : usec;
+}
+
+/* time querying `bvh` for the leaves overlapping `rect` and compiling them,
+   or -1 on failure */
+static long time_query(
+	struct xylo_dcmds *cmds,
+	struct xylo_dbvh *bvh,
+	float const *rect,
+	size_t nrounds)
+{
+	struct bench_timer timer;
+	struct wbuf visible;
+	long usec;
+	size_t i, n;
+	int result;
+
+	wbuf_init(&visible);
+	if (start_timer(&timer)) { return -1; }
+	for (result = 0, i = 0; !result && i < nrounds; i++) {
+		wbuf_rewind(&visible);
+		result = xylo_dbvh_query(bvh, rect, &visible);
+		n = wbuf_nmemb(&visible, sizeof (struct xylo_draw const *));
+		if (!result) {
+			result = xylo_dcmds_compile_leaves(
+				cmds, visible.begin, n);
+		}
+	}
+	usec = stop_timer(&timer);
+	wbuf_term(&visible);
+	return result ? -1 : usec;
+}
+
+/* time moving 1% of the leaves of `scene` and updating `bvh` */
+static long time_update(struct xylo_dbvh *bvh, struct scene *scene)
+{
+	struct bench_timer timer;
+	long usec;
+	size_t i;
+	int result;
+
+	for (i = 0; i < scene->n; i += 100) { place(scene->leaves + i); }
+	if (start_timer(&timer)) { return -1; }
+	for (result = 0, i = 0; !result && i < scene->n; i += 100) {
+		result = xylo_dbvh_update(bvh, &scene->leaves[i].draw);
+	}
+	usec = stop_timer(&timer);
+	return result ? -1 : usec;
+}
+
+static int run(struct scene *scene, size_t nrounds)
+{
+	struct xylo_dbvh *bvh;
+	struct xylo_dcmds cmds;
+	float rect[4];
+	long usec[4];
+	size_t nvisible;
+
+	/* view of about 1% of the world */
+	rect[0] = rect[1] = 0.45f * WORLD_SIZE;
+	rect[2] = rect[3] = 0.55f * WORLD_SIZE;
+
+	if (bvh = xylo_make_dbvh(), !bvh) { return -1; }
+	xylo_init_dcmds(&cmds);
+	usec[0] = time_build(bvh, scene);
+	usec[1] = usec[0] < 0 ? -1 : time_compile(&cmds, scene, nrounds);
+	usec[2] = usec[1] < 0 ? -1 : time_query(&cmds, bvh, rect, nrounds);
+	nvisible = xylo_dcmds_length(&cmds);
+	usec[3] = usec[2] < 0 ? -1 : time_update(bvh, scene);
+	xylo_term_dcmds(&cmds);
+	xylo_free_dbvh(bvh);
+	if (usec[3] < 0) { return -1; }
+
+	printf("%zu leaves: build %g ms, update 1%% %g ms\n",
+	       scene->n, usec[0] * 1e-3, usec[3] * 1e-3);
+	printf("compile all %g ms, query and compile %zu visible %g ms\n",
+	       usec[1] * 1e-3 / nrounds, nvisible, usec[2] * 1e-3 / nrounds);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct scene scene;
+	size_t nleaves, nrounds;
+	int result;
+
+	nleaves = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_LEAVES;
+	nrounds = argc > 2 ? strtoul(argv[2], NULL, 10) : DEFAULT_ROUNDS;
+	if (argc > 3 || nleaves == 0 || nrounds == 0) {
+		fprintf(stderr, "usage: %s [leaves [rounds]]\n", argv[0]);
+		return 2;
+	}
+	srand(1);
+	if (make_scene(&scene, nleaves)) {
+		fprintf(stderr, "%s: out of memory\n", argv[0]);
+		return 1;
+	}
+	result = run(&scene, nrounds);
+	term_scene(&scene);
+	if (result) {
+		fprintf(stderr, "%s: benchmark failed\n", argv[0]);
+		return 1;
+	}
+	return 0;
+}
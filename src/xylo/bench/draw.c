@@ -0,0 +1,177 @@
+/* Draw command benchmark. Builds a complete tree of draw lists with many
+   outline leaves, and times compiling it into draw commands, projecting the
+   commands for alternating projections, and projecting them again for the
+   same projection, e.g.
+
+       target/bench/xylo/bin/draw [leaves [rounds]]
+*/
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "base/mem.h"
+#include "base/gbuf.h"
+#include "base/wbuf.h"
+#include "gm/matrix.h"
+#include "tempo/tempo.h"
+#include "xylo/draw.h"
+
+#include "bench.h"
+
+#define FANOUT 4
+#define DEFAULT_LEAVES 16384
+#define DEFAULT_ROUNDS 100
+
+/* A complete tree of dlists with `nleaves` outline leaves (without any
+   outline, since nothing is drawn) */
+struct tree
+{
+	size_t nlists, nleaves;
+	struct xylo_dlist *lists;
+	struct xylo_doutline *leaves;
+};
+
+static void random_transform(struct xylo_draw_transform *t)
+{
+	int i;
+	for (i = 0; i < 4; i++) { t->m22[i] = frand(-1.f, 1.f); }
+	t->pos[0] = frand(-100.f, 100.f);
+	t->pos[1] = frand(-100.f, 100.f);
+}
+
+/* Build a tree where list i has children FANOUT*i + 1 ... FANOUT*i + FANOUT,
+   the ones past the last list being leaves */
+static int make_tree(struct tree *tree, size_t nleaves)
+{
+	size_t i, j, child;
+
+	tree->nleaves = nleaves;
+	tree->nlists = (nleaves + FANOUT - 3) / (FANOUT - 1);
+	tree->lists = malloc(tree->nlists * sizeof *tree->lists);
+	tree->leaves = malloc(nleaves * sizeof *tree->leaves);
+	if (!tree->lists || !tree->leaves) {
+		free(tree->lists);
+		free(tree->leaves);
+		return -1;
+	}
+
+	for (i = 0; i < nleaves; i++) {
+		xylo_init_doutline(tree->leaves + i, NULL);
+		random_transform(&tree->leaves[i].transform);
+		tree->leaves[i].style.color[0] = (float)i;
+	}
+	for (i = 0; i < tree->nlists; i++) {
+		xylo_init_dlist(tree->lists + i);
+		for (j = 1; j <= FANOUT; j++) {
+			child = FANOUT * i + j;
+			if (child < tree->nlists) {
+				(void)xylo_dlist_append(
+					tree->lists + i,
+					&tree->lists[child].draw);
+			} else if (child - tree->nlists < nleaves) {
+				(void)xylo_dlist_append(
+					tree->lists + i,
+					&tree->leaves[child - tree->nlists].draw);
+			}
+		}
+	}
+	return 0;
+}
+
+static void term_tree(struct tree *tree)
+{
+	size_t i;
+
+	for (i = 0; i < tree->nlists; i++) {
+		xylo_term_dlist(tree->lists + i);
+	}
+	for (i = 0; i < tree->nleaves; i++) {
+		xylo_term_doutline(tree->leaves + i);
+	}
+	free(tree->lists);
+	free(tree->leaves);
+}
+
+static int run(struct tree *tree, size_t nrounds)
+{
+	struct xylo_dcmds cmds;
+	struct bench_timer timer;
+	float proj[2][16], scale[16];
+	float const *mvp;
+	volatile float sink;
+	long usec[3];
+	size_t i;
+	int result;
+
+	(void)m44orthographicf(proj[0], -320.f, 320.f, -240.f, 240.f, 0.f, 1.f);
+	(void)m44scalef(scale, 0.5f, 0.5f, 1.f);
+	(void)m44mulf(proj[1], scale, proj[0]);
+	xylo_init_dcmds(&cmds);
+
+	result = start_timer(&timer);
+	if (!result) {
+		for (i = 0; !result && i < nrounds; i++) {
+			result = xylo_dcmds_compile(
+				&cmds, &tree->lists[0].draw);
+		}
+		usec[0] = stop_timer(&timer);
+	}
+
+	if (!result) { result = start_timer(&timer); }
+	if (!result) {
+		for (i = 0; i < nrounds; i++) {
+			mvp = xylo_dcmds_project(&cmds, proj[i & 1]);
+			sink = mvp[0];
+		}
+		usec[1] = stop_timer(&timer);
+	}
+
+	if (!result) {
+		/* the matrices for proj[1] are then cached */
+		(void)xylo_dcmds_project(&cmds, proj[1]);
+		result = start_timer(&timer);
+	}
+	if (!result) {
+		for (i = 0; i < nrounds; i++) {
+			mvp = xylo_dcmds_project(&cmds, proj[1]);
+			sink = mvp[0];
+		}
+		usec[2] = stop_timer(&timer);
+		(void)sink;
+
+		printf("%zu leaves: compile %g ms, project %g ms, "
+		       "cached %g ms\n",
+		       tree->nleaves,
+		       usec[0] * 1e-3 / nrounds,
+		       usec[1] * 1e-3 / nrounds,
+		       usec[2] * 1e-3 / nrounds);
+	}
+	xylo_term_dcmds(&cmds);
+	return result;
+}
+
+int main(int argc, char *argv[])
+{
+	struct tree tree;
+	size_t nleaves, nrounds;
+	int result;
+
+	nleaves = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_LEAVES;
+	nrounds = argc > 2 ? strtoul(argv[2], NULL, 10) : DEFAULT_ROUNDS;
+	if (argc > 3 || nleaves < 2 || nrounds == 0) {
+		fprintf(stderr, "usage: %s [leaves [rounds]]\n", argv[0]);
+		return 2;
+	}
+	srand(1);
+	if (make_tree(&tree, nleaves)) {
+		fprintf(stderr, "%s: out of memory\n", argv[0]);
+		return 1;
+	}
+	result = run(&tree, nrounds);
+	term_tree(&tree);
+	if (result) {
+		fprintf(stderr, "%s: benchmark failed\n", argv[0]);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,513 @@
+/* Non-interactive rendering benchmark. Draws synthetic scenes into an
+   off-screen (pixmap) context under each anti-aliasing mode and reports time,
+   GL calls, and fill cost per frame, and then compares drawing the deep scene
+   leaf by leaf to drawing it compiled into draw commands. It runs on any X
+   server, including Xvfb with a software rasterizer, e.g.
+
+       xvfb-run target/bench/xylo/bin/render [shapes [frames]]
+*/
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "glapi/api.h"
+#include "glapi/core.h"
+#include "glapi/test.h"
+#include "base/mem.h"
+#include "base/gbuf.h"
+#include "base/wbuf.h"
+#include "gm/matrix.h"
+#include "spline/shape.h"
+#include "tempo/tempo.h"
+#include "xylo/types.h"
+#include "xylo/xylo.h"
+#include "xylo/draw.h"
+#include "xylo/shape.h"
+#include "xylo/aa.h"
+
+#include "../xylo.h"
+
+#define DEFAULT_SHAPES 1000
+#define DEFAULT_FRAMES 50
+#define WARMUP_FRAMES 3
+#define DEEP_LEVELS 64
+
+#define ALL_BUFFERS \
+	(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT | GL_DEPTH_BUFFER_BIT)
+
+static struct spline_shape const shapes[] = {
+	/* circle */
+	{
+		1,
+		(struct spline_outline[]) {
+			{
+				4,
+				(struct spline_segment[]) {
+					{ { 0.5f, 0.0f }, { 0.5f, 0.5f }, 0.707106781f },
+					{ { 0.0f, 0.5f }, {-0.5f, 0.5f }, 0.707106781f },
+					{ {-0.5f, 0.0f }, {-0.5f,-0.5f }, 0.707106781f },
+					{ { 0.0f,-0.5f }, { 0.5f,-0.5f }, 0.707106781f },
+				}
+			}
+		}
+	},
+	/* ring */
+	{
+		2,
+		(struct spline_outline[]) {
+			{
+				4,
+				(struct spline_segment[]) {
+					{ { 0.5f, 0.0f }, { 0.5f, 0.5f }, 0.707106781f },
+					{ { 0.0f, 0.5f }, {-0.5f, 0.5f }, 0.707106781f },
+					{ {-0.5f, 0.0f }, {-0.5f,-0.5f }, 0.707106781f },
+					{ { 0.0f,-0.5f }, { 0.5f,-0.5f }, 0.707106781f },
+				}
+			},
+			{
+				4,
+				(struct spline_segment[]) {
+					{ { 0.3f, 0.0f }, { 0.3f, 0.3f }, 0.707106781f },
+					{ { 0.0f, 0.3f }, {-0.3f, 0.3f }, 0.707106781f },
+					{ {-0.3f, 0.0f }, {-0.3f,-0.3f }, 0.707106781f },
+					{ { 0.0f,-0.3f }, { 0.3f,-0.3f }, 0.707106781f },
+				}
+			}
+		}
+	},
+	/* four-pointed star with concave sides */
+	{
+		1,
+		(struct spline_outline[]) {
+			{
+				4,
+				(struct spline_segment[]) {
+					{ { 0.5f, 0.0f }, { 0.1f, 0.1f }, 1.0f },
+					{ { 0.0f, 0.5f }, {-0.1f, 0.1f }, 1.0f },
+					{ {-0.5f, 0.0f }, {-0.1f,-0.1f }, 1.0f },
+					{ { 0.0f,-0.5f }, { 0.1f,-0.1f }, 1.0f },
+				}
+			}
+		}
+	}
+};
+
+enum scene_type { OUTLINES, MESHES, DEEP };
+
+static char const *const scene_names[] = { "outlines", "meshes", "deep" };
+
+struct scene
+{
+	size_t n;
+	struct xylo_dlist lists[DEEP_LEVELS];
+	struct xylo_doutline *outlines;
+	struct xylo_dmesh *meshes;
+};
+
+/* Calls on the drawing path of xylo, counted by replacing the entry points
+   of the API */
+static struct gl_core33 real_gl;
+static unsigned long gl_calls, draw_calls;
+
+#define COUNT(name, params, args) \
+	static void APIENTRY count_##name params \
+	{ \
+		gl_calls++; \
+		real_gl.name args; \
+	}
+
+#define COUNT_DRAW(name, params, args) \
+	static void APIENTRY count_##name params \
+	{ \
+		gl_calls++; \
+		draw_calls++; \
+		real_gl.name args; \
+	}
+
+COUNT(ActiveTexture, (GLenum t), (t))
+COUNT(BindBuffer, (GLenum t, GLuint b), (t, b))
+COUNT(BindFramebuffer, (GLenum t, GLuint f), (t, f))
+COUNT(BindTexture, (GLenum t, GLuint x), (t, x))
+COUNT(BindVertexArray, (GLuint a), (a))
+COUNT(BufferData,
+	(GLenum t, GLsizeiptr n, void const *p, GLenum u), (t, n, p, u))
+COUNT(Clear, (GLbitfield m), (m))
+COUNT(ColorMask,
+	(GLboolean r, GLboolean g, GLboolean b, GLboolean a), (r, g, b, a))
+COUNT(Disable, (GLenum c), (c))
+COUNT(Enable, (GLenum c), (c))
+COUNT(GetIntegerv, (GLenum p, GLint *v), (p, v))
+COUNT(StencilFunc, (GLenum f, GLint r, GLuint m), (f, r, m))
+COUNT(StencilOp, (GLenum s, GLenum d, GLenum p), (s, d, p))
+COUNT(Uniform1i, (GLint l, GLint v), (l, v))
+COUNT(Uniform2fv, (GLint l, GLsizei n, GLfloat const *v), (l, n, v))
+COUNT(Uniform4fv, (GLint l, GLsizei n, GLfloat const *v), (l, n, v))
+COUNT(UseProgram, (GLuint p), (p))
+COUNT(Viewport, (GLint x, GLint y, GLsizei w, GLsizei h), (x, y, w, h))
+COUNT_DRAW(DrawArrays, (GLenum m, GLint f, GLsizei n), (m, f, n))
+COUNT_DRAW(DrawArraysInstanced,
+	(GLenum m, GLint f, GLsizei n, GLsizei i), (m, f, n, i))
+COUNT_DRAW(DrawElementsInstancedBaseVertex,
+	(GLenum m, GLsizei n, GLenum t, void const *p, GLsizei i, GLint b),
+	(m, n, t, p, i, b))
+
+static void count_gl_calls(struct gl_core33 *gl)
+{
+	real_gl = *gl;
+	gl->ActiveTexture = count_ActiveTexture;
+	gl->BindBuffer = count_BindBuffer;
+	gl->BindFramebuffer = count_BindFramebuffer;
+	gl->BindTexture = count_BindTexture;
+	gl->BindVertexArray = count_BindVertexArray;
+	gl->BufferData = count_BufferData;
+	gl->Clear = count_Clear;
+	gl->ColorMask = count_ColorMask;
+	gl->Disable = count_Disable;
+	gl->Enable = count_Enable;
+	gl->GetIntegerv = count_GetIntegerv;
+	gl->StencilFunc = count_StencilFunc;
+	gl->StencilOp = count_StencilOp;
+	gl->Uniform1i = count_Uniform1i;
+	gl->Uniform2fv = count_Uniform2fv;
+	gl->Uniform4fv = count_Uniform4fv;
+	gl->UseProgram = count_UseProgram;
+	gl->Viewport = count_Viewport;
+	gl->DrawArrays = count_DrawArrays;
+	gl->DrawArraysInstanced = count_DrawArraysInstanced;
+	gl->DrawElementsInstancedBaseVertex =
+		count_DrawElementsInstancedBaseVertex;
+	gl_calls = draw_calls = 0;
+}
+
+static void uncount_gl_calls(struct gl_core33 *gl)
+{
+	*gl = real_gl;
+}
+
+static void place(
+	size_t i,
+	size_t n,
+	GLint const *size,
+	struct xylo_draw_transform *t,
+	struct xylo_draw_style *s)
+{
+	size_t cols, rows;
+	float cw, ch, scale;
+
+	for (cols = 1; cols * cols < n; cols++) { }
+	rows = (n + cols - 1) / cols;
+	cw = (float)size[0] / cols;
+	ch = (float)size[1] / rows;
+	scale = 1.5f * (cw < ch ? cw : ch);
+
+	/* overlapping neighbours, with a slight rotation */
+	t->m22[0] = t->m22[3] = scale * 0.995f;
+	t->m22[1] = scale * 0.0998f;
+	t->m22[2] = -t->m22[1];
+	t->pos[0] = (i % cols + 0.5f) * cw - size[0] * 0.5f;
+	t->pos[1] = (i / cols + 0.5f) * ch - size[1] * 0.5f;
+
+	s->color[0] = (i % 3) / 2.f;
+	s->color[1] = (i % 5) / 4.f;
+	s->color[2] = (i % 7) / 6.f;
+	s->color[3] = 1.f;
+}
+
+static int make_scene(
+	struct scene *scene,
+	enum scene_type type,
+	size_t n,
+	GLint const *size,
+	struct xylo_outline_set *oset,
+	struct xylo_mesh_set *mset)
+{
+	struct xylo_draw *leaf;
+	size_t i, levels, shape;
+
+	levels = type == DEEP ? DEEP_LEVELS : 1;
+	scene->n = 0;
+	scene->outlines = NULL;
+	scene->meshes = NULL;
+	for (i = 0; i < levels; i++) { xylo_init_dlist(scene->lists + i); }
+	for (i = 1; i < levels; i++) {
+		if (xylo_dlist_append(scene->lists + i - 1,
+		                      &scene->lists[i].draw)) {
+			return -1;
+		}
+	}
+	if (type == MESHES) {
+		scene->meshes = malloc(n * sizeof *scene->meshes);
+		if (!scene->meshes) { return -1; }
+	} else {
+		scene->outlines = malloc(n * sizeof *scene->outlines);
+		if (!scene->outlines) { return -1; }
+	}
+	for (i = 0; i < n; i++) {
+		shape = i % length_of(shapes);
+		if (type == MESHES) {
+			xylo_init_dmesh(scene->meshes + i,
+			                xylo_get_mesh(mset, shape));
+			scene->meshes[i].id = i + 1;
+			place(i, n, size, &scene->meshes[i].transform,
+			      &scene->meshes[i].style);
+			leaf = &scene->meshes[i].draw;
+		} else {
+			xylo_init_doutline(scene->outlines + i,
+			                   xylo_get_outline(oset, shape));
+			scene->outlines[i].id = i + 1;
+			place(i, n, size, &scene->outlines[i].transform,
+			      &scene->outlines[i].style);
+			leaf = &scene->outlines[i].draw;
+		}
+		scene->n++;
+		/* spread the leaves over all levels of a deep tree */
+		if (xylo_dlist_append(scene->lists + i % levels, leaf)) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static void term_scene(struct scene *scene, enum scene_type type)
+{
+	size_t i, levels;
+
+	levels = type == DEEP ? DEEP_LEVELS : 1;
+	for (i = 0; i < levels; i++) { xylo_term_dlist(scene->lists + i); }
+	for (i = 0; scene->outlines && i < scene->n; i++) {
+		xylo_term_doutline(scene->outlines + i);
+	}
+	for (i = 0; scene->meshes && i < scene->n; i++) {
+		xylo_term_dmesh(scene->meshes + i);
+	}
+	free(scene->outlines);
+	free(scene->meshes);
+}
+
+static void run_scene(
+	struct gl_api *api,
+	struct xylo *xylo,
+	struct xylo_view const *view,
+	struct scene *scene,
+	char const *name,
+	size_t frames)
+{
+	static char const *const aa_names[] = {
+		"none", "quincunx", "rgss", "auto"
+	};
+	static enum xylo_aa const aas[] = {
+		XYLO_AA_NONE,
+		XYLO_AA_QUINCUNX,
+		XYLO_AA_RGSS,
+		XYLO_AA_AUTO
+	};
+
+	struct gl_core33 const *restrict gl;
+	struct pfclock *clk;
+	GLuint queries[3];
+	GLuint64 samples, ns[2];
+	GLint viewport[4];
+	usec64 t0, t1;
+	size_t i, frame;
+
+	gl = gl_get_core33(api);
+	clk = pfclock_make();
+	gl->GetIntegerv(GL_VIEWPORT, viewport);
+	gl->GenQueries(3, queries);
+
+	for (i = 0; i < length_of(aas); i++) {
+		xylo_set_aa(xylo, aas[i]);
+		for (frame = 0; frame < WARMUP_FRAMES; frame++) {
+			gl->Clear(ALL_BUFFERS);
+			xylo_draw(xylo, view, &scene->lists[0].draw);
+		}
+
+		/* wall time */
+		gl->Finish();
+		t0 = pfclock_usec(clk);
+		for (frame = 0; frame < frames; frame++) {
+			gl->Clear(ALL_BUFFERS);
+			xylo_draw(xylo, view, &scene->lists[0].draw);
+		}
+		gl->Finish();
+		t1 = pfclock_usec(clk);
+
+		/* calls, fill cost, and GPU time of a single frame, timed with
+		   timestamps since XYLO_AA_AUTO has its own GL_TIME_ELAPSED
+		   query active while drawing */
+		gl->Clear(ALL_BUFFERS);
+		gl->BeginQuery(GL_SAMPLES_PASSED, queries[0]);
+		gl->QueryCounter(queries[1], GL_TIMESTAMP);
+		count_gl_calls((struct gl_core33 *)gl);
+		xylo_draw(xylo, view, &scene->lists[0].draw);
+		uncount_gl_calls((struct gl_core33 *)gl);
+		gl->QueryCounter(queries[2], GL_TIMESTAMP);
+		gl->EndQuery(GL_SAMPLES_PASSED);
+		gl->GetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &samples);
+		gl->GetQueryObjectui64v(queries[1], GL_QUERY_RESULT, ns + 0);
+		gl->GetQueryObjectui64v(queries[2], GL_QUERY_RESULT, ns + 1);
+
+		printf("%-9s %-9s %6zu %9.3f %9.3f %7lu %6lu %8.2f\n",
+		       name, aa_names[i], scene->n,
+		       (t1 - t0) * 1e-3 / frames,
+		       (ns[1] - ns[0]) * 1e-6,
+		       gl_calls, draw_calls,
+		       (double)samples / ((double)viewport[2] * viewport[3]));
+	}
+
+	gl->DeleteQueries(3, queries);
+	pfclock_free(clk);
+}
+
+/* time drawing the tree of `scene` leaf by leaf, with `xylo_draw()`, which
+   compiles it every frame, and compiled into draw commands once, without
+   anti-aliasing */
+static int run_commands(
+	struct gl_api *api,
+	struct xylo *xylo,
+	struct xylo_view const *view,
+	struct scene *scene,
+	char const *name,
+	size_t frames)
+{
+	struct gl_core33 const *restrict gl;
+	struct xylo_dcmds cmds;
+	struct pfclock *clk;
+	usec64 t[5];
+	size_t frame;
+
+	gl = gl_get_core33(api);
+	if (clk = pfclock_make(), !clk) { return -1; }
+	xylo_set_aa(xylo, XYLO_AA_NONE);
+	xylo_init_dcmds(&cmds);
+
+	gl->Finish();
+	t[0] = pfclock_usec(clk);
+	for (frame = 0; frame < frames; frame++) {
+		gl->Clear(ALL_BUFFERS);
+		xylo_draw_tree(xylo, view, &scene->lists[0].draw);
+	}
+	gl->Finish();
+	t[1] = pfclock_usec(clk);
+	for (frame = 0; frame < frames; frame++) {
+		gl->Clear(ALL_BUFFERS);
+		xylo_draw(xylo, view, &scene->lists[0].draw);
+	}
+	gl->Finish();
+	t[2] = pfclock_usec(clk);
+	if (xylo_dcmds_compile(&cmds, &scene->lists[0].draw)) {
+		pfclock_free(clk);
+		return -1;
+	}
+	t[3] = pfclock_usec(clk);
+	for (frame = 0; frame < frames; frame++) {
+		gl->Clear(ALL_BUFFERS);
+		xylo_draw_dcmds(xylo, view, &cmds);
+	}
+	gl->Finish();
+	t[4] = pfclock_usec(clk);
+
+	printf("%s, %zu shapes: tree %.3f ms/frame, xylo_draw %.3f ms/frame, "
+	       "compile %.3f ms, commands %.3f ms/frame\n",
+	       name, scene->n,
+	       (t[1] - t[0]) * 1e-3 / frames,
+	       (t[2] - t[1]) * 1e-3 / frames,
+	       (t[3] - t[2]) * 1e-3,
+	       (t[4] - t[3]) * 1e-3 / frames);
+
+	xylo_term_dcmds(&cmds);
+	pfclock_free(clk);
+	return 0;
+}
+
+static int benchmark(struct gl_api *api, size_t n, size_t frames)
+{
+	static enum scene_type const types[] = { OUTLINES, MESHES, DEEP };
+
+	struct gl_core33 const *restrict gl;
+	struct xylo *xylo;
+	struct xylo_outline_set *oset;
+	struct xylo_mesh_set *mset;
+	struct xylo_view view;
+	struct scene scene;
+	GLint size[2];
+	size_t i;
+	int status;
+
+	gl = gl_get_core33(api);
+	if (!gl) {
+		fprintf(stderr, "OpenGL 3.3 or above required\n");
+		return -1;
+	}
+	xylo = make_xylo(api);
+	if (!xylo) { return -1; }
+	oset = xylo_make_outline_set(api, length_of(shapes), shapes);
+	mset = xylo_make_mesh_set(api, length_of(shapes), shapes);
+	if (!oset || !mset) { return -1; }
+
+	size[0] = gl_test_output_width;
+	size[1] = gl_test_output_height;
+	gl->Viewport(0, 0, size[0], size[1]);
+	(void)m44orthographicf(view.projection,
+		-size[0] * 0.5f, size[0] * 0.5f,
+		-size[1] * 0.5f, size[1] * 0.5f,
+		-1.f, 1.f);
+	gl->ClearColor(1.f, 1.f, 1.f, 1.f);
+
+	printf("%s, %dx%d\n", (char const *)gl->GetString(GL_RENDERER),
+	       size[0], size[1]);
+	printf("%-9s %-9s %6s %9s %9s %7s %6s %8s\n",
+	       "scene", "aa", "shapes", "ms/frame", "gpu ms", "calls",
+	       "draws", "fill");
+
+	status = 0;
+	for (i = 0; i < length_of(types); i++) {
+		if (make_scene(&scene, types[i], n, size, oset, mset)) {
+			status = -1;
+		} else {
+			if (types[i] == MESHES) {
+				xylo_set_mesh_set(xylo, mset);
+			} else {
+				xylo_set_outline_set(xylo, oset);
+			}
+			run_scene(api, xylo, &view, &scene,
+			          scene_names[types[i]], frames);
+			if (types[i] == DEEP) {
+				status = run_commands(
+					api, xylo, &view, &scene,
+					scene_names[types[i]], frames);
+			}
+		}
+		term_scene(&scene, types[i]);
+		if (status) { break; }
+	}
+
+	xylo_free_outline_set(oset, api);
+	xylo_free_mesh_set(mset, api);
+	free_xylo(xylo);
+	return status;
+}
+
+static size_t shape_count, frame_count;
+
+static int run(struct gl_api *api, struct gl_test *test)
+{
+	(void)test;
+	return benchmark(api, shape_count, frame_count);
+}
+
+int main(int argc, char *argv[])
+{
+	shape_count = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_SHAPES;
+	frame_count = argc > 2 ? strtoul(argv[2], NULL, 10) : DEFAULT_FRAMES;
+	if (argc > 3 || shape_count == 0 || frame_count == 0) {
+		fprintf(stderr, "usage: %s [shapes [frames]]\n", argv[0]);
+		return 2;
+	}
+	if (gl_run_test(NULL, run)) {
+		fprintf(stderr, "%s: benchmark failed\n", argv[0]);
+		return 1;
+	}
+	return 0;
+}
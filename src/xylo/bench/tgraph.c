@@ -0,0 +1,260 @@
+/* Transformation graph benchmark. Builds a random tree of affine 2D
+   transforms, and compares propagating them with the built-in kernel to
+   `xylo_tgraph_transform()` with a callback, and a full propagation to an
+   incremental update after touching a few nodes. Then it propagates a tree
+   of 4x4 matrices on thread pools of different sizes, e.g.
+
+       target/bench/xylo/bin/tgraph [nodes [rounds]]
+*/
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "tempo/tempo.h"
+#include "tpool/tpool.h"
+#include "xylo/tgraph.h"
+
+#include "bench.h"
+
+#define DEFAULT_NODES 100000
+#define DEFAULT_ROUNDS 20
+
+static void affine2d_concat(void *dest, void const *child, void const *parent)
+{
+	float *d = dest;
+	float const *c = child, *p = parent;
+
+	d[0] = p[0]*c[0] + p[2]*c[1];
+	d[1] = p[1]*c[0] + p[3]*c[1];
+	d[2] = p[0]*c[2] + p[2]*c[3];
+	d[3] = p[1]*c[2] + p[3]*c[3];
+	d[4] = p[0]*c[4] + p[2]*c[5] + p[4];
+	d[5] = p[1]*c[4] + p[3]*c[5] + p[5];
+}
+
+static void random_affine2d(float *tfm)
+{
+	float a = frand(0.f, 6.283f);
+
+	tfm[0] = cosf(a);
+	tfm[1] = sinf(a);
+	tfm[2] = -tfm[1];
+	tfm[3] = tfm[0];
+	tfm[4] = frand(-5.f, 5.f);
+	tfm[5] = frand(-5.f, 5.f);
+}
+
+static void random_mat44(float *tfm)
+{
+	float t[6];
+	int i;
+
+	random_affine2d(t);
+	for (i = 0; i < 16; i++) { tfm[i] = (i % 5 == 0) ? 1.f : 0.f; }
+	tfm[0] = t[0];
+	tfm[1] = t[1];
+	tfm[4] = t[2];
+	tfm[5] = t[3];
+	tfm[12] = t[4];
+	tfm[13] = t[5];
+}
+
+/* Build a random tree of `n` nodes of `nfloats` floats, 6 or 16, where each
+   node is a child of some node created before it */
+static struct xylo_tgraph *make_random_graph(
+	struct xylo_tnode **nodes,
+	size_t n,
+	size_t nfloats)
+{
+	struct xylo_tgraph *graph;
+	struct xylo_tnode *parent;
+	float tfm[16];
+	size_t i;
+
+	srand(1);
+	graph = xylo_make_tgraph(nfloats * sizeof (float));
+	if (!graph) { return NULL; }
+	for (i = 0; i < n; i++) {
+		if (nfloats == 6) {
+			random_affine2d(tfm);
+		} else {
+			random_mat44(tfm);
+		}
+		parent = i < 4 ? NULL : nodes[rand() % i];
+		nodes[i] = xylo_make_tnode(graph, parent, tfm);
+		if (!nodes[i]) {
+			xylo_free_tgraph(graph);
+			return NULL;
+		}
+	}
+	return graph;
+}
+
+static int run_propagation(
+	struct xylo_tgraph *graph,
+	size_t nnodes,
+	size_t nrounds)
+{
+	struct bench_timer timer;
+	long usec[2];
+	size_t i;
+
+	/* flatten outside of the timed loop */
+	if (xylo_tgraph_compact(graph) ||
+	    xylo_tgraph_propagate(graph, xylo_taffine2d)) {
+		return -1;
+	}
+
+	if (start_timer(&timer)) { return -1; }
+	for (i = 0; i < nrounds; i++) {
+		(void)xylo_tgraph_transform(graph, affine2d_concat);
+	}
+	usec[0] = stop_timer(&timer);
+
+	if (start_timer(&timer)) { return -1; }
+	for (i = 0; i < nrounds; i++) {
+		(void)xylo_tgraph_propagate(graph, xylo_taffine2d);
+	}
+	usec[1] = stop_timer(&timer);
+
+	printf("%zu nodes: transform %g ms, propagate %g ms\n",
+	       nnodes, usec[0] * 1e-3 / nrounds, usec[1] * 1e-3 / nrounds);
+	return 0;
+}
+
+/* Touch `count` random nodes by moving them a little */
+static int touch_random(
+	struct xylo_tgraph *graph,
+	struct xylo_tnode **nodes,
+	size_t n,
+	size_t count)
+{
+	struct xylo_tnode *node;
+	float tfm[6];
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		node = nodes[rand() % n];
+		(void)memcpy(tfm, xylo_tnode_local(node), sizeof tfm);
+		tfm[4] += 0.5f;
+		if (xylo_tnode_set_local(graph, node, tfm)) { return -1; }
+	}
+	return 0;
+}
+
+/* time `nrounds` rounds of touching `touched` nodes and updating `graph` */
+static long time_update(
+	struct xylo_tgraph *graph,
+	struct xylo_tnode **nodes,
+	size_t nnodes,
+	size_t touched,
+	size_t nrounds,
+	int (*update)(struct xylo_tgraph *, enum xylo_tformat))
+{
+	struct bench_timer timer;
+	long usec;
+	size_t i;
+
+	for (usec = 0, i = 0; i < nrounds; i++) {
+		if (touch_random(graph, nodes, nnodes, touched) ||
+		    start_timer(&timer)) {
+			return -1;
+		}
+		(void)update(graph, xylo_taffine2d);
+		usec += stop_timer(&timer);
+	}
+	return usec;
+}
+
+static int run_incremental(
+	struct xylo_tgraph *graph,
+	struct xylo_tnode **nodes,
+	size_t nnodes,
+	size_t nrounds)
+{
+	size_t touched;
+	long full, incremental;
+
+	if (xylo_tgraph_propagate(graph, xylo_taffine2d)) { return -1; }
+	for (touched = 10; touched <= nnodes / 100; touched *= 10) {
+		full = time_update(graph, nodes, nnodes, touched, nrounds,
+		                   xylo_tgraph_propagate);
+		incremental = time_update(graph, nodes, nnodes, touched,
+		                          nrounds, xylo_tgraph_update);
+		if (full < 0 || incremental < 0) { return -1; }
+		printf("%zu nodes, %zu touched: propagate %g ms, update %g ms\n",
+		       nnodes,
+		       touched,
+		       full * 1e-3 / nrounds,
+		       incremental * 1e-3 / nrounds);
+	}
+	return 0;
+}
+
+static int run_parallel(
+	struct xylo_tgraph *graph,
+	size_t nnodes,
+	size_t nrounds)
+{
+	struct bench_timer timer;
+	struct tpool *pool;
+	unsigned nthreads;
+	size_t i;
+	long usec;
+
+	if (xylo_tgraph_propagate(graph, xylo_tmat44f)) { return -1; }
+	for (nthreads = 1; nthreads <= 8; nthreads *= 2) {
+		if (pool = tpool_make(nthreads), !pool) { return -1; }
+		if (start_timer(&timer)) {
+			tpool_free(pool);
+			return -1;
+		}
+		for (i = 0; i < nrounds; i++) {
+			(void)xylo_tgraph_propagate_parallel(
+				graph, xylo_tmat44f, pool);
+		}
+		usec = stop_timer(&timer);
+		tpool_free(pool);
+		printf("%zu nodes, %u threads: %g ms\n",
+		       nnodes, nthreads, usec * 1e-3 / nrounds);
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct xylo_tgraph *graph;
+	struct xylo_tnode **nodes;
+	size_t nnodes, nrounds;
+	int result;
+
+	nnodes = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_NODES;
+	nrounds = argc > 2 ? strtoul(argv[2], NULL, 10) : DEFAULT_ROUNDS;
+	if (argc > 3 || nnodes == 0 || nrounds == 0) {
+		fprintf(stderr, "usage: %s [nodes [rounds]]\n", argv[0]);
+		return 2;
+	}
+	nodes = malloc(nnodes * sizeof *nodes);
+	graph = nodes ? make_random_graph(nodes, nnodes, 6) : NULL;
+	if (!graph) {
+		fprintf(stderr, "%s: out of memory\n", argv[0]);
+		free(nodes);
+		return 1;
+	}
+	result = run_propagation(graph, nnodes, nrounds) ||
+		run_incremental(graph, nodes, nnodes, nrounds);
+	xylo_free_tgraph(graph);
+	if (!result) {
+		graph = make_random_graph(nodes, nnodes, 16);
+		result = graph ? run_parallel(graph, nnodes, nrounds) : -1;
+		if (graph) { xylo_free_tgraph(graph); }
+	}
+	free(nodes);
+	if (result) {
+		fprintf(stderr, "%s: benchmark failed\n", argv[0]);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,230 @@
+/* Mesh triangulation benchmark. Triangulates many glyph-like shapes, each an
+   outer and an inner contour of lines and conic arcs, on thread pools of
+   different sizes, and then through a mesh cache in memory and in a file, e.g.
+
+       target/bench/xylo/bin/triangulate [glyphs]
+*/
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "adt/ilist.h"
+#include "base/wbuf.h"
+#include "glapi/core.h"
+#include "spline/shape.h"
+#include "tempo/tempo.h"
+#include "tpool/tpool.h"
+#include "xylo/shape.h"
+
+#include "../mesh.h"
+#include "../meshcache.h"
+#include "bench.h"
+
+#define DEFAULT_GLYPHS 2000
+
+/* Outer and inner contour of each glyph, like an O */
+#define OUTER_SEGMENTS 24
+#define INNER_SEGMENTS 12
+
+struct glyphs
+{
+	size_t n;
+	struct spline_shape *shapes;
+	struct spline_outline *outlines;
+	struct spline_segment *segments;
+};
+
+/* a closed contour of conic arcs and lines around the origin with a wobbly
+   radius, clockwise if `n` is negative */
+static void make_contour(
+	struct spline_outline *outline,
+	struct spline_segment *segments,
+	int n,
+	float radius)
+{
+	float a, da, r, w;
+	size_t i, m;
+
+	m = n < 0 ? -n : n;
+	da = 2.f * 3.14159265f / n;
+	w = cosf(da / 2.f);
+	for (i = 0; i < m; i++) {
+		a = da * i;
+		r = radius * frand(0.9f, 1.1f);
+		segments[i].end[0] = r * cosf(a);
+		segments[i].end[1] = r * sinf(a);
+		if (i % 3 == 1) {
+			segments[i].mid[0] = r / w * cosf(a + da / 2.f);
+			segments[i].mid[1] = r / w * sinf(a + da / 2.f);
+			segments[i].weight = w;
+		} else {
+			/* straight line */
+			(void)memcpy(segments[i].mid, segments[i].end,
+			             sizeof segments[i].mid);
+			segments[i].weight = 0.f;
+		}
+	}
+	outline->n = m;
+	outline->segments = segments;
+}
+
+static int make_glyphs(struct glyphs *glyphs, size_t n)
+{
+	size_t i;
+	struct spline_segment *segments;
+
+	glyphs->n = n;
+	glyphs->shapes = malloc(n * sizeof *glyphs->shapes);
+	glyphs->outlines = malloc(n * 2 * sizeof *glyphs->outlines);
+	glyphs->segments = malloc(
+		n * (OUTER_SEGMENTS + INNER_SEGMENTS) *
+		sizeof *glyphs->segments);
+	if (!glyphs->shapes || !glyphs->outlines || !glyphs->segments) {
+		free(glyphs->shapes);
+		free(glyphs->outlines);
+		free(glyphs->segments);
+		return -1;
+	}
+
+	srand(1);
+	for (i = 0; i < n; i++) {
+		segments = glyphs->segments +
+			i * (OUTER_SEGMENTS + INNER_SEGMENTS);
+		make_contour(glyphs->outlines + i*2, segments,
+			OUTER_SEGMENTS, 0.4f);
+		make_contour(glyphs->outlines + i*2 + 1,
+			segments + OUTER_SEGMENTS,
+			-INNER_SEGMENTS, 0.2f);
+		glyphs->shapes[i].n = 2;
+		glyphs->shapes[i].outlines = glyphs->outlines + i*2;
+	}
+	return 0;
+}
+
+static void free_glyphs(struct glyphs *glyphs)
+{
+	free(glyphs->shapes);
+	free(glyphs->outlines);
+	free(glyphs->segments);
+}
+
+/* triangulate `glyphs` through `cache`, which can be NULL, on `pool`, and
+   return the elapsed time in microseconds or -1 on failure */
+static long triangulate(
+	struct glyphs const *glyphs,
+	struct xylo_mesh_cache *cache,
+	struct tpool *pool,
+	size_t *counts)
+{
+	struct bench_timer timer;
+	struct wbuf buf;
+	long usec;
+	int result;
+
+	if (start_timer(&timer)) { return -1; }
+	wbuf_init(&buf);
+	result = xylo_triangulate_cached(
+		cache,
+		pool,
+		glyphs->n,
+		glyphs->shapes,
+		&buf,
+		counts);
+	usec = stop_timer(&timer);
+	wbuf_term(&buf);
+	return result ? -1 : usec;
+}
+
+static int run_parallel(struct glyphs const *glyphs, size_t *counts)
+{
+	static unsigned const nthreads[] = { 1, 2, 4, 0 };
+
+	struct tpool *pool;
+	size_t i;
+	long usec;
+
+	for (i = 0; i < sizeof nthreads / sizeof *nthreads; i++) {
+		if (pool = tpool_make(nthreads[i]), !pool) { return -1; }
+		usec = triangulate(glyphs, NULL, pool, counts);
+		if (usec >= 0) {
+			printf("%2u threads:       %8.2f ms\n",
+			       tpool_size(pool), usec * 1e-3);
+		}
+		tpool_free(pool);
+		if (usec < 0) { return -1; }
+	}
+	return 0;
+}
+
+/* a file name for a mesh cache, which the caller removes */
+static char const *cache_path(void)
+{
+	static char path[256];
+	char const *dir;
+
+	dir = getenv("TMPDIR");
+	if (!dir || !*dir) { dir = "/tmp"; }
+	if (snprintf(path, sizeof path, "%s/xylo-mesh-bench.cache", dir) >=
+	    (int)sizeof path) {
+		return NULL;
+	}
+	return path;
+}
+
+static int run_cached(struct glyphs const *glyphs, size_t *counts)
+{
+	struct xylo_mesh_cache *cache;
+	char const *path;
+	long usec[3];
+
+	if (path = cache_path(), !path) { return -1; }
+	(void)remove(path);
+
+	if (cache = xylo_make_mesh_cache(NULL), !cache) { return -1; }
+	usec[0] = triangulate(glyphs, cache, NULL, counts);
+	usec[1] = triangulate(glyphs, cache, NULL, counts);
+	if (xylo_save_mesh_cache(cache, path)) { usec[1] = -1; }
+	xylo_free_mesh_cache(cache);
+
+	if (cache = xylo_make_mesh_cache(path), !cache) { return -1; }
+	usec[2] = triangulate(glyphs, cache, NULL, counts);
+	xylo_free_mesh_cache(cache);
+	(void)remove(path);
+
+	if (usec[0] < 0 || usec[1] < 0 || usec[2] < 0) { return -1; }
+	printf("cache miss:       %8.2f ms\n", usec[0] * 1e-3);
+	printf("cache in memory:  %8.2f ms\n", usec[1] * 1e-3);
+	printf("cache from file:  %8.2f ms\n", usec[2] * 1e-3);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct glyphs glyphs;
+	size_t n, *counts;
+	int result;
+
+	n = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_GLYPHS;
+	if (argc > 2 || n == 0) {
+		fprintf(stderr, "usage: %s [glyphs]\n", argv[0]);
+		return 2;
+	}
+	counts = malloc(n * sizeof *counts);
+	if (!counts || make_glyphs(&glyphs, n)) {
+		fprintf(stderr, "%s: out of memory\n", argv[0]);
+		free(counts);
+		return 1;
+	}
+	printf("%zu glyphs of %d segments\n",
+	       n, OUTER_SEGMENTS + INNER_SEGMENTS);
+	result = run_parallel(&glyphs, counts) || run_cached(&glyphs, counts);
+	free_glyphs(&glyphs);
+	free(counts);
+	if (result) {
+		fprintf(stderr, "%s: benchmark failed\n", argv[0]);
+		return 1;
+	}
+	return 0;
+}
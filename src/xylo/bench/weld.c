@@ -0,0 +1,149 @@
+/* Vertex welding benchmark. Welds the points of the outline of one large
+   generated shape, in the order in which meshes are built, and compares the
+   time to that of a linear search for each point, e.g.
+
+       target/bench/xylo/bin/weld [segments]
+*/
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "glapi/core.h"
+#include "tempo/tempo.h"
+
+#include "../types.h"
+#include "../weld.h"
+#include "bench.h"
+
+#define MIN_SQUARED_DISTANCE 1e-10
+#define DEFAULT_SEGMENTS 25000
+
+/* the linear search that welding replaces */
+static float square_distance(float const a[2], float const b[2])
+{
+	double dx, dy;
+	dx = a[0] - b[0];
+	dy = a[1] - b[1];
+	return dx*dx + dy*dy;
+}
+
+static unsigned linear_insert(float (*v)[2], size_t *n, float const pt[2])
+{
+	size_t i, m;
+	for (i = 0, m = *n; i < m; i++) {
+		if (square_distance(v[i], pt) < MIN_SQUARED_DISTANCE) {
+			return i;
+		}
+	}
+	++*n;
+	(void)memcpy(v[i], pt, sizeof *v);
+	return i;
+}
+
+/* points of the outline of a generated shape, in the order in which meshes
+   are built: the end point, the next end point, and the control point of
+   each segment */
+static float (*make_shape_points(size_t nseg))[2]
+{
+	float (*points)[2], (*ends)[2], a, r;
+	size_t i, j;
+
+	points = malloc(nseg * 3 * sizeof *points);
+	ends = malloc(nseg * sizeof *ends);
+	if (!points || !ends) {
+		free(points);
+		free(ends);
+		return NULL;
+	}
+	for (i = 0; i < nseg; i++) {
+		a = 2.f * 3.14159265f * i / nseg;
+		r = frand(0.9f, 1.1f);
+		ends[i][0] = r * cosf(a);
+		ends[i][1] = r * sinf(a);
+	}
+	for (i = 0; i < nseg; i++) {
+		j = (i + 1) % nseg;
+		(void)memcpy(points[i*3 + 0], ends[i], sizeof *ends);
+		(void)memcpy(points[i*3 + 1], ends[j], sizeof *ends);
+		points[i*3 + 2][0] = (ends[i][0] + points[i*3 + 1][0]) * 0.51f;
+		points[i*3 + 2][1] = (ends[i][1] + points[i*3 + 1][1]) * 0.51f;
+	}
+	free(ends);
+	return points;
+}
+
+/* time welding the first `n` points, or -1 on failure */
+static long time_weld(float (*points)[2], size_t n, float (*vertices)[2])
+{
+	struct xylo_weld weld;
+	struct bench_timer timer;
+	long usec;
+	size_t i;
+
+	if (xylo_init_weld(&weld, vertices, n)) { return -1; }
+	if (start_timer(&timer)) {
+		xylo_term_weld(&weld);
+		return -1;
+	}
+	for (i = 0; i < n; i++) { (void)xylo_weld_insert(&weld, points[i]); }
+	usec = stop_timer(&timer);
+	xylo_term_weld(&weld);
+	return usec;
+}
+
+static long time_linear(float (*points)[2], size_t n, float (*vertices)[2])
+{
+	struct bench_timer timer;
+	size_t i, nv;
+
+	if (start_timer(&timer)) { return -1; }
+	nv = 0;
+	for (i = 0; i < n; i++) {
+		(void)linear_insert(vertices, &nv, points[i]);
+	}
+	return stop_timer(&timer);
+}
+
+int main(int argc, char *argv[])
+{
+	float (*points)[2], (*vertices)[2];
+	size_t nseg, n;
+	long usec;
+
+	nseg = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_SEGMENTS;
+	if (argc > 2 || nseg == 0) {
+		fprintf(stderr, "usage: %s [segments]\n", argv[0]);
+		return 2;
+	}
+	srand(2);
+	points = make_shape_points(nseg);
+	vertices = malloc(nseg * 3 * sizeof *vertices);
+	if (!points || !vertices) {
+		fprintf(stderr, "%s: out of memory\n", argv[0]);
+		free(points);
+		free(vertices);
+		return 1;
+	}
+
+	/* a linear search of the whole shape takes tens of seconds */
+	usec = 0;
+	printf("%zu segments, %zu vertices\n", nseg, nseg * 2);
+	for (n = nseg * 3; n >= 1000; n /= 10) {
+		if (usec = time_weld(points, n, vertices), usec < 0) { break; }
+		printf("%6zu points, grid:   %10.2f ms\n", n, usec * 1e-3);
+	}
+	for (n = nseg * 3 / 10; n >= 1000 && usec >= 0; n /= 10) {
+		if (usec = time_linear(points, n, vertices), usec < 0) { break; }
+		printf("%6zu points, linear: %10.2f ms\n", n, usec * 1e-3);
+	}
+
+	free(vertices);
+	free(points);
+	if (usec < 0) {
+		fprintf(stderr, "%s: benchmark failed\n", argv[0]);
+		return 1;
+	}
+	return 0;
+}
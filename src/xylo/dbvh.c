@@ -0,0 +1,533 @@
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+#include <string.h>
+#include <math.h>
+
+#include "base/mem.h"
+#include "base/gbuf.h"
+#include "base/wbuf.h"
+#include "glapi/core.h"
+#include "xylo/draw.h"
+#include "xylo/dbvh.h"
+
+#include "types.h"
+
+/* maximum number of leaves in a terminal node */
+#define NODE_ITEMS 4
+
+#define NO_PARENT UINT32_MAX
+
+/* A leaf of the draw tree */
+struct item
+{
+	struct xylo_draw const *draw;
+	float bounds[4];
+	uint32_t node; /* terminal node containing the item */
+};
+
+/* Entry of the item lookup table, sorted by address of the leaf */
+struct entry
+{
+	struct xylo_draw const *draw;
+	uint32_t item;
+};
+
+/* Nodes are stored in breadth-first order, so parents always come before
+   their children and the children of a node are adjacent. Terminal nodes have
+   no children and contain `order[begin]` ... `order[end - 1]`. */
+struct node
+{
+	float bounds[4];
+	uint32_t parent, child, begin, end;
+};
+
+struct xylo_dbvh
+{
+	struct wbuf items; /* struct item[], in drawing order */
+	struct wbuf order; /* uint32_t[], items grouped by terminal node */
+	struct wbuf nodes; /* struct node[] */
+	struct wbuf lookup; /* struct entry[] */
+	struct wbuf stack, hits; /* uint32_t[], scratch space for queries */
+};
+
+static void empty_bounds(float *dest)
+{
+	dest[0] = dest[1] = HUGE_VALF;
+	dest[2] = dest[3] = -HUGE_VALF;
+}
+
+static void add_bounds(float *dest, float const *b)
+{
+	if (b[0] < dest[0]) { dest[0] = b[0]; }
+	if (b[1] < dest[1]) { dest[1] = b[1]; }
+	if (b[2] > dest[2]) { dest[2] = b[2]; }
+	if (b[3] > dest[3]) { dest[3] = b[3]; }
+}
+
+static int overlaps(float const *a, float const *b)
+{
+	return a[0] <= b[2] && b[0] <= a[2] && a[1] <= b[3] && b[1] <= a[3];
+}
+
+/* Bounds of the box `src` after the affine transform `t` */
+static void transform_bounds(
+	float *dest,
+	struct xylo_draw_transform const *t,
+	float const *src)
+{
+	float x, y, p[2];
+	int k;
+
+	empty_bounds(dest);
+	if (src[0] > src[2] || src[1] > src[3]) { return; }
+	for (k = 0; k < 4; k++) {
+		x = src[(k & 1) ? 2 : 0];
+		y = src[(k & 2) ? 3 : 1];
+		p[0] = t->m22[0] * x + t->m22[2] * y + t->pos[0];
+		p[1] = t->m22[1] * x + t->m22[3] * y + t->pos[1];
+		add_bounds(dest, (float[4]){ p[0], p[1], p[0], p[1] });
+	}
+}
+
+static void leaf_bounds(float *dest, struct xylo_draw const *draw)
+{
+	struct xylo_doutline const *doutline;
+	struct xylo_dmesh const *dmesh;
+
+	empty_bounds(dest);
+	switch (draw->type) {
+	case xylo_doutline:
+		doutline = xylo_doutline_cast((struct xylo_draw *)draw);
+		if (doutline->outline) {
+			transform_bounds(dest, &doutline->transform,
+			                 doutline->outline->bounds);
+		}
+		break;
+
+	case xylo_dmesh:
+		dmesh = xylo_dmesh_cast((struct xylo_draw *)draw);
+		if (dmesh->mesh) {
+			transform_bounds(dest, &dmesh->transform,
+			                 dmesh->mesh->bounds);
+		}
+		break;
+
+	case xylo_dlist:
+	case xylo_dmax:
+	default:
+		assert("Unreachable" && 0);
+		break;
+	}
+}
+
+static struct item *get_items(struct xylo_dbvh const *bvh)
+{
+	return bvh->items.begin;
+}
+
+static struct node *get_nodes(struct xylo_dbvh const *bvh)
+{
+	return bvh->nodes.begin;
+}
+
+static uint32_t *get_order(struct xylo_dbvh const *bvh)
+{
+	return bvh->order.begin;
+}
+
+/* Recompute the bounds of `node` from its items or children */
+static void fit_node(struct xylo_dbvh *bvh, struct node *node)
+{
+	struct item const *items;
+	struct node const *nodes;
+	uint32_t const *order;
+	uint32_t i;
+
+	empty_bounds(node->bounds);
+	if (node->child) {
+		nodes = get_nodes(bvh);
+		add_bounds(node->bounds, nodes[node->child].bounds);
+		add_bounds(node->bounds, nodes[node->child + 1].bounds);
+	} else {
+		items = get_items(bvh);
+		order = get_order(bvh);
+		for (i = node->begin; i < node->end; i++) {
+			add_bounds(node->bounds, items[order[i]].bounds);
+		}
+	}
+}
+
+/* Bottom-up pass over all nodes */
+static void fit_nodes(struct xylo_dbvh *bvh)
+{
+	struct node *nodes;
+	size_t i;
+
+	nodes = get_nodes(bvh);
+	for (i = wbuf_nmemb(&bvh->nodes, sizeof *nodes); i > 0; i--) {
+		fit_node(bvh, nodes + i - 1);
+	}
+}
+
+static int collect_rec(struct xylo_dbvh *bvh, struct xylo_draw const *draw)
+{
+	struct xylo_dlist const *dlist;
+	struct xylo_draw **p, **q;
+	struct item *item;
+	int i;
+
+	assert(draw != NULL);
+	switch (draw->type) {
+	case xylo_doutline:
+	case xylo_dmesh:
+		item = wbuf_alloc(&bvh->items, sizeof *item);
+		if (!item) { return -1; }
+		item->draw = draw;
+		item->node = 0;
+		leaf_bounds(item->bounds, draw);
+		break;
+
+	case xylo_dlist:
+		dlist = xylo_dlist_cast((struct xylo_draw *)draw);
+		for (i = 0; i < 2; i++) {
+			p = dlist->elements.begin[i];
+			q = dlist->elements.end[i];
+			for (; p < q; p++) {
+				if (collect_rec(bvh, *p)) { return -1; }
+			}
+		}
+		break;
+
+	case xylo_dmax:
+	default:
+		assert("Unreachable" && 0);
+		break;
+	}
+	return 0;
+}
+
+static float centre(struct item const *item, int axis)
+{
+	float const *b = item->bounds;
+	return b[axis] <= b[axis + 2] ? (b[axis] + b[axis + 2]) * 0.5f : 0.f;
+}
+
+/* Partially sort `order[0]` ... `order[n - 1]` by the centre of their items
+   along `axis`, so that element k is in its sorted position with no greater
+   element before it and no smaller one after */
+static void select_nth(
+	uint32_t *order,
+	ptrdiff_t n,
+	ptrdiff_t k,
+	struct item const *items,
+	int axis)
+{
+	ptrdiff_t lo, hi, i, j;
+	uint32_t tmp;
+	float pivot;
+
+	lo = 0;
+	hi = n - 1;
+	while (lo < hi) {
+		pivot = centre(items + order[lo + (hi - lo) / 2], axis);
+		i = lo;
+		j = hi;
+		while (i <= j) {
+			while (centre(items + order[i], axis) < pivot) { i++; }
+			while (centre(items + order[j], axis) > pivot) { j--; }
+			if (i <= j) {
+				tmp = order[i];
+				order[i++] = order[j];
+				order[j--] = tmp;
+			}
+		}
+		if (k <= j) {
+			hi = j;
+		} else if (k >= i) {
+			lo = i;
+		} else {
+			break;
+		}
+	}
+}
+
+/* Split the items of `node` at the median of their centres along the axis
+   where the centres are spread out the most */
+static uint32_t split_node(struct xylo_dbvh *bvh, struct node const *node)
+{
+	struct item const *items;
+	uint32_t *order, i, mid;
+	float c[4], x, y;
+
+	items = get_items(bvh);
+	order = get_order(bvh);
+	empty_bounds(c);
+	for (i = node->begin; i < node->end; i++) {
+		x = centre(items + order[i], 0);
+		y = centre(items + order[i], 1);
+		add_bounds(c, (float[4]){ x, y, x, y });
+	}
+	mid = (node->end - node->begin) / 2;
+	select_nth(order + node->begin, node->end - node->begin, mid, items,
+	           (c[2] - c[0] >= c[3] - c[1]) ? 0 : 1);
+	return node->begin + mid;
+}
+
+static int make_nodes(struct xylo_dbvh *bvh)
+{
+	struct node *node, *children;
+	uint32_t i, n, mid, child;
+
+	n = wbuf_nmemb(&bvh->items, sizeof(struct item));
+	node = wbuf_alloc(&bvh->nodes, sizeof *node);
+	if (!node) { return -1; }
+	node->parent = NO_PARENT;
+	node->begin = 0;
+	node->end = n;
+
+	/* nodes are appended while iterating, which gives breadth-first order */
+	for (i = 0; i < wbuf_nmemb(&bvh->nodes, sizeof *node); i++) {
+		node = get_nodes(bvh) + i;
+		node->child = 0;
+		if (node->end - node->begin <= NODE_ITEMS) {
+			for (n = node->begin; n < node->end; n++) {
+				get_items(bvh)[get_order(bvh)[n]].node = i;
+			}
+			continue;
+		}
+		mid = split_node(bvh, node);
+		child = wbuf_nmemb(&bvh->nodes, sizeof *node);
+		children = wbuf_alloc(&bvh->nodes, 2 * sizeof *children);
+		if (!children) { return -1; }
+		node = get_nodes(bvh) + i;
+		node->child = child;
+		children[0].parent = children[1].parent = i;
+		children[0].begin = node->begin;
+		children[0].end = children[1].begin = mid;
+		children[1].end = node->end;
+	}
+	return 0;
+}
+
+static int by_address(void const *a, void const *b)
+{
+	uintptr_t p, q;
+
+	p = (uintptr_t)((struct entry const *)a)->draw;
+	q = (uintptr_t)((struct entry const *)b)->draw;
+	return (p > q) - (p < q);
+}
+
+static void rewind_dbvh(struct xylo_dbvh *bvh)
+{
+	wbuf_rewind(&bvh->items);
+	wbuf_rewind(&bvh->order);
+	wbuf_rewind(&bvh->nodes);
+	wbuf_rewind(&bvh->lookup);
+}
+
+struct xylo_dbvh *xylo_make_dbvh(void)
+{
+	struct xylo_dbvh *bvh;
+
+	bvh = malloc(sizeof *bvh);
+	if (!bvh) { return NULL; }
+	wbuf_init(&bvh->items);
+	wbuf_init(&bvh->order);
+	wbuf_init(&bvh->nodes);
+	wbuf_init(&bvh->lookup);
+	wbuf_init(&bvh->stack);
+	wbuf_init(&bvh->hits);
+	return bvh;
+}
+
+void xylo_free_dbvh(struct xylo_dbvh *bvh)
+{
+	if (!bvh) { return; }
+	wbuf_term(&bvh->items);
+	wbuf_term(&bvh->order);
+	wbuf_term(&bvh->nodes);
+	wbuf_term(&bvh->stack);
+	wbuf_term(&bvh->lookup);
+	wbuf_term(&bvh->hits);
+	free(bvh);
+}
+
+int xylo_dbvh_build(struct xylo_dbvh *bvh, struct xylo_draw const *root)
+{
+	struct entry *lookup;
+	uint32_t *order, i, n;
+
+	assert(bvh != NULL);
+	assert(root != NULL);
+
+	rewind_dbvh(bvh);
+	if (collect_rec(bvh, root)) { goto fail; }
+	n = wbuf_nmemb(&bvh->items, sizeof(struct item));
+	order = wbuf_alloc(&bvh->order, n * sizeof *order);
+	if (!order) { goto fail; }
+	lookup = wbuf_alloc(&bvh->lookup, n * sizeof *lookup);
+	if (!lookup) { goto fail; }
+	for (i = 0; i < n; i++) {
+		order[i] = i;
+		lookup[i].draw = get_items(bvh)[i].draw;
+		lookup[i].item = i;
+	}
+	if (n > 1) { qsort(lookup, n, sizeof *lookup, by_address); }
+	if (make_nodes(bvh)) { goto fail; }
+	fit_nodes(bvh);
+	return 0;
+
+fail:
+	rewind_dbvh(bvh);
+	return -1;
+}
+
+int xylo_dbvh_update(struct xylo_dbvh *bvh, struct xylo_draw const *leaf)
+{
+	struct entry const *entry, key = { leaf, 0 };
+	struct item *item;
+	struct node *nodes;
+	uint32_t i;
+	size_t n;
+	float old[4];
+
+	assert(bvh != NULL);
+	assert(leaf != NULL);
+
+	n = wbuf_nmemb(&bvh->lookup, sizeof key);
+	if (n == 0) { return -1; }
+	entry = bsearch(&key, bvh->lookup.begin, n, sizeof key, by_address);
+	if (!entry) { return -1; }
+	item = get_items(bvh) + entry->item;
+	leaf_bounds(item->bounds, leaf);
+
+	/* refit towards the root until the bounds of a node stay the same */
+	nodes = get_nodes(bvh);
+	for (i = item->node; i != NO_PARENT; i = nodes[i].parent) {
+		(void)memcpy(old, nodes[i].bounds, sizeof old);
+		fit_node(bvh, nodes + i);
+		if (memcmp(old, nodes[i].bounds, sizeof old) == 0) { break; }
+	}
+	return 0;
+}
+
+void xylo_dbvh_refit(struct xylo_dbvh *bvh)
+{
+	struct item *item, *end;
+
+	assert(bvh != NULL);
+
+	end = bvh->items.end;
+	for (item = get_items(bvh); item < end; item++) {
+		leaf_bounds(item->bounds, item->draw);
+	}
+	fit_nodes(bvh);
+}
+
+size_t xylo_dbvh_length(struct xylo_dbvh const *bvh)
+{
+	assert(bvh != NULL);
+	return wbuf_nmemb(&bvh->items, sizeof(struct item));
+}
+
+/* Collect the indices of the items whose bounds overlap `rect` in
+   `bvh->hits`, in no particular order. A point is an empty rectangle. */
+static int find_hits(struct xylo_dbvh *bvh, float const *rect)
+{
+	struct item const *items;
+	struct node const *node;
+	uint32_t const *order;
+	uint32_t i, j;
+
+	wbuf_rewind(&bvh->hits);
+	wbuf_rewind(&bvh->stack);
+	if (wbuf_nmemb(&bvh->items, sizeof *items) == 0) { return 0; }
+
+	items = get_items(bvh);
+	order = get_order(bvh);
+	i = 0;
+	if (!wbuf_write(&bvh->stack, &i, sizeof i)) { return -1; }
+	while (wbuf_pop(&bvh->stack, &i, sizeof i) == 0) {
+		node = get_nodes(bvh) + i;
+		if (!overlaps(node->bounds, rect)) { continue; }
+		if (node->child) {
+			j = node->child;
+			if (!wbuf_write(&bvh->stack, &j, sizeof j)) { return -1; }
+			j++;
+			if (!wbuf_write(&bvh->stack, &j, sizeof j)) { return -1; }
+			continue;
+		}
+		for (j = node->begin; j < node->end; j++) {
+			if (!overlaps(items[order[j]].bounds, rect)) { continue; }
+			if (!wbuf_write(&bvh->hits, order + j, sizeof *order)) {
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+static int ascending(void const *a, void const *b)
+{
+	uint32_t const *p = a, *q = b;
+	return (*p > *q) - (*p < *q);
+}
+
+static int descending(void const *a, void const *b)
+{
+	return ascending(b, a);
+}
+
+int xylo_dbvh_query(
+	struct xylo_dbvh *bvh,
+	float const rect[4],
+	struct wbuf *dest)
+{
+	struct item const *items;
+	uint32_t const *hit, *end;
+	size_t n;
+
+	assert(bvh != NULL);
+	assert(rect != NULL);
+	assert(dest != NULL);
+
+	if (find_hits(bvh, rect)) { return -1; }
+	n = wbuf_nmemb(&bvh->hits, sizeof *hit);
+	if (n > 1) { qsort(bvh->hits.begin, n, sizeof *hit, ascending); }
+	items = get_items(bvh);
+	end = bvh->hits.end;
+	for (hit = bvh->hits.begin; hit < end; hit++) {
+		if (!wbuf_write(dest, &items[*hit].draw, sizeof items->draw)) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+size_t xylo_dbvh_pick(
+	struct xylo_dbvh *bvh,
+	float x,
+	float y,
+	struct xylo_draw const **dest,
+	size_t max)
+{
+	struct item const *items;
+	uint32_t const *hits;
+	size_t i, n;
+
+	assert(bvh != NULL);
+	assert(dest != NULL || max == 0);
+
+	if (find_hits(bvh, (float[4]){ x, y, x, y })) { return 0; }
+	n = wbuf_nmemb(&bvh->hits, sizeof *hits);
+	if (n > 1) { qsort(bvh->hits.begin, n, sizeof *hits, descending); }
+	items = get_items(bvh);
+	hits = bvh->hits.begin;
+	for (i = 0; i < n && i < max; i++) {
+		dest[i] = items[hits[i]].draw;
+	}
+	return i;
+}
@@ -2,10 +2,13 @@
 #include <assert.h>
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
 
 #include "base/mem.h"
 #include "base/gbuf.h"
+#include "base/wbuf.h"
 #include "gm/matrix.h"
+#include "gm/batch.h"
 #include "glapi/core.h"
 #include "glapi/api.h"
 
@@ -51,25 +54,41 @@ static void init_style(struct xylo_draw_style *s)
 	s->color[0] = s->color[1] = s->color[2] = s->color[3] = 0.0f;
 }
 
+static void xylo_draw_cmds(
+	struct xylo *xylo,
+	size_t samples,
+	float const *proj,
+	struct xylo_dcmds *cmds);
+
 static void xylo_draw_rec(
 	struct xylo *xylo,
 	size_t samples,
 	float const *proj,
-	struct xylo_draw *draw);
+	struct xylo_draw const *draw);
 
-static void resize_fb(
-	struct gl_core33 const *restrict gl,
-	struct xylo_fb *fb,
-	GLint size[2])
+/* draw `cmds`, or the tree `draw` leaf by leaf if `cmds` is NULL */
+static void draw_samples(
+	struct xylo *xylo,
+	size_t samples,
+	float const *proj,
+	struct xylo_dcmds *cmds,
+	struct xylo_draw const *draw)
 {
-	if (fb->width < size[0] || fb->height < size[1]) {
-		xylo_fb_resize(gl, fb, size[0], size[1]);
+	struct gl_core33 const *restrict gl;
+
+	if (cmds) {
+		xylo_draw_cmds(xylo, samples, proj, cmds);
+	} else {
+		gl = gl_get_core33(xylo->api);
+		xylo_shapes_set_sample_count(&xylo->shapes, gl, samples);
+		xylo_draw_rec(xylo, samples, proj, draw);
 	}
 }
 
 static void draw_aliased(
 	struct xylo *xylo,
 	struct xylo_view const *view,
+	struct xylo_dcmds *cmds,
 	struct xylo_draw const *draw)
 {
 	static size_t const samples = 1;
@@ -86,7 +105,7 @@ static void draw_aliased(
 	xylo_shapes_set_sample_offset(&xylo->shapes, gl, samples, offsets);
 	xylo_shapes_set_sample_clip(&xylo->shapes, gl, samples, clip);
 
-	xylo_draw_rec(xylo, 1, view->projection, (struct xylo_draw *)draw);
+	draw_samples(xylo, samples, view->projection, cmds, draw);
 
 	xylo_end(xylo);
 }
@@ -95,6 +114,7 @@ static void draw_aliased(
 static void draw_quincunx(
 	struct xylo *xylo,
 	struct xylo_view const *view,
+	struct xylo_dcmds *cmds,
 	struct xylo_draw const *draw)
 {
 	static size_t const samples = 2;
@@ -104,6 +124,7 @@ static void draw_quincunx(
 	};
 
 	struct gl_core33 const *restrict gl;
+	struct xylo_fb *fb;
 	GLint viewport[4], size[2];
 	float scaled_proj[16], scale[16];
 	float offsets[2 * 4];
@@ -142,11 +163,11 @@ static void draw_quincunx(
 	gl->Enable(GL_CLIP_DISTANCE0);
 	xylo_shapes_set_sample_offset(&xylo->shapes, gl, samples, offsets);
 	xylo_shapes_set_sample_clip(&xylo->shapes, gl, samples, clip);
-	resize_fb(gl, &xylo->samples, size);
-	gl->BindFramebuffer(GL_DRAW_FRAMEBUFFER, xylo->samples.fbo);
+	fb = xylo_fb_pool_get(gl, &xylo->fbs, size[0], size[1], XYLO_AA_QUINCUNX);
+	gl->BindFramebuffer(GL_DRAW_FRAMEBUFFER, fb->fbo);
 	gl->Viewport(0, 0, size[0], size[1]);
 	gl->Clear(ALL_BUFFERS);
-	xylo_draw_rec(xylo, samples, scaled_proj, (struct xylo_draw *)draw);
+	draw_samples(xylo, samples, scaled_proj, cmds, draw);
 	gl->Disable(GL_CLIP_DISTANCE0);
 
 	/* compose center and corner samples */
@@ -154,7 +175,7 @@ static void draw_quincunx(
 	gl->Viewport(viewport[0], viewport[1], viewport[2], viewport[3]);
 	gl->UseProgram(xylo->quincunx.program);
 	gl->ActiveTexture(GL_TEXTURE0);
-	gl->BindTexture(GL_TEXTURE_2D, xylo->samples.color);
+	gl->BindTexture(GL_TEXTURE_2D, fb->color);
 	xylo_quincunx_set_tex_unit(&xylo->quincunx, gl, 0);
 	xylo_quincunx_set_pixel_size(&xylo->quincunx, gl, pw, ph);
 	xylo_quincunx_draw(&xylo->quincunx, gl);
@@ -165,6 +186,7 @@ static void draw_quincunx(
 static void draw_rgss(
 	struct xylo *xylo,
 	struct xylo_view const *view,
+	struct xylo_dcmds *cmds,
 	struct xylo_draw const *draw)
 {
 	static size_t const samples = 4;
@@ -176,6 +198,7 @@ static void draw_rgss(
 	};
 
 	struct gl_core33 const *restrict gl;
+	struct xylo_fb *fb;
 	GLint viewport[4], size[2];
 	float scaled_proj[16], scale[16];
 	float offsets[4 * 4];
@@ -226,11 +249,11 @@ static void draw_rgss(
 	gl->Enable(GL_CLIP_DISTANCE1);
 	xylo_shapes_set_sample_offset(&xylo->shapes, gl, samples, offsets);
 	xylo_shapes_set_sample_clip(&xylo->shapes, gl, samples, clip);
-	resize_fb(gl, &xylo->samples, size);
-	gl->BindFramebuffer(GL_DRAW_FRAMEBUFFER, xylo->samples.fbo);
+	fb = xylo_fb_pool_get(gl, &xylo->fbs, size[0], size[1], XYLO_AA_RGSS);
+	gl->BindFramebuffer(GL_DRAW_FRAMEBUFFER, fb->fbo);
 	gl->Viewport(0, 0, size[0], size[1]);
 	gl->Clear(ALL_BUFFERS);
-	xylo_draw_rec(xylo, samples, scaled_proj, (struct xylo_draw *)draw);
+	draw_samples(xylo, samples, scaled_proj, cmds, draw);
 	gl->Disable(GL_CLIP_DISTANCE0);
 	gl->Disable(GL_CLIP_DISTANCE1);
 
@@ -239,94 +262,380 @@ static void draw_rgss(
 	gl->Viewport(viewport[0], viewport[1], viewport[2], viewport[3]);
 	gl->UseProgram(xylo->rgss.program);
 	gl->ActiveTexture(GL_TEXTURE0);
-	gl->BindTexture(GL_TEXTURE_2D, xylo->samples.color);
+	gl->BindTexture(GL_TEXTURE_2D, fb->color);
 	xylo_rgss_set_tex_unit(&xylo->rgss, gl, 0);
 	xylo_rgss_draw(&xylo->rgss, gl);
 
 	xylo_end(xylo);
 }
 
-void xylo_draw(
+static void draw_anti_aliased(
 	struct xylo *xylo,
 	struct xylo_view const *view,
+	struct xylo_dcmds *cmds,
 	struct xylo_draw const *draw)
 {
-	switch (xylo->aa) {
+	struct gl_core33 const *restrict gl;
+	int mode;
+
+	gl = gl_get_core33(xylo->api);
+	mode = xylo->aa;
+	if (xylo->aa == XYLO_AA_AUTO) {
+		xylo_aa_timer_poll(gl, &xylo->timer, &xylo->governor);
+		mode = xylo->governor.mode;
+		xylo_aa_timer_begin(gl, &xylo->timer, mode);
+	}
+	xylo->current_aa = mode;
+
+	switch (mode) {
 	case XYLO_AA_NONE:
-		draw_aliased(xylo, view, draw);
+		draw_aliased(xylo, view, cmds, draw);
 		break;
 
 	case XYLO_AA_QUINCUNX:
-		draw_quincunx(xylo, view, draw);
+		draw_quincunx(xylo, view, cmds, draw);
 		break;
 
 	case XYLO_AA_RGSS:
-		draw_rgss(xylo, view, draw);
+		draw_rgss(xylo, view, cmds, draw);
 		break;
 
 	default:
 		assert(0 && "invalid anti-aliasing mode");
 	}
+
+	if (xylo->aa == XYLO_AA_AUTO) {
+		xylo_aa_timer_end(gl, &xylo->timer, &xylo->governor, mode);
+	}
+}
+
+void xylo_draw(
+	struct xylo *xylo,
+	struct xylo_view const *view,
+	struct xylo_draw const *draw)
+{
+	if (xylo_dcmds_compile(xylo->tree, draw)) {
+		/* out of memory - draw leaf by leaf, which needs none */
+		draw_anti_aliased(xylo, view, NULL, draw);
+	} else {
+		draw_anti_aliased(xylo, view, xylo->tree, NULL);
+	}
+}
+
+void xylo_draw_tree(
+	struct xylo *xylo,
+	struct xylo_view const *view,
+	struct xylo_draw const *draw)
+{
+	draw_anti_aliased(xylo, view, NULL, draw);
+}
+
+void xylo_draw_dcmds(
+	struct xylo *xylo,
+	struct xylo_view const *view,
+	struct xylo_dcmds *cmds)
+{
+	draw_anti_aliased(xylo, view, cmds, NULL);
+}
+
+/* maximum number of outlines which share stencil and cover passes */
+#define OUTLINE_BATCH_MAX 64
+
+/* number of consecutive commands starting at `p` with the same shape */
+static size_t same_shape(struct xylo_dcmd const *p, size_t n)
+{
+	size_t i;
+
+	for (i = 1; i < n; i++) {
+		if (p[i].type != p->type ||
+		    p[i].outline != p->outline ||
+		    p[i].mesh != p->mesh) {
+			break;
+		}
+	}
+	return i;
+}
+
+static int overlaps(float const *a, float const *b)
+{
+	return a[0] <= b[2] && b[0] <= a[2] && a[1] <= b[3] && b[1] <= a[3];
 }
 
-static void draw_outline(
+/* Return the number of consecutive outline commands, starting at `p`, with
+   pairwise disjoint screen-space `bounds`. Since the stencil passes of such
+   outlines cannot interfere with each other they can share state. */
+static size_t outline_batch(
+	struct xylo_dcmd const *p,
+	float const *bounds,
+	size_t n)
+{
+	size_t i, j;
+
+	if (n > OUTLINE_BATCH_MAX) { n = OUTLINE_BATCH_MAX; }
+	for (i = 1; i < n && p[i].type == xylo_doutline; i++) {
+		for (j = 0; j < i; j++) {
+			if (overlaps(bounds + 4*i, bounds + 4*j)) { return i; }
+		}
+	}
+	return i;
+}
+
+/* draw `n` outline commands, where the first one has object index `index`,
+   as one stencil pass and one cover pass */
+static void draw_outlines(
 	struct xylo *xylo,
-	struct xylo_outline const *outline,
+	struct xylo_dcmd const *p,
+	GLint index,
+	size_t n,
 	size_t samples)
 {
 	struct gl_core33 const *restrict gl = gl_get_core33(xylo->api);
+	size_t i, run;
+	int pass;
+
+	for (pass = 0; pass < 2; pass++) {
+		if (pass == 0) {
+			/* Step one - Fill in stencil buffer*/
+			gl->ColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			gl->StencilFunc(GL_ALWAYS, 0x00, 0x01);
+			gl->StencilOp(GL_KEEP, GL_KEEP, GL_INVERT);
+		} else {
+			/* Step two - fill in color without overdraw and erase
+			   stencil */
+			gl->ColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+			gl->StencilFunc(GL_EQUAL, 0x01, 0x01);
+			gl->StencilOp(GL_ZERO, GL_ZERO, GL_ZERO);
+		}
+		for (i = 0; i < n; i += run) {
+			run = same_shape(p + i, n - i);
+			xylo_shapes_set_object_index(
+				&xylo->shapes,
+				gl,
+				index + i);
+			xylo_outline_draw_instances(
+				gl,
+				p[i].outline,
+				samples,
+				run);
+		}
+	}
+}
 
-	/* Step one - Fill in stencil buffer*/
-	gl->ColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
-	gl->StencilFunc(GL_ALWAYS, 0x00, 0x01);
-	gl->StencilOp(GL_KEEP, GL_KEEP, GL_INVERT);
+static struct xylo_object const *project_objects(
+	struct xylo_dcmds *cmds,
+	float const *proj);
+
+static void xylo_draw_cmds(
+	struct xylo *xylo,
+	size_t samples,
+	float const *proj,
+	struct xylo_dcmds *cmds)
+{
+	struct gl_core33 const *restrict gl;
+	struct xylo_dcmd const *p;
+	struct xylo_object const *objects;
+	float const *bounds;
+	size_t i, n, base, count, max, run;
+
+	assert(xylo != 0);
+	assert(proj != 0);
+	assert(cmds != 0);
 
-	xylo_outline_draw(gl, outline, samples);
+	gl = gl_get_core33(xylo->api);
+	objects = project_objects(cmds, proj);
+	n = xylo_dcmds_length(cmds);
+	max = xylo->shapes.max_objects;
+	xylo_shapes_set_sample_count(&xylo->shapes, gl, samples);
+
+	/* upload per-object data once, in as few chunks as the texture buffer
+	   allows, so that each object only needs its index */
+	for (base = 0; base < n; base += count) {
+		count = n - base < max ? n - base : max;
+		xylo_shapes_set_objects(
+			&xylo->shapes,
+			gl,
+			count,
+			objects + base);
+		p = (struct xylo_dcmd const *)cmds->cmds.begin + base;
+		bounds = (float const *)cmds->bounds.begin + 4*base;
+		for (i = 0; i < count; i += run, p += run, bounds += 4*run) {
+			switch (p->type) {
+			case xylo_doutline:
+				run = outline_batch(p, bounds, count - i);
+				draw_outlines(xylo, p, i, run, samples);
+				break;
+
+			case xylo_dmesh:
+				/* consecutive copies of a mesh are drawn as
+				   one instanced draw call */
+				run = same_shape(p, count - i);
+				xylo_shapes_set_object_index(
+					&xylo->shapes,
+					gl,
+					i);
+				xylo_mesh_draw_instances(
+					gl,
+					p->mesh,
+					samples,
+					run);
+				break;
+
+			case xylo_dlist:
+			case xylo_dmax:
+			default:
+				assert("Unreachable" && 0);
+				run = 1;
+				break;
+			}
+		}
+	}
+}
 
-	/* Step two - fill in color without overdraw and erase stencil */
-	gl->ColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-	gl->StencilFunc(GL_EQUAL, 0x01, 0x01);
-	gl->StencilOp(GL_ZERO, GL_ZERO, GL_ZERO);
+/* Draw one leaf with the transform `transform` and the shader data of
+   `cmd`, uploading its object data on its own */
+static void draw_leaf(
+	struct xylo *xylo,
+	size_t samples,
+	float const *proj,
+	struct xylo_dcmd const *cmd,
+	struct xylo_draw_transform const *transform)
+{
+	struct gl_core33 const *restrict gl;
+	struct xylo_object object;
+	float mv[16];
 
-	xylo_outline_draw(gl, outline, samples);
+	gl = gl_get_core33(xylo->api);
+	transform_to_modelview(mv, transform);
+	(void)m44mulf(object.mvp, proj, mv);
+	(void)memcpy(object.color, cmd->color, sizeof object.color);
+	object.id[0] = (float)cmd->id;
+	object.id[1] = object.id[2] = object.id[3] = 0.f;
+	xylo_shapes_set_objects(&xylo->shapes, gl, 1, &object);
+	if (cmd->type == xylo_doutline) {
+		draw_outlines(xylo, cmd, 0, 1, samples);
+	} else {
+		xylo_shapes_set_object_index(&xylo->shapes, gl, 0);
+		xylo_mesh_draw_instances(gl, cmd->mesh, samples, 1);
+	}
 }
 
+/* Walk the tree `draw` and draw each leaf as it is found. This is slower than
+   drawing compiled commands, since nothing is batched, but allocates no
+   memory. */
 static void xylo_draw_rec(
 	struct xylo *xylo,
 	size_t samples,
 	float const *proj,
-	struct xylo_draw *draw)
+	struct xylo_draw const *draw)
 {
-	struct gl_core33 const *restrict gl;
 	struct xylo_doutline *doutline;
 	struct xylo_dmesh *dmesh;
 	struct xylo_dlist *dlist;
 	struct xylo_draw **p, **q;
-	float mvp[16], mv[16];
+	struct xylo_dcmd cmd;
 	int i;
 
 	assert(xylo != 0);
 	assert(proj != 0);
+	assert(draw != 0);
+	switch (draw->type) {
+	case xylo_doutline:
+		doutline = xylo_doutline_cast((struct xylo_draw *)draw);
+		cmd.type = xylo_doutline;
+		cmd.id = doutline->id;
+		(void)memcpy(cmd.color, doutline->style.color,
+		             sizeof cmd.color);
+		cmd.outline = doutline->outline;
+		cmd.mesh = NULL;
+		draw_leaf(xylo, samples, proj, &cmd, &doutline->transform);
+		break;
+
+	case xylo_dmesh:
+		dmesh = xylo_dmesh_cast((struct xylo_draw *)draw);
+		cmd.type = xylo_dmesh;
+		cmd.id = dmesh->id;
+		(void)memcpy(cmd.color, dmesh->style.color, sizeof cmd.color);
+		cmd.outline = NULL;
+		cmd.mesh = dmesh->mesh;
+		draw_leaf(xylo, samples, proj, &cmd, &dmesh->transform);
+		break;
+
+	case xylo_dlist:
+		dlist = xylo_dlist_cast((struct xylo_draw *)draw);
+		for (i = 0; i < 2; i++) {
+			p = dlist->elements.begin[i];
+			q = dlist->elements.end[i];
+			for (; p < q; p++) {
+				xylo_draw_rec(xylo, samples, proj, *p);
+			}
+		}
+		break;
+
+	case xylo_dmax:
+	default:
+		assert("Unreachable" && 0);
+		break;
+	}
+}
+
+static int compile_leaf(
+	struct xylo_dcmds *cmds,
+	enum xylo_dtype type,
+	unsigned id,
+	struct xylo_draw_transform const *transform,
+	struct xylo_draw_style const *style)
+{
+	struct xylo_dcmd *cmd;
+	struct xylo_object *object;
+	float *mv;
+
+	cmd = wbuf_alloc(&cmds->cmds, sizeof *cmd);
+	if (!cmd) { return -1; }
+	mv = wbuf_alloc(&cmds->mv, 16 * sizeof *mv);
+	if (!mv) { return -1; }
+	object = wbuf_alloc(&cmds->objects, sizeof *object);
+	if (!object) { return -1; }
+	cmd->type = type;
+	cmd->id = id;
+	(void)memcpy(cmd->color, style->color, sizeof cmd->color);
+	cmd->outline = NULL;
+	cmd->mesh = NULL;
+	transform_to_modelview(mv, transform);
+	(void)memcpy(object->color, style->color, sizeof object->color);
+	object->id[0] = (float)id;
+	object->id[1] = object->id[2] = object->id[3] = 0.f;
+	return 0;
+}
+
+static int compile_rec(struct xylo_dcmds *cmds, struct xylo_draw *draw)
+{
+	struct xylo_doutline *doutline;
+	struct xylo_dmesh *dmesh;
+	struct xylo_dlist *dlist;
+	struct xylo_draw **p, **q;
+	struct xylo_dcmd *cmd;
+	int i;
+
 	assert(draw != 0);
 	switch (draw->type) {
 	case xylo_doutline:
 		doutline = xylo_doutline_cast(draw);
-		transform_to_modelview(mv, &doutline->transform);
-		gl = gl_get_core33(xylo->api);
-		xylo_shapes_set_object_id(&xylo->shapes, gl, doutline->id);
-		xylo_shapes_set_mvp(&xylo->shapes, gl, m44mulf(mvp, proj, mv));
-		xylo_shapes_set_color4fv(&xylo->shapes, gl, doutline->style.color);
-		draw_outline(xylo, doutline->outline, samples);
+		if (compile_leaf(cmds, xylo_doutline, doutline->id,
+			&doutline->transform, &doutline->style)) {
+			return -1;
+		}
+		cmd = (struct xylo_dcmd *)cmds->cmds.end - 1;
+		cmd->outline = doutline->outline;
 		break;
 
 	case xylo_dmesh:
 		dmesh = xylo_dmesh_cast(draw);
-		transform_to_modelview(mv, &dmesh->transform);
-		gl = gl_get_core33(xylo->api);
-		xylo_shapes_set_object_id(&xylo->shapes, gl, dmesh->id);
-		xylo_shapes_set_mvp(&xylo->shapes, gl, m44mulf(mvp, proj, mv));
-		xylo_shapes_set_color4fv(&xylo->shapes, gl, dmesh->style.color);
-		xylo_mesh_draw(gl, dmesh->mesh, samples);
+		if (compile_leaf(cmds, xylo_dmesh, dmesh->id,
+			&dmesh->transform, &dmesh->style)) {
+			return -1;
+		}
+		cmd = (struct xylo_dcmd *)cmds->cmds.end - 1;
+		cmd->mesh = dmesh->mesh;
 		break;
 
 	case xylo_dlist:
@@ -335,7 +644,7 @@ static void xylo_draw_rec(
 			p = dlist->elements.begin[i];
 			q = dlist->elements.end[i];
 			for (; p < q; p++) {
-				xylo_draw_rec(xylo, samples, proj, *p);
+				if (compile_rec(cmds, *p)) { return -1; }
 			}
 		}
 		break;
@@ -345,6 +654,175 @@ static void xylo_draw_rec(
 		assert("Unreachable" && 0);
 		break;
 	}
+	return 0;
+}
+
+static void rewind_dcmds(struct xylo_dcmds *cmds)
+{
+	wbuf_rewind(&cmds->cmds);
+	wbuf_rewind(&cmds->mv);
+	wbuf_rewind(&cmds->mvp);
+	wbuf_rewind(&cmds->objects);
+	wbuf_rewind(&cmds->bounds);
+	cmds->has_mvp = 0;
+	cmds->has_objects = 0;
+}
+
+void xylo_init_dcmds(struct xylo_dcmds *cmds)
+{
+	wbuf_init(&cmds->cmds);
+	wbuf_init(&cmds->mv);
+	wbuf_init(&cmds->mvp);
+	wbuf_init(&cmds->objects);
+	wbuf_init(&cmds->bounds);
+	(void)m44idf(cmds->proj);
+	cmds->has_mvp = 0;
+	cmds->has_objects = 0;
+}
+
+void xylo_term_dcmds(struct xylo_dcmds *cmds)
+{
+	wbuf_term(&cmds->cmds);
+	wbuf_term(&cmds->mv);
+	wbuf_term(&cmds->mvp);
+	wbuf_term(&cmds->objects);
+	wbuf_term(&cmds->bounds);
+}
+
+/* Allocate space for the projected data of the compiled commands */
+static int finish_dcmds(struct xylo_dcmds *cmds)
+{
+	size_t n;
+
+	n = xylo_dcmds_length(cmds);
+	if (!wbuf_alloc(&cmds->mvp, n * 16 * sizeof(float))) { return -1; }
+	if (!wbuf_alloc(&cmds->bounds, n * 4 * sizeof(float))) { return -1; }
+	return 0;
+}
+
+int xylo_dcmds_compile(struct xylo_dcmds *cmds, struct xylo_draw const *draw)
+{
+	assert(cmds != NULL);
+	assert(draw != NULL);
+
+	rewind_dcmds(cmds);
+	if (compile_rec(cmds, (struct xylo_draw *)draw)) { goto fail; }
+	if (finish_dcmds(cmds)) { goto fail; }
+	return 0;
+
+fail:
+	rewind_dcmds(cmds);
+	return -1;
+}
+
+int xylo_dcmds_compile_leaves(
+	struct xylo_dcmds *cmds,
+	struct xylo_draw const *const *leaves,
+	size_t n)
+{
+	size_t i;
+
+	assert(cmds != NULL);
+	assert(leaves != NULL || n == 0);
+
+	rewind_dcmds(cmds);
+	for (i = 0; i < n; i++) {
+		if (compile_rec(cmds, (struct xylo_draw *)leaves[i])) {
+			goto fail;
+		}
+	}
+	if (finish_dcmds(cmds)) { goto fail; }
+	return 0;
+
+fail:
+	rewind_dcmds(cmds);
+	return -1;
+}
+
+size_t xylo_dcmds_length(struct xylo_dcmds const *cmds)
+{
+	assert(cmds != NULL);
+	return wbuf_nmemb(&cmds->cmds, sizeof(struct xylo_dcmd));
+}
+
+float const *xylo_dcmds_project(struct xylo_dcmds *cmds, float const *proj)
+{
+	assert(cmds != NULL);
+	assert(proj != NULL);
+
+	if (!cmds->has_mvp || memcmp(cmds->proj, proj, sizeof cmds->proj)) {
+		(void)memcpy(cmds->proj, proj, sizeof cmds->proj);
+		(void)m44mulmnf(
+			cmds->mvp.begin,
+			cmds->proj,
+			cmds->mv.begin,
+			xylo_dcmds_length(cmds));
+		cmds->has_mvp = 1;
+		cmds->has_objects = 0;
+	}
+	return cmds->mvp.begin;
+}
+
+/* Transform the bounding box `src` with the matrix `mvp` into the bounding
+   box `dest` in normalized device coordinates. */
+static void project_bounds(float *dest, float const *mvp, float const *src)
+{
+	float x, y, w, px, py;
+	int i;
+
+	dest[0] = dest[1] = HUGE_VALF;
+	dest[2] = dest[3] = -HUGE_VALF;
+	for (i = 0; i < 4; i++) {
+		x = src[(i & 1) ? 2 : 0];
+		y = src[(i & 2) ? 3 : 1];
+		w = mvp[3]*x + mvp[7]*y + mvp[15];
+		if (!(w > 0.f)) {
+			/* behind the viewer - assume it covers everything */
+			dest[0] = dest[1] = -HUGE_VALF;
+			dest[2] = dest[3] = HUGE_VALF;
+			return;
+		}
+		px = (mvp[0]*x + mvp[4]*y + mvp[12]) / w;
+		py = (mvp[1]*x + mvp[5]*y + mvp[13]) / w;
+		if (px < dest[0]) { dest[0] = px; }
+		if (py < dest[1]) { dest[1] = py; }
+		if (px > dest[2]) { dest[2] = px; }
+		if (py > dest[3]) { dest[3] = py; }
+	}
+}
+
+/* like `xylo_dcmds_project()`, but return the per-object shader data and
+   update the screen-space bounds */
+static struct xylo_object const *project_objects(
+	struct xylo_dcmds *cmds,
+	float const *proj)
+{
+	static float const everything[4] = {
+		-HUGE_VALF, -HUGE_VALF, HUGE_VALF, HUGE_VALF
+	};
+
+	struct xylo_object *p, *q;
+	struct xylo_dcmd const *cmd;
+	float const *mvp;
+	float *bounds;
+
+	mvp = xylo_dcmds_project(cmds, proj);
+	if (!cmds->has_objects) {
+		p = cmds->objects.begin;
+		q = cmds->objects.end;
+		cmd = cmds->cmds.begin;
+		bounds = cmds->bounds.begin;
+		for (; p < q; p++, cmd++, mvp += 16, bounds += 4) {
+			(void)memcpy(p->mvp, mvp, sizeof p->mvp);
+			if (cmd->type == xylo_doutline) {
+				project_bounds(bounds, mvp, cmd->outline->bounds);
+			} else {
+				(void)memcpy(bounds, everything, sizeof everything);
+			}
+		}
+		cmds->has_objects = 1;
+	}
+	return cmds->objects.begin;
 }
 
 void xylo_init_dlist(struct xylo_dlist *dlist)
@@ -4,6 +4,7 @@ struct xylo;
 struct xylo_view;
 struct xylo_draw;
 struct xylo_dlist;
+struct xylo_dcmds;
 struct xylo_dshape;
 struct xylo_outline;
 
@@ -12,6 +13,12 @@ void xylo_draw(
 	struct xylo_view const *view,
 	struct xylo_draw const *draw);
 
+/* draw commands compiled by `xylo_dcmds_compile()` */
+void xylo_draw_dcmds(
+	struct xylo *xylo,
+	struct xylo_view const *view,
+	struct xylo_dcmds *cmds);
+
 void xylo_init_dlist(struct xylo_dlist *list);
 
 void xylo_term_dlist(struct xylo_dlist *list);
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <stddef.h>
 #include <stdlib.h>
 
 #include "glapi/core.h"
@@ -129,3 +130,136 @@ unsigned xylo_fb_object_id(
 
 	return value;
 }
+
+/* size of the color, object ID, and depth-stencil buffers in bytes */
+static size_t fb_size(GLsizei width, GLsizei height)
+{
+	if (width <= 0 || height <= 0) { return 0; }
+	return (size_t)width * height * (4 + 2 + 4);
+}
+
+void xylo_init_fb_pool(
+	struct gl_core33 const *restrict gl,
+	struct xylo_fb_pool *pool,
+	size_t limit)
+{
+	size_t i;
+
+	assert(gl != NULL);
+	assert(pool != NULL);
+
+	for (i = 0; i < FB_POOL_SIZE; i++) {
+		xylo_init_fb(gl, pool->fbs + i, 1);
+		pool->aa[i] = 0;
+		pool->used[i] = 0;
+	}
+	pool->clock = 0;
+	pool->limit = limit;
+	pool->last = NULL;
+}
+
+void xylo_term_fb_pool(
+	struct gl_core33 const *restrict gl,
+	struct xylo_fb_pool *pool)
+{
+	size_t i;
+
+	assert(gl != NULL);
+	assert(pool != NULL);
+
+	for (i = 0; i < FB_POOL_SIZE; i++) {
+		xylo_term_fb(gl, pool->fbs + i);
+	}
+}
+
+/* Release the storage of the least recently used target. Return its index,
+   or -1 if no target is in use. */
+static ptrdiff_t release_lru(
+	struct gl_core33 const *restrict gl,
+	struct xylo_fb_pool *pool)
+{
+	ptrdiff_t i, lru;
+
+	lru = -1;
+	for (i = 0; i < FB_POOL_SIZE; i++) {
+		if (!pool->used[i]) { continue; }
+		if (lru < 0 || pool->used[i] < pool->used[lru]) { lru = i; }
+	}
+	if (lru < 0) { return -1; }
+
+	/* new names have no storage */
+	xylo_term_fb(gl, pool->fbs + lru);
+	xylo_init_fb(gl, pool->fbs + lru, 1);
+	if (pool->last == pool->fbs + lru) { pool->last = NULL; }
+	pool->used[lru] = 0;
+	return lru;
+}
+
+struct xylo_fb *xylo_fb_pool_get(
+	struct gl_core33 const *restrict gl,
+	struct xylo_fb_pool *pool,
+	GLsizei width,
+	GLsizei height,
+	int aa)
+{
+	struct xylo_fb *fb;
+	ptrdiff_t i, slot;
+	size_t need;
+
+	assert(gl != NULL);
+	assert(pool != NULL);
+
+	slot = -1;
+	for (i = 0; i < FB_POOL_SIZE; i++) {
+		fb = pool->fbs + i;
+		if (!pool->used[i]) {
+			if (slot < 0) { slot = i; }
+		} else if (pool->aa[i] == aa && fb->width == width &&
+		           fb->height == height) {
+			pool->used[i] = ++pool->clock;
+			return pool->last = fb;
+		}
+	}
+
+	need = fb_size(width, height);
+	while (xylo_fb_pool_size(pool) + need > pool->limit) {
+		i = release_lru(gl, pool);
+		if (i < 0) { break; }
+		if (slot < 0 || i < slot) { slot = i; }
+	}
+	if (slot < 0) { slot = release_lru(gl, pool); }
+
+	fb = pool->fbs + slot;
+	xylo_fb_resize(gl, fb, width, height);
+	pool->aa[slot] = aa;
+	pool->used[slot] = ++pool->clock;
+	return pool->last = fb;
+}
+
+void xylo_fb_pool_set_limit(
+	struct gl_core33 const *restrict gl,
+	struct xylo_fb_pool *pool,
+	size_t limit)
+{
+	assert(gl != NULL);
+	assert(pool != NULL);
+
+	pool->limit = limit;
+	while (xylo_fb_pool_size(pool) > limit) {
+		if (release_lru(gl, pool) < 0) { break; }
+	}
+}
+
+size_t xylo_fb_pool_size(struct xylo_fb_pool const *pool)
+{
+	size_t i, size;
+
+	assert(pool != NULL);
+
+	size = 0;
+	for (i = 0; i < FB_POOL_SIZE; i++) {
+		if (!pool->used[i]) { continue; }
+		size += fb_size(pool->fbs[i].width, pool->fbs[i].height);
+	}
+	return size;
+}
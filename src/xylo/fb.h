@@ -19,3 +19,37 @@ unsigned xylo_fb_object_id(
 	struct xylo_fb *fb,
 	GLsizei x,
 	GLsizei y);
+
+struct xylo_fb_pool;
+
+void xylo_init_fb_pool(
+	struct gl_core33 const *restrict gl,
+	struct xylo_fb_pool *pool,
+	size_t limit);
+
+void xylo_term_fb_pool(
+	struct gl_core33 const *restrict gl,
+	struct xylo_fb_pool *pool);
+
+/* Return a render target of exactly `width` x `height` pixels for the
+   anti-aliasing mode `aa`. A target used before with the same size and mode
+   is returned as is, so that views of different sizes can be drawn in turns
+   without reallocation. Otherwise the least recently used targets are
+   released until the new one fits within the memory limit of the pool, or
+   until it is the only one. */
+struct xylo_fb *xylo_fb_pool_get(
+	struct gl_core33 const *restrict gl,
+	struct xylo_fb_pool *pool,
+	GLsizei width,
+	GLsizei height,
+	int aa);
+
+/* Change the memory limit of `pool`, releasing the least recently used
+   targets until the rest fit */
+void xylo_fb_pool_set_limit(
+	struct gl_core33 const *restrict gl,
+	struct xylo_fb_pool *pool,
+	size_t limit);
+
+/* Return the total size of the targets in `pool`, in bytes */
+size_t xylo_fb_pool_size(struct xylo_fb_pool const *pool);
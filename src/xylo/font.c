@@ -0,0 +1,394 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdalign.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "base/mem.h"
+#include "base/wbuf.h"
+#include "spline/shape.h"
+#include "xylo/text.h"
+
+/* longest line of a font file, including the newline */
+#define MAX_LINE 256
+
+/* a glyph as it is read, and its outlines */
+struct glyph_item
+{
+	struct xylo_glyph glyph;
+	size_t first, n;
+};
+
+/* an outline as it is read, and its segments */
+struct outline_item
+{
+	size_t first, n;
+};
+
+struct font_buffer
+{
+	struct xylo_font font;
+
+	/* whether the font line has been read, and whether segments are read
+	   into the last outline of the last glyph */
+	bool has_font, has_outline;
+	struct wbuf glyphs;   /* struct glyph_item[] */
+	struct wbuf outlines; /* struct outline_item[] */
+	struct wbuf segments; /* struct spline_segment[] */
+	struct wbuf kernings; /* struct xylo_kerning[] */
+};
+
+static size_t glyph_count(struct font_buffer const *buf)
+{
+	return wbuf_nmemb(&buf->glyphs, sizeof(struct glyph_item));
+}
+
+static size_t outline_count(struct font_buffer const *buf)
+{
+	return wbuf_nmemb(&buf->outlines, sizeof(struct outline_item));
+}
+
+static size_t segment_count(struct font_buffer const *buf)
+{
+	return wbuf_nmemb(&buf->segments, sizeof(struct spline_segment));
+}
+
+static size_t kerning_count(struct font_buffer const *buf)
+{
+	return wbuf_nmemb(&buf->kernings, sizeof(struct xylo_kerning));
+}
+
+static bool all_finite(float const *x, size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		if (!isfinite(x[i])) { return false; }
+	}
+	return true;
+}
+
+static int parse_font(struct font_buffer *buf, char const *args)
+{
+	struct xylo_font *font = &buf->font;
+	float x[4];
+	char rest[2];
+
+	if (buf->has_font) { return -1; }
+	if (sscanf(args, "%f %f %f %f %1s", x+0, x+1, x+2, x+3, rest) != 4) {
+		return -1;
+	}
+	if (!all_finite(x, 4) || !(x[0] > 0.f)) { return -1; }
+	font->units_per_em = x[0];
+	font->ascent = x[1];
+	font->descent = x[2];
+	font->line_gap = x[3];
+	buf->has_font = true;
+	return 0;
+}
+
+static int parse_glyph(struct font_buffer *buf, char const *args)
+{
+	struct glyph_item *item;
+	unsigned long code;
+	float advance;
+	char rest[2];
+
+	if (sscanf(args, "%lu %f %1s", &code, &advance, rest) != 2) {
+		return -1;
+	}
+	if (!isfinite(advance)) { return -1; }
+	item = wbuf_alloc(&buf->glyphs, sizeof *item);
+	if (!item) { return -1; }
+	item->glyph.code = code;
+	item->glyph.advance = advance;
+	item->first = outline_count(buf);
+	item->n = 0;
+	buf->has_outline = false;
+	return 0;
+}
+
+static int parse_outline(struct font_buffer *buf, char const *args)
+{
+	struct outline_item *item;
+	struct glyph_item *glyph;
+	char rest[2];
+
+	if (glyph_count(buf) == 0) { return -1; }
+	if (sscanf(args, "%1s", rest) == 1) { return -1; }
+	item = wbuf_alloc(&buf->outlines, sizeof *item);
+	if (!item) { return -1; }
+	item->first = segment_count(buf);
+	item->n = 0;
+	glyph = (struct glyph_item *)buf->glyphs.end - 1;
+	glyph->n++;
+	buf->has_outline = true;
+	return 0;
+}
+
+static int parse_segment(struct font_buffer *buf, char const *line)
+{
+	struct spline_segment *segment;
+	struct outline_item *outline;
+	float x[5];
+	char rest[2];
+
+	if (!buf->has_outline) { return -1; }
+	if (sscanf(line, "%f %f %f %f %f %1s", x+0, x+1, x+2, x+3, x+4, rest)
+	    != 5) {
+		return -1;
+	}
+	if (!all_finite(x, 5)) { return -1; }
+	segment = wbuf_alloc(&buf->segments, sizeof *segment);
+	if (!segment) { return -1; }
+	segment->end[0] = x[0];
+	segment->end[1] = x[1];
+	segment->mid[0] = x[2];
+	segment->mid[1] = x[3];
+	segment->weight = x[4];
+	outline = (struct outline_item *)buf->outlines.end - 1;
+	outline->n++;
+	return 0;
+}
+
+static int parse_kerning(struct font_buffer *buf, char const *args)
+{
+	struct xylo_kerning *kerning;
+	unsigned long left, right;
+	float adjust;
+	char rest[2];
+
+	if (sscanf(args, "%lu %lu %f %1s", &left, &right, &adjust, rest) != 3) {
+		return -1;
+	}
+	if (!isfinite(adjust)) { return -1; }
+	buf->has_outline = false;
+	kerning = wbuf_alloc(&buf->kernings, sizeof *kerning);
+	if (!kerning) { return -1; }
+	kerning->left = left;
+	kerning->right = right;
+	kerning->adjust = adjust;
+	return 0;
+}
+
+static int parse_line(struct font_buffer *buf, char const *line)
+{
+	char word[16];
+	int k;
+
+	if (sscanf(line, " %15s%n", word, &k) != 1 || word[0] == '#') {
+		return 0;
+	}
+	if (!buf->has_font) {
+		return strcmp(word, "font") ? -1 : parse_font(buf, line + k);
+	} else if (!strcmp(word, "glyph")) {
+		return parse_glyph(buf, line + k);
+	} else if (!strcmp(word, "outline")) {
+		return parse_outline(buf, line + k);
+	} else if (!strcmp(word, "kern")) {
+		return parse_kerning(buf, line + k);
+	} else {
+		return parse_segment(buf, line);
+	}
+}
+
+static int glyph_item_cmp(void const *a, void const *b)
+{
+	unsigned long l = ((struct glyph_item const *)a)->glyph.code;
+	unsigned long r = ((struct glyph_item const *)b)->glyph.code;
+	return l < r ? -1 : l > r;
+}
+
+static int kerning_cmp(void const *a, void const *b)
+{
+	struct xylo_kerning const *l = a, *r = b;
+
+	if (l->left != r->left) { return l->left < r->left ? -1 : 1; }
+	return l->right < r->right ? -1 : l->right > r->right;
+}
+
+/* sort and check the parsed items */
+static int check_items(struct font_buffer *buf)
+{
+	struct glyph_item const *glyphs;
+	struct outline_item const *outlines;
+	struct xylo_kerning const *kernings;
+	size_t i, n;
+
+	if (!buf->has_font) { return -1; }
+	outlines = buf->outlines.begin;
+	for (i = 0, n = outline_count(buf); i < n; i++) {
+		if (outlines[i].n == 0) { return -1; }
+	}
+	n = glyph_count(buf);
+	glyphs = buf->glyphs.begin;
+	if (n > 1) {
+		qsort(buf->glyphs.begin, n, sizeof *glyphs, glyph_item_cmp);
+	}
+	for (i = 1; i < n; i++) {
+		if (glyphs[i - 1].glyph.code == glyphs[i].glyph.code) {
+			return -1;
+		}
+	}
+	n = kerning_count(buf);
+	kernings = buf->kernings.begin;
+	if (n > 1) {
+		qsort(buf->kernings.begin, n, sizeof *kernings, kerning_cmp);
+	}
+	for (i = 1; i < n; i++) {
+		if (!kerning_cmp(kernings + i - 1, kernings + i)) { return -1; }
+	}
+	return 0;
+}
+
+/* allocate a single memory block for the font and all its parts */
+static struct xylo_font *alloc_block(struct font_buffer const *buf)
+{
+	struct memblk blk[6];
+	struct xylo_font *font;
+	struct xylo_glyph *glyphs;
+	struct spline_shape *shapes;
+	struct spline_outline *outlines;
+	struct spline_segment *segments;
+	struct xylo_kerning *kernings;
+	struct glyph_item const *glyph;
+	struct outline_item const *outline;
+	size_t i, nglyphs, noutlines, nsegments, nkernings;
+
+	nglyphs = glyph_count(buf);
+	noutlines = outline_count(buf);
+	nsegments = segment_count(buf);
+	nkernings = kerning_count(buf);
+	if (memblk_init(blk + 0, 1, sizeof *font)) { return NULL; }
+	if (memblk_push(blk + 1, nglyphs, sizeof *glyphs, alignof(*glyphs)) ||
+	    memblk_push(blk + 2, nglyphs, sizeof *shapes, alignof(*shapes)) ||
+	    memblk_push(blk + 3, noutlines, sizeof *outlines,
+	                alignof(*outlines)) ||
+	    memblk_push(blk + 4, nsegments, sizeof *segments,
+	                alignof(*segments)) ||
+	    memblk_push(blk + 5, nkernings, sizeof *kernings,
+	                alignof(*kernings))) {
+		return NULL;
+	}
+	if (font = malloc(blk[5].extent), !font) { return NULL; }
+	glyphs = memblk_offset(font, blk[1]);
+	shapes = memblk_offset(font, blk[2]);
+	outlines = memblk_offset(font, blk[3]);
+	segments = memblk_offset(font, blk[4]);
+	kernings = memblk_offset(font, blk[5]);
+
+	*font = buf->font;
+	font->nglyphs = nglyphs;
+	font->nkernings = nkernings;
+	font->glyphs = glyphs;
+	font->shapes = shapes;
+	font->kernings = kernings;
+
+	glyph = buf->glyphs.begin;
+	for (i = 0; i < nglyphs; i++, glyph++) {
+		glyphs[i] = glyph->glyph;
+		shapes[i].n = glyph->n;
+		shapes[i].outlines = outlines + glyph->first;
+	}
+	outline = buf->outlines.begin;
+	for (i = 0; i < noutlines; i++, outline++) {
+		outlines[i].n = outline->n;
+		outlines[i].segments = segments + outline->first;
+	}
+	if (nsegments > 0) {
+		(void)memcpy(segments, buf->segments.begin,
+		             nsegments * sizeof *segments);
+	}
+	if (nkernings > 0) {
+		(void)memcpy(kernings, buf->kernings.begin,
+		             nkernings * sizeof *kernings);
+	}
+	return font;
+}
+
+static int parse_file(struct font_buffer *buf, FILE *fp)
+{
+	char line[MAX_LINE];
+	size_t len;
+
+	while (fgets(line, sizeof line, fp)) {
+		len = strlen(line);
+		if (len + 1 == sizeof line && line[len - 1] != '\n' &&
+		    !feof(fp)) {
+			/* too long */
+			return -1;
+		}
+		if (parse_line(buf, line)) { return -1; }
+	}
+	return ferror(fp) ? -1 : check_items(buf);
+}
+
+struct xylo_font const *xylo_load_font(char const *filename)
+{
+	struct xylo_font const *result;
+	FILE *fp;
+
+	fp = fopen(filename, "r");
+	if (fp) {
+		result = xylo_fload_font(fp);
+		fclose(fp);
+	} else {
+		result = NULL;
+	}
+	return result;
+}
+
+struct xylo_font const *xylo_fload_font(FILE *fp)
+{
+	struct xylo_font const *result;
+	struct font_buffer buf;
+
+	assert(fp != NULL);
+
+	(void)memset(&buf.font, 0, sizeof buf.font);
+	buf.has_font = false;
+	buf.has_outline = false;
+	wbuf_init(&buf.glyphs);
+	wbuf_init(&buf.outlines);
+	wbuf_init(&buf.segments);
+	wbuf_init(&buf.kernings);
+
+	result = parse_file(&buf, fp) ? NULL : alloc_block(&buf);
+
+	wbuf_term(&buf.kernings);
+	wbuf_term(&buf.segments);
+	wbuf_term(&buf.outlines);
+	wbuf_term(&buf.glyphs);
+	return result;
+}
+
+void xylo_free_font(struct xylo_font const *font)
+{
+	free((void *)font);
+}
+
+static int glyph_code_cmp(void const *key, void const *glyph)
+{
+	unsigned long l = *(unsigned long const *)key;
+	unsigned long r = ((struct xylo_glyph const *)glyph)->code;
+	return l < r ? -1 : l > r;
+}
+
+size_t xylo_font_glyph(struct xylo_font const *font, unsigned long code)
+{
+	static unsigned long const missing = 0;
+
+	struct xylo_glyph const *glyph;
+
+	assert(font != NULL);
+
+	glyph = bsearch(&code, font->glyphs, font->nglyphs,
+	                sizeof *glyph, glyph_code_cmp);
+	if (!glyph) {
+		glyph = bsearch(&missing, font->glyphs, font->nglyphs,
+		                sizeof *glyph, glyph_code_cmp);
+	}
+	return glyph ? (size_t)(glyph - font->glyphs) : font->nglyphs;
+}
@@ -4,6 +4,7 @@
 #include <stdalign.h>
 #include <stdbool.h>
 #include <string.h>
+#include <limits.h>
 #include <math.h>
 
 #include "base/mem.h"
@@ -12,16 +13,17 @@
 #include "glapi/core.h"
 #include "spline/triangulate.h"
 #include "spline/shape.h"
+#include "tpool/tpool.h"
+#include "adt/ilist.h"
 #include "xylo/types.h"
 #include "xylo/shape.h"
 
 #include "mesh.h"
+#include "meshcache.h"
 #include "private.h"
 #include "xylo.h"
 #include "types.h"
-
-/* When points are close enough to be considered the same */
-#define MIN_SQUARED_DISTANCE 1e-10
+#include "weld.h"
 
 /* a triangle containing a curve */
 struct curve
@@ -163,24 +165,260 @@ static bool is_inside(
 	return inside;
 }
 
-static float square_distance(float const a[2], float const b[2])
+/* one side of a triangle, as the sorted indices of its vertices */
+struct side
+{
+	unsigned key[2], id;
+};
+
+static int side_cmp(void const *a, void const *b)
+{
+	struct side const *l = a, *r = b;
+	int res;
+
+	res = uintcmp(l->key[0], r->key[0]);
+	return res ? res : uintcmp(l->key[1], r->key[1]);
+}
+
+static void init_side(struct side *side, unsigned a, unsigned b, unsigned id)
 {
-	double dx, dy;
-	dx = a[0] - b[0];
-	dy = a[1] - b[1];
-	return dx*dx + dy*dy;
+	side->key[0] = a < b ? a : b;
+	side->key[1] = a < b ? b : a;
+	side->id = id;
+}
+
+/* the vertices next to each vertex, as a list of `adjacent` vertices where
+   those of vertex `v` start at `first[v]` and end at `first[v + 1]` */
+struct adjacency
+{
+	unsigned *first, *adjacent;
+};
+
+static int make_adjacency(
+	struct adjacency *adj,
+	struct side const *sides,
+	size_t nsides)
+{
+	struct memblk blk[2];
+	size_t i, nv;
+	unsigned v;
+
+	for (nv = i = 0; i < nsides; i++) {
+		if (sides[i].key[1] >= nv) { nv = sides[i].key[1] + 1; }
+	}
+	if (memblk_init(blk+0, nv + 1, sizeof(*adj->first))) { return -1; }
+	if (memblk_push(blk+1, nsides * 2, sizeof(*adj->adjacent),
+			alignof(*adj->adjacent))) {
+		return -1;
+	}
+	if (adj->first = malloc(blk[1].extent + 1), !adj->first) { return -1; }
+	adj->adjacent = memblk_offset(adj->first, blk[1]);
+
+	/* count, then place each side at both of its vertices */
+	(void)memset(adj->first, 0, (nv + 1) * sizeof *adj->first);
+	for (i = 0; i < nsides; i++) {
+		adj->first[sides[i].key[0] + 1]++;
+		adj->first[sides[i].key[1] + 1]++;
+	}
+	for (v = 0; v < nv; v++) { adj->first[v + 1] += adj->first[v]; }
+	for (i = 0; i < nsides; i++) {
+		adj->adjacent[adj->first[sides[i].key[0]]++] = sides[i].key[1];
+		adj->adjacent[adj->first[sides[i].key[1]]++] = sides[i].key[0];
+	}
+	for (v = nv; v > 0; v--) { adj->first[v] = adj->first[v - 1]; }
+	adj->first[0] = 0;
+	return 0;
 }
 
-static float (*insert_vertex(float (*v)[2], size_t *n, float const pt[2]))[2]
+/* Flip the sides along the boundary edge from `a` to `b`, which the
+   triangulation has split at the vertices on it. Each next vertex is the
+   neighbour exactly on the edge, ahead of the current one: the differences
+   and products of float coordinates are exact in double precision. Return
+   non-zero if there is no such chain of sides. */
+static int flip_chain(
+	unsigned char *flip,
+	struct side const *sides,
+	size_t nsides,
+	unsigned const *twin,
+	struct adjacency const *adj,
+	float (*vertices)[2],
+	unsigned a,
+	unsigned b)
 {
-	size_t i, m;
-	for (i = 0, m = *n; i < m; i++) {
-		if (square_distance(v[i], pt) < MIN_SQUARED_DISTANCE) {
-			return v + i;
+	struct side key;
+	struct side const *side;
+	double dx, dy, ex, ey;
+	unsigned c, w, next;
+	size_t i, k;
+
+	dx = (double)vertices[b][0] - vertices[a][0];
+	dy = (double)vertices[b][1] - vertices[a][1];
+	for (c = a, k = 0; c != b; c = next, k++) {
+		if (k == nsides) { return -1; }
+		next = UINT_MAX;
+		for (i = adj->first[c]; i < adj->first[c + 1]; i++) {
+			w = adj->adjacent[i];
+			ex = (double)vertices[w][0] - vertices[c][0];
+			ey = (double)vertices[w][1] - vertices[c][1];
+			if (ex*dy - ey*dx == 0.0 && ex*dx + ey*dy > 0.0) {
+				next = w;
+				break;
+			}
 		}
+		if (next == UINT_MAX) { return -1; }
+		init_side(&key, c, next, 0);
+		side = bsearch(&key, sides, nsides, sizeof *sides, side_cmp);
+		if (!side) { return -1; }
+		flip[side->id] ^= 1;
+		if (twin[side->id] != UINT_MAX) { flip[twin[side->id]] ^= 1; }
 	}
-	++*n;
-	return memcpy(v[i], pt, sizeof *v);
+	return 0;
+}
+
+int xylo_classify_triangles(
+	bool *inside,
+	struct triangle_set const *triangles,
+	unsigned (*edges)[2],
+	size_t nedges,
+	float (*vertices)[2])
+{
+	enum { UNVISITED = 0, OUTSIDE, INSIDE };
+
+	struct memblk blk[6];
+	struct side *sides, *bounds;
+	unsigned *twin, *queue, *head, *tail, t, u, id;
+	unsigned char *flip, *state;
+	struct adjacency adj;
+	size_t i, j, nsides, nmatched;
+	bool chained;
+	float pt[2];
+
+	assert(inside != NULL);
+	assert(triangles != NULL);
+
+	nsides = triangles->n * 3;
+	if (memblk_init(blk+0, nsides, sizeof(*sides))) { return -1; }
+	if (memblk_push(blk+1, nedges, sizeof(*bounds), alignof(*bounds))) {
+		return -1;
+	}
+	if (memblk_push(blk+2, nsides, sizeof(*twin), alignof(*twin))) {
+		return -1;
+	}
+	if (memblk_push(blk+3, triangles->n, sizeof(*queue), alignof(*queue))) {
+		return -1;
+	}
+	if (memblk_push(blk+4, nsides, sizeof(*flip), alignof(*flip))) {
+		return -1;
+	}
+	if (memblk_push(blk+5, triangles->n, sizeof(*state),
+			alignof(*state))) {
+		return -1;
+	}
+	if (sides = malloc(blk[5].extent + 1), !sides) { return -1; }
+	bounds = memblk_offset(sides, blk[1]);
+	twin = memblk_offset(sides, blk[2]);
+	queue = memblk_offset(sides, blk[3]);
+	flip = memblk_offset(sides, blk[4]);
+	state = memblk_offset(sides, blk[5]);
+
+	/* pair up the sides shared by two triangles */
+	for (i = 0; i < triangles->n; i++) {
+		for (j = 0; j < 3; j++) {
+			init_side(sides + i*3 + j,
+				triangles->indices[i][j],
+				triangles->indices[i][(j + 1) % 3],
+				i*3 + j);
+		}
+	}
+	qsort(sides, nsides, sizeof *sides, side_cmp);
+	for (i = 0; i < nsides; i++) { twin[i] = UINT_MAX; }
+	for (i = 0; i + 1 < nsides; i++) {
+		if (side_cmp(sides + i, sides + i + 1) == 0) {
+			twin[sides[i].id] = sides[i + 1].id;
+			twin[sides[i + 1].id] = sides[i].id;
+			i++;
+		}
+	}
+
+	/* crossing a side flips the parity as many times as there are
+	   boundary edges along it */
+	for (i = 0; i < nedges; i++) {
+		init_side(bounds + i, edges[i][0], edges[i][1], 0);
+	}
+	qsort(bounds, nedges, sizeof *bounds, side_cmp);
+	for (i = j = nmatched = 0; i < nsides; i++) {
+		while (j < nedges && side_cmp(bounds + j, sides + i) < 0) { j++; }
+		flip[sides[i].id] = 0;
+		while (j < nedges && side_cmp(bounds + j, sides + i) == 0) {
+			flip[sides[i].id] ^= 1;
+			bounds[j].id = 1;
+			nmatched++;
+			j++;
+		}
+		/* the twin side has the same key */
+		if (i + 1 < nsides && side_cmp(sides + i, sides + i + 1) == 0) {
+			flip[sides[i + 1].id] = flip[sides[i].id];
+			i++;
+		}
+	}
+
+	/* a boundary edge through other vertices is split into a chain of
+	   sides, each of which flips the parity */
+	chained = true;
+	if (nmatched < nedges) {
+		adj.first = NULL;
+		chained = !make_adjacency(&adj, sides, nsides);
+		for (i = 0; chained && i < nedges; i++) {
+			if (bounds[i].id) { continue; }
+			chained = !flip_chain(flip, sides, nsides, twin, &adj,
+				vertices, bounds[i].key[0], bounds[i].key[1]);
+		}
+		free(adj.first);
+	}
+
+	/* flood fill from the triangles along the convex hull, where the
+	   outside of the triangulation is outside of the shape */
+	(void)memset(state, UNVISITED, triangles->n);
+	if (!chained) {
+		/* the sides do not match the boundary - leave every triangle
+		   unvisited and cast rays instead */
+		nsides = 0;
+	}
+	head = tail = queue;
+	for (id = 0; id < nsides; id++) {
+		t = id / 3;
+		if (twin[id] == UINT_MAX && state[t] == UNVISITED) {
+			state[t] = flip[id] ? INSIDE : OUTSIDE;
+			*tail++ = t;
+		}
+	}
+	while (head != tail) {
+		t = *head++;
+		for (j = 0; j < 3; j++) {
+			id = t*3 + j;
+			if (twin[id] == UINT_MAX) { continue; }
+			u = twin[id] / 3;
+			if (state[u] != UNVISITED) { continue; }
+			state[u] = (state[t] == INSIDE) != flip[id]
+				? INSIDE
+				: OUTSIDE;
+			*tail++ = u;
+		}
+	}
+
+	/* triangles cut off from the rest, which should not happen, unless
+	   the sides do not match the boundary */
+	for (i = 0; i < triangles->n; i++) {
+		if (state[i] != UNVISITED) {
+			inside[i] = state[i] == INSIDE;
+		} else {
+			barycenter(pt, triangles->indices[i], vertices);
+			inside[i] = is_inside(edges, nedges, vertices, pt);
+		}
+	}
+
+	free(sides);
+	return 0;
 }
 
 static void insert_edge(unsigned edge[2], unsigned a, unsigned b)
@@ -249,9 +487,28 @@ static size_t vertex_size(size_t n)
 	return n * sizeof(float) * VERTEX_FLOATS;
 }
 
+/* whether the `n` vertices `v` span no area */
+static bool is_flat(float const (*v)[2], size_t n)
+{
+	size_t i;
+	float a[2], b[2];
+
+	for (i = 2; i < n; i++) {
+		a[0] = v[1][0] - v[0][0];
+		a[1] = v[1][1] - v[0][1];
+		b[0] = v[i][0] - v[0][0];
+		b[1] = v[i][1] - v[0][1];
+		if (a[0] * b[1] - a[1] * b[0] != 0.f) { return false; }
+	}
+	return true;
+}
+
+/* Write the triangles of `shape` to `buf`, and return how many there are or
+   -1 on failure */
 static int push_triangulated_shape(
 	struct wbuf *buf,
-	struct spline_shape const *shape)
+	struct spline_shape const *shape,
+	struct triangle_workspace *workspace)
 {
 	typedef float float2[2];
 	typedef unsigned edge[2];
@@ -259,13 +516,14 @@ static int push_triangulated_shape(
 	struct memblk blk[3];
 	struct spline_outline const *outline;
 	size_t i, j, k, nseg, nv, ne, nc;
-	float2 *v, *p0, *p1, *p2, pt;
+	float2 *v, *p0, *p1, *p2;
 	edge *e, *ebound, *ecurve;
-	bool inside;
+	bool *inside;
 	unsigned key[3], (*tri)[3];
 	struct curve *curve, *c;
 	int nwritten;
 	struct triangle_set *triangles;
+	struct xylo_weld weld;
 	float weight;
 
 	/* count number of segments */
@@ -276,17 +534,20 @@ static int push_triangulated_shape(
 	}
 
 	/* Allocate temporary storage */
-	if (memblk_init(blk+0, nseg * 2, sizeof(*v))) return 0;
-	if (memblk_push(blk+1, nseg * 3, sizeof(*e), alignof(*e))) return 0;
-	if (memblk_push(blk+2, nseg, sizeof(*c), alignof(*c))) return 0;
+	if (memblk_init(blk+0, nseg * 2, sizeof(*v))) return -1;
+	if (memblk_push(blk+1, nseg * 3, sizeof(*e), alignof(*e))) return -1;
+	if (memblk_push(blk+2, nseg, sizeof(*c), alignof(*c))) return -1;
 
-	if (v = malloc(blk[2].extent), !v) { return 0; }
+	if (v = malloc(blk[2].extent + 1), !v) { return -1; }
 	e = memblk_offset(v, blk[1]);
 	c = memblk_offset(v, blk[2]);
+	if (xylo_init_weld(&weld, v, nseg * 2)) {
+		free(v);
+		return -1;
+	}
 
 	nc = 0;
 	ne = nseg * 3;
-	nv = 0;
 
 	ebound = e + nseg;
 	ecurve = e + nseg;
@@ -297,12 +558,18 @@ static int push_triangulated_shape(
 		for (j = 0; j < outline->n; j++) {
 			k = (j + 1) % outline->n;
 
-			p0 = insert_vertex(v, &nv, outline->segments[j].end);
-			p2 = insert_vertex(v, &nv, outline->segments[k].end);
+			p0 = v + xylo_weld_insert(
+				&weld,
+				outline->segments[j].end);
+			p2 = v + xylo_weld_insert(
+				&weld,
+				outline->segments[k].end);
 
 			if (p0 != p2) {
 				insert_edge(*--ebound, p0 - v, p2 - v);
-				p1 = insert_vertex(v, &nv, outline->segments[j].mid);
+				p1 = v + xylo_weld_insert(
+					&weld,
+					outline->segments[j].mid);
 				if (p1 != p0 && p1 != p2) {
 					insert_edge(*ecurve++, p0 - v, p1 - v);
 					insert_edge(*ecurve++, p1 - v, p2 - v);
@@ -319,29 +586,43 @@ static int push_triangulated_shape(
 		}
 	}
 
-	/* triangulate shape */
-	nwritten = 0;
+	nv = weld.n;
+	xylo_term_weld(&weld);
+
+	/* triangulate shape, where there are no triangles without at least
+	   three vertices which are not all on a line */
+	nwritten = -1;
+	inside = NULL;
 	ne = ecurve - ebound;
-	triangles = triangle_set_triangulate(
+	triangles = triangle_workspace_triangulate(
+		workspace,
 		(float const (*)[2])v, nv,
 		(unsigned const (*)[2])ebound, ne);
-	if (!triangles) { goto ret; }
+	if (!triangles) {
+		if (is_flat((float const (*)[2])v, nv)) { nwritten = 0; }
+		goto ret;
+	}
 	if (wbuf_reserve(buf, vertex_size(triangles->n * 3))) { goto ret; }
 
 	/* check which triangles are inside/outside */
+	inside = malloc(triangles->n * sizeof *inside + 1);
+	if (!inside) { goto ret; }
+	if (xylo_classify_triangles(inside, triangles, ebound,
+	                            (e + nseg) - ebound, v)) {
+		goto ret;
+	}
+	nwritten = 0;
 	qsort(c, nc, sizeof *c, curve_cmp);
 	for (i = 0; i < triangles->n; i++) {
 		tri = triangles->indices + i;
-		barycenter(pt, *tri, v);
-		inside = is_inside(ebound, nseg, v, pt);
 		init_curve_key(key, *tri);
 		curve = bsearch(key, c, nc, sizeof *c, curve_key_cmp);
 		if (curve) {
 			tri = &curve->indices;
 			weight = curve->weight;
-			write_triangle(buf, *tri, weight, curve && inside, v);
+			write_triangle(buf, *tri, weight, curve && inside[i], v);
 			nwritten++;
-		} else if (inside) {
+		} else if (inside[i]) {
 			write_fill(buf, *tri, v);
 			nwritten++;
 		} else {
@@ -349,7 +630,7 @@ static int push_triangulated_shape(
 		}
 	}
 
-ret:	free(triangles);
+ret:	free(inside);
 	free(v);
 	return nwritten;
 }
@@ -372,10 +653,150 @@ static struct xylo_mesh_set *make_block(size_t n)
 	return set;
 }
 
+/* Shapes are triangulated in a few chunks per thread, where each chunk reuses
+   one triangulation workspace for its shapes */
+#define CHUNKS_PER_THREAD 4
+
+/* per-shape output of the CPU phase, written by one iteration each */
+struct triangulate_job
+{
+	struct spline_shape const *shapes;
+	struct wbuf *bufs;
+	int *triangles;
+	size_t n, nchunks;
+};
+
+static void triangulate_chunk(void *arg, size_t k)
+{
+	struct triangulate_job const *job = arg;
+	struct triangle_workspace *workspace;
+	struct spline_shape *simple;
+	size_t i, end;
+
+	workspace = triangle_workspace_make();
+	end = job->n * (k + 1) / job->nchunks;
+	for (i = job->n * k / job->nchunks; i < end; i++) {
+		simple = workspace ? spline_simplify_shape(job->shapes + i) : NULL;
+		if (!simple) {
+			job->triangles[i] = -1;
+			continue;
+		}
+		job->triangles[i] = push_triangulated_shape(
+			job->bufs + i,
+			simple,
+			workspace);
+		spline_free_shape(simple);
+	}
+	triangle_workspace_free(workspace);
+}
+
+int xylo_triangulate_shapes(
+	struct tpool *pool,
+	size_t n,
+	struct spline_shape const *shapes,
+	struct wbuf *dest,
+	size_t *counts)
+{
+	struct memblk blk[2];
+	struct triangulate_job job;
+	size_t i, sz;
+	int result;
+
+	assert(dest != NULL);
+	assert(counts != NULL);
+
+	if (n == 0) { return 0; }
+	if (memblk_init(blk+0, n, sizeof(*job.bufs))) { return -1; }
+	if (memblk_push(blk+1, n, sizeof(*job.triangles),
+			alignof(*job.triangles))) {
+		return -1;
+	}
+	if (job.bufs = malloc(blk[1].extent), !job.bufs) { return -1; }
+	job.triangles = memblk_offset(job.bufs, blk[1]);
+	job.shapes = shapes;
+	job.n = n;
+	job.nchunks = tpool_size(pool) * CHUNKS_PER_THREAD;
+	if (job.nchunks > n) { job.nchunks = n; }
+	for (i = 0; i < n; i++) { wbuf_init(job.bufs + i); }
+
+	tpool_run(pool, job.nchunks, triangulate_chunk, &job);
+
+	/* concatenate in shape order, so that the result does not depend on
+	   how the shapes were distributed over threads */
+	result = 0;
+	for (sz = i = 0; i < n; i++) {
+		if (job.triangles[i] < 0) { result = -1; }
+		sz += wbuf_size(job.bufs + i);
+	}
+	if (!result) { result = wbuf_reserve(dest, sz); }
+	for (i = 0; i < n; i++) {
+		if (!result) {
+			(void)wbuf_concat(dest, job.bufs + i);
+			counts[i] = (size_t)job.triangles[i] * 3;
+		}
+		wbuf_term(job.bufs + i);
+	}
+	free(job.bufs);
+	return result;
+}
+
 struct xylo_mesh_set *xylo_make_mesh_set(
 	struct gl_api *api,
 	size_t n,
 	struct spline_shape const *shapes)
+{
+	return xylo_make_mesh_set_parallel(api, n, shapes, NULL);
+}
+
+struct xylo_mesh_set *xylo_make_mesh_set_parallel(
+	struct gl_api *api,
+	size_t n,
+	struct spline_shape const *shapes,
+	struct tpool *pool)
+{
+	return xylo_make_mesh_set_cached(api, n, shapes, pool, NULL);
+}
+
+struct xylo_mesh_set *xylo_make_mesh_set_cached(
+	struct gl_api *api,
+	size_t n,
+	struct spline_shape const *shapes,
+	struct tpool *pool,
+	struct xylo_mesh_cache *cache)
+{
+	struct xylo_mesh_set *set;
+	size_t i, *counts;
+	float *bounds;
+	struct memblk blk[2];
+	struct wbuf buf;
+
+	/* CPU phase */
+	if (memblk_init(blk+0, n, 4 * sizeof(*bounds))) { return NULL; }
+	if (memblk_push(blk+1, n, sizeof(*counts), alignof(*counts))) {
+		return NULL;
+	}
+	if (bounds = malloc(blk[1].extent + 1), !bounds) { return NULL; }
+	counts = memblk_offset(bounds, blk[1]);
+	wbuf_init(&buf);
+	if (xylo_triangulate_cached(cache, pool, n, shapes, &buf, counts)) {
+		set = NULL;
+	} else {
+		for (i = 0; i < n; i++) {
+			spline_shape_bounds(bounds + 4*i, shapes + i);
+		}
+		set = xylo_upload_mesh_set(api, n, buf.begin, counts, bounds);
+	}
+	wbuf_term(&buf);
+	free(bounds);
+	return set;
+}
+
+struct xylo_mesh_set *xylo_upload_mesh_set(
+	struct gl_api *api,
+	size_t n,
+	float const *vertices,
+	size_t const *counts,
+	float const *bounds)
 {
 	static struct {
 		GLuint location;
@@ -387,48 +808,30 @@ struct xylo_mesh_set *xylo_make_mesh_set(
 	};
 
 	struct gl_core33 const *restrict gl;
-	size_t i, acc, sz;
 	struct xylo_mesh_set *set;
+	size_t i, acc;
 	GLsizei stride;
-	struct wbuf buf;
-	int m;
-	struct spline_shape *simple;
 
 	set = make_block(n);
 	if (!set) { return NULL; }
-	gl = gl_get_core33(api);
-	gl->GenBuffers(1, &set->vbo);
-	gl->GenVertexArrays(1, &set->vao);
-	wbuf_init(&buf);
-
 	acc = 0;
 	for (i = 0; i < n; i++) {
-		simple = spline_simplify_shape(shapes + i);
-		if (!simple) {
-			xylo_free_mesh_set(set, api);
-			wbuf_term(&buf);
-			return NULL;
-		}
-		m = push_triangulated_shape(&buf, simple);
-		spline_free_shape(simple);
-		if (m < 0) { 
-			xylo_free_mesh_set(set, api);
-			wbuf_term(&buf);
-			return NULL;
-		}
-		m *= 3;
 		set->shapes[i].first = acc;
-		set->shapes[i].count = m;
-		set->shapes[i].vao = set->vao;
-		acc += m;
+		set->shapes[i].count = counts[i];
+		(void)memcpy(set->shapes[i].bounds, bounds + 4*i,
+		             sizeof set->shapes[i].bounds);
+		acc += counts[i];
 	}
 
 	/* copy buffer to GPU */
-	sz = wbuf_size(&buf);
+	gl = gl_get_core33(api);
+	gl->GenBuffers(1, &set->vbo);
+	gl->GenVertexArrays(1, &set->vao);
+	for (i = 0; i < n; i++) { set->shapes[i].vao = set->vao; }
 	gl->BindVertexArray(set->vao);
 	gl->BindBuffer(GL_ARRAY_BUFFER, set->vbo);
-	gl->BufferData(GL_ARRAY_BUFFER, sz, buf.begin, GL_STATIC_DRAW);
-	wbuf_term(&buf);
+	gl->BufferData(GL_ARRAY_BUFFER, vertex_size(acc), vertices,
+	               GL_STATIC_DRAW);
 
 	stride = sizeof(float) * VERTEX_FLOATS;
 	for (i = 0; i < length_of(attribs); i++) {
@@ -467,6 +870,15 @@ void xylo_mesh_draw(
        struct gl_core33 const *restrict gl,
        struct xylo_mesh const *mesh,
        GLsizei samples)
+{
+	xylo_mesh_draw_instances(gl, mesh, samples, 1);
+}
+
+void xylo_mesh_draw_instances(
+       struct gl_core33 const *restrict gl,
+       struct xylo_mesh const *mesh,
+       GLsizei samples,
+       GLsizei n)
 {
 	int stencil_test;
 	assert(xylo_get_uint(gl, GL_VERTEX_ARRAY_BINDING) == mesh->vao);
@@ -476,6 +888,6 @@ void xylo_mesh_draw(
 		GL_TRIANGLES,
 		mesh->first,
 		mesh->count,
-		samples);
+		samples * n);
 	if (stencil_test) { gl->Enable(GL_STENCIL_TEST); }
 }
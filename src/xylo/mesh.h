@@ -4,13 +4,52 @@ struct gl_api;
 struct gl_core33;
 struct xylo_mesh_set;
 struct xylo_mesh;
+struct xylo_mesh_cache;
 struct spline_shape;
+struct tpool;
+struct wbuf;
+struct triangle_set;
 
 struct xylo_mesh_set *xylo_make_mesh_set(
 	struct gl_api *api,
 	size_t n,
 	struct spline_shape const *shapes);
 
+struct xylo_mesh_set *xylo_make_mesh_set_parallel(
+	struct gl_api *api,
+	size_t n,
+	struct spline_shape const *shapes,
+	struct tpool *pool);
+
+struct xylo_mesh_set *xylo_make_mesh_set_cached(
+	struct gl_api *api,
+	size_t n,
+	struct spline_shape const *shapes,
+	struct tpool *pool,
+	struct xylo_mesh_cache *cache);
+
+/* Create a mesh set of `n` meshes from consecutive `vertices`, where mesh
+   `i` is the next `counts[i]` vertices, of `VERTEX_FLOATS` floats each, and
+   has the bounding box `bounds[4*i]` ... `bounds[4*i + 3]`. Return NULL on
+   failure. */
+struct xylo_mesh_set *xylo_upload_mesh_set(
+	struct gl_api *api,
+	size_t n,
+	float const *vertices,
+	size_t const *counts,
+	float const *bounds);
+
+/* Append the triangle vertices of each shape to `dest`, in shape order, and
+   store the number of vertices of shape `i` in `counts[i]`. Shapes are
+   triangulated in parallel on `pool`, or serially if it is NULL. Return
+   non-zero on failure. */
+int xylo_triangulate_shapes(
+	struct tpool *pool,
+	size_t n,
+	struct spline_shape const *shapes,
+	struct wbuf *dest,
+	size_t *counts);
+
 void xylo_free_mesh_set(struct xylo_mesh_set *set, struct gl_api *api);
 
 struct xylo_mesh const *xylo_get_mesh(
@@ -21,3 +60,25 @@ void xylo_mesh_draw(
        struct gl_core33 const *restrict gl,
        struct xylo_mesh const *shape,
        GLsizei samples);
+
+/* draw `n` consecutive objects with the same mesh, starting with the currently
+   selected object index */
+void xylo_mesh_draw_instances(
+       struct gl_core33 const *restrict gl,
+       struct xylo_mesh const *shape,
+       GLsizei samples,
+       GLsizei n);
+
+/* Set `inside[i]` to whether triangle `i` is inside the `nedges` boundary
+   `edges` by the even-odd rule. The triangulation is flood filled from its
+   convex hull, flipping between inside and outside at boundary edges. An
+   edge which passes through other vertices, and is split into a chain of
+   collinear sides, flips at each of them. Only if some edge matches no
+   sides at all are rays cast from each triangle instead. Return non-zero on
+   allocation failure. */
+int xylo_classify_triangles(
+	_Bool *inside,
+	struct triangle_set const *triangles,
+	unsigned (*edges)[2],
+	size_t nedges,
+	float (*vertices)[2]);
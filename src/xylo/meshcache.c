@@ -0,0 +1,523 @@
+#include <assert.h>
+#include <stdalign.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "base/mem.h"
+#include "base/wbuf.h"
+#include "adt/ilist.h"
+#include "rescache/rescache.h"
+#include "glapi/core.h"
+#include "spline/shape.h"
+#include "xylo/shape.h"
+
+#include "private.h"
+#include "mesh.h"
+#include "meshcache.h"
+
+/* Changes whenever the triangulation or the vertex layout does, so that
+   files and hashes of older meshes are not used */
+#define MESH_VERSION 1
+
+/* Meshes are saved as a header, an index of entries sorted by key, and the
+   vertices which the entries refer to, in native byte order. A saved file is
+   mapped into memory and its vertices are used as they are. */
+struct blob_header
+{
+	char magic[8];
+	uint32_t version, vertex_floats;
+	uint64_t n;
+};
+
+struct xylo_mesh_blob_entry
+{
+	uint64_t key[2];
+
+	/* from the start of the file, and in vertices */
+	uint64_t offset, count;
+};
+
+static char const blob_magic[8] = "xylomesh";
+
+struct mesh_key
+{
+	uint64_t h[2];
+};
+
+struct xylo_cached_mesh
+{
+	struct ilist list;
+	struct mesh_key key;
+	float const *vertices;
+	size_t count;
+	bool owned;
+};
+
+static struct xylo_cached_mesh *mesh_of(struct ilist *p)
+{
+	return container_of(p, struct xylo_cached_mesh, list);
+}
+
+static uint64_t rotl(uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+/* the finalizer of MurmurHash3 */
+static uint64_t fmix(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdu;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53u;
+	h ^= h >> 33;
+	return h;
+}
+
+static void hash_word(struct mesh_key *key, uint32_t w)
+{
+	key->h[0] = (key->h[0] ^ w) * 0x100000001b3u;
+	key->h[1] = rotl(key->h[1] ^ (w * 0x9e3779b97f4a7c15u), 31);
+	key->h[1] *= 0x87c37b91114253d5u;
+}
+
+static void hash_float(struct mesh_key *key, float x)
+{
+	uint32_t w;
+
+	/* both zeros are the same point */
+	if (x == 0.f) { x = 0.f; }
+	(void)memcpy(&w, &x, sizeof w);
+	hash_word(key, w);
+}
+
+static void hash_size(struct mesh_key *key, size_t n)
+{
+	hash_word(key, (uint32_t)n);
+	hash_word(key, (uint32_t)((uint64_t)n >> 32));
+}
+
+/* 128-bit hash of the outlines and segments of `shape`, which is the key of
+   its mesh */
+static void hash_shape(struct mesh_key *key, struct spline_shape const *shape)
+{
+	struct spline_outline const *outline;
+	struct spline_segment const *s;
+	size_t i, j;
+
+	key->h[0] = 0xcbf29ce484222325u;
+	key->h[1] = 0x6a09e667f3bcc908u;
+	hash_word(key, MESH_VERSION);
+	hash_size(key, shape->n);
+	for (i = 0; i < shape->n; i++) {
+		outline = shape->outlines + i;
+		hash_size(key, outline->n);
+		for (j = 0; j < outline->n; j++) {
+			s = outline->segments + j;
+			hash_float(key, s->end[0]);
+			hash_float(key, s->end[1]);
+			hash_float(key, s->mid[0]);
+			hash_float(key, s->mid[1]);
+			hash_float(key, s->weight);
+		}
+	}
+	key->h[0] = fmix(key->h[0] ^ key->h[1]);
+	key->h[1] = fmix(key->h[1] + key->h[0]);
+}
+
+static int key_cmp(uint64_t const a[2], uint64_t const b[2])
+{
+	if (a[0] != b[0]) { return a[0] < b[0] ? -1 : 1; }
+	if (a[1] != b[1]) { return a[1] < b[1] ? -1 : 1; }
+	return 0;
+}
+
+static int entry_key_cmp(void const *key, void const *entry)
+{
+	struct xylo_mesh_blob_entry const *e = entry;
+	return key_cmp(key, e->key);
+}
+
+static size_t vertex_bytes(size_t n)
+{
+	return n * sizeof(float) * VERTEX_FLOATS;
+}
+
+/* constructor of meshes which are in the mapped file */
+static int load_mapped(void const *key, size_t size, void *data, void *link)
+{
+	struct xylo_mesh_cache *cache = link;
+	struct xylo_cached_mesh *mesh = data;
+	struct xylo_mesh_blob_entry const *e;
+
+	assert(size == sizeof mesh->key);
+
+	if (!cache->index) { return -1; }
+	e = bsearch(key, cache->index, cache->nindex, sizeof *e, entry_key_cmp);
+	if (!e) { return -1; }
+	(void)memcpy(&mesh->key, key, sizeof mesh->key);
+	mesh->vertices = (float const *)((char const *)cache->map + e->offset);
+	mesh->count = e->count;
+	mesh->owned = false;
+	clist_insert_prev(&cache->entries, &mesh->list);
+	return 0;
+}
+
+/* constructor of meshes which have just been triangulated */
+static int load_pending(void const *key, size_t size, void *data, void *link)
+{
+	struct xylo_mesh_cache *cache = link;
+	struct xylo_cached_mesh *mesh = data;
+	struct xylo_cached_mesh const *pending = cache->pending;
+	float *vertices;
+
+	assert(size == sizeof mesh->key);
+
+	if (!pending || memcmp(key, &pending->key, size)) { return -1; }
+	vertices = malloc(vertex_bytes(pending->count) + 1);
+	if (!vertices) { return -1; }
+	if (pending->count > 0) {
+		(void)memcpy(vertices, pending->vertices,
+		             vertex_bytes(pending->count));
+	}
+	(void)memcpy(&mesh->key, key, sizeof mesh->key);
+	mesh->vertices = vertices;
+	mesh->count = pending->count;
+	mesh->owned = true;
+	clist_insert_prev(&cache->entries, &mesh->list);
+	return 0;
+}
+
+static void unload_mesh(void const *key, size_t size, void *data, void *link)
+{
+	struct xylo_cached_mesh *mesh = data;
+
+	(void)key;
+	(void)size;
+	(void)link;
+
+	clist_remove(&mesh->list);
+	if (mesh->owned) { free((void *)mesh->vertices); }
+}
+
+/* check that the mapped file is a valid index with vertices in bounds */
+static bool map_index(struct xylo_mesh_cache *cache)
+{
+	struct blob_header const *header = cache->map;
+	struct xylo_mesh_blob_entry const *e;
+	size_t i, size, start;
+
+	size = cache->map_size;
+	if (size < sizeof *header) { return false; }
+	if (memcmp(header->magic, blob_magic, sizeof blob_magic) ||
+	    header->version != MESH_VERSION ||
+	    header->vertex_floats != VERTEX_FLOATS ||
+	    header->n > (size - sizeof *header) / sizeof *e) {
+		return false;
+	}
+	e = (struct xylo_mesh_blob_entry const *)(header + 1);
+	start = sizeof *header + header->n * sizeof *e;
+	for (i = 0; i < header->n; i++) {
+		if (e[i].offset < start || e[i].offset > size ||
+		    e[i].offset % alignof(float) ||
+		    e[i].count > (size - e[i].offset) / vertex_bytes(1)) {
+			return false;
+		}
+		if (i > 0 && key_cmp(e[i - 1].key, e[i].key) >= 0) {
+			return false;
+		}
+	}
+	cache->index = e;
+	cache->nindex = header->n;
+	return true;
+}
+
+struct xylo_mesh_cache *xylo_make_mesh_cache(char const *path)
+{
+	static int (*const loaders[])(void const *, size_t, void *, void *) = {
+		load_mapped,
+		load_pending
+	};
+
+	struct xylo_mesh_cache *cache;
+
+	cache = malloc(sizeof *cache);
+	if (!cache) { return NULL; }
+	cache->meshes = make_rescachen(
+		sizeof(struct xylo_cached_mesh),
+		alignof(struct xylo_cached_mesh),
+		alignof(struct mesh_key),
+		loaders,
+		length_of(loaders),
+		unload_mesh,
+		cache);
+	if (!cache->meshes) {
+		free(cache);
+		return NULL;
+	}
+	clist_init(&cache->entries);
+	cache->map = NULL;
+	cache->map_size = 0;
+	cache->index = NULL;
+	cache->nindex = 0;
+	cache->pending = NULL;
+	cache->hits = 0;
+	cache->misses = 0;
+
+	/* a missing or stale file is the same as an empty one */
+	if (path) { cache->map = xylo_map_file(path, &cache->map_size); }
+	if (cache->map && !map_index(cache)) {
+		xylo_unmap_file(cache->map, cache->map_size);
+		cache->map = NULL;
+	}
+	return cache;
+}
+
+void xylo_free_mesh_cache(struct xylo_mesh_cache *cache)
+{
+	if (!cache) { return; }
+	if (free_rescache(cache->meshes)) {
+		assert(!"Meshes are still in use");
+	}
+	if (cache->map) { xylo_unmap_file(cache->map, cache->map_size); }
+	free(cache);
+}
+
+/* mesh to save, and where its vertices are now */
+struct save_item
+{
+	uint64_t key[2];
+	float const *vertices;
+	size_t count;
+};
+
+static int push_item(
+	struct wbuf *items,
+	uint64_t const key[2],
+	float const *vertices,
+	size_t count)
+{
+	struct save_item *item;
+
+	item = wbuf_alloc(items, sizeof *item);
+	if (!item) { return -1; }
+	(void)memcpy(item->key, key, sizeof item->key);
+	item->vertices = vertices;
+	item->count = count;
+	return 0;
+}
+
+/* every loaded mesh and those of the mapped file which are not loaded */
+static int push_items(struct wbuf *items, struct xylo_mesh_cache *cache)
+{
+	struct xylo_mesh_blob_entry const *e;
+	struct xylo_cached_mesh *mesh;
+	struct ilist *p;
+	size_t i;
+	bool loaded;
+
+	for (p = cache->entries.next; p != &cache->entries; p = p->next) {
+		mesh = mesh_of(p);
+		if (push_item(items, mesh->key.h, mesh->vertices, mesh->count)) {
+			return -1;
+		}
+	}
+	for (i = 0; i < cache->nindex; i++) {
+		e = cache->index + i;
+		loaded = false;
+		for (p = cache->entries.next; p != &cache->entries; p = p->next) {
+			if (!key_cmp(mesh_of(p)->key.h, e->key)) {
+				loaded = true;
+				break;
+			}
+		}
+		if (!loaded && push_item(items, e->key,
+		    (float const *)((char const *)cache->map + e->offset),
+		    e->count)) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int item_cmp(void const *a, void const *b)
+{
+	struct save_item const *l = a, *r = b;
+	return key_cmp(l->key, r->key);
+}
+
+static int write_blob(FILE *fp, struct save_item const *items, size_t n)
+{
+	struct blob_header header;
+	struct xylo_mesh_blob_entry e;
+	uint64_t offset;
+	size_t i;
+
+	(void)memcpy(header.magic, blob_magic, sizeof header.magic);
+	header.version = MESH_VERSION;
+	header.vertex_floats = VERTEX_FLOATS;
+	header.n = n;
+	if (fwrite(&header, sizeof header, 1, fp) != 1) { return -1; }
+
+	offset = sizeof header + n * sizeof e;
+	for (i = 0; i < n; i++) {
+		(void)memcpy(e.key, items[i].key, sizeof e.key);
+		e.offset = offset;
+		e.count = items[i].count;
+		if (fwrite(&e, sizeof e, 1, fp) != 1) { return -1; }
+		offset += vertex_bytes(items[i].count);
+	}
+	for (i = 0; i < n; i++) {
+		if (items[i].count > 0 &&
+		    fwrite(items[i].vertices, vertex_bytes(items[i].count), 1,
+		           fp) != 1) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+int xylo_save_mesh_cache(struct xylo_mesh_cache *cache, char const *path)
+{
+	struct wbuf items, tmpname;
+	size_t n;
+	FILE *fp;
+	int result;
+
+	assert(cache != NULL);
+	assert(path != NULL);
+
+	wbuf_init(&items);
+	wbuf_init(&tmpname);
+	result = -1;
+	if (push_items(&items, cache)) { goto fail; }
+	n = wbuf_size(&items) / sizeof(struct save_item);
+	qsort(items.begin, n, sizeof(struct save_item), item_cmp);
+
+	/* write another file, which replaces the old one once it is
+	   complete, so that it is never seen half-written, and so that the
+	   old one stays mapped as it was */
+	if (!wbuf_write(&tmpname, path, strlen(path)) ||
+	    !wbuf_write(&tmpname, ".tmp", sizeof ".tmp")) {
+		goto fail;
+	}
+	fp = fopen(tmpname.begin, "wb");
+	if (!fp) { goto fail; }
+	result = write_blob(fp, items.begin, n);
+	if (fclose(fp)) { result = -1; }
+	if (!result && rename(tmpname.begin, path)) { result = -1; }
+	if (result) { (void)remove(tmpname.begin); }
+
+fail:	wbuf_term(&tmpname);
+	wbuf_term(&items);
+	return result;
+}
+
+/* triangulate the shapes which were not found and add them to the cache */
+static int add_missing(
+	struct xylo_mesh_cache *cache,
+	struct tpool *pool,
+	struct spline_shape const *shapes,
+	struct mesh_key const *keys,
+	struct xylo_cached_mesh const **meshes,
+	size_t const *missing,
+	size_t m)
+{
+	struct spline_shape *todo;
+	struct xylo_cached_mesh pending;
+	struct wbuf buf;
+	size_t i, *counts;
+	float const *v;
+	int result;
+
+	todo = malloc(m * (sizeof *todo + sizeof *counts));
+	if (!todo) { return -1; }
+	counts = (size_t *)(todo + m);
+	for (i = 0; i < m; i++) { todo[i] = shapes[missing[i]]; }
+
+	/* shapes which could not be triangulated fail the whole call, so that
+	   only meshes with all their triangles are ever inserted */
+	wbuf_init(&buf);
+	result = xylo_triangulate_shapes(pool, m, todo, &buf, counts);
+	v = buf.begin;
+	for (i = 0; i < m && !result; i++) {
+		pending.key = keys[missing[i]];
+		pending.vertices = v;
+		pending.count = counts[i];
+		cache->pending = &pending;
+		meshes[missing[i]] = rescache_load(
+			cache->meshes,
+			keys + missing[i],
+			sizeof keys[missing[i]]);
+		cache->pending = NULL;
+		if (!meshes[missing[i]]) { result = -1; }
+		v += counts[i] * VERTEX_FLOATS;
+	}
+	wbuf_term(&buf);
+	free(todo);
+	return result;
+}
+
+int xylo_triangulate_cached(
+	struct xylo_mesh_cache *cache,
+	struct tpool *pool,
+	size_t n,
+	struct spline_shape const *shapes,
+	struct wbuf *dest,
+	size_t *counts)
+{
+	struct memblk blk[3];
+	struct xylo_cached_mesh const **meshes;
+	struct mesh_key *keys;
+	size_t i, m, sz, *missing;
+	int result;
+
+	assert(dest != NULL);
+	assert(counts != NULL);
+
+	if (!cache) {
+		return xylo_triangulate_shapes(pool, n, shapes, dest, counts);
+	}
+	if (n == 0) { return 0; }
+	if (memblk_init(blk + 0, n, sizeof *meshes)) { return -1; }
+	if (memblk_push(blk + 1, n, sizeof *keys, alignof(*keys))) {
+		return -1;
+	}
+	if (memblk_push(blk + 2, n, sizeof *missing, alignof(*missing))) {
+		return -1;
+	}
+	if (meshes = malloc(blk[2].extent), !meshes) { return -1; }
+	keys = memblk_offset(meshes, blk[1]);
+	missing = memblk_offset(meshes, blk[2]);
+
+	/* look up every shape first, so that the missing ones can be
+	   triangulated together */
+	for (i = m = 0; i < n; i++) {
+		hash_shape(keys + i, shapes + i);
+		meshes[i] = rescache_load(cache->meshes, keys + i, sizeof keys[i]);
+		if (!meshes[i]) { missing[m++] = i; }
+	}
+	cache->hits += n - m;
+	cache->misses += m;
+	result = m > 0 ? add_missing(
+		cache, pool, shapes, keys, meshes, missing, m) : 0;
+
+	for (sz = i = 0; i < n && !result; i++) {
+		sz += vertex_bytes(meshes[i]->count);
+	}
+	if (!result) { result = wbuf_reserve(dest, sz); }
+	for (i = 0; i < n; i++) {
+		if (!meshes[i]) { continue; }
+		if (!result) {
+			(void)wbuf_write(dest, meshes[i]->vertices,
+			                 vertex_bytes(meshes[i]->count));
+			counts[i] = meshes[i]->count;
+		}
+		rescache_release(cache->meshes, meshes[i]);
+	}
+	free(meshes);
+	return result;
+}
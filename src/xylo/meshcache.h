@@ -0,0 +1,43 @@
+#include <stddef.h>
+
+struct rescache;
+struct spline_shape;
+struct tpool;
+struct wbuf;
+
+struct xylo_mesh_cache
+{
+	/* meshes by the hash of their shape */
+	struct rescache *meshes;
+
+	/* every loaded mesh, in no particular order */
+	struct ilist entries;
+
+	/* file of meshes from an earlier process and its sorted index */
+	void const *map;
+	size_t map_size, nindex;
+	struct xylo_mesh_blob_entry const *index;
+
+	/* mesh which has just been triangulated, for the loader to copy */
+	struct xylo_cached_mesh const *pending;
+
+	/* number of shapes which were found in the cache or triangulated */
+	size_t hits, misses;
+};
+
+/* Like `xylo_triangulate_shapes()`, but take the vertices of the shapes which
+   are in `cache` from there, and add those of the others to it. With a NULL
+   cache, every shape is triangulated. Return non-zero on failure. */
+int xylo_triangulate_cached(
+	struct xylo_mesh_cache *cache,
+	struct tpool *pool,
+	size_t n,
+	struct spline_shape const *shapes,
+	struct wbuf *dest,
+	size_t *counts);
+
+/* Map the whole file at `path` read-only into memory and store its size in
+   `size`. Return NULL on failure. */
+void const *xylo_map_file(char const *path, size_t *size);
+
+void xylo_unmap_file(void const *data, size_t size);
@@ -1,6 +1,19 @@
 # xylo 2D renderer
-require base adt gm glapi glam spline tempo
+require base adt gm glapi glam spline tempo tpool rescache
+define_source *.c
+
+if contains "$TAGS" posix; then
+  define_source posix/*.c
+fi
 
 for test in test/*.c; do
   define_ok_test $test
 done
+
+define_utility -c bench bench/render.c
+define_utility -c bench bench/classify.c
+define_utility -c bench bench/triangulate.c
+define_utility -c bench bench/weld.c
+define_utility -c bench bench/tgraph.c
+define_utility -c bench bench/draw.c
+define_utility -c bench bench/dbvh.c
@@ -233,6 +233,7 @@ static size_t setup_parameters(
 		offset = max_index - shape_vertices;
 		outlines[i].indices = (void const *)offset;
 		outlines[i].count = shape_vertices * 2;
+		spline_shape_bounds(outlines[i].bounds, shapes + i);
 		vertices += shape_vertices + 1;
 	}
 
@@ -366,12 +367,21 @@ void xylo_outline_draw(
        struct gl_core33 const *restrict gl,
        struct xylo_outline const *outline,
        GLsizei samples)
+{
+	xylo_outline_draw_instances(gl, outline, samples, 1);
+}
+
+void xylo_outline_draw_instances(
+       struct gl_core33 const *restrict gl,
+       struct xylo_outline const *outline,
+       GLsizei samples,
+       GLsizei n)
 {
 	gl->DrawElementsInstancedBaseVertex(
 		GL_TRIANGLES,
 		outline->count,
 		outline->type,
 		outline->indices,
-		samples,
+		samples * n,
 		outline->basevertex);
 }
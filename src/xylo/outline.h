@@ -21,3 +21,11 @@ void xylo_outline_draw(
        struct gl_core33 const *restrict gl,
        struct xylo_outline const *shape,
        GLsizei samples);
+
+/* draw `n` consecutive objects with the same outline, starting with the
+   currently selected object index */
+void xylo_outline_draw_instances(
+       struct gl_core33 const *restrict gl,
+       struct xylo_outline const *shape,
+       GLsizei samples,
+       GLsizei n);
@@ -0,0 +1,192 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "glapi/api.h"
+#include "glapi/core.h"
+#include "xylo/types.h"
+#include "xylo/xylo.h"
+
+#include "types.h"
+#include "pick.h"
+
+void xylo_init_picker(
+	struct gl_core33 const *restrict gl,
+	struct xylo_picker *picker)
+{
+	GLuint pbo[PICK_RING];
+	size_t i;
+
+	assert(gl != NULL);
+	assert(picker != NULL);
+
+	gl->GenBuffers(PICK_RING, pbo);
+	for (i = 0; i < PICK_RING; i++) {
+		picker->slots[i].pbo = pbo[i];
+		picker->slots[i].size = 0;
+		picker->slots[i].fence = NULL;
+		picker->slots[i].serial = 0;
+	}
+	picker->next = 0;
+	picker->serial = 0;
+	picker->ids = NULL;
+	picker->ids_size = 0;
+}
+
+void xylo_term_picker(
+	struct gl_core33 const *restrict gl,
+	struct xylo_picker *picker)
+{
+	GLuint pbo[PICK_RING];
+	size_t i;
+
+	assert(gl != NULL);
+	assert(picker != NULL);
+
+	for (i = 0; i < PICK_RING; i++) {
+		if (picker->slots[i].fence) {
+			gl->DeleteSync(picker->slots[i].fence);
+		}
+		pbo[i] = picker->slots[i].pbo;
+	}
+	gl->DeleteBuffers(PICK_RING, pbo);
+	free(picker->ids);
+}
+
+unsigned xylo_pick_object_ids(
+	struct xylo *xylo,
+	GLint x,
+	GLint y,
+	GLsizei width,
+	GLsizei height)
+{
+	struct gl_core33 const *restrict gl;
+	struct xylo_picker *picker;
+	struct xylo_pick_slot *slot;
+	struct xylo_fb *fb;
+	GLsizeiptr size;
+	GLint alignment;
+
+	assert(xylo != NULL);
+
+	fb = xylo->fbs.last;
+	if (!fb || fb->object_id == 0) { return 0; }
+	if (width <= 0 || height <= 0) { return 0; }
+	if (x < 0 || width > fb->width - x) { return 0; }
+	if (y < 0 || height > fb->height - y) { return 0; }
+
+	gl = gl_get_core33(xylo->api);
+	picker = &xylo->picker;
+	slot = picker->slots + picker->next;
+	picker->next = (picker->next + 1) % PICK_RING;
+
+	/* the ring is full - drop the oldest request */
+	if (slot->fence) { gl->DeleteSync(slot->fence); }
+
+	size = (GLsizeiptr)width * height * sizeof(GLushort);
+	gl->BindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+	if (slot->size < size) {
+		gl->BufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+		slot->size = size;
+	}
+
+	/* read tightly packed rows into the buffer */
+	gl->GetIntegerv(GL_PACK_ALIGNMENT, &alignment);
+	gl->PixelStorei(GL_PACK_ALIGNMENT, sizeof(GLushort));
+	gl->BindFramebuffer(GL_READ_FRAMEBUFFER, fb->fbo);
+	gl->ReadBuffer(GL_COLOR_ATTACHMENT1);
+	gl->ReadPixels(
+		x, y,
+		width, height,
+		GL_RED_INTEGER,
+		GL_UNSIGNED_SHORT,
+		(void *)0);
+	gl->PixelStorei(GL_PACK_ALIGNMENT, alignment);
+	gl->BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	/* flush so that the fence is eventually signaled without waiting */
+	slot->fence = gl->FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	gl->Flush();
+
+	if (++picker->serial == 0) { picker->serial = 1; }
+	slot->serial = picker->serial;
+	slot->x = x;
+	slot->y = y;
+	slot->width = width;
+	slot->height = height;
+	return slot->serial;
+}
+
+static int copy_ids(
+	struct gl_core33 const *restrict gl,
+	struct xylo_picker *picker,
+	struct xylo_pick_slot const *slot)
+{
+	GLushort *ids;
+	void const *p;
+	size_t size;
+
+	size = (size_t)slot->width * slot->height * sizeof *ids;
+	if (picker->ids_size < size) {
+		ids = realloc(picker->ids, size);
+		if (!ids) { return -1; }
+		picker->ids = ids;
+		picker->ids_size = size;
+	}
+	gl->BindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+	p = gl->MapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+	if (p) {
+		(void)memcpy(picker->ids, p, size);
+		(void)gl->UnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	gl->BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	return p ? 0 : -2;
+}
+
+int xylo_poll_object_ids(struct xylo *xylo, struct xylo_pick *pick)
+{
+	struct gl_core33 const *restrict gl;
+	struct xylo_picker *picker;
+	struct xylo_pick_slot *slot;
+	size_t i, j;
+	GLint status;
+	int err;
+
+	assert(xylo != NULL);
+	assert(pick != NULL);
+
+	gl = gl_get_core33(xylo->api);
+	picker = &xylo->picker;
+
+	/* look for the most recent request that has finished */
+	for (i = 1; i <= PICK_RING; i++) {
+		slot = picker->slots + (picker->next + PICK_RING - i) % PICK_RING;
+		if (!slot->fence) { continue; }
+		gl->GetSynciv(slot->fence, GL_SYNC_STATUS, 1, NULL, &status);
+		if (status != GL_SIGNALED) { continue; }
+
+		err = copy_ids(gl, picker, slot);
+
+		/* this request and all older ones are done */
+		for (j = i; j <= PICK_RING; j++) {
+			slot = picker->slots +
+				(picker->next + PICK_RING - j) % PICK_RING;
+			if (slot->fence) {
+				gl->DeleteSync(slot->fence);
+				slot->fence = NULL;
+			}
+		}
+		if (err) { return err; }
+
+		slot = picker->slots + (picker->next + PICK_RING - i) % PICK_RING;
+		pick->serial = slot->serial;
+		pick->x = slot->x;
+		pick->y = slot->y;
+		pick->width = slot->width;
+		pick->height = slot->height;
+		pick->ids = picker->ids;
+		return 1;
+	}
+	return 0;
+}
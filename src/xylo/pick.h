@@ -0,0 +1,10 @@
+struct gl_core33;
+struct xylo_picker;
+
+void xylo_init_picker(
+	struct gl_core33 const *restrict gl,
+	struct xylo_picker *picker);
+
+void xylo_term_picker(
+	struct gl_core33 const *restrict gl,
+	struct xylo_picker *picker);
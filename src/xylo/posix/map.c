@@ -0,0 +1,34 @@
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "adt/ilist.h"
+
+#include "../meshcache.h"
+
+void const *xylo_map_file(char const *path, size_t *size)
+{
+	struct stat st;
+	void *data;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) { return NULL; }
+	if (fstat(fd, &st) || st.st_size <= 0) {
+		(void)close(fd);
+		return NULL;
+	}
+	data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	(void)close(fd);
+	if (data == MAP_FAILED) { return NULL; }
+	*size = (size_t)st.st_size;
+	return data;
+}
+
+void xylo_unmap_file(void const *data, size_t size)
+{
+	(void)munmap((void *)data, size);
+}
@@ -8,6 +8,18 @@ enum
 	FRAGMENT_ID_LOC = 1
 };
 
+/* default memory limit of the off-screen render targets, in bytes */
+#define FB_POOL_LIMIT (64 << 20)
+
+/* default drawing time budget of XYLO_AA_AUTO, in microseconds */
+#define AA_BUDGET 8000
+
+/* texels per struct xylo_object */
+#define OBJECT_TEXELS 6
+
+/* texture unit of the shapes program's per-object data */
+#define OBJECTS_TEX_UNIT 1
+
 enum
 {
 	ATTRIB_SHAPE_POS = 0,
@@ -19,9 +19,14 @@
 static struct gl_shader_source const shapes_vert = {
 	GL_VERTEX_SHADER,
 	GLSL(330,
-	uniform mat4 mvp;
-
-	/* custom multisampling support for 2 or 4 samples */
+	/* per-object data, six texels per object - see struct xylo_object */
+	uniform samplerBuffer objects;
+	uniform int object_index;
+
+	/* custom multisampling support for 2 or 4 samples - each object is
+	   drawn as `sample_count` consecutive instances, and runs of objects
+	   with the same shape as runs of such groups */
+	uniform int sample_count;
 	uniform vec2 sample_clip[4];
 	uniform vec4 sample_offset[4];
 
@@ -29,6 +34,8 @@ static struct gl_shader_source const shapes_vert = {
 	in vec3 quadratic_pos;
 
 	out vec3 quadratic;
+	flat out vec4 color;
+	flat out uint object_id;
 	out gl_PerVertex
 	{
 		vec4 gl_Position;
@@ -37,14 +44,24 @@ static struct gl_shader_source const shapes_vert = {
 
 	void main()
 	{
+		int sample = gl_InstanceID % sample_count;
+		int base = 6 * (object_index + gl_InstanceID / sample_count);
+		mat4 mvp = mat4(
+			texelFetch(objects, base + 0),
+			texelFetch(objects, base + 1),
+			texelFetch(objects, base + 2),
+			texelFetch(objects, base + 3));
+
+		color = texelFetch(objects, base + 4);
+		object_id = uint(texelFetch(objects, base + 5).x);
 		quadratic = quadratic_pos;
 		gl_Position = mvp * vec4(shape_pos, 0.0, 1.0) +
-			sample_offset[gl_InstanceID];
+			sample_offset[sample];
 
 		/* clip-space clip-planes through center defined by axis
 		   aligned normal directions */
-		gl_ClipDistance[0] = sample_clip[gl_InstanceID].x * gl_Position.x;
-		gl_ClipDistance[1] = sample_clip[gl_InstanceID].y * gl_Position.y;
+		gl_ClipDistance[0] = sample_clip[sample].x * gl_Position.x;
+		gl_ClipDistance[1] = sample_clip[sample].y * gl_Position.y;
 	})
 };
 
@@ -52,10 +69,9 @@ static struct gl_shader_source const shapes_frag = {
 	GL_FRAGMENT_SHADER,
 	GLSL(330,
 
-	uniform vec4 color;
-	uniform uint object_id;
-
 	in vec3 quadratic;
+	flat in vec4 color;
+	flat in uint object_id;
 
 	out vec4 fill_color;
 	out uint fragment_id;
@@ -86,11 +102,11 @@ static struct gl_location const shapes_attrib[] = {
 
 #define UNIFORM(name) { offsetof(struct xylo_shapes, name), #name }
 static struct gl_uniform_layout const uniforms[] = {
-	UNIFORM(mvp),
+	UNIFORM(sample_count),
 	UNIFORM(sample_clip),
 	UNIFORM(sample_offset),
-	UNIFORM(color),
-	UNIFORM(object_id),
+	UNIFORM(objects),
+	UNIFORM(object_index),
 	{ 0, 0 }
 };
 #undef UNIFORM
@@ -106,34 +122,44 @@ int xylo_init_shapes(struct xylo_shapes *shapes, struct gl_api *api)
 		shapes_attrib,
 		fragment_locs
 	};
+	struct gl_core33 const *restrict gl;
+	GLint max_texels;
+
+	gl = gl_get_core33(api);
 	shapes->program = gl_make_program(api, &program);
 	if (!shapes->program) { return -1; }
 	gl_get_uniforms(api, shapes, shapes->program, uniforms);
+
+	/* texture buffer of per-object data */
+	gl->GenBuffers(1, &shapes->tbo);
+	gl->GenTextures(1, &shapes->tex);
+	gl->BindBuffer(GL_TEXTURE_BUFFER, shapes->tbo);
+	gl->BindTexture(GL_TEXTURE_BUFFER, shapes->tex);
+	gl->TexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, shapes->tbo);
+	gl->BindTexture(GL_TEXTURE_BUFFER, 0);
+	gl->BindBuffer(GL_TEXTURE_BUFFER, 0);
+	gl->GetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+	shapes->max_objects = max_texels / OBJECT_TEXELS;
 	return 0;
 }
 
 void xylo_term_shapes(struct xylo_shapes *shapes, struct gl_api *api)
 {
-	gl_get_core30(api)->DeleteProgram(shapes->program);
-	gl_unuse_program(api, shapes->program);
-}
+	struct gl_core33 const *restrict gl = gl_get_core33(api);
 
-void xylo_shapes_set_color4fv(
-	struct xylo_shapes *shapes,
-	struct gl_core33 const *restrict gl,
-	float const *color)
-{
-	assert(xylo_get_uint(gl, GL_CURRENT_PROGRAM) == shapes->program);
-	gl->Uniform4fv(shapes->color, 1, color);
+	gl->DeleteTextures(1, &shapes->tex);
+	gl->DeleteBuffers(1, &shapes->tbo);
+	gl->DeleteProgram(shapes->program);
+	gl_unuse_program(api, shapes->program);
 }
 
-void xylo_shapes_set_mvp(
+void xylo_shapes_set_sample_count(
 	struct xylo_shapes *shapes,
 	struct gl_core33 const *restrict gl,
-	float const *mvp)
+	GLsizei n)
 {
 	assert(xylo_get_uint(gl, GL_CURRENT_PROGRAM) == shapes->program);
-	gl->UniformMatrix4fv(shapes->mvp, 1, GL_FALSE, mvp);
+	gl->Uniform1i(shapes->sample_count, n);
 }
 
 void xylo_shapes_set_sample_clip(
@@ -156,20 +182,36 @@ void xylo_shapes_set_sample_offset(
 	gl->Uniform4fv(shapes->sample_offset, n, sample_offset);
 }
 
-void xylo_shapes_set_object_id(
+void xylo_shapes_set_objects(
 	struct xylo_shapes *shapes,
 	struct gl_core33 const *restrict gl,
-	unsigned object_id)
+	GLsizei n,
+	struct xylo_object const *objects)
 {
 	assert(xylo_get_uint(gl, GL_CURRENT_PROGRAM) == shapes->program);
-	gl->Uniform1ui(shapes->object_id, object_id);
+	assert(n <= shapes->max_objects);
+
+	/* re-specify the whole buffer so that the driver can orphan the
+	   storage used by the previous frame instead of synchronizing */
+	gl->BindBuffer(GL_TEXTURE_BUFFER, shapes->tbo);
+	gl->BufferData(
+		GL_TEXTURE_BUFFER,
+		n * sizeof *objects,
+		objects,
+		GL_STREAM_DRAW);
+	gl->BindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	gl->ActiveTexture(GL_TEXTURE0 + OBJECTS_TEX_UNIT);
+	gl->BindTexture(GL_TEXTURE_BUFFER, shapes->tex);
+	gl->ActiveTexture(GL_TEXTURE0);
+	gl->Uniform1i(shapes->objects, OBJECTS_TEX_UNIT);
 }
 
-void xylo_shapes_set_sample_offsets(
+void xylo_shapes_set_object_index(
 	struct xylo_shapes *shapes,
 	struct gl_core33 const *restrict gl,
-	unsigned object_id)
+	GLint index)
 {
 	assert(xylo_get_uint(gl, GL_CURRENT_PROGRAM) == shapes->program);
-	gl->Uniform1ui(shapes->object_id, object_id);
+	gl->Uniform1i(shapes->object_index, index);
 }
@@ -1,20 +1,15 @@
 struct gl_api;
 struct xylo_shapes;
+struct xylo_object;
 
 int xylo_init_shapes(struct xylo_shapes *shapes, struct gl_api *api);
 void xylo_term_shapes(struct xylo_shapes *shapes, struct gl_api *api);
 
-/* set shape solid color */
-void xylo_shapes_set_color4fv(
+/* set number of samples, i.e. instances, per object */
+void xylo_shapes_set_sample_count(
 	struct xylo_shapes *shapes,
 	struct gl_core33 const *restrict gl,
-	float const color[4]);
-
-/* set model-view-projection matrix */
-void xylo_shapes_set_mvp(
-	struct xylo_shapes *shapes,
-	struct gl_core33 const *restrict gl,
-	float const *mvp);
+	GLsizei n);
 
 void xylo_shapes_set_sample_clip(
 	struct xylo_shapes *shapes,
@@ -28,8 +23,16 @@ void xylo_shapes_set_sample_offset(
 	GLsizei n,
 	float const *sample_offset);
 
-/* set object ID */
-void xylo_shapes_set_object_id(
+/* upload transforms, colors, and IDs of `n` objects to draw, which must be
+   at most `shapes->max_objects` */
+void xylo_shapes_set_objects(
+	struct xylo_shapes *shapes,
+	struct gl_core33 const *restrict gl,
+	GLsizei n,
+	struct xylo_object const *objects);
+
+/* select which of the objects most recently uploaded to draw */
+void xylo_shapes_set_object_index(
 	struct xylo_shapes *shapes,
 	struct gl_core33 const *restrict gl,
-	unsigned object_id);
+	GLint index);
@@ -0,0 +1,126 @@
+#include <stddef.h>
+#include <stdio.h>
+
+#include "ok/ok.h"
+#include "glapi/core.h"
+#include "xylo/aa.h"
+
+#include "../types.h"
+#include "../aa.h"
+
+#define BUDGET 8000
+
+/* draw `frames` frames which take `usec` times the relative cost of the
+   current mode, and return the number of mode changes */
+static int run_frames(
+	struct xylo_aa_governor *governor,
+	double usec,
+	int frames)
+{
+	static double const cost[] = { 1.0, 2.0, 4.0 };
+	int i, mode, changes;
+
+	changes = 0;
+	for (i = 0; i < frames; i++) {
+		mode = governor->mode;
+		xylo_aa_governor_update(governor, mode, usec * cost[mode]);
+		if (governor->mode != mode) { changes++; }
+	}
+	return changes;
+}
+
+int test_drop_quality_when_over_budget(void)
+{
+	struct xylo_aa_governor governor;
+
+	xylo_init_aa_governor(&governor, BUDGET);
+	if (governor.mode != XYLO_AA_RGSS) {
+		fail_test("Expected to start at full quality\n");
+	}
+
+	/* RGSS takes twice the budget, quincunx fits */
+	run_frames(&governor, BUDGET / 2.0, 10);
+	if (governor.mode != XYLO_AA_QUINCUNX) {
+		fail_test("Expected quincunx, got mode %d\n", governor.mode);
+	}
+
+	/* nothing but no anti-aliasing fits */
+	run_frames(&governor, BUDGET * 0.6, 10);
+	if (governor.mode != XYLO_AA_NONE) {
+		fail_test("Expected no anti-aliasing, got mode %d\n",
+		          governor.mode);
+	}
+
+	/* nothing fits at all */
+	run_frames(&governor, BUDGET * 2.0, 10);
+	if (governor.mode != XYLO_AA_NONE) {
+		fail_test("Expected no anti-aliasing, got mode %d\n",
+		          governor.mode);
+	}
+	return ok;
+}
+
+int test_return_to_full_quality_after_a_while(void)
+{
+	struct xylo_aa_governor governor;
+	int frames;
+
+	xylo_init_aa_governor(&governor, BUDGET);
+	run_frames(&governor, BUDGET, 10);
+	if (governor.mode != XYLO_AA_NONE) {
+		fail_test("Expected no anti-aliasing, got mode %d\n",
+		          governor.mode);
+	}
+
+	/* still scene which is cheap to draw */
+	for (frames = 0; governor.mode != XYLO_AA_RGSS; frames++) {
+		if (frames > 1000) { fail_test("Quality never returned\n"); }
+		run_frames(&governor, BUDGET / 10.0, 1);
+	}
+	printf("back to full quality after %d frames\n", frames);
+	if (frames < 20) {
+		fail_test("Expected a delay before raising quality\n");
+	}
+	return ok;
+}
+
+int test_do_not_switch_back_and_forth_at_the_limit(void)
+{
+	struct xylo_aa_governor governor;
+	int i, changes;
+
+	/* RGSS barely misses the budget, and quincunx barely fits */
+	xylo_init_aa_governor(&governor, BUDGET);
+	changes = 0;
+	for (i = 0; i < 100; i++) {
+		changes += run_frames(&governor, BUDGET * (i & 1 ? .26 : .24), 1);
+	}
+	if (changes != 1) {
+		fail_test("Expected a single change, got %d\n", changes);
+	}
+	if (governor.mode != XYLO_AA_QUINCUNX) {
+		fail_test("Expected quincunx, got mode %d\n", governor.mode);
+	}
+	return ok;
+}
+
+int test_ignore_times_of_previous_modes(void)
+{
+	struct xylo_aa_governor governor;
+	int i;
+
+	xylo_init_aa_governor(&governor, BUDGET);
+	run_frames(&governor, BUDGET, 3);
+	if (governor.mode == XYLO_AA_RGSS) {
+		fail_test("Expected lower quality\n");
+	}
+
+	/* late results of frames drawn before the switch */
+	for (i = 0; i < 100; i++) {
+		xylo_aa_governor_update(&governor, XYLO_AA_RGSS, 1.0);
+	}
+	if (governor.mode == XYLO_AA_RGSS) {
+		fail_test("Times of another mode were used\n");
+	}
+	return ok;
+}
@@ -0,0 +1,302 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "ok/ok.h"
+#include "base/mem.h"
+#include "base/gbuf.h"
+#include "base/wbuf.h"
+#include "glapi/core.h"
+#include "xylo/draw.h"
+#include "xylo/dbvh.h"
+
+#include "../types.h"
+
+#define GROUP_SIZE 16
+#define WORLD_SIZE 1000.f
+#define QUERIES 200
+
+/* A two-level draw tree of outline leaves scattered over the world, in groups
+   of GROUP_SIZE */
+struct scene
+{
+	size_t n, ngroups;
+	struct xylo_outline *outlines;
+	struct xylo_doutline *leaves;
+	struct xylo_dlist root, *groups;
+};
+
+static float frand(float lo, float hi)
+{
+	return lo + (float)rand() / RAND_MAX * (hi - lo);
+}
+
+static void place(struct xylo_doutline *leaf)
+{
+	float a, s;
+
+	a = frand(0.f, 6.2832f);
+	s = frand(0.5f, 2.f);
+	leaf->transform.m22[0] = s * cosf(a);
+	leaf->transform.m22[1] = s * sinf(a);
+	leaf->transform.m22[2] = -s * sinf(a);
+	leaf->transform.m22[3] = s * cosf(a);
+	leaf->transform.pos[0] = frand(0.f, WORLD_SIZE);
+	leaf->transform.pos[1] = frand(0.f, WORLD_SIZE);
+}
+
+static int make_scene(struct scene *scene, size_t n)
+{
+	struct xylo_outline *outline;
+	size_t i;
+
+	scene->n = n;
+	scene->ngroups = (n + GROUP_SIZE - 1) / GROUP_SIZE;
+	scene->outlines = calloc(n, sizeof *scene->outlines);
+	scene->leaves = malloc(n * sizeof *scene->leaves);
+	scene->groups = malloc(scene->ngroups * sizeof *scene->groups);
+	if (!scene->outlines || !scene->leaves || !scene->groups) {
+		return -1;
+	}
+	xylo_init_dlist(&scene->root);
+	for (i = 0; i < scene->ngroups; i++) {
+		xylo_init_dlist(scene->groups + i);
+		if (xylo_dlist_append(&scene->root, &scene->groups[i].draw)) {
+			return -1;
+		}
+	}
+	for (i = 0; i < n; i++) {
+		outline = scene->outlines + i;
+		outline->bounds[0] = frand(-5.f, 0.f);
+		outline->bounds[1] = frand(-5.f, 0.f);
+		outline->bounds[2] = frand(0.f, 5.f);
+		outline->bounds[3] = frand(0.f, 5.f);
+		xylo_init_doutline(scene->leaves + i, outline);
+		scene->leaves[i].id = i;
+		place(scene->leaves + i);
+		if (xylo_dlist_append(scene->groups + i / GROUP_SIZE,
+		                      &scene->leaves[i].draw)) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static void term_scene(struct scene *scene)
+{
+	size_t i;
+
+	for (i = 0; i < scene->n; i++) {
+		xylo_term_doutline(scene->leaves + i);
+	}
+	for (i = 0; i < scene->ngroups; i++) {
+		xylo_term_dlist(scene->groups + i);
+	}
+	xylo_term_dlist(&scene->root);
+	free(scene->outlines);
+	free(scene->leaves);
+	free(scene->groups);
+}
+
+/* world-space bounds of a leaf, computed independently of xylo_dbvh */
+static void world_bounds(float *dest, struct xylo_doutline const *leaf)
+{
+	float const *m = leaf->transform.m22, *b = leaf->outline->bounds;
+	float ex, ey;
+
+	ex = (fabsf(m[0]) * (b[2] - b[0]) + fabsf(m[2]) * (b[3] - b[1])) / 2;
+	ey = (fabsf(m[1]) * (b[2] - b[0]) + fabsf(m[3]) * (b[3] - b[1])) / 2;
+	dest[0] = m[0] * (b[0] + b[2]) / 2 + m[2] * (b[1] + b[3]) / 2;
+	dest[1] = m[1] * (b[0] + b[2]) / 2 + m[3] * (b[1] + b[3]) / 2;
+	dest[0] += leaf->transform.pos[0];
+	dest[1] += leaf->transform.pos[1];
+	dest[2] = dest[0] + ex;
+	dest[3] = dest[1] + ey;
+	dest[0] -= ex;
+	dest[1] -= ey;
+}
+
+/* bounds are compared with some slack to ignore rounding differences, so
+   leaves close to the edge are not checked */
+static int near_edge(float const *b, float const *rect)
+{
+	static float const eps = 1e-3f;
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		if (fabsf(b[i] - rect[i + 2]) < eps) { return 1; }
+		if (fabsf(b[i + 2] - rect[i]) < eps) { return 1; }
+	}
+	return 0;
+}
+
+static int overlaps(float const *a, float const *b)
+{
+	return a[0] <= b[2] && b[0] <= a[2] && a[1] <= b[3] && b[1] <= a[3];
+}
+
+static void random_rect(float *rect, float size)
+{
+	rect[0] = frand(-size, WORLD_SIZE);
+	rect[1] = frand(-size, WORLD_SIZE);
+	rect[2] = rect[0] + frand(0.f, size);
+	rect[3] = rect[1] + frand(0.f, size);
+}
+
+/* Check that `result` holds the leaves overlapping `rect` in drawing order */
+static void check_query(
+	struct scene const *scene,
+	float const *rect,
+	struct wbuf const *result)
+{
+	struct xylo_draw const *const *p, *const *q;
+	float b[4];
+	size_t i;
+
+	p = result->begin;
+	q = result->end;
+	for (i = 0; i < scene->n; i++) {
+		world_bounds(b, scene->leaves + i);
+		if (p < q && *p == &scene->leaves[i].draw) {
+			if (!overlaps(b, rect) && !near_edge(b, rect)) {
+				fail_test("leaf %zu reported but not overlapping\n",
+				          i);
+			}
+			p++;
+		} else if (overlaps(b, rect) && !near_edge(b, rect)) {
+			fail_test("leaf %zu overlapping but not reported\n", i);
+		}
+	}
+	if (p != q) {
+		fail_test("unexpected leaves or leaves out of order\n");
+	}
+}
+
+static void check_queries(struct scene const *scene, struct xylo_dbvh *bvh)
+{
+	struct wbuf result;
+	float rect[4];
+	int i;
+
+	wbuf_init(&result);
+	for (i = 0; i < QUERIES; i++) {
+		random_rect(rect, i & 1 ? 10.f : 200.f);
+		wbuf_rewind(&result);
+		if (xylo_dbvh_query(bvh, rect, &result)) {
+			bail_out("out of memory\n");
+		}
+		check_query(scene, rect, &result);
+	}
+	wbuf_term(&result);
+}
+
+int test_query_leaves_overlapping_a_rectangle(void)
+{
+	struct scene scene;
+	struct xylo_dbvh *bvh;
+
+	if (make_scene(&scene, 5000)) { bail_out("out of memory\n"); }
+	bvh = xylo_make_dbvh();
+	if (!bvh || xylo_dbvh_build(bvh, &scene.root.draw)) {
+		bail_out("out of memory\n");
+	}
+	if (xylo_dbvh_length(bvh) != scene.n) {
+		fail_test("expected %zu leaves, got %zu\n",
+		          scene.n, xylo_dbvh_length(bvh));
+	}
+	check_queries(&scene, bvh);
+
+	xylo_free_dbvh(bvh);
+	term_scene(&scene);
+	return ok;
+}
+
+int test_pick_candidates_topmost_first(void)
+{
+	struct scene scene;
+	struct xylo_dbvh *bvh;
+	struct xylo_draw const *picked[64];
+	float b[4], pt[4];
+	size_t i, j, n;
+	int k;
+
+	if (make_scene(&scene, 5000)) { bail_out("out of memory\n"); }
+	bvh = xylo_make_dbvh();
+	if (!bvh || xylo_dbvh_build(bvh, &scene.root.draw)) {
+		bail_out("out of memory\n");
+	}
+
+	for (k = 0; k < QUERIES; k++) {
+		pt[0] = pt[2] = frand(0.f, WORLD_SIZE);
+		pt[1] = pt[3] = frand(0.f, WORLD_SIZE);
+		n = xylo_dbvh_pick(bvh, pt[0], pt[1], picked, length_of(picked));
+		j = 0;
+		for (i = scene.n; i-- > 0; ) {
+			world_bounds(b, scene.leaves + i);
+			if (near_edge(b, pt)) {
+				if (j < n && picked[j] == &scene.leaves[i].draw) {
+					j++;
+				}
+			} else if (overlaps(b, pt)) {
+				if (j >= n || picked[j] != &scene.leaves[i].draw) {
+					fail_test("leaf %zu not picked in order\n", i);
+				}
+				j++;
+			}
+		}
+		if (j != n) { fail_test("unexpected leaves picked\n"); }
+	}
+
+	/* only the topmost leaves fit */
+	pt[0] = scene.leaves[0].transform.pos[0];
+	pt[1] = scene.leaves[0].transform.pos[1];
+	scene.leaves[1].transform = scene.leaves[0].transform;
+	xylo_dbvh_refit(bvh);
+	n = xylo_dbvh_pick(bvh, pt[0], pt[1], picked, 1);
+	if (n != 1 || picked[0] == &scene.leaves[0].draw) {
+		fail_test("expected only the topmost leaf\n");
+	}
+
+	xylo_free_dbvh(bvh);
+	term_scene(&scene);
+	return ok;
+}
+
+int test_update_moved_leaves(void)
+{
+	struct scene scene;
+	struct xylo_dbvh *bvh;
+	struct xylo_doutline stranger;
+	size_t i;
+
+	if (make_scene(&scene, 2000)) { bail_out("out of memory\n"); }
+	bvh = xylo_make_dbvh();
+	if (!bvh || xylo_dbvh_build(bvh, &scene.root.draw)) {
+		bail_out("out of memory\n");
+	}
+
+	for (i = 0; i < scene.n; i += 7) {
+		place(scene.leaves + i);
+		if (xylo_dbvh_update(bvh, &scene.leaves[i].draw)) {
+			fail_test("leaf %zu not found\n", i);
+		}
+	}
+	check_queries(&scene, bvh);
+
+	/* a shape change is an update too */
+	scene.outlines[3].bounds[2] += 50.f;
+	(void)xylo_dbvh_update(bvh, &scene.leaves[3].draw);
+	check_queries(&scene, bvh);
+
+	xylo_init_doutline(&stranger, scene.outlines);
+	if (!xylo_dbvh_update(bvh, &stranger.draw)) {
+		fail_test("expected failure for unknown leaf\n");
+	}
+	xylo_term_doutline(&stranger);
+
+	xylo_free_dbvh(bvh);
+	term_scene(&scene);
+	return ok;
+}
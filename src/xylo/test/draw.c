@@ -0,0 +1,210 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "ok/ok.h"
+#include "base/mem.h"
+#include "base/gbuf.h"
+#include "base/wbuf.h"
+#include "gm/matrix.h"
+#include "xylo/draw.h"
+
+#define FANOUT 4
+
+/* A complete tree of dlists with `nleaves` outline leaves (without any
+   outline, since nothing is drawn) */
+struct tree
+{
+	size_t nlists, nleaves;
+	struct xylo_dlist *lists;
+	struct xylo_doutline *leaves;
+};
+
+static void random_transform(struct xylo_draw_transform *t)
+{
+	int i;
+	for (i = 0; i < 4; i++) {
+		t->m22[i] = (float)rand() / RAND_MAX * 2.f - 1.f;
+	}
+	t->pos[0] = (float)rand() / RAND_MAX * 200.f - 100.f;
+	t->pos[1] = (float)rand() / RAND_MAX * 200.f - 100.f;
+}
+
+/* Build a tree where list i has children FANOUT*i + 1 ... FANOUT*i + FANOUT,
+   the ones past the last list being leaves */
+static int make_tree(struct tree *tree, size_t nleaves)
+{
+	size_t i, j, child;
+
+	tree->nleaves = nleaves;
+	tree->nlists = (nleaves + FANOUT - 3) / (FANOUT - 1);
+	tree->lists = malloc(tree->nlists * sizeof *tree->lists);
+	tree->leaves = malloc(nleaves * sizeof *tree->leaves);
+	if (!tree->lists || !tree->leaves) { return -1; }
+
+	for (i = 0; i < nleaves; i++) {
+		xylo_init_doutline(tree->leaves + i, NULL);
+		random_transform(&tree->leaves[i].transform);
+		tree->leaves[i].style.color[0] = (float)i;
+	}
+	for (i = 0; i < tree->nlists; i++) {
+		xylo_init_dlist(tree->lists + i);
+		for (j = 1; j <= FANOUT; j++) {
+			child = FANOUT * i + j;
+			if (child < tree->nlists) {
+				(void)xylo_dlist_append(
+					tree->lists + i,
+					&tree->lists[child].draw);
+			} else if (child - tree->nlists < nleaves) {
+				(void)xylo_dlist_append(
+					tree->lists + i,
+					&tree->leaves[child - tree->nlists].draw);
+			}
+		}
+	}
+	return 0;
+}
+
+static void term_tree(struct tree *tree)
+{
+	size_t i;
+
+	for (i = 0; i < tree->nlists; i++) {
+		xylo_term_dlist(tree->lists + i);
+	}
+	for (i = 0; i < tree->nleaves; i++) {
+		xylo_term_doutline(tree->leaves + i);
+	}
+	free(tree->lists);
+	free(tree->leaves);
+}
+
+static void expected_mvp(
+	float *dest,
+	float const *proj,
+	struct xylo_draw_transform const *t)
+{
+	float mv[16];
+
+	(void)m44idf(mv);
+	mv[0] = t->m22[0];
+	mv[1] = t->m22[1];
+	mv[4] = t->m22[2];
+	mv[5] = t->m22[3];
+	mv[12] = t->pos[0];
+	mv[13] = t->pos[1];
+	(void)m44mulf(dest, proj, mv);
+}
+
+static int mvp_differs(float const *a, float const *b)
+{
+	int i;
+	for (i = 0; i < 16; i++) {
+		if (fabsf(a[i] - b[i]) > 1e-6f) { return 1; }
+	}
+	return 0;
+}
+
+int test_compile_draw_tree_in_drawing_order(void)
+{
+	struct tree tree;
+	struct xylo_dcmds cmds;
+	struct xylo_dcmd const *cmd;
+	struct xylo_doutline *leaf;
+	float proj[16], exp[16];
+	float const *mvp;
+	size_t i, n;
+
+	if (make_tree(&tree, 100)) { bail_out("out of memory\n"); }
+	(void)m44orthographicf(proj, -320.f, 320.f, -240.f, 240.f, 0.f, 100.f);
+	for (i = 0; i < tree.nleaves; i++) { tree.leaves[i].id = i; }
+
+	xylo_init_dcmds(&cmds);
+	if (xylo_dcmds_compile(&cmds, &tree.lists[0].draw)) {
+		bail_out("out of memory\n");
+	}
+	n = xylo_dcmds_length(&cmds);
+	if (n != tree.nleaves) {
+		fail_test("expected %zu commands, got %zu\n", tree.nleaves, n);
+	}
+	mvp = xylo_dcmds_project(&cmds, proj);
+
+	/* leaves are not visited in index order, but each leaf has its index
+	   in the red channel */
+	cmd = cmds.cmds.begin;
+	for (i = 0; i < n; i++, cmd++, mvp += 16) {
+		if (cmd->type != xylo_doutline) {
+			fail_test("command %zu: unexpected type\n", i);
+		}
+		leaf = tree.leaves + (size_t)cmd->color[0];
+		if (cmd->id != leaf->id) {
+			fail_test("command %zu: expected id %u, got %u\n",
+			          i, leaf->id, cmd->id);
+		}
+		expected_mvp(exp, proj, &leaf->transform);
+		if (mvp_differs(exp, mvp)) {
+			fail_test("command %zu: wrong MVP\n", i);
+		}
+	}
+
+	xylo_term_dcmds(&cmds);
+	term_tree(&tree);
+	return ok;
+}
+
+int test_compiled_mvps_are_cached_per_projection(void)
+{
+	struct xylo_doutline a, b;
+	struct xylo_dlist dlist;
+	struct xylo_dcmds cmds;
+	float proj[16], exp[16], *mvp;
+
+	xylo_init_doutline(&a, NULL);
+	xylo_init_doutline(&b, NULL);
+	random_transform(&a.transform);
+	random_transform(&b.transform);
+	xylo_init_dlist(&dlist);
+	(void)xylo_dlist_append(&dlist, &a.draw);
+	(void)xylo_dlist_append(&dlist, &b.draw);
+
+	xylo_init_dcmds(&cmds);
+	if (xylo_dcmds_compile(&cmds, &dlist.draw)) {
+		bail_out("out of memory\n");
+	}
+	(void)m44scalef(proj, 0.5f, 0.25f, 1.f);
+
+	/* same projection - the cached value is returned */
+	mvp = (float *)xylo_dcmds_project(&cmds, proj);
+	mvp[16] = 42.f;
+	mvp = (float *)xylo_dcmds_project(&cmds, proj);
+	if (mvp[16] != 42.f) {
+		fail_test("MVPs recomputed for the same projection\n");
+	}
+
+	/* new projection - recomputed */
+	proj[12] = 1.f;
+	mvp = (float *)xylo_dcmds_project(&cmds, proj);
+	expected_mvp(exp, proj, &b.transform);
+	if (mvp_differs(exp, mvp + 16)) {
+		fail_test("MVPs not recomputed for a new projection\n");
+	}
+
+	/* compiling again discards the cache */
+	random_transform(&b.transform);
+	if (xylo_dcmds_compile(&cmds, &dlist.draw)) {
+		bail_out("out of memory\n");
+	}
+	mvp = (float *)xylo_dcmds_project(&cmds, proj);
+	expected_mvp(exp, proj, &b.transform);
+	if (mvp_differs(exp, mvp + 16)) {
+		fail_test("MVPs not recomputed after compilation\n");
+	}
+
+	xylo_term_dcmds(&cmds);
+	xylo_term_dlist(&dlist);
+	xylo_term_doutline(&a);
+	xylo_term_doutline(&b);
+	return ok;
+}
@@ -0,0 +1,554 @@
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "ok/ok.h"
+#include "base/mem.h"
+#include "base/wbuf.h"
+#include "glapi/core.h"
+#include "spline/shape.h"
+#include "spline/stroke.h"
+#include "spline/triangulate.h"
+#include "tpool/tpool.h"
+#include "adt/ilist.h"
+#include "xylo/shape.h"
+
+#include "../private.h"
+#include "../mesh.h"
+#include "../meshcache.h"
+
+#define GLYPHS 64
+#define POLYGON_HOLES 8
+
+/* Outer and inner contour of each glyph, like an O */
+#define OUTER_SEGMENTS 24
+#define INNER_SEGMENTS 12
+
+struct glyphs
+{
+	size_t n;
+	struct spline_shape *shapes;
+	struct spline_outline *outlines;
+	struct spline_segment *segments;
+};
+
+static float frand(float lo, float hi)
+{
+	return lo + (float)rand() / RAND_MAX * (hi - lo);
+}
+
+/* a closed contour of conic arcs and lines around the origin with a wobbly
+   radius, clockwise if `n` is negative */
+static void make_contour(
+	struct spline_outline *outline,
+	struct spline_segment *segments,
+	int n,
+	float radius)
+{
+	float a, da, r, w;
+	size_t i, m;
+
+	m = n < 0 ? -n : n;
+	da = 2.f * 3.14159265f / n;
+	w = cosf(da / 2.f);
+	for (i = 0; i < m; i++) {
+		a = da * i;
+		r = radius * frand(0.9f, 1.1f);
+		segments[i].end[0] = r * cosf(a);
+		segments[i].end[1] = r * sinf(a);
+		if (i % 3 == 1) {
+			segments[i].mid[0] = r / w * cosf(a + da / 2.f);
+			segments[i].mid[1] = r / w * sinf(a + da / 2.f);
+			segments[i].weight = w;
+		} else {
+			/* straight line */
+			(void)memcpy(segments[i].mid, segments[i].end,
+			             sizeof segments[i].mid);
+			segments[i].weight = 0.f;
+		}
+	}
+	outline->n = m;
+	outline->segments = segments;
+}
+
+static int make_glyphs(struct glyphs *glyphs, size_t n)
+{
+	size_t i;
+	struct spline_segment *segments;
+
+	glyphs->n = n;
+	glyphs->shapes = malloc(n * sizeof *glyphs->shapes);
+	glyphs->outlines = malloc(n * 2 * sizeof *glyphs->outlines);
+	glyphs->segments = malloc(
+		n * (OUTER_SEGMENTS + INNER_SEGMENTS) *
+		sizeof *glyphs->segments);
+	if (!glyphs->shapes || !glyphs->outlines || !glyphs->segments) {
+		free(glyphs->shapes);
+		free(glyphs->outlines);
+		free(glyphs->segments);
+		return -1;
+	}
+
+	srand(1);
+	for (i = 0; i < n; i++) {
+		segments = glyphs->segments +
+			i * (OUTER_SEGMENTS + INNER_SEGMENTS);
+		make_contour(glyphs->outlines + i*2, segments,
+			OUTER_SEGMENTS, 0.4f);
+		make_contour(glyphs->outlines + i*2 + 1,
+			segments + OUTER_SEGMENTS,
+			-INNER_SEGMENTS, 0.2f);
+		glyphs->shapes[i].n = 2;
+		glyphs->shapes[i].outlines = glyphs->outlines + i*2;
+	}
+	return 0;
+}
+
+static void free_glyphs(struct glyphs *glyphs)
+{
+	free(glyphs->shapes);
+	free(glyphs->outlines);
+	free(glyphs->segments);
+}
+
+/* triangulate `glyphs` on `pool`, and return non-zero on failure */
+static int triangulate(
+	struct glyphs const *glyphs,
+	struct tpool *pool,
+	struct wbuf *dest,
+	size_t *counts)
+{
+	return xylo_triangulate_shapes(
+		pool,
+		glyphs->n,
+		glyphs->shapes,
+		dest,
+		counts);
+}
+
+int test_parallel_triangulation_gives_the_same_result(void)
+{
+	struct glyphs glyphs;
+	struct wbuf serial, parallel;
+	size_t serial_counts[GLYPHS], parallel_counts[GLYPHS], i, total;
+	struct tpool *pool;
+
+	if (make_glyphs(&glyphs, GLYPHS)) { bail_out("Out of memory\n"); }
+	if (pool = tpool_make(4), !pool) { bail_out("tpool_make failed\n"); }
+	wbuf_init(&serial);
+	wbuf_init(&parallel);
+
+	if (triangulate(&glyphs, NULL, &serial, serial_counts) ||
+	    triangulate(&glyphs, pool, &parallel, parallel_counts)) {
+		fail_test("Triangulation failed\n");
+	}
+
+	total = 0;
+	for (i = 0; i < GLYPHS; i++) {
+		if (serial_counts[i] == 0) {
+			fail_test("Glyph %zu has no triangles\n", i);
+		}
+		if (serial_counts[i] != parallel_counts[i]) {
+			fail_test("Glyph %zu: %zu != %zu vertices\n",
+			          i, serial_counts[i], parallel_counts[i]);
+		}
+		total += serial_counts[i];
+	}
+	if (wbuf_size(&serial) != total * sizeof(float) * VERTEX_FLOATS) {
+		fail_test("Vertex data does not match vertex counts\n");
+	}
+	if (wbuf_size(&serial) != wbuf_size(&parallel) ||
+	    memcmp(serial.begin, parallel.begin, wbuf_size(&serial))) {
+		fail_test("Different vertex data\n");
+	}
+
+	wbuf_term(&parallel);
+	wbuf_term(&serial);
+	tpool_free(pool);
+	free_glyphs(&glyphs);
+	return ok;
+}
+
+/* total area of the triangles of `n` vertices */
+static double triangle_area(float const *v, size_t n)
+{
+	double area, ax, ay, bx, by;
+	size_t i;
+
+	for (area = 0.0, i = 0; i + 3 <= n; i += 3, v += 3*VERTEX_FLOATS) {
+		ax = v[VERTEX_FLOATS] - v[0];
+		ay = v[VERTEX_FLOATS + 1] - v[1];
+		bx = v[2*VERTEX_FLOATS] - v[0];
+		by = v[2*VERTEX_FLOATS + 1] - v[1];
+		area += fabs(ax*by - ay*bx) * 0.5;
+	}
+	return area;
+}
+
+int test_triangulate_a_stroked_outline(void)
+{
+	static enum spline_join const joins[] = {
+		SPLINE_JOIN_MITER, SPLINE_JOIN_BEVEL
+	};
+	static double const areas[] = { 80.0, 80.0 - 4 * 0.5 };
+
+	struct spline_segment square[] = {
+		{ { 0.f, 0.f }, { 0.f, 0.f }, 0.f },
+		{ { 10.f, 0.f }, { 10.f, 0.f }, 0.f },
+		{ { 10.f, 10.f }, { 10.f, 10.f }, 0.f },
+		{ { 0.f, 10.f }, { 0.f, 10.f }, 0.f }
+	};
+	struct spline_outline outline = { 4, square };
+	struct spline_stroke stroke = { 2.f, SPLINE_JOIN_MITER, SPLINE_CAP_BUTT,
+	                                4.f, 0.01f };
+	struct spline_shape *shape;
+	struct wbuf buf;
+	size_t i, count;
+	double area;
+
+	/* the ring between squares of sides 8 and 12, with or without its
+	   outer corners */
+	for (i = 0; i < length_of(joins); i++) {
+		stroke.join = joins[i];
+		shape = spline_stroke_outline(&outline, 1, &stroke);
+		if (!shape) { bail_out("Out of memory\n"); }
+		wbuf_init(&buf);
+		if (xylo_triangulate_shapes(NULL, 1, shape, &buf, &count)) {
+			fail_test("Triangulation failed\n");
+		}
+		area = triangle_area(buf.begin, count);
+		if (fabs(area - areas[i]) > 1e-3) {
+			fail_test("Area %f, expected %f\n", area, areas[i]);
+		}
+		wbuf_term(&buf);
+		spline_free_shape(shape);
+	}
+	return ok;
+}
+
+/* triangulate `glyphs` through `cache`, and return non-zero on failure */
+static int triangulate_cached(
+	struct glyphs const *glyphs,
+	struct xylo_mesh_cache *cache,
+	struct wbuf *dest,
+	size_t *counts)
+{
+	return xylo_triangulate_cached(
+		cache,
+		NULL,
+		glyphs->n,
+		glyphs->shapes,
+		dest,
+		counts);
+}
+
+/* a file name for a mesh cache, which the caller removes */
+static char const *cache_path(void)
+{
+	static char path[256];
+	char const *dir;
+
+	dir = getenv("TMPDIR");
+	if (!dir || !*dir) { dir = "/tmp"; }
+	if (snprintf(path, sizeof path, "%s/xylo-mesh-test.cache", dir) >=
+	    (int)sizeof path) {
+		bail_out("Too long TMPDIR\n");
+	}
+	return path;
+}
+
+static void check_same(
+	struct wbuf const *expected,
+	size_t const *expected_counts,
+	struct wbuf const *actual,
+	size_t const *actual_counts,
+	size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		if (expected_counts[i] != actual_counts[i]) {
+			fail_test("Glyph %zu: %zu != %zu vertices\n",
+			          i, expected_counts[i], actual_counts[i]);
+		}
+	}
+	if (wbuf_size(expected) != wbuf_size(actual) ||
+	    memcmp(expected->begin, actual->begin, wbuf_size(expected))) {
+		fail_test("Different vertex data\n");
+	}
+}
+
+int test_cache_triangulated_shapes_in_memory(void)
+{
+	struct glyphs glyphs;
+	struct wbuf expected, first, second;
+	size_t expected_counts[GLYPHS], counts[2][GLYPHS];
+	struct xylo_mesh_cache *cache;
+
+	if (make_glyphs(&glyphs, GLYPHS)) { bail_out("Out of memory\n"); }
+	if (cache = xylo_make_mesh_cache(NULL), !cache) {
+		bail_out("Out of memory\n");
+	}
+	wbuf_init(&expected);
+	wbuf_init(&first);
+	wbuf_init(&second);
+
+	/* the last glyph is the same as the first one */
+	glyphs.shapes[GLYPHS - 1] = glyphs.shapes[0];
+	if (triangulate(&glyphs, NULL, &expected, expected_counts) ||
+	    triangulate_cached(&glyphs, cache, &first, counts[0])) {
+		fail_test("Triangulation failed\n");
+	}
+	check_same(&expected, expected_counts, &first, counts[0], GLYPHS);
+	if (cache->misses != GLYPHS || cache->hits != 0) {
+		fail_test("%zu misses, %zu hits\n", cache->misses, cache->hits);
+	}
+
+	if (triangulate_cached(&glyphs, cache, &second, counts[1])) {
+		fail_test("Triangulation failed\n");
+	}
+	check_same(&expected, expected_counts, &second, counts[1], GLYPHS);
+	if (cache->misses != GLYPHS || cache->hits != GLYPHS) {
+		fail_test("%zu misses, %zu hits\n", cache->misses, cache->hits);
+	}
+
+	wbuf_term(&second);
+	wbuf_term(&first);
+	wbuf_term(&expected);
+	xylo_free_mesh_cache(cache);
+	free_glyphs(&glyphs);
+	return ok;
+}
+
+int test_load_cached_shapes_from_a_file(void)
+{
+	struct glyphs glyphs, half;
+	struct wbuf expected, actual;
+	size_t expected_counts[GLYPHS], counts[GLYPHS];
+	struct xylo_mesh_cache *cache;
+	char const *path;
+
+	if (make_glyphs(&glyphs, GLYPHS)) { bail_out("Out of memory\n"); }
+	path = cache_path();
+	(void)remove(path);
+	wbuf_init(&expected);
+	if (triangulate(&glyphs, NULL, &expected, expected_counts)) {
+		fail_test("Triangulation failed\n");
+	}
+
+	/* save half of the glyphs, then all of them with the first half
+	   from the file which is replaced, and then use them all */
+	half = glyphs;
+	half.n = GLYPHS / 2;
+	if (cache = xylo_make_mesh_cache(path), !cache) {
+		bail_out("Out of memory\n");
+	}
+	wbuf_init(&actual);
+	if (triangulate_cached(&half, cache, &actual, counts)) {
+		fail_test("Triangulation failed\n");
+	}
+	if (xylo_save_mesh_cache(cache, path)) { fail_test("Save failed\n"); }
+	xylo_free_mesh_cache(cache);
+	wbuf_term(&actual);
+
+	if (cache = xylo_make_mesh_cache(path), !cache) {
+		bail_out("Out of memory\n");
+	}
+	wbuf_init(&actual);
+	if (triangulate_cached(&glyphs, cache, &actual, counts)) {
+		fail_test("Triangulation failed\n");
+	}
+	check_same(&expected, expected_counts, &actual, counts, GLYPHS);
+	if (cache->misses != GLYPHS - GLYPHS / 2) {
+		fail_test("%zu misses\n", cache->misses);
+	}
+	if (xylo_save_mesh_cache(cache, path)) { fail_test("Save failed\n"); }
+	check_same(&expected, expected_counts, &actual, counts, GLYPHS);
+	xylo_free_mesh_cache(cache);
+	wbuf_term(&actual);
+
+	if (cache = xylo_make_mesh_cache(path), !cache) {
+		bail_out("Out of memory\n");
+	}
+	wbuf_init(&actual);
+	if (triangulate_cached(&glyphs, cache, &actual, counts)) {
+		fail_test("Triangulation failed\n");
+	}
+	check_same(&expected, expected_counts, &actual, counts, GLYPHS);
+	if (cache->misses != 0 || cache->hits != GLYPHS) {
+		fail_test("%zu misses, %zu hits\n", cache->misses, cache->hits);
+	}
+	xylo_free_mesh_cache(cache);
+	wbuf_term(&actual);
+
+	(void)remove(path);
+	wbuf_term(&expected);
+	free_glyphs(&glyphs);
+	return ok;
+}
+
+/* Vertices and boundary edges of a square with `n` by `n` holes, each a
+   jittered quadrilateral in its own cell, or NULL on failure */
+static struct polygon
+{
+	size_t nv, ne;
+	float (*vertices)[2];
+	unsigned (*edges)[2];
+} *make_polygon(size_t n)
+{
+	static float const corners[4][2] = {
+		{ -1.f, -1.f }, { 1.f, -1.f }, { 1.f, 1.f }, { -1.f, 1.f }
+	};
+
+	struct polygon *p;
+	size_t i, j, k, first;
+	float cell, x, y;
+
+	p = malloc(sizeof *p);
+	if (!p) { return NULL; }
+	p->nv = p->ne = (n * n + 1) * 4;
+	p->vertices = malloc(p->nv * sizeof *p->vertices);
+	p->edges = malloc(p->ne * sizeof *p->edges);
+	if (!p->vertices || !p->edges) {
+		free(p->vertices);
+		free(p->edges);
+		free(p);
+		return NULL;
+	}
+	cell = 2.f / (n + 1);
+	for (first = i = 0; i <= n * n; i++, first += 4) {
+		x = (i % n + 1) * cell - 1.f;
+		y = (i / n + 1) * cell - 1.f;
+		for (k = 0; k < 4; k++) {
+			j = first + k;
+			if (i == n * n) {
+				/* the square itself */
+				p->vertices[j][0] = corners[k][0];
+				p->vertices[j][1] = corners[k][1];
+			} else {
+				p->vertices[j][0] = x + corners[k][0] * cell *
+					frand(0.2f, 0.4f);
+				p->vertices[j][1] = y + corners[k][1] * cell *
+					frand(0.2f, 0.4f);
+			}
+			p->edges[j][0] = j;
+			p->edges[j][1] = first + (k + 1) % 4;
+		}
+	}
+	return p;
+}
+
+static void free_polygon(struct polygon *p)
+{
+	free(p->vertices);
+	free(p->edges);
+	free(p);
+}
+
+/* even-odd rule by casting a ray from the barycenter of each triangle */
+static bool ray_cast(
+	struct polygon const *p,
+	struct triangle_set const *t,
+	size_t i)
+{
+	float x, y, (*a)[2], (*b)[2];
+	unsigned const *tri;
+	bool inside;
+	size_t j;
+
+	tri = t->indices[i];
+	x = (p->vertices[tri[0]][0] + p->vertices[tri[1]][0] +
+	     p->vertices[tri[2]][0]) / 3.0;
+	y = (p->vertices[tri[0]][1] + p->vertices[tri[1]][1] +
+	     p->vertices[tri[2]][1]) / 3.0;
+	inside = false;
+	for (j = 0; j < p->ne; j++) {
+		a = p->vertices + p->edges[j][0];
+		b = p->vertices + p->edges[j][1];
+		if (((*a)[1] > y) == ((*b)[1] > y)) { continue; }
+		if (x < (*a)[0] + ((*b)[0] - (*a)[0]) *
+		         (y - (*a)[1]) / ((*b)[1] - (*a)[1])) {
+			inside = !inside;
+		}
+	}
+	return inside;
+}
+
+/* classify the triangles of `p` by flood fill and by casting rays, and
+   return the number of differences or -1 on failure */
+static long classify(struct polygon *p)
+{
+	struct triangle_set *t;
+	bool *inside, *expected;
+	size_t i;
+	long ninside, ndiff;
+
+	t = triangle_set_triangulate(
+		(float const (*)[2])p->vertices, p->nv,
+		(unsigned const (*)[2])p->edges, p->ne);
+	if (!t) { return -1; }
+	inside = malloc(t->n * sizeof *inside * 2);
+	if (!inside) { return free(t), -1; }
+	expected = inside + t->n;
+	if (xylo_classify_triangles(inside, t, p->edges, p->ne, p->vertices)) {
+		return -1;
+	}
+	for (i = 0; i < t->n; i++) { expected[i] = ray_cast(p, t, i); }
+
+	ninside = ndiff = 0;
+	for (i = 0; i < t->n; i++) {
+		if (inside[i] != expected[i]) { ndiff++; }
+		if (inside[i]) { ninside++; }
+	}
+	/* the square minus its holes is most of the triangles */
+	if (ninside < (long)t->n / 2) { ndiff = -1; }
+
+	free(inside);
+	triangle_set_free(t);
+	return ndiff;
+}
+
+int test_classify_triangles_like_casting_rays(void)
+{
+	/* a square with a triangular hole whose vertex touches its bottom
+	   edge, which the triangulation splits in two */
+	static float touching_vertices[][2] = {
+		{ 0.f, 0.f }, { 4.f, 0.f }, { 4.f, 4.f }, { 0.f, 4.f },
+		{ 2.f, 0.f }, { 3.f, 2.f }, { 1.f, 2.f }
+	};
+	static unsigned touching_edges[][2] = {
+		{ 0, 1 }, { 1, 2 }, { 2, 3 }, { 3, 0 },
+		{ 4, 5 }, { 5, 6 }, { 6, 4 }
+	};
+
+	struct polygon *p, touching;
+	long ndiff;
+
+	srand(3);
+	if (p = make_polygon(POLYGON_HOLES), !p) {
+		bail_out("Out of memory\n");
+	}
+	ndiff = classify(p);
+	if (ndiff < 0) {
+		fail_test("Classification failed\n");
+	} else if (ndiff > 0) {
+		fail_test("%ld triangles classified differently\n", ndiff);
+	}
+	free_polygon(p);
+
+	touching.nv = length_of(touching_vertices);
+	touching.ne = length_of(touching_edges);
+	touching.vertices = touching_vertices;
+	touching.edges = touching_edges;
+	ndiff = classify(&touching);
+	if (ndiff < 0) {
+		fail_test("Classification of a touching hole failed\n");
+	} else if (ndiff > 0) {
+		fail_test("%ld triangles next to a touching hole classified "
+		          "differently\n", ndiff);
+	}
+	return ok;
+}
@@ -9,6 +9,7 @@
 #include "glapi/test.h"
 #include "gm/matrix.h"
 #include "base/gbuf.h"
+#include "base/wbuf.h"
 #include "base/mem.h"
 #include "spline/shape.h"
 #include "tempo/tempo.h"
@@ -927,3 +928,599 @@ static int aa2_(struct gl_api *api, struct gl_test *test)
 	return 0;
 }
 int test_render_more_using_anti_aliasing(void) { return run(aa2_); }
+
+/* Count calls which set uniforms or upload buffer data, and draw calls, by
+   temporarily replacing the entry points of the API */
+static struct gl_core33 real_gl;
+static unsigned long state_calls, draw_calls, toggle_calls;
+
+static void APIENTRY count_Uniform1i(GLint l, GLint v0)
+{
+	state_calls++;
+	real_gl.Uniform1i(l, v0);
+}
+
+static void APIENTRY count_Uniform1ui(GLint l, GLuint v0)
+{
+	state_calls++;
+	real_gl.Uniform1ui(l, v0);
+}
+
+static void APIENTRY count_Uniform2fv(GLint l, GLsizei n, GLfloat const *v)
+{
+	state_calls++;
+	real_gl.Uniform2fv(l, n, v);
+}
+
+static void APIENTRY count_Uniform4fv(GLint l, GLsizei n, GLfloat const *v)
+{
+	state_calls++;
+	real_gl.Uniform4fv(l, n, v);
+}
+
+static void APIENTRY count_UniformMatrix4fv(
+	GLint l,
+	GLsizei n,
+	GLboolean t,
+	GLfloat const *v)
+{
+	state_calls++;
+	real_gl.UniformMatrix4fv(l, n, t, v);
+}
+
+static void APIENTRY count_BufferData(
+	GLenum target,
+	GLsizeiptr size,
+	void const *data,
+	GLenum usage)
+{
+	state_calls++;
+	real_gl.BufferData(target, size, data, usage);
+}
+
+static void APIENTRY count_DrawArraysInstanced(
+	GLenum mode,
+	GLint first,
+	GLsizei count,
+	GLsizei instances)
+{
+	draw_calls++;
+	real_gl.DrawArraysInstanced(mode, first, count, instances);
+}
+
+static void APIENTRY count_ColorMask(
+	GLboolean r,
+	GLboolean g,
+	GLboolean b,
+	GLboolean a)
+{
+	toggle_calls++;
+	real_gl.ColorMask(r, g, b, a);
+}
+
+static void APIENTRY count_StencilFunc(GLenum func, GLint ref, GLuint mask)
+{
+	toggle_calls++;
+	real_gl.StencilFunc(func, ref, mask);
+}
+
+static void APIENTRY count_StencilOp(GLenum sfail, GLenum dpfail, GLenum dppass)
+{
+	toggle_calls++;
+	real_gl.StencilOp(sfail, dpfail, dppass);
+}
+
+static void count_state_calls(struct gl_core33 *gl)
+{
+	real_gl = *gl;
+	gl->Uniform1i = count_Uniform1i;
+	gl->Uniform1ui = count_Uniform1ui;
+	gl->Uniform2fv = count_Uniform2fv;
+	gl->Uniform4fv = count_Uniform4fv;
+	gl->UniformMatrix4fv = count_UniformMatrix4fv;
+	gl->BufferData = count_BufferData;
+	gl->DrawArraysInstanced = count_DrawArraysInstanced;
+	gl->ColorMask = count_ColorMask;
+	gl->StencilFunc = count_StencilFunc;
+	gl->StencilOp = count_StencilOp;
+	state_calls = 0;
+	draw_calls = 0;
+	toggle_calls = 0;
+}
+
+static void uncount_state_calls(struct gl_core33 *gl)
+{
+	*gl = real_gl;
+}
+
+static int call_count_(struct gl_api *api, struct gl_test *test)
+{
+	struct gl_core33 const *gl;
+	struct xylo *xylo;
+	struct xylo_mesh_set *set;
+	struct xylo_dlist dlist;
+	struct xylo_dmesh dmeshes[200];
+	struct xylo_view view;
+	enum xylo_aa aas[] = { XYLO_AA_NONE, XYLO_AA_QUINCUNX, XYLO_AA_RGSS };
+	unsigned long calls[2];
+	size_t i, j, n[2] = { 100, 200 };
+
+	(void)test;
+
+	gl = gl_get_core33(api);
+	if (!gl) { skip_test("OpenGL 3.3 or above required"); }
+	xylo = make_xylo(api);
+	if (!xylo) { return -1; }
+	set = xylo_make_mesh_set(api, length_of(test_shape), test_shape);
+	if (!set) { return -1; }
+
+	xylo_init_dlist(&dlist);
+	for (i = 0; i < length_of(dmeshes); i++) {
+		xylo_init_dmesh(dmeshes + i, xylo_get_mesh(set, i % 4));
+		update_transform(i, 3.0, &dmeshes[i].transform);
+	}
+
+	update_view(gl, &view);
+	xylo_set_mesh_set(xylo, set);
+	for (i = 0; i < length_of(aas); i++) {
+		xylo_set_aa(xylo, aas[i]);
+		for (j = 0; j < length_of(n); j++) {
+			while (xylo_dlist_length(&dlist) < n[j]) {
+				xylo_dlist_append(
+					&dlist,
+					&dmeshes[xylo_dlist_length(&dlist)].draw);
+			}
+			count_state_calls((struct gl_core33 *)gl);
+			xylo_draw(xylo, &view, &dlist.draw);
+			calls[j] = state_calls;
+			uncount_state_calls((struct gl_core33 *)gl);
+		}
+		while (xylo_dlist_length(&dlist) > 0) {
+			xylo_dlist_remove(&dlist, 0);
+		}
+
+		/* the number of calls per additional object */
+		printf("AA mode %d: %lu calls for %zu objects, %lu for %zu\n",
+		       (int)aas[i], calls[0], n[0], calls[1], n[1]);
+		if (calls[1] - calls[0] != n[1] - n[0]) {
+			fail_test("Expected one call per object, got %g\n",
+			          (double)(calls[1] - calls[0]) / (n[1] - n[0]));
+		}
+	}
+	gl->Finish();
+
+	xylo_term_dlist(&dlist);
+	for (i = 0; i < length_of(dmeshes); i++) {
+		xylo_term_dmesh(dmeshes + i);
+	}
+	xylo_free_mesh_set(set, api);
+	free_xylo(xylo);
+	return ok;
+}
+int test_set_one_uniform_per_object(void) { return run(call_count_); }
+
+static int instanced_(struct gl_api *api, struct gl_test *test)
+{
+	struct gl_core33 const *gl;
+	struct xylo *xylo;
+	struct xylo_mesh_set *set;
+	struct xylo_dlist dlist;
+	struct xylo_dmesh dmeshes[100];
+	struct xylo_view view;
+	size_t i;
+
+	(void)test;
+
+	gl = gl_get_core33(api);
+	if (!gl) { skip_test("OpenGL 3.3 or above required"); }
+	xylo = make_xylo(api);
+	if (!xylo) { return -1; }
+	set = xylo_make_mesh_set(api, length_of(test_shape), test_shape);
+	if (!set) { return -1; }
+
+	/* two runs of the same mesh, separated by one other mesh */
+	xylo_init_dlist(&dlist);
+	for (i = 0; i < length_of(dmeshes); i++) {
+		xylo_init_dmesh(dmeshes + i, xylo_get_mesh(set, i == 50));
+		update_transform(i, 3.0, &dmeshes[i].transform);
+		dmeshes[i].id = i + 1;
+		xylo_dlist_append(&dlist, &dmeshes[i].draw);
+	}
+
+	gl->ClearColor(1.f, 1.f, 1.f, 1.f);
+	gl->Clear(ALL_BUFFERS);
+	update_view(gl, &view);
+	xylo_set_mesh_set(xylo, set);
+	xylo_set_aa(xylo, XYLO_AA_RGSS);
+
+	count_state_calls((struct gl_core33 *)gl);
+	xylo_draw(xylo, &view, &dlist.draw);
+	uncount_state_calls((struct gl_core33 *)gl);
+	gl->Finish();
+	gl_test_swap_buffers(test);
+	if (is_test_interactive()) { gl_test_wait_for_key(test); }
+
+	printf("%zu objects: %lu draw calls\n", length_of(dmeshes), draw_calls);
+	if (draw_calls != 3) {
+		fail_test("Expected 3 draw calls, got %lu\n", draw_calls);
+	}
+
+	xylo_term_dlist(&dlist);
+	for (i = 0; i < length_of(dmeshes); i++) {
+		xylo_term_dmesh(dmeshes + i);
+	}
+	xylo_free_mesh_set(set, api);
+	free_xylo(xylo);
+	return ok;
+}
+int test_draw_copies_of_a_mesh_as_instances(void) { return run(instanced_); }
+
+static int outline_batch_(struct gl_api *api, struct gl_test *test)
+{
+	struct gl_core33 const *gl;
+	struct xylo *xylo;
+	struct xylo_outline_set *set;
+	struct xylo_dlist dlist;
+	struct xylo_doutline doutlines[100];
+	struct xylo_view view;
+	unsigned long toggles[2];
+	size_t i;
+	int overlap;
+
+	gl = gl_get_core33(api);
+	if (!gl) { skip_test("OpenGL 3.3 or above required"); }
+	xylo = make_xylo(api);
+	if (!xylo) { return -1; }
+	set = xylo_make_outline_set(api, length_of(test_shape), test_shape);
+	if (!set) { return -1; }
+
+	xylo_init_dlist(&dlist);
+	for (i = 0; i < length_of(doutlines); i++) {
+		xylo_init_doutline(doutlines + i, xylo_get_outline(set, i % 4));
+		memcpy(doutlines[i].style.color, i & 1 ? red : black, sizeof red);
+		m22mulsf(doutlines[i].transform.m22,
+		         doutlines[i].transform.m22,
+		         20.0f);
+		xylo_dlist_append(&dlist, &doutlines[i].draw);
+	}
+
+	gl->ClearColor(1.f, 1.f, 1.f, 1.f);
+	update_view(gl, &view);
+	xylo_set_outline_set(xylo, set);
+
+	/* first all on top of each other, then in a grid */
+	for (overlap = 1; overlap >= 0; overlap--) {
+		for (i = 0; i < length_of(doutlines); i++) {
+			doutlines[i].transform.pos[0] =
+				overlap ? 0.f : -270.f + (i % 10) * 60.f;
+			doutlines[i].transform.pos[1] =
+				overlap ? 0.f : -225.f + (i / 10) * 50.f;
+		}
+		gl->Clear(ALL_BUFFERS);
+		count_state_calls((struct gl_core33 *)gl);
+		xylo_draw(xylo, &view, &dlist.draw);
+		toggles[overlap] = toggle_calls;
+		uncount_state_calls((struct gl_core33 *)gl);
+		gl_test_swap_buffers(test);
+		if (is_test_interactive()) { gl_test_wait_for_key(test); }
+	}
+
+	printf("%zu outlines: %lu state changes overlapping, "
+	       "%lu side by side\n",
+	       length_of(doutlines), toggles[1], toggles[0]);
+	if (toggles[1] != 6 * length_of(doutlines)) {
+		fail_test("Expected separate passes for overlapping outlines\n");
+	}
+	if (toggles[0] > 6 * 2) {
+		fail_test("Expected shared passes for disjoint outlines\n");
+	}
+
+	xylo_term_dlist(&dlist);
+	for (i = 0; i < length_of(doutlines); i++) {
+		xylo_term_doutline(doutlines + i);
+	}
+	xylo_free_outline_set(set, api);
+	free_xylo(xylo);
+	return ok;
+}
+int test_share_stencil_passes_of_disjoint_outlines(void)
+{
+	return run(outline_batch_);
+}
+
+/* draw frames until the asynchronous pick `serial` is delivered */
+static int poll_pick(
+	struct xylo *xylo,
+	struct xylo_view const *view,
+	struct xylo_draw const *draw,
+	unsigned serial,
+	struct xylo_pick *pick)
+{
+	int frame, ret;
+
+	for (frame = 0; frame < 100; frame++) {
+		ret = xylo_poll_object_ids(xylo, pick);
+		if (ret < 0) { return ret; }
+		if (ret && pick->serial == serial) { return ret; }
+		xylo_draw(xylo, view, draw);
+	}
+	return 0;
+}
+
+static int async_pick_(struct gl_api *api, struct gl_test *test)
+{
+	static GLint const points[][2] = {
+		{ 1, 1 }, { 215, 220 }, { 300, 388 }, { 375, 300 }
+	};
+
+	struct xylo *xylo;
+	struct xylo_outline_set *set;
+	struct xylo_dlist dlist;
+	struct xylo_doutline a, b, c;
+	struct gl_core33 const *gl;
+	struct xylo_view view;
+	struct xylo_pick pick;
+	unsigned serial, id;
+	size_t i;
+	int j;
+
+	(void)test;
+
+	gl = gl_get_core33(api);
+	if (!gl) { skip_test("OpenGL 3.3 or above required"); }
+	xylo = make_xylo(api);
+	if (!xylo) { return -1; }
+	set = xylo_make_outline_set(api, length_of(test_shape), test_shape);
+	if (!set) { return -1; }
+
+	xylo_set_aa(xylo, XYLO_AA_QUINCUNX);
+
+	xylo_init_doutline(&a, xylo_get_outline(set, 0));
+	xylo_init_doutline(&b, xylo_get_outline(set, 2));
+	xylo_init_doutline(&c, xylo_get_outline(set, 3));
+	a.id = 1;
+	b.id = 2;
+	c.id = 3;
+
+	xylo_init_dlist(&dlist);
+	xylo_dlist_append(&dlist, &a.draw);
+	xylo_dlist_append(&dlist, &b.draw);
+	xylo_dlist_append(&dlist, &c.draw);
+
+	m22mulsf(a.transform.m22, a.transform.m22, 30.0f);
+	m22mulsf(b.transform.m22, b.transform.m22, 60.0f);
+	m22mulsf(c.transform.m22, c.transform.m22, 90.0f);
+
+	a.transform.pos[0] = a.transform.pos[1] = -90.0;
+	c.transform.pos[0] = b.transform.pos[1] = 90.0;
+
+	gl->ClearColor(1.f, 1.f, 1.f, 1.f);
+	gl->Clear(GL_COLOR_BUFFER_BIT);
+	update_view(gl, &view);
+	xylo_set_outline_set(xylo, set);
+	xylo_draw(xylo, &view, &dlist.draw);
+
+	/* single pixels agree with synchronous reads */
+	for (i = 0; i < length_of(points); i++) {
+		id = xylo_get_object_id(xylo, points[i][0], points[i][1]);
+		serial = xylo_pick_object_ids(
+			xylo,
+			points[i][0],
+			points[i][1],
+			1, 1);
+		if (!serial) { fail_test("Pick request failed\n"); }
+		if (poll_pick(xylo, &view, &dlist.draw, serial, &pick) != 1) {
+			fail_test("Pick was not delivered\n");
+		} else if (pick.ids[0] != id) {
+			fail_test("Expected id %u, got %u\n", id, pick.ids[0]);
+		}
+	}
+
+	/* a region is read row by row from the bottom, and requests older
+	   than the one delivered are dropped */
+	(void)xylo_pick_object_ids(xylo, 1, 1, 1, 1);
+	serial = xylo_pick_object_ids(xylo, 214, 219, 3, 3);
+	if (poll_pick(xylo, &view, &dlist.draw, serial, &pick) != 1) {
+		fail_test("Pick was not delivered\n");
+	} else {
+		for (j = 0; j < 9; j++) {
+			id = xylo_get_object_id(xylo, 214 + j % 3, 219 + j / 3);
+			if (pick.ids[j] != id) {
+				fail_test("Expected id %u at %d, got %u\n",
+				          id, j, pick.ids[j]);
+			}
+		}
+	}
+	if (xylo_poll_object_ids(xylo, &pick) != 0) {
+		fail_test("Expected no more picks\n");
+	}
+
+	xylo_term_dlist(&dlist);
+	xylo_term_doutline(&a);
+	xylo_term_doutline(&b);
+	xylo_term_doutline(&c);
+	xylo_free_outline_set(set, api);
+	free_xylo(xylo);
+	return ok;
+}
+int test_read_object_IDs_asynchronously(void) { return run(async_pick_); }
+
+static unsigned long alloc_calls;
+
+static void APIENTRY count_TexImage2D(
+	GLenum target, GLint level, GLint ifmt, GLsizei w, GLsizei h,
+	GLint border, GLenum fmt, GLenum type, void const *data)
+{
+	alloc_calls++;
+	real_gl.TexImage2D(target, level, ifmt, w, h, border, fmt, type, data);
+}
+
+static void APIENTRY count_RenderbufferStorage(
+	GLenum target, GLenum ifmt, GLsizei w, GLsizei h)
+{
+	alloc_calls++;
+	real_gl.RenderbufferStorage(target, ifmt, w, h);
+}
+
+static void count_allocations(struct gl_core33 *gl)
+{
+	real_gl = *gl;
+	gl->TexImage2D = count_TexImage2D;
+	gl->RenderbufferStorage = count_RenderbufferStorage;
+	alloc_calls = 0;
+}
+
+static int fb_pool_(struct gl_api *api, struct gl_test *test)
+{
+	struct gl_core33 const *gl;
+	struct xylo *xylo;
+	struct xylo_mesh_set *set;
+	struct xylo_dmesh dmesh;
+	struct xylo_view view;
+	enum xylo_aa aas[] = { XYLO_AA_QUINCUNX, XYLO_AA_RGSS };
+	GLint sizes[][2] = { { 320, 240 }, { 200, 100 } };
+	size_t i, j, frame;
+
+	(void)test;
+
+	gl = gl_get_core33(api);
+	if (!gl) { skip_test("OpenGL 3.3 or above required"); }
+	xylo = make_xylo(api);
+	if (!xylo) { return -1; }
+	set = xylo_make_mesh_set(api, length_of(test_shape), test_shape);
+	if (!set) { return -1; }
+	xylo_init_dmesh(&dmesh, xylo_get_mesh(set, 0));
+	m22mulsf(dmesh.transform.m22, dmesh.transform.m22, 90.0f);
+	xylo_set_mesh_set(xylo, set);
+
+	/* a preview and a main view, in both anti-aliasing modes, drawn in
+	   turns - only the first frame allocates */
+	count_allocations((struct gl_core33 *)gl);
+	for (frame = 0; frame < 3; frame++) {
+		if (frame == 1) {
+			if (alloc_calls == 0) {
+				fail_test("Expected allocations in first frame\n");
+			}
+			alloc_calls = 0;
+		}
+		for (i = 0; i < length_of(aas); i++) {
+			xylo_set_aa(xylo, aas[i]);
+			for (j = 0; j < length_of(sizes); j++) {
+				gl->Viewport(0, 0, sizes[j][0], sizes[j][1]);
+				ortho(view.projection, sizes[j]);
+				xylo_draw(xylo, &view, &dmesh.draw);
+			}
+		}
+	}
+	if (alloc_calls != 0) {
+		fail_test("Expected no reallocation, got %lu\n", alloc_calls);
+	}
+
+	/* a limit smaller than a single target keeps one at a time */
+	xylo_set_fb_limit(xylo, 1);
+	alloc_calls = 0;
+	for (j = 0; j < length_of(sizes); j++) {
+		gl->Viewport(0, 0, sizes[j][0], sizes[j][1]);
+		ortho(view.projection, sizes[j]);
+		xylo_draw(xylo, &view, &dmesh.draw);
+	}
+	if (alloc_calls == 0) {
+		fail_test("Expected reallocation with a small limit\n");
+	}
+	uncount_state_calls((struct gl_core33 *)gl);
+	gl->Finish();
+
+	xylo_term_dmesh(&dmesh);
+	xylo_free_mesh_set(set, api);
+	free_xylo(xylo);
+	return ok;
+}
+int test_reuse_framebuffers_across_views(void) { return run(fb_pool_); }
+
+/* drawing leaf by leaf, as xylo_draw() does when it runs out of memory, gives
+   the same picture as drawing compiled commands */
+static int tree_(struct gl_api *api, struct gl_test *test)
+{
+	struct gl_core33 const *gl;
+	struct xylo *xylo;
+	struct xylo_mesh_set *set;
+	struct xylo_dlist dlists[2];
+	struct xylo_dmesh dmeshes[40];
+	struct xylo_view view;
+	unsigned ids[12][16];
+	unsigned long calls;
+	size_t i;
+	GLint x, y;
+
+	gl = gl_get_core33(api);
+	if (!gl) { skip_test("OpenGL 3.3 or above required"); }
+	xylo = make_xylo(api);
+	if (!xylo) { return -1; }
+	set = xylo_make_mesh_set(api, length_of(test_shape), test_shape);
+	if (!set) { return -1; }
+
+	/* overlapping meshes over a nested list */
+	xylo_init_dlist(dlists + 0);
+	xylo_init_dlist(dlists + 1);
+	xylo_dlist_append(dlists + 0, &dlists[1].draw);
+	for (i = 0; i < length_of(dmeshes); i++) {
+		xylo_init_dmesh(dmeshes + i, xylo_get_mesh(set, i % 4));
+		memcpy(dmeshes[i].style.color, i & 1 ? red : black, sizeof red);
+		update_transform(i, 3.0, &dmeshes[i].transform);
+		dmeshes[i].id = i + 1;
+		xylo_dlist_append(dlists + i % 2, &dmeshes[i].draw);
+	}
+
+	gl->ClearColor(1.f, 1.f, 1.f, 1.f);
+	update_view(gl, &view);
+	xylo_set_mesh_set(xylo, set);
+	xylo_set_aa(xylo, XYLO_AA_QUINCUNX);
+
+	gl->Clear(ALL_BUFFERS);
+	xylo_draw(xylo, &view, &dlists[0].draw);
+	gl->Finish();
+	for (y = 0; y < 12; y++) {
+		for (x = 0; x < 16; x++) {
+			ids[y][x] = xylo_get_object_id(
+				xylo,
+				(2*x + 1) * gl_test_output_width / 32,
+				(2*y + 1) * gl_test_output_height / 24);
+		}
+	}
+
+	gl->Clear(ALL_BUFFERS);
+	count_state_calls((struct gl_core33 *)gl);
+	xylo_draw_tree(xylo, &view, &dlists[0].draw);
+	uncount_state_calls((struct gl_core33 *)gl);
+	calls = draw_calls;
+	gl->Finish();
+	gl_test_swap_buffers(test);
+	if (is_test_interactive()) { gl_test_wait_for_key(test); }
+
+	/* one draw call per leaf */
+	if (calls != length_of(dmeshes)) {
+		fail_test("Expected %zu draw calls, got %lu\n",
+		          length_of(dmeshes), calls);
+	}
+	for (y = 0; y < 12; y++) {
+		for (x = 0; x < 16; x++) {
+			if (ids[y][x] != xylo_get_object_id(
+				xylo,
+				(2*x + 1) * gl_test_output_width / 32,
+				(2*y + 1) * gl_test_output_height / 24)) {
+				fail_test("Different object at (%d, %d)\n",
+				          (int)x, (int)y);
+			}
+		}
+	}
+
+	xylo_term_dlist(dlists + 0);
+	xylo_term_dlist(dlists + 1);
+	for (i = 0; i < length_of(dmeshes); i++) {
+		xylo_term_dmesh(dmeshes + i);
+	}
+	xylo_free_mesh_set(set, api);
+	free_xylo(xylo);
+	return ok;
+}
+int test_draw_tree_leaf_by_leaf(void) { return run(tree_); }
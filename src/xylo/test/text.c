@@ -0,0 +1,433 @@
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "ok/ok.h"
+#include "base/mem.h"
+#include "base/wbuf.h"
+#include "glapi/core.h"
+#include "spline/shape.h"
+#include "xylo/text.h"
+
+#include "../private.h"
+#include "../types.h"
+#include "../mesh.h"
+#include "../text.h"
+
+#define check(cond) do { if (!(cond)) fail_test(#cond " failed\n"); } while (0)
+
+/* Glyphs out of order, with a box for missing characters, a space, a square
+   "A" with a square hole, and a triangle "V" which is kerned after "A". */
+static char const test_font[] =
+	"# test font\n"
+	"font 1000 800 -200 200\n"
+	"\n"
+	"glyph 86 600\n"
+	"outline\n"
+	"  0 700 0 700 0\n"
+	"  300 0 300 0 0\n"
+	"  600 700 600 700 0\n"
+	"glyph 0 500\n"
+	"outline\n"
+	"  0 0 0 0 0\n"
+	"  500 0 500 0 0\n"
+	"  500 700 500 700 0\n"
+	"  0 700 0 700 0\n"
+	"glyph 32 250\n"
+	"glyph 65 600\n"
+	"outline\n"
+	"  0 0 0 0 0\n"
+	"  600 0 600 0 0\n"
+	"  600 700 600 700 0\n"
+	"  0 700 0 700 0\n"
+	"outline\n"
+	"  200 200 200 200 0\n"
+	"  200 500 200 500 0\n"
+	"  400 500 400 500 0\n"
+	"  400 200 400 200 0\n"
+	"kern 86 65 -50\n"
+	"kern 65 86 -100\n";
+
+/* advances, line height, and the kerning of "AV" */
+#define ADVANCE_A 600.f
+#define ADVANCE_SPACE 250.f
+#define ADVANCE_MISSING 500.f
+#define LINE_HEIGHT 1200.f
+#define KERN_AV -100.f
+
+static struct xylo_font const *parse(char const *src)
+{
+	struct xylo_font const *font;
+	FILE *fp;
+
+	fp = tmpfile();
+	if (!fp) { bail_out("Could not create a temporary file\n"); }
+	if (fputs(src, fp) == EOF) { bail_out("Could not write\n"); }
+	rewind(fp);
+	font = xylo_fload_font(fp);
+	fclose(fp);
+	return font;
+}
+
+static struct xylo_font const *load_test_font(void)
+{
+	struct xylo_font const *font;
+
+	font = parse(test_font);
+	if (!font) { bail_out("Could not load the test font\n"); }
+	return font;
+}
+
+static size_t code_glyph(struct xylo_font const *font, unsigned long code)
+{
+	size_t g;
+
+	g = xylo_font_glyph(font, code);
+	if (g == font->nglyphs || font->glyphs[g].code != code) {
+		fail_test("No glyph %lu\n", code);
+	}
+	return g;
+}
+
+static void check_glyph(
+	struct xylo_text_layout const *layout,
+	size_t i,
+	size_t glyph,
+	float x,
+	float y)
+{
+	struct xylo_glyph_pos const *p;
+
+	if (i >= layout->n) { fail_test("No glyph %zu\n", i); }
+	p = layout->glyphs + i;
+	if (p->glyph != glyph || p->pos[0] != x || p->pos[1] != y) {
+		fail_test("Glyph %zu is %zu at (%g, %g), expected %zu at "
+		          "(%g, %g)\n", i, p->glyph, p->pos[0], p->pos[1],
+		          glyph, x, y);
+	}
+}
+
+int test_load_an_outline_font(void)
+{
+	static char const *const malformed[] = {
+		"",
+		"glyph 65 600\n",
+		"font 1000 800 -200\n",
+		"font 0 800 -200 200\n",
+		"font 1000 800 -200 200 100\n",
+		"font 1000 800 -200 200\nfont 1000 800 -200 200\n",
+		"font 1000 800 -200 200\noutline\n",
+		"font 1000 800 -200 200\nglyph 65 600\n0 0 0 0 0\n",
+		"font 1000 800 -200 200\nglyph 65 600\noutline\n",
+		"font 1000 800 -200 200\nglyph 65 600\noutline\n0 0 0 0\n",
+		"font 1000 800 -200 200\nglyph 65 600\noutline\n0 0 0 0 x\n",
+		"font 1000 800 -200 200\nglyph 65 600\nglyph 65 500\n",
+		"font 1000 800 -200 200\nglyph 65 nan\n",
+		"font 1000 800 -200 200\nkern 65 86 -100\nkern 65 86 -90\n",
+		"font 1000 800 -200 200\nglyph 65 600\noutline\n"
+			"0 0 0 0 0\nkern 65 86 -100\n0 0 0 0 0\n"
+	};
+
+	struct xylo_font const *font;
+	struct spline_shape const *shape;
+	size_t i;
+
+	font = load_test_font();
+	check(font->units_per_em == 1000.f);
+	check(font->ascent == 800.f);
+	check(font->descent == -200.f);
+	check(font->line_gap == 200.f);
+	check(font->nglyphs == 4);
+	check(font->glyphs[0].code == 0);
+	check(font->glyphs[1].code == 32);
+	check(font->glyphs[2].code == 65);
+	check(font->glyphs[3].code == 86);
+	check(font->glyphs[2].advance == ADVANCE_A);
+
+	/* the outlines stay with their glyphs */
+	check(font->shapes[1].n == 0);
+	shape = font->shapes + 2;
+	check(shape->n == 2);
+	check(shape->outlines[0].n == 4);
+	check(shape->outlines[1].n == 4);
+	check(shape->outlines[1].segments[2].end[0] == 400.f);
+	check(shape->outlines[1].segments[2].end[1] == 500.f);
+	check(font->shapes[3].n == 1);
+	check(font->shapes[3].outlines[0].n == 3);
+	check(font->shapes[3].outlines[0].segments[1].end[0] == 300.f);
+
+	check(font->nkernings == 2);
+	check(font->kernings[0].left == 65 && font->kernings[0].right == 86);
+	check(font->kernings[0].adjust == KERN_AV);
+	check(font->kernings[1].left == 86 && font->kernings[1].right == 65);
+
+	/* missing characters use the glyph of code point zero */
+	check(xylo_font_glyph(font, 65) == 2);
+	check(xylo_font_glyph(font, 66) == 0);
+	xylo_free_font(font);
+
+	for (i = 0; i < length_of(malformed); i++) {
+		font = parse(malformed[i]);
+		if (font) {
+			fail_test("Loaded malformed font %zu\n", i);
+		}
+	}
+
+	/* without a missing glyph, missing characters have no glyph */
+	font = parse("font 1000 800 -200 200\nglyph 65 600\n");
+	if (!font) { fail_test("Could not load a font\n"); }
+	check(xylo_font_glyph(font, 66) == font->nglyphs);
+	xylo_free_font(font);
+
+	return ok;
+}
+
+int test_lay_out_lines_of_text(void)
+{
+	static char const text[] = "AV A\nA\xc3\xa9\xff";
+
+	struct xylo_font const *font;
+	struct xylo_text_layout *layout;
+	size_t a, v, missing;
+	float x;
+
+	font = load_test_font();
+	a = code_glyph(font, 'A');
+	v = code_glyph(font, 'V');
+	missing = code_glyph(font, 0);
+
+	layout = xylo_layout_text(font, text, sizeof text - 1, 0.f);
+	if (!layout) { bail_out("Out of memory\n"); }
+
+	/* the space has no outlines, and é and the stray byte are missing */
+	check(layout->n == 6);
+	check(layout->nlines == 2);
+	check_glyph(layout, 0, a, 0.f, 0.f);
+	check_glyph(layout, 1, v, ADVANCE_A + KERN_AV, 0.f);
+	x = 2*ADVANCE_A + KERN_AV + ADVANCE_SPACE;
+	check_glyph(layout, 2, a, x, 0.f);
+	check_glyph(layout, 3, a, 0.f, -LINE_HEIGHT);
+	check_glyph(layout, 4, missing, ADVANCE_A, -LINE_HEIGHT);
+	check_glyph(layout, 5, missing, ADVANCE_A + ADVANCE_MISSING,
+	            -LINE_HEIGHT);
+	check(layout->bounds[0] == 0.f);
+	check(layout->bounds[1] == -LINE_HEIGHT + font->descent);
+	check(layout->bounds[2] == x + ADVANCE_A);
+	check(layout->bounds[3] == font->ascent);
+	xylo_free_text_layout(layout);
+
+	/* the missing glyph advances the pen */
+	layout = xylo_layout_text(font, "\xc3\xa9\xff" "A", 4, 0.f);
+	if (!layout) { bail_out("Out of memory\n"); }
+	check(layout->n == 3);
+	check_glyph(layout, 2, a, 2*ADVANCE_MISSING, 0.f);
+	xylo_free_text_layout(layout);
+
+	/* an empty text is a single empty line */
+	layout = xylo_layout_text(font, "", 0, 0.f);
+	if (!layout) { bail_out("Out of memory\n"); }
+	check(layout->n == 0);
+	check(layout->nlines == 1);
+	check(layout->bounds[0] == 0.f && layout->bounds[2] == 0.f);
+	xylo_free_text_layout(layout);
+
+	xylo_free_font(font);
+	return ok;
+}
+
+int test_wrap_lines_at_spaces(void)
+{
+	struct xylo_font const *font;
+	struct xylo_text_layout *layout;
+	size_t i, a;
+
+	font = load_test_font();
+	a = code_glyph(font, 'A');
+
+	/* "AA" fits, but "AA AA" does not */
+	layout = xylo_layout_text(font, "AA AA  AA", 9, 3*ADVANCE_A);
+	if (!layout) { bail_out("Out of memory\n"); }
+	check(layout->n == 6);
+	check(layout->nlines == 3);
+	for (i = 0; i < layout->n; i++) {
+		check_glyph(layout, i, a, (i % 2) * ADVANCE_A,
+		            (i / 2) * -LINE_HEIGHT);
+	}
+	check(layout->bounds[2] == 2*ADVANCE_A);
+	xylo_free_text_layout(layout);
+
+	/* words without spaces are broken where they do not fit, but each
+	   line has at least one glyph */
+	layout = xylo_layout_text(font, "AAAAA", 5, 2.5f*ADVANCE_A);
+	if (!layout) { bail_out("Out of memory\n"); }
+	check(layout->n == 5);
+	check(layout->nlines == 3);
+	for (i = 0; i < layout->n; i++) {
+		check_glyph(layout, i, a, (i % 2) * ADVANCE_A,
+		            (i / 2) * -LINE_HEIGHT);
+	}
+	check(layout->bounds[2] == 2*ADVANCE_A);
+	xylo_free_text_layout(layout);
+
+	layout = xylo_layout_text(font, "AA", 2, 0.5f*ADVANCE_A);
+	if (!layout) { bail_out("Out of memory\n"); }
+	check(layout->nlines == 2);
+	check_glyph(layout, 0, a, 0.f, 0.f);
+	check_glyph(layout, 1, a, 0.f, -LINE_HEIGHT);
+	xylo_free_text_layout(layout);
+
+	xylo_free_font(font);
+	return ok;
+}
+
+int test_cache_text_layouts(void)
+{
+	static char const text[] = "AV AV AV";
+
+	struct xylo_font const *font;
+	struct xylo_layout_cache *cache;
+	struct xylo_text_layout const *layout[4];
+	struct xylo_text_layout *expected;
+	size_t i;
+
+	font = load_test_font();
+	cache = xylo_make_layout_cache(font);
+	if (!cache) { bail_out("Out of memory\n"); }
+
+	layout[0] = xylo_cached_layout(cache, text, sizeof text - 1, 2000.f);
+	layout[1] = xylo_cached_layout(cache, text, sizeof text - 1, 2000.f);
+	layout[2] = xylo_cached_layout(cache, text, sizeof text - 1, 0.f);
+	layout[3] = xylo_cached_layout(cache, text, sizeof text - 1, -1.f);
+	for (i = 0; i < 4; i++) {
+		if (!layout[i]) { bail_out("Out of memory\n"); }
+	}
+	check(layout[0] == layout[1]);
+	check(layout[0] != layout[2]);
+	check(layout[2] == layout[3]);
+	check(layout[0]->nlines == 3);
+	check(layout[2]->nlines == 1);
+
+	/* the same as laying it out again */
+	expected = xylo_layout_text(font, text, sizeof text - 1, 2000.f);
+	if (!expected) { bail_out("Out of memory\n"); }
+	check(expected->n == layout[0]->n);
+	check(!memcmp(expected->glyphs, layout[0]->glyphs,
+	              expected->n * sizeof *expected->glyphs));
+	check(!memcmp(expected->bounds, layout[0]->bounds,
+	              sizeof expected->bounds));
+	xylo_free_text_layout(expected);
+
+	/* layouts in use are kept */
+	xylo_release_layout(cache, layout[0]);
+	xylo_release_layout(cache, layout[2]);
+	check(xylo_clean_layout_cache(cache) == 0);
+	xylo_release_layout(cache, layout[1]);
+	check(xylo_clean_layout_cache(cache) == 1);
+	xylo_release_layout(cache, layout[3]);
+	check(xylo_clean_layout_cache(cache) == 1);
+
+	xylo_free_layout_cache(cache);
+	xylo_free_font(font);
+	return ok;
+}
+
+int test_move_glyph_triangles_into_text(void)
+{
+	static char const text[] = "AVA\nV";
+
+	struct xylo_font const *font;
+	struct xylo_text_layout *layout;
+	struct xylo_mesh *glyphs;
+	struct xylo_glyph_pos const *p;
+	struct wbuf vertices, dest;
+	size_t i, j, n, *counts, first;
+	float bounds[4], expected[4];
+	float const *src, *dst;
+	long count;
+
+	font = load_test_font();
+	n = font->nglyphs;
+	glyphs = malloc(n * sizeof *glyphs);
+	counts = malloc(n * sizeof *counts);
+	if (!glyphs || !counts) { bail_out("Out of memory\n"); }
+	wbuf_init(&vertices);
+	if (xylo_triangulate_shapes(NULL, n, font->shapes, &vertices, counts)) {
+		fail_test("Triangulation failed\n");
+	}
+	for (first = i = 0; i < n; i++) {
+		glyphs[i].first = (GLint)first;
+		glyphs[i].count = (GLsizei)counts[i];
+		spline_shape_bounds(glyphs[i].bounds, font->shapes + i);
+		first += counts[i];
+	}
+	check(counts[code_glyph(font, 'A')] > 0);
+	check(counts[code_glyph(font, 'V')] > 0);
+
+	layout = xylo_layout_text(font, text, sizeof text - 1, 0.f);
+	if (!layout) { bail_out("Out of memory\n"); }
+	wbuf_init(&dest);
+	count = xylo_push_text_vertices(
+		&dest,
+		bounds,
+		vertices.begin,
+		glyphs,
+		layout);
+	if (count < 0) { bail_out("Out of memory\n"); }
+
+	/* every glyph's triangles, moved to where it is */
+	expected[0] = expected[1] = HUGE_VALF;
+	expected[2] = expected[3] = -HUGE_VALF;
+	dst = dest.begin;
+	for (i = 0, p = layout->glyphs; i < layout->n; i++, p++) {
+		src = (float const *)vertices.begin +
+		      glyphs[p->glyph].first * VERTEX_FLOATS;
+		for (j = 0; j < (size_t)glyphs[p->glyph].count; j++) {
+			if (dst[0] != src[0] + p->pos[0] ||
+			    dst[1] != src[1] + p->pos[1] ||
+			    memcmp(dst + 2, src + 2, 3 * sizeof *dst)) {
+				fail_test("Vertex %zu of glyph %zu is off\n",
+				          j, i);
+			}
+			dst += VERTEX_FLOATS;
+			src += VERTEX_FLOATS;
+		}
+		expected[0] = fminf(expected[0],
+		                    glyphs[p->glyph].bounds[0] + p->pos[0]);
+		expected[1] = fminf(expected[1],
+		                    glyphs[p->glyph].bounds[1] + p->pos[1]);
+		expected[2] = fmaxf(expected[2],
+		                    glyphs[p->glyph].bounds[2] + p->pos[0]);
+		expected[3] = fmaxf(expected[3],
+		                    glyphs[p->glyph].bounds[3] + p->pos[1]);
+	}
+	check((size_t)count * VERTEX_FLOATS * sizeof(float) ==
+	      wbuf_size(&dest));
+	check(dst == dest.end);
+	check(!memcmp(bounds, expected, sizeof bounds));
+	check(bounds[0] == 0.f && bounds[1] == -LINE_HEIGHT);
+	check(bounds[3] == 700.f);
+	xylo_free_text_layout(layout);
+
+	/* an empty text has an empty box */
+	layout = xylo_layout_text(font, " ", 1, 0.f);
+	if (!layout) { bail_out("Out of memory\n"); }
+	count = xylo_push_text_vertices(
+		&dest,
+		bounds,
+		vertices.begin,
+		glyphs,
+		layout);
+	check(count == 0);
+	check(bounds[0] > bounds[2] && bounds[1] > bounds[3]);
+	xylo_free_text_layout(layout);
+
+	wbuf_term(&dest);
+	wbuf_term(&vertices);
+	free(counts);
+	free(glyphs);
+	xylo_free_font(font);
+	return ok;
+}
@@ -1,5 +1,7 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
 #include "ok/ok.h"
 #include "base/mem.h"
@@ -7,6 +9,7 @@
 #include "base/mempool.h"
 #include "adt/ilist.h"
 #include "adt/itree.h"
+#include "tpool/tpool.h"
 #include "xylo/tgraph.h"
 
 static void path_concat(void *dest, void const *child, void const *parent)
@@ -130,3 +133,314 @@ int test_check_transformation_locality_after_compaction(void)
 
 	return 0;
 }
+
+static void affine2d_concat(void *dest, void const *child, void const *parent)
+{
+	float *d = dest;
+	float const *c = child, *p = parent;
+
+	d[0] = p[0]*c[0] + p[2]*c[1];
+	d[1] = p[1]*c[0] + p[3]*c[1];
+	d[2] = p[0]*c[2] + p[2]*c[3];
+	d[3] = p[1]*c[2] + p[3]*c[3];
+	d[4] = p[0]*c[4] + p[2]*c[5] + p[4];
+	d[5] = p[1]*c[4] + p[3]*c[5] + p[5];
+}
+
+static void mat44_concat(void *dest, void const *child, void const *parent)
+{
+	float *d = dest;
+	float const *c = child, *p = parent;
+	int row, col;
+
+	for (col = 0; col < 4; col++) {
+		for (row = 0; row < 4; row++) {
+			d[col*4 + row] = p[0*4 + row]*c[col*4 + 0]
+			               + p[1*4 + row]*c[col*4 + 1]
+			               + p[2*4 + row]*c[col*4 + 2]
+			               + p[3*4 + row]*c[col*4 + 3];
+		}
+	}
+}
+
+static void random_affine2d(float *tfm)
+{
+	float a = (float)rand() / RAND_MAX * 6.283f;
+
+	tfm[0] = cosf(a);
+	tfm[1] = sinf(a);
+	tfm[2] = -tfm[1];
+	tfm[3] = tfm[0];
+	tfm[4] = (float)rand() / RAND_MAX * 10.f - 5.f;
+	tfm[5] = (float)rand() / RAND_MAX * 10.f - 5.f;
+}
+
+static void random_mat44(float *tfm)
+{
+	float t[6];
+	int i;
+
+	random_affine2d(t);
+	for (i = 0; i < 16; i++) { tfm[i] = (i % 5 == 0) ? 1.f : 0.f; }
+	tfm[0] = t[0];
+	tfm[1] = t[1];
+	tfm[4] = t[2];
+	tfm[5] = t[3];
+	tfm[12] = t[4];
+	tfm[13] = t[5];
+}
+
+/* Build a random tree of `n` nodes where each node is a child of some node
+   created before it */
+static struct xylo_tgraph *make_random_graph(
+	struct xylo_tnode **nodes,
+	size_t n,
+	size_t nfloats)
+{
+	struct xylo_tgraph *graph;
+	struct xylo_tnode *parent;
+	float tfm[16];
+	size_t i;
+
+	srand(1);
+	graph = xylo_make_tgraph(nfloats * sizeof (float));
+	for (i = 0; i < n; i++) {
+		if (nfloats == 6) {
+			random_affine2d(tfm);
+		} else {
+			random_mat44(tfm);
+		}
+		parent = i < 4 ? NULL : nodes[rand() % i];
+		nodes[i] = xylo_make_tnode(graph, parent, tfm);
+		if (!nodes[i]) {
+			xylo_free_tgraph(graph);
+			return NULL;
+		}
+	}
+	return graph;
+}
+
+static int compare_globals(
+	struct xylo_tnode **nodes,
+	float const *expected,
+	size_t n,
+	size_t nfloats)
+{
+	float const *q;
+	size_t i, j;
+
+	for (i = 0; i < n; i++) {
+		q = xylo_tnode_global(nodes[i]);
+		for (j = 0; j < nfloats; j++) {
+			if (fabsf(q[j] - expected[i*nfloats + j]) > 1e-4f) {
+				fail_test("node %zu differs at %zu: %g != %g\n",
+				          i, j, q[j], expected[i*nfloats + j]);
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+static int check_propagate(enum xylo_tformat format, size_t nfloats)
+{
+	struct xylo_tgraph *graph;
+	struct xylo_tnode *nodes[2000];
+	float *expected, *local, tfm[16];
+	size_t i, n;
+	int round;
+
+	n = length_of(nodes) - 10;
+	graph = make_random_graph(nodes, n, nfloats);
+	expected = malloc(length_of(nodes) * nfloats * sizeof (float));
+	if (!graph || !expected) { bail_out("out of memory\n"); }
+
+	for (round = 0; round < 2; round++) {
+		/* reference */
+		(void)xylo_tgraph_transform(graph, nfloats == 6
+			? affine2d_concat
+			: mat44_concat);
+		for (i = 0; i < n; i++) {
+			(void)memcpy(
+				expected + i*nfloats,
+				xylo_tnode_global(nodes[i]),
+				nfloats * sizeof (float));
+		}
+		if (xylo_tgraph_propagate(graph, format)) {
+			fail_test("propagate failed\n");
+		}
+		(void)compare_globals(nodes, expected, n, nfloats);
+
+		/* change a root, and add some more nodes to re-flatten, with
+		   a copy of its transform since new nodes can move it */
+		local = xylo_tnode_local(nodes[0]);
+		local[nfloats - 1] += 1.f;
+		(void)memcpy(tfm, local, nfloats * sizeof *tfm);
+		for (; n < length_of(nodes); n++) {
+			nodes[n] = xylo_make_tnode(graph, nodes[n / 3], tfm);
+		}
+	}
+	free(expected);
+	xylo_free_tgraph(graph);
+	return ok;
+}
+
+int test_propagate_affine_2d_transforms(void)
+{
+	return check_propagate(xylo_taffine2d, 6);
+}
+
+int test_propagate_4x4_matrix_transforms(void)
+{
+	return check_propagate(xylo_tmat44f, 16);
+}
+
+/* Touch `count` random nodes by moving them a little */
+static void touch_random(
+	struct xylo_tgraph *graph,
+	struct xylo_tnode **nodes,
+	size_t n,
+	size_t count)
+{
+	float tfm[6];
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		struct xylo_tnode *node = nodes[rand() % n];
+		(void)memcpy(tfm, xylo_tnode_local(node), sizeof tfm);
+		tfm[4] += 0.5f;
+		if (xylo_tnode_set_local(graph, node, tfm)) {
+			bail_out("out of memory\n");
+		}
+	}
+}
+
+int test_update_only_touched_subtrees(void)
+{
+	struct xylo_tgraph *graph;
+	struct xylo_tnode *nodes[2000];
+	float *expected;
+	size_t i, n = length_of(nodes);
+	int round;
+
+	graph = make_random_graph(nodes, n, 6);
+	expected = malloc(n * 6 * sizeof (float));
+	if (!graph || !expected) { bail_out("out of memory\n"); }
+
+	/* all nodes start out touched */
+	if (xylo_tgraph_update(graph, xylo_taffine2d)) {
+		fail_test("update failed\n");
+	}
+	for (round = 0; round < 4; round++) {
+		touch_random(graph, nodes, n, 1 << round);
+		if (xylo_tgraph_update(graph, xylo_taffine2d)) {
+			fail_test("update failed\n");
+		}
+		for (i = 0; i < n; i++) {
+			(void)memcpy(
+				expected + i*6,
+				xylo_tnode_global(nodes[i]),
+				6 * sizeof (float));
+		}
+		/* a full pass should not change anything */
+		(void)xylo_tgraph_transform(graph, affine2d_concat);
+		if (compare_globals(nodes, expected, n, 6)) { break; }
+	}
+	free(expected);
+	xylo_free_tgraph(graph);
+	return ok;
+}
+
+int test_free_touched_nodes(void)
+{
+	struct xylo_tgraph *graph;
+	struct xylo_tnode *nodes[2000];
+	float tfm[6], *expected;
+	size_t i, n = length_of(nodes);
+
+	graph = xylo_make_tgraph(sizeof tfm);
+	expected = malloc(n * 6 * sizeof (float));
+	if (!graph || !expected) { bail_out("out of memory\n"); }
+	srand(2);
+	for (i = 0; i < n; i++) {
+		random_affine2d(tfm);
+		nodes[i] = xylo_make_tnode(graph, i ? nodes[0] : NULL, tfm);
+		if (!nodes[i]) { bail_out("out of memory\n"); }
+	}
+	if (xylo_tgraph_update(graph, xylo_taffine2d)) {
+		fail_test("update failed\n");
+	}
+
+	/* free every other touched leaf, starting with the first one, so that
+	   the remaining ones move around in the list of touched nodes */
+	for (i = 1; i <= 12; i++) {
+		random_affine2d(tfm);
+		if (xylo_tnode_set_local(graph, nodes[i], tfm)) {
+			bail_out("out of memory\n");
+		}
+	}
+	for (i = 1; i <= 12; i += 2) {
+		xylo_free_tnode(graph, nodes[i]);
+		nodes[i] = nodes[--n];
+	}
+	if (xylo_tgraph_update(graph, xylo_taffine2d)) {
+		fail_test("update failed\n");
+	}
+	for (i = 0; i < n; i++) {
+		(void)memcpy(
+			expected + i*6,
+			xylo_tnode_global(nodes[i]),
+			6 * sizeof (float));
+	}
+	(void)xylo_tgraph_transform(graph, affine2d_concat);
+	(void)compare_globals(nodes, expected, n, 6);
+
+	free(expected);
+	xylo_free_tgraph(graph);
+	return ok;
+}
+
+int test_parallel_propagation_matches_serial(void)
+{
+	struct xylo_tgraph *graph;
+	struct xylo_tnode **nodes;
+	struct tpool *pool;
+	float *expected;
+	size_t i, n = 20000;
+
+	nodes = malloc(n * sizeof *nodes);
+	expected = malloc(n * 16 * sizeof (float));
+	pool = tpool_make(4);
+	if (!nodes || !expected || !pool) { bail_out("out of memory\n"); }
+	graph = make_random_graph(nodes, n, 16);
+	if (!graph) { bail_out("out of memory\n"); }
+
+	(void)xylo_tgraph_propagate(graph, xylo_tmat44f);
+	for (i = 0; i < n; i++) {
+		(void)memcpy(
+			expected + i*16,
+			xylo_tnode_global(nodes[i]),
+			16 * sizeof (float));
+	}
+	/* clear the globals to make sure they are all recomputed */
+	for (i = 0; i < n; i++) {
+		float *global = (float *)xylo_tnode_global(nodes[i]);
+		(void)memset(global, 0, 16 * sizeof (float));
+	}
+	if (xylo_tgraph_propagate_parallel(graph, xylo_tmat44f, pool)) {
+		fail_test("parallel propagation failed\n");
+	}
+	for (i = 0; i < n; i++) {
+		if (memcmp(expected + i*16, xylo_tnode_global(nodes[i]),
+		           16 * sizeof (float))) {
+			fail_test("node %zu differs\n", i);
+			break;
+		}
+	}
+
+	tpool_free(pool);
+	xylo_free_tgraph(graph);
+	free(expected);
+	free(nodes);
+	return ok;
+}
@@ -0,0 +1,95 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ok/ok.h"
+#include "glapi/core.h"
+
+#include "../types.h"
+#include "../weld.h"
+
+#define MIN_SQUARED_DISTANCE 1e-10
+#define CLUSTER_POINTS 20000
+
+static float frand(float lo, float hi)
+{
+	return lo + (float)rand() / RAND_MAX * (hi - lo);
+}
+
+/* the linear search that welding replaces */
+static float square_distance(float const a[2], float const b[2])
+{
+	double dx, dy;
+	dx = a[0] - b[0];
+	dy = a[1] - b[1];
+	return dx*dx + dy*dy;
+}
+
+static unsigned linear_insert(float (*v)[2], size_t *n, float const pt[2])
+{
+	size_t i, m;
+	for (i = 0, m = *n; i < m; i++) {
+		if (square_distance(v[i], pt) < MIN_SQUARED_DISTANCE) {
+			return i;
+		}
+	}
+	++*n;
+	(void)memcpy(v[i], pt, sizeof *v);
+	return i;
+}
+
+int test_weld_like_a_linear_search(void)
+{
+	static float const spread[] = { 1e-6f, 5e-6f, 1e-5f, 2e-5f, 1e-3f };
+
+	float (*points)[2], (*linear)[2], (*welded)[2];
+	struct xylo_weld weld;
+	size_t i, nlinear;
+	unsigned expected, actual;
+	float centre[2], s;
+
+	points = malloc(CLUSTER_POINTS * sizeof *points);
+	linear = malloc(CLUSTER_POINTS * sizeof *linear);
+	welded = malloc(CLUSTER_POINTS * sizeof *welded);
+	if (!points || !linear || !welded) { bail_out("Out of memory\n"); }
+
+	/* clusters of points around and across the welding distance */
+	srand(1);
+	for (i = 0; i < CLUSTER_POINTS; i++) {
+		if (i % 16 == 0) {
+			centre[0] = frand(-1.f, 1.f);
+			centre[1] = frand(-1.f, 1.f);
+			s = spread[rand() % (sizeof spread / sizeof *spread)];
+		}
+		points[i][0] = centre[0] + frand(-s, s);
+		points[i][1] = centre[1] + frand(-s, s);
+	}
+
+	nlinear = 0;
+	if (xylo_init_weld(&weld, welded, CLUSTER_POINTS)) {
+		bail_out("Out of memory\n");
+	}
+	for (i = 0; i < CLUSTER_POINTS; i++) {
+		expected = linear_insert(linear, &nlinear, points[i]);
+		actual = xylo_weld_insert(&weld, points[i]);
+		if (expected != actual) {
+			fail_test("Point %zu: expected %u, got %u\n",
+			          i, expected, actual);
+		}
+	}
+	if (nlinear == CLUSTER_POINTS || nlinear < CLUSTER_POINTS / 16) {
+		fail_test("Expected some points to be merged, %zu of %d left\n",
+		          nlinear, CLUSTER_POINTS);
+	}
+	if (weld.n != nlinear ||
+	    memcmp(welded, linear, nlinear * sizeof *linear)) {
+		fail_test("Expected the same vertices\n");
+	}
+
+	xylo_term_weld(&weld);
+	free(welded);
+	free(linear);
+	free(points);
+	return ok;
+}
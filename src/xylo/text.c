@@ -0,0 +1,532 @@
+#include <assert.h>
+#include <stdalign.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+
+#include "base/mem.h"
+#include "base/wbuf.h"
+#include "adt/ilist.h"
+#include "glapi/core.h"
+#include "rescache/rescache.h"
+#include "spline/shape.h"
+#include "xylo/shape.h"
+#include "xylo/text.h"
+
+#include "private.h"
+#include "types.h"
+#include "mesh.h"
+#include "meshcache.h"
+#include "text.h"
+
+/* the character which replaces malformed UTF-8 */
+#define REPLACEMENT 0xfffdul
+
+struct xylo_glyph_set
+{
+	struct xylo_font const *font;
+	struct xylo_outline_set *outlines;
+	struct xylo_mesh_set *meshes;
+	struct wbuf vertices; /* float[][VERTEX_FLOATS] of every glyph */
+};
+
+struct xylo_layout_cache
+{
+	struct xylo_font const *font;
+	struct rescache *layouts;
+	struct wbuf key;
+};
+
+/* Decode the code point at the start of the `n` bytes at `s`. Return the
+   length of its encoding, where malformed sequences are single replacement
+   characters. */
+static size_t decode_utf8(unsigned long *code, unsigned char const *s, size_t n)
+{
+	static unsigned long const min[] = { 0, 0, 0x80, 0x800, 0x10000 };
+
+	unsigned long c;
+	size_t i, len;
+
+	assert(n > 0);
+
+	if (s[0] < 0x80) {
+		*code = s[0];
+		return 1;
+	} else if ((s[0] & 0xe0) == 0xc0) {
+		len = 2;
+		c = s[0] & 0x1f;
+	} else if ((s[0] & 0xf0) == 0xe0) {
+		len = 3;
+		c = s[0] & 0x0f;
+	} else if ((s[0] & 0xf8) == 0xf0) {
+		len = 4;
+		c = s[0] & 0x07;
+	} else {
+		*code = REPLACEMENT;
+		return 1;
+	}
+	for (i = 1; i < len; i++) {
+		if (i == n || (s[i] & 0xc0) != 0x80) {
+			*code = REPLACEMENT;
+			return i;
+		}
+		c = (c << 6) | (s[i] & 0x3f);
+	}
+	if (c < min[len] || c > 0x10fffful || (c >= 0xd800 && c < 0xe000)) {
+		c = REPLACEMENT;
+	}
+	*code = c;
+	return len;
+}
+
+static int kerning_key_cmp(void const *key, void const *kerning)
+{
+	unsigned long const *l = key;
+	struct xylo_kerning const *r = kerning;
+
+	if (l[0] != r->left) { return l[0] < r->left ? -1 : 1; }
+	return l[1] < r->right ? -1 : l[1] > r->right;
+}
+
+static float kerning(
+	struct xylo_font const *font,
+	unsigned long left,
+	unsigned long right)
+{
+	struct xylo_kerning const *k;
+	unsigned long const key[2] = { left, right };
+
+	k = bsearch(key, font->kernings, font->nkernings, sizeof *k,
+	            kerning_key_cmp);
+	return k ? k->adjust : 0.f;
+}
+
+/* state of the line being laid out */
+struct line
+{
+	/* first glyph of the line, and the first one after its last space */
+	size_t start, brk;
+
+	/* pen position, and that before and after the last space */
+	float x, y, space_begin, space_end;
+	bool has_space;
+};
+
+static void next_line(struct line *line, size_t start, float height)
+{
+	line->start = start;
+	line->x = 0.f;
+	line->y -= height;
+	line->has_space = false;
+}
+
+/* break the line at its last space and move the glyphs after it to the start
+   of the next line */
+static void wrap_line(
+	struct line *line,
+	struct xylo_glyph_pos *glyphs,
+	size_t n,
+	float height)
+{
+	float dx;
+	size_t i;
+
+	dx = line->space_end;
+	for (i = line->brk; i < n; i++) {
+		glyphs[i].pos[0] -= dx;
+		glyphs[i].pos[1] -= height;
+	}
+	line->x -= dx;
+	line->y -= height;
+	line->start = line->brk;
+	line->has_space = false;
+}
+
+static int layout_text(
+	struct xylo_text_layout *dest,
+	struct xylo_font const *font,
+	char const *utf8,
+	size_t size,
+	float width)
+{
+	unsigned char const *s;
+	struct xylo_glyph_pos *pos;
+	struct xylo_glyph const *glyph, *prev;
+	struct line line;
+	struct wbuf buf;
+	unsigned long code;
+	size_t i, n, g, len;
+	float height, max_width;
+
+	assert(font != NULL);
+	assert(utf8 != NULL || size == 0);
+
+	height = font->ascent - font->descent + font->line_gap;
+	s = (unsigned char const *)utf8;
+	wbuf_init(&buf);
+	line.start = 0;
+	line.x = line.y = 0.f;
+	line.has_space = false;
+	max_width = 0.f;
+	dest->nlines = 1;
+	prev = NULL;
+	for (i = 0; i < size; i += len) {
+		len = decode_utf8(&code, s + i, size - i);
+		n = wbuf_nmemb(&buf, sizeof *pos);
+		if (code == '\n') {
+			if (line.x > max_width) { max_width = line.x; }
+			next_line(&line, n, height);
+			dest->nlines++;
+			prev = NULL;
+			continue;
+		}
+		g = xylo_font_glyph(font, code);
+		if (g == font->nglyphs) { continue; }
+		glyph = font->glyphs + g;
+		if (prev) { line.x += kerning(font, prev->code, glyph->code); }
+		if (width > 0.f && code != ' ' &&
+		    line.x + glyph->advance > width) {
+			if (line.has_space) {
+				if (line.space_begin > max_width) {
+					max_width = line.space_begin;
+				}
+				wrap_line(&line, buf.begin, n, height);
+				dest->nlines++;
+			} else if (n > line.start || line.x > 0.f) {
+				if (line.x > max_width) { max_width = line.x; }
+				next_line(&line, n, height);
+				dest->nlines++;
+			}
+		}
+		if (code == ' ') {
+			/* a line ends before a run of spaces */
+			if (!line.has_space || line.brk != n) {
+				line.space_begin = line.x;
+			}
+			line.brk = n + (font->shapes[g].n > 0);
+			line.space_end = line.x + glyph->advance;
+			line.has_space = true;
+		}
+		if (font->shapes[g].n > 0) {
+			pos = wbuf_alloc(&buf, sizeof *pos);
+			if (!pos) {
+				wbuf_term(&buf);
+				return -1;
+			}
+			pos->glyph = g;
+			pos->pos[0] = line.x;
+			pos->pos[1] = line.y;
+		}
+		line.x += glyph->advance;
+		prev = glyph;
+	}
+	if (line.x > max_width) { max_width = line.x; }
+	(void)wbuf_trim(&buf);
+
+	dest->n = wbuf_nmemb(&buf, sizeof *pos);
+	dest->glyphs = buf.begin;
+	dest->bounds[0] = 0.f;
+	dest->bounds[1] = line.y + font->descent;
+	dest->bounds[2] = max_width;
+	dest->bounds[3] = font->ascent;
+	return 0;
+}
+
+struct xylo_text_layout *xylo_layout_text(
+	struct xylo_font const *font,
+	char const *utf8,
+	size_t size,
+	float width)
+{
+	struct xylo_text_layout *layout;
+
+	layout = malloc(sizeof *layout);
+	if (!layout) { return NULL; }
+	if (layout_text(layout, font, utf8, size, width)) {
+		free(layout);
+		return NULL;
+	}
+	return layout;
+}
+
+void xylo_free_text_layout(struct xylo_text_layout *layout)
+{
+	if (!layout) { return; }
+	free((void *)layout->glyphs);
+	free(layout);
+}
+
+/* The key of a cached layout is its width followed by its text, and the
+   layout is the data of the resource cache */
+static int load_layout(void const *key, size_t size, void *data, void *link)
+{
+	struct xylo_layout_cache const *cache = link;
+	float width;
+
+	assert(size >= sizeof width);
+
+	(void)memcpy(&width, key, sizeof width);
+	return layout_text(
+		data,
+		cache->font,
+		(char const *)key + sizeof width,
+		size - sizeof width,
+		width);
+}
+
+static void unload_layout(void const *key, size_t size, void *data, void *link)
+{
+	struct xylo_text_layout *layout = data;
+
+	(void)key;
+	(void)size;
+	(void)link;
+
+	free((void *)layout->glyphs);
+}
+
+struct xylo_layout_cache *xylo_make_layout_cache(struct xylo_font const *font)
+{
+	struct xylo_layout_cache *cache;
+
+	assert(font != NULL);
+
+	cache = malloc(sizeof *cache);
+	if (!cache) { return NULL; }
+	cache->layouts = make_rescache(
+		sizeof(struct xylo_text_layout),
+		alignof(struct xylo_text_layout),
+		alignof(float),
+		load_layout,
+		unload_layout,
+		cache);
+	if (!cache->layouts) {
+		free(cache);
+		return NULL;
+	}
+	cache->font = font;
+	wbuf_init(&cache->key);
+	return cache;
+}
+
+struct xylo_text_layout const *xylo_cached_layout(
+	struct xylo_layout_cache *cache,
+	char const *utf8,
+	size_t size,
+	float width)
+{
+	assert(cache != NULL);
+	assert(utf8 != NULL || size == 0);
+
+	/* every width which does not wrap is the same */
+	if (!(width > 0.f) || isinf(width)) { width = 0.f; }
+	wbuf_rewind(&cache->key);
+	if (!wbuf_write(&cache->key, &width, sizeof width) ||
+	    (size > 0 && !wbuf_write(&cache->key, utf8, size))) {
+		return NULL;
+	}
+	return rescache_load(
+		cache->layouts,
+		cache->key.begin,
+		wbuf_size(&cache->key));
+}
+
+void xylo_release_layout(
+	struct xylo_layout_cache *cache,
+	struct xylo_text_layout const *layout)
+{
+	assert(cache != NULL);
+	rescache_release(cache->layouts, layout);
+}
+
+size_t xylo_clean_layout_cache(struct xylo_layout_cache *cache)
+{
+	assert(cache != NULL);
+	return rescache_clean(cache->layouts);
+}
+
+void xylo_free_layout_cache(struct xylo_layout_cache *cache)
+{
+	if (!cache) { return; }
+	if (free_rescache(cache->layouts)) {
+		assert(!"Layouts are still in use");
+	}
+	wbuf_term(&cache->key);
+	free(cache);
+}
+
+long xylo_push_text_vertices(
+	struct wbuf *dest,
+	float bounds[4],
+	float const *vertices,
+	struct xylo_mesh const *glyphs,
+	struct xylo_text_layout const *layout)
+{
+	struct xylo_glyph_pos const *p;
+	struct xylo_mesh const *glyph;
+	float const *src;
+	float *dst, x, y;
+	size_t i, j, n, total;
+
+	assert(dest != NULL);
+	assert(layout != NULL);
+
+	bounds[0] = bounds[1] = HUGE_VALF;
+	bounds[2] = bounds[3] = -HUGE_VALF;
+	for (total = i = 0; i < layout->n; i++) {
+		total += glyphs[layout->glyphs[i].glyph].count;
+	}
+	if (total > LONG_MAX / VERTEX_FLOATS) { return -1; }
+	dst = wbuf_alloc(dest, total * VERTEX_FLOATS * sizeof *dst);
+	if (!dst) { return -1; }
+	for (i = 0, p = layout->glyphs; i < layout->n; i++, p++) {
+		glyph = glyphs + p->glyph;
+		x = p->pos[0];
+		y = p->pos[1];
+		n = glyph->count;
+		src = vertices + (size_t)glyph->first * VERTEX_FLOATS;
+
+		/* moving the triangles leaves their curve coordinates as
+		   they are */
+		(void)memcpy(dst, src, n * VERTEX_FLOATS * sizeof *dst);
+		for (j = 0; j < n; j++, dst += VERTEX_FLOATS) {
+			dst[0] += x;
+			dst[1] += y;
+		}
+		if (n == 0) { continue; }
+		if (glyph->bounds[0] + x < bounds[0]) {
+			bounds[0] = glyph->bounds[0] + x;
+		}
+		if (glyph->bounds[1] + y < bounds[1]) {
+			bounds[1] = glyph->bounds[1] + y;
+		}
+		if (glyph->bounds[2] + x > bounds[2]) {
+			bounds[2] = glyph->bounds[2] + x;
+		}
+		if (glyph->bounds[3] + y > bounds[3]) {
+			bounds[3] = glyph->bounds[3] + y;
+		}
+	}
+	return (long)total;
+}
+
+struct xylo_glyph_set *xylo_make_glyph_set(
+	struct gl_api *api,
+	struct xylo_font const *font,
+	struct tpool *pool,
+	struct xylo_mesh_cache *cache)
+{
+	struct xylo_glyph_set *set;
+	struct memblk blk[2];
+	size_t i, n, *counts;
+	float *bounds;
+
+	assert(font != NULL);
+
+	set = malloc(sizeof *set);
+	if (!set) { return NULL; }
+	set->font = font;
+	set->outlines = NULL;
+	set->meshes = NULL;
+	wbuf_init(&set->vertices);
+
+	/* keep the triangles of the glyphs for text meshes */
+	n = font->nglyphs;
+	if (memblk_init(blk+0, n, 4 * sizeof(*bounds))) { goto fail; }
+	if (memblk_push(blk+1, n, sizeof(*counts), alignof(*counts))) {
+		goto fail;
+	}
+	if (bounds = malloc(blk[1].extent + 1), !bounds) { goto fail; }
+	counts = memblk_offset(bounds, blk[1]);
+	if (!xylo_triangulate_cached(cache, pool, n, font->shapes,
+	                             &set->vertices, counts)) {
+		for (i = 0; i < n; i++) {
+			spline_shape_bounds(bounds + 4*i, font->shapes + i);
+		}
+		set->meshes = xylo_upload_mesh_set(
+			api,
+			n,
+			set->vertices.begin,
+			counts,
+			bounds);
+	}
+	free(bounds);
+	if (!set->meshes) { goto fail; }
+	set->outlines = xylo_make_outline_set(api, n, font->shapes);
+	if (!set->outlines) { goto fail; }
+	return set;
+
+fail:
+	xylo_free_glyph_set(set, api);
+	return NULL;
+}
+
+struct xylo_outline const *xylo_get_glyph_outline(
+	struct xylo_glyph_set *set,
+	size_t glyph)
+{
+	assert(set != NULL);
+	assert(glyph < set->font->nglyphs);
+	return xylo_get_outline(set->outlines, glyph);
+}
+
+struct xylo_mesh const *xylo_get_glyph_mesh(
+	struct xylo_glyph_set *set,
+	size_t glyph)
+{
+	assert(set != NULL);
+	assert(glyph < set->font->nglyphs);
+	return xylo_get_mesh(set->meshes, glyph);
+}
+
+void xylo_free_glyph_set(struct xylo_glyph_set *set, struct gl_api *api)
+{
+	if (!set) { return; }
+	if (set->outlines) { xylo_free_outline_set(set->outlines, api); }
+	if (set->meshes) { xylo_free_mesh_set(set->meshes, api); }
+	wbuf_term(&set->vertices);
+	free(set);
+}
+
+struct xylo_mesh_set *xylo_make_text_mesh_set(
+	struct gl_api *api,
+	struct xylo_glyph_set const *glyphs,
+	size_t n,
+	struct xylo_text_layout const *const *layouts)
+{
+	struct xylo_mesh_set *set;
+	struct memblk blk[2];
+	struct wbuf buf;
+	size_t i, *counts;
+	float *bounds;
+	long count;
+
+	assert(glyphs != NULL);
+	assert(layouts != NULL || n == 0);
+
+	if (memblk_init(blk+0, n, 4 * sizeof(*bounds))) { return NULL; }
+	if (memblk_push(blk+1, n, sizeof(*counts), alignof(*counts))) {
+		return NULL;
+	}
+	if (bounds = malloc(blk[1].extent + 1), !bounds) { return NULL; }
+	counts = memblk_offset(bounds, blk[1]);
+	wbuf_init(&buf);
+	set = NULL;
+	for (i = 0; i < n; i++) {
+		count = xylo_push_text_vertices(
+			&buf,
+			bounds + 4*i,
+			glyphs->vertices.begin,
+			glyphs->meshes->shapes,
+			layouts[i]);
+		if (count < 0) { goto done; }
+		counts[i] = (size_t)count;
+	}
+	set = xylo_upload_mesh_set(api, n, buf.begin, counts, bounds);
+
+done:	wbuf_term(&buf);
+	free(bounds);
+	return set;
+}
@@ -0,0 +1,17 @@
+#include <stddef.h>
+
+struct wbuf;
+struct xylo_mesh;
+struct xylo_text_layout;
+
+/* Append the triangles of the glyphs of `layout` to `dest`, moved to their
+   positions, where the triangles of glyph `i` are the vertices `glyphs[i]`
+   of `vertices`. Store the bounding box of the glyphs in `bounds`, which is
+   empty if there are none. Return the number of vertices, or negative on
+   failure. */
+long xylo_push_text_vertices(
+	struct wbuf *dest,
+	float bounds[4],
+	float const *vertices,
+	struct xylo_mesh const *glyphs,
+	struct xylo_text_layout const *layout);
@@ -10,15 +10,24 @@
 #include "base/mempool.h"
 #include "adt/ilist.h"
 #include "adt/itree.h"
+#include "tpool/tpool.h"
 #include "xylo/tgraph.h"
 
 #define NODE_BLOCK_SIZE 100
 #define TRANSFORM_SPACE_SIZE 200
 
+/* update all nodes if more than 1/TOUCHED_FULL_PASS_RATIO have been touched */
+#define TOUCHED_FULL_PASS_RATIO 128
+
+/* levels smaller than this are not split between threads */
+#define PARALLEL_MIN_NODES 1024
+
 struct xylo_tnode
 {
 	float *local, *global;
 	struct itree tree;
+	int dirty;
+	size_t touched; /* index in the touched nodes while dirty */
 };
 
 struct xylo_tgraph
@@ -26,7 +35,11 @@ struct xylo_tgraph
 	struct itree root;
 	struct mempool nodes;
 	struct wbuf local_tfm, global_tfm;
-	size_t transform_size;
+	struct wbuf parents; /* uint32_t[], see xylo_tgraph_propagate() */
+	struct wbuf levels; /* size_t[], first node of each level (and end) */
+	struct wbuf touched; /* struct xylo_tnode *[], see xylo_tnode_touch() */
+	size_t transform_size, nroots;
+	int flat;
 };
 
 void *xylo_tnode_local(struct xylo_tnode *node)
@@ -49,6 +62,11 @@ void xylo_init_tgraph(struct xylo_tgraph *graph, size_t transform_size)
 	mempool_init(&graph->nodes, NODE_BLOCK_SIZE, sizeof (struct xylo_tnode));
 	wbuf_init(&graph->local_tfm);
 	wbuf_init(&graph->global_tfm);
+	wbuf_init(&graph->parents);
+	wbuf_init(&graph->levels);
+	wbuf_init(&graph->touched);
+	graph->nroots = 0;
+	graph->flat = 0;
 }
 
 void xylo_term_tgraph(struct xylo_tgraph *graph)
@@ -59,6 +77,11 @@ void xylo_term_tgraph(struct xylo_tgraph *graph)
 	mempool_term(&graph->nodes);
 	wbuf_term(&graph->local_tfm);
 	wbuf_term(&graph->global_tfm);
+	wbuf_term(&graph->parents);
+	wbuf_term(&graph->levels);
+	wbuf_term(&graph->touched);
+	graph->nroots = 0;
+	graph->flat = 0;
 }
 
 struct xylo_tgraph *xylo_make_tgraph(size_t transform_size)
@@ -86,6 +109,7 @@ static void xylo_init_tnode(
 	itree_graft(parent, &node->tree, NULL);
 	node->local = local;
 	node->global = global;
+	node->dirty = 0;
 }
 
 static int queue_push(struct wbuf queue[2], void const *data, size_t size)
@@ -120,16 +144,29 @@ static int enqueue_children(struct itree *node, struct wbuf queue[2])
 	return 0;
 }
 
-/* Compact the transformations */
+/* index of a node in breadth-first order, once its transforms are written */
+static uint32_t tfm_index(
+	struct xylo_tnode const *node,
+	struct wbuf const *local,
+	size_t size)
+{
+	return ((char *)node->local - (char *)local->begin) / size;
+}
+
+/* Compact the transformations. If `parents` is not NULL the transforms are
+   also flattened: roots get a separate global transform and the index of the
+   parent of each node is written to `parents`. */
 static int graph_tfm_buffers(
 	struct xylo_tgraph *graph,
 	struct wbuf *local,
 	struct wbuf *global,
-	int write_global)
+	int write_global,
+	struct wbuf *parents)
 {
 	struct wbuf queue[2];
-	struct xylo_tnode *p;
+	struct xylo_tnode *p, *parent;
 	struct itree *t;
+	uint32_t index;
 	int result;
 	size_t size;
 
@@ -153,6 +190,15 @@ static int graph_tfm_buffers(
 		}
 		p->local = p->global = wbuf_swrite(local, p->local, size);
 		assert(p->local != NULL);
+		if (parents) {
+			p->global = wbuf_salloc(global, size);
+			index = tfm_index(p, local, size);
+			assert(p->global != NULL);
+			if (!wbuf_write(parents, &index, sizeof index)) {
+				result = -1;
+				goto out;
+			}
+		}
 	}
 	/* child nodes have separate global and local transforms */
 	while (queue_pop(queue, &p, sizeof p) == 0) {
@@ -169,6 +215,15 @@ static int graph_tfm_buffers(
 		}
 		assert(p->local != NULL);
 		assert(p->global != NULL);
+		if (parents) {
+			t = itree_parent(&p->tree);
+			parent = container_of(t, struct xylo_tnode, tree);
+			index = tfm_index(parent, local, size);
+			if (!wbuf_write(parents, &index, sizeof index)) {
+				result = -1;
+				goto out;
+			}
+		}
 	}
 out:	wbuf_term(queue + 0);
 	wbuf_term(queue + 1);
@@ -182,7 +237,8 @@ static int resize_tfm_spaces(struct xylo_tgraph *graph, size_t newsize)
 	int result;
 
 	assert(graph != NULL);
-	assert(wbuf_size(&graph->local_tfm) == wbuf_size(&graph->global_tfm));
+	/* roots don't always have a separate global transform */
+	assert(wbuf_size(&graph->local_tfm) >= wbuf_size(&graph->global_tfm));
 	if (wbuf_capacity(&graph->global_tfm) == newsize) { return 0; }
 
 	nmemb = newsize / graph->transform_size;
@@ -193,7 +249,7 @@ static int resize_tfm_spaces(struct xylo_tgraph *graph, size_t newsize)
 	if ((result = wbuf_reserve(&local, newsize))) { goto fail; }
 
 	/* if this doesn't succeed we've corrupted the nodes */
-	result = graph_tfm_buffers(graph, &local, &global, 1);
+	result = graph_tfm_buffers(graph, &local, &global, 1, NULL);
 	if (result == 0) {
 		wbuf_swap(&local, &graph->local_tfm);
 		wbuf_swap(&global, &graph->global_tfm);
@@ -217,10 +273,72 @@ int xylo_tgraph_compact(struct xylo_tgraph *graph)
 
 	/* copy local, but global becomes garbage */
 	wbuf_swap(local, global);
-	result = graph_tfm_buffers(graph, local, global, 0);
+	result = graph_tfm_buffers(graph, local, global, 0, NULL);
+	graph->flat = 0;
 	return result;
 }
 
+/* Split nodes into levels by depth, which are consecutive in breadth-first
+   order. A node starts a new level if its parent is in the current one. */
+static int find_levels(struct xylo_tgraph *graph, size_t nroots)
+{
+	uint32_t const *parents;
+	size_t i, nmemb, level;
+
+	parents = graph->parents.begin;
+	nmemb = graph->nodes.nmemb;
+	wbuf_rewind(&graph->levels);
+
+	level = 0;
+	if (!wbuf_write(&graph->levels, &level, sizeof level)) { return -1; }
+	for (i = nroots; i < nmemb; i++) {
+		if (parents[i] >= level) {
+			level = i;
+			if (!wbuf_write(&graph->levels, &level, sizeof level)) {
+				return -1;
+			}
+		}
+	}
+	if (!wbuf_write(&graph->levels, &nmemb, sizeof nmemb)) { return -1; }
+	return 0;
+}
+
+/* Lay out transforms in breadth-first order, so that the local and global
+   transforms of the node at index i are both at offset i*transform_size. */
+static int flatten(struct xylo_tgraph *graph)
+{
+	struct wbuf *local, *global;
+	struct itree *t;
+	size_t nroots;
+
+	if (graph->flat) { return 0; }
+	assert(graph->nodes.nmemb <= UINT32_MAX);
+
+	wbuf_rewind(&graph->parents);
+	if (wbuf_reserve(&graph->parents, graph->nodes.nmemb * sizeof (uint32_t))) {
+		return -1;
+	}
+	nroots = 0;
+	for (t = itree_first_child(&graph->root); t; t = itree_next_sibling(t)) {
+		nroots++;
+	}
+
+	local = &graph->local_tfm;
+	global = &graph->global_tfm;
+	wbuf_rewind(local);
+	wbuf_rewind(global);
+
+	/* same as compaction, but roots need a global transform too */
+	wbuf_swap(local, global);
+	if (graph_tfm_buffers(graph, local, global, 0, &graph->parents)) {
+		return -1;
+	}
+	if (find_levels(graph, nroots)) { return -1; }
+	graph->nroots = nroots;
+	graph->flat = 1;
+	return 0;
+}
+
 struct xylo_tnode *xylo_make_tnode(
 	struct xylo_tgraph *graph,
 	struct xylo_tnode *parent,
@@ -236,7 +354,7 @@ struct xylo_tnode *xylo_make_tnode(
 	local = wbuf_salloc(&graph->local_tfm, tfm_size);
 	if (!local) {
 		/* no more transforms available: garbage collect or grow */
-		tfm_nmemb = wbuf_nmemb(&graph->global_tfm, tfm_size);
+		tfm_nmemb = wbuf_nmemb(&graph->local_tfm, tfm_size);
 		node_nmemb = graph->nodes.nmemb;
 		if (node_nmemb + (node_nmemb >> 1) >= tfm_nmemb) {
 			/* expand new local space */
@@ -248,12 +366,12 @@ struct xylo_tnode *xylo_make_tnode(
 		} else {
 			if (xylo_tgraph_compact(graph)) { return NULL; }
 		}
-		local = wbuf_salloc(&graph->global_tfm, tfm_size);
+		local = wbuf_salloc(&graph->local_tfm, tfm_size);
 		assert(local != NULL);
 	}
 	(void)memcpy(local, tfm, tfm_size);
 	if (parent) {
-		/* size of global_tfm = size of local_tfm */
+		/* size of global_tfm <= size of local_tfm */
 		global = wbuf_salloc(&graph->global_tfm, tfm_size);
 		assert(global != NULL);
 	} else {
@@ -261,15 +379,69 @@ struct xylo_tnode *xylo_make_tnode(
 	}
 	node = mempool_alloc(&graph->nodes);
 	if (!node) {
-		wbuf_retract(&graph->local_tfm, tfm_size);
-		wbuf_retract(&graph->global_tfm, tfm_size);
+		(void)wbuf_retract(&graph->local_tfm, tfm_size);
+		if (parent) {
+			(void)wbuf_retract(&graph->global_tfm, tfm_size);
+		}
 		return NULL;
 	}
 	parent_tree = parent ? &parent->tree : &graph->root;
 	xylo_init_tnode(node, parent_tree, local, global);
+	graph->flat = 0;
+	if (xylo_tnode_touch(graph, node)) {
+		xylo_free_tnode(graph, node);
+		return NULL;
+	}
 	return node;
 }
 
+int xylo_tnode_touch(struct xylo_tgraph *graph, struct xylo_tnode *node)
+{
+	assert(graph != NULL);
+	assert(node != NULL);
+	if (node->dirty) { return 0; }
+	node->touched = wbuf_nmemb(&graph->touched, sizeof node);
+	if (!wbuf_write(&graph->touched, &node, sizeof node)) { return -1; }
+	node->dirty = 1;
+	return 0;
+}
+
+int xylo_tnode_set_local(
+	struct xylo_tgraph *graph,
+	struct xylo_tnode *node,
+	void const *transform)
+{
+	assert(graph != NULL);
+	assert(node != NULL);
+	(void)memcpy(node->local, transform, graph->transform_size);
+	return xylo_tnode_touch(graph, node);
+}
+
+/* remove `node` from the list of touched nodes, moving the last touched node
+   to its place */
+static void untouch(struct xylo_tgraph *graph, struct xylo_tnode *node)
+{
+	struct xylo_tnode **touched, *last;
+
+	touched = graph->touched.begin;
+	(void)wbuf_pop(&graph->touched, &last, sizeof last);
+	if (last != node) {
+		touched[node->touched] = last;
+		last->touched = node->touched;
+	}
+	node->dirty = 0;
+}
+
+/* all global transforms are up to date */
+static void clear_touched(struct xylo_tgraph *graph)
+{
+	struct xylo_tnode *node;
+
+	while (wbuf_pop(&graph->touched, &node, sizeof node) == 0) {
+		node->dirty = 0;
+	}
+}
+
 void xylo_free_tnode(struct xylo_tgraph *graph, struct xylo_tnode *node)
 {
 	struct itree *p;
@@ -279,8 +451,10 @@ void xylo_free_tnode(struct xylo_tgraph *graph, struct xylo_tnode *node)
 		child = container_of(p, struct xylo_tnode, tree);
 		xylo_free_tnode(graph, child);
 	}
+	if (node->dirty) { untouch(graph, node); }
 	(void)itree_prune(&node->tree);
 	mempool_free(&graph->nodes, node);
+	graph->flat = 0;
 }
 
 int xylo_tgraph_transform(
@@ -296,6 +470,14 @@ int xylo_tgraph_transform(
 	wbuf_init(queue + 0);
 	wbuf_init(queue + 1);
 	result = 0;
+
+	/* roots only have separate global transforms in flattened graphs */
+	for (t = itree_first_child(&graph->root); t; t = itree_next_sibling(t)) {
+		p = container_of(t, struct xylo_tnode, tree);
+		if (p->global != p->local) {
+			(void)memcpy(p->global, p->local, graph->transform_size);
+		}
+	}
 	if (enqueue_children(&graph->root, queue)) {
 		result = -1;
 		goto out;
@@ -312,7 +494,285 @@ int xylo_tgraph_transform(
 			transform(child->global, child->local, p->global);
 		}
 	}
+	clear_touched(graph);
 out:	wbuf_term(queue + 0);
 	wbuf_term(queue + 1);
 	return result;
 }
+
+/* dest = parent * child, where each is a struct xylo_draw_transform */
+static void affine2d(
+	float *restrict dest,
+	float const *restrict child,
+	float const *restrict parent)
+{
+	float const m0 = parent[0], m1 = parent[1], m2 = parent[2];
+	float const m3 = parent[3], x = parent[4], y = parent[5];
+
+	dest[0] = m0*child[0] + m2*child[1];
+	dest[1] = m1*child[0] + m3*child[1];
+	dest[2] = m0*child[2] + m2*child[3];
+	dest[3] = m1*child[2] + m3*child[3];
+	dest[4] = m0*child[4] + m2*child[5] + x;
+	dest[5] = m1*child[4] + m3*child[5] + y;
+}
+
+/* dest = parent * child, where each is a column-major 4x4 matrix */
+static void mat44f(
+	float *restrict dest,
+	float const *restrict child,
+	float const *restrict parent)
+{
+	int row, col;
+
+	for (col = 0; col < 4; col++) {
+		for (row = 0; row < 4; row++) {
+			dest[col*4 + row] = parent[0*4 + row]*child[col*4 + 0]
+			                  + parent[1*4 + row]*child[col*4 + 1]
+			                  + parent[2*4 + row]*child[col*4 + 2]
+			                  + parent[3*4 + row]*child[col*4 + 3];
+		}
+	}
+}
+
+/* Propagate transforms of nodes [begin, end) of a flattened graph. Each
+   format gets its own loop so that the kernel is inlined. */
+static void propagate_range(
+	struct xylo_tgraph *graph,
+	enum xylo_tformat format,
+	size_t begin,
+	size_t end)
+{
+	float *global;
+	float const *local;
+	uint32_t const *parents;
+	size_t i;
+
+	global = (float *)graph->global_tfm.begin;
+	local = (float const *)graph->local_tfm.begin;
+	parents = (uint32_t const *)graph->parents.begin;
+
+	switch (format) {
+	case xylo_taffine2d:
+		for (i = begin; i < end; i++) {
+			affine2d(global + 6*i, local + 6*i, global + 6*parents[i]);
+		}
+		break;
+	case xylo_tmat44f:
+		for (i = begin; i < end; i++) {
+			mat44f(global + 16*i, local + 16*i, global + 16*parents[i]);
+		}
+		break;
+	default:
+		assert(0 && "unknown transform format");
+	}
+}
+
+int xylo_tgraph_propagate(struct xylo_tgraph *graph, enum xylo_tformat format)
+{
+	size_t nmemb;
+
+	assert(graph != NULL);
+	assert(graph->transform_size == (format == xylo_taffine2d
+		? sizeof (float [6])
+		: sizeof (float [16])));
+
+	if (flatten(graph)) { return -1; }
+	nmemb = graph->nodes.nmemb;
+
+	/* roots: global = local */
+	(void)memcpy(
+		graph->global_tfm.begin,
+		graph->local_tfm.begin,
+		graph->nroots * graph->transform_size);
+
+	/* parents always precede their children in breadth-first order */
+	propagate_range(graph, format, graph->nroots, nmemb);
+	clear_touched(graph);
+	return 0;
+}
+
+struct parallel_level
+{
+	struct xylo_tgraph *graph;
+	enum xylo_tformat format;
+	size_t begin, end, nchunks;
+};
+
+/* Start of chunk `i` of a level. Chunks are extended so that siblings, which
+   are next to each other, always end up in the same chunk. */
+static size_t chunk_begin(struct parallel_level const *level, size_t i)
+{
+	uint32_t const *parents;
+	size_t j;
+
+	if (i == 0) { return level->begin; }
+	if (i == level->nchunks) { return level->end; }
+
+	parents = level->graph->parents.begin;
+	j = level->begin + (level->end - level->begin) * i / level->nchunks;
+	while (j < level->end && parents[j] == parents[j - 1]) { j++; }
+	return j;
+}
+
+static void propagate_chunk(void *arg, size_t i)
+{
+	struct parallel_level const *level = arg;
+
+	propagate_range(
+		level->graph,
+		level->format,
+		chunk_begin(level, i),
+		chunk_begin(level, i + 1));
+}
+
+int xylo_tgraph_propagate_parallel(
+	struct xylo_tgraph *graph,
+	enum xylo_tformat format,
+	struct tpool *pool)
+{
+	struct parallel_level level;
+	size_t const *levels;
+	size_t i, nlevels;
+
+	assert(graph != NULL);
+	assert(graph->transform_size == (format == xylo_taffine2d
+		? sizeof (float [6])
+		: sizeof (float [16])));
+
+	if (flatten(graph)) { return -1; }
+
+	/* roots: global = local */
+	(void)memcpy(
+		graph->global_tfm.begin,
+		graph->local_tfm.begin,
+		graph->nroots * graph->transform_size);
+
+	/* each level only depends on the previous one */
+	level.graph = graph;
+	level.format = format;
+	levels = graph->levels.begin;
+	nlevels = wbuf_nmemb(&graph->levels, sizeof *levels) - 1;
+	for (i = 1; i < nlevels; i++) {
+		level.begin = levels[i];
+		level.end = levels[i + 1];
+		level.nchunks = (level.end - level.begin) / PARALLEL_MIN_NODES;
+		if (level.nchunks > tpool_size(pool)) {
+			level.nchunks = tpool_size(pool);
+		}
+		if (level.nchunks <= 1) {
+			propagate_range(graph, format, level.begin, level.end);
+		} else {
+			tpool_run(pool, level.nchunks, propagate_chunk, &level);
+		}
+	}
+	clear_touched(graph);
+	return 0;
+}
+
+static void combine(
+	enum xylo_tformat format,
+	float *dest,
+	float const *child,
+	float const *parent)
+{
+	switch (format) {
+	case xylo_taffine2d: affine2d(dest, child, parent); break;
+	case xylo_tmat44f: mat44f(dest, child, parent); break;
+	default: assert(0 && "unknown transform format");
+	}
+}
+
+/* order nodes by the address of their local transform, which is
+   breadth-first order in a flattened graph */
+static int cmp_local(void const *a, void const *b)
+{
+	struct xylo_tnode const *p = *(struct xylo_tnode * const *)a;
+	struct xylo_tnode const *q = *(struct xylo_tnode * const *)b;
+	uintptr_t x = (uintptr_t)p->local, y = (uintptr_t)q->local;
+
+	return (x > y) - (x < y);
+}
+
+/* Update the global transforms in the subtree rooted at `node` depth-first,
+   and clear the dirty flag of every node in it */
+static int update_subtree(
+	struct xylo_tgraph *graph,
+	enum xylo_tformat format,
+	struct xylo_tnode *node,
+	struct wbuf *stack)
+{
+	struct xylo_tnode *p, *child;
+	struct itree *t;
+
+	t = itree_parent(&node->tree);
+	if (t == &graph->root) {
+		if (node->global != node->local) {
+			(void)memcpy(node->global, node->local, graph->transform_size);
+		}
+	} else {
+		p = container_of(t, struct xylo_tnode, tree);
+		combine(format, node->global, node->local, p->global);
+	}
+	node->dirty = 0;
+
+	wbuf_rewind(stack);
+	if (!wbuf_write(stack, &node, sizeof node)) { return -1; }
+	while (wbuf_pop(stack, &p, sizeof p) == 0) {
+		for (t = itree_first_child(&p->tree); t; t = itree_next_sibling(t)) {
+			child = container_of(t, struct xylo_tnode, tree);
+			combine(format, child->global, child->local, p->global);
+			child->dirty = 0;
+			if (!wbuf_write(stack, &child, sizeof child)) { return -1; }
+		}
+	}
+	return 0;
+}
+
+int xylo_tgraph_update(struct xylo_tgraph *graph, enum xylo_tformat format)
+{
+	struct xylo_tnode **touched;
+	struct wbuf stack;
+	size_t i, n;
+	int result;
+
+	assert(graph != NULL);
+	assert(graph->transform_size == (format == xylo_taffine2d
+		? sizeof (float [6])
+		: sizeof (float [16])));
+
+	touched = graph->touched.begin;
+	n = wbuf_nmemb(&graph->touched, sizeof *touched);
+	result = 0;
+
+	/* Random access through the tree is a lot slower per node than a linear
+	   pass, and a touched node can have many descendants */
+	if (n > graph->nodes.nmemb / TOUCHED_FULL_PASS_RATIO) {
+		return xylo_tgraph_propagate(graph, format);
+	}
+
+	/* visit ancestors before descendants when possible, since the subtree
+	   of a touched node covers all touched nodes below it */
+	if (n > 1) { qsort(touched, n, sizeof *touched, cmp_local); }
+
+	wbuf_init(&stack);
+	for (i = 0; i < n; i++) {
+		if (!touched[i]->dirty) { continue; }
+		if (update_subtree(graph, format, touched[i], &stack)) {
+			result = -1;
+			break;
+		}
+	}
+	wbuf_term(&stack);
+	if (result == 0) {
+		wbuf_rewind(&graph->touched);
+	} else {
+		/* touch everything again, including the updated nodes, in
+		   their sorted order */
+		for (i = 0; i < n; i++) {
+			touched[i]->dirty = 1;
+			touched[i]->touched = i;
+		}
+	}
+	return result;
+}
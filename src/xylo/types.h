@@ -1,7 +1,20 @@
 struct xylo_shapes
 {
 	GLuint program;
-	GLuint mvp, sample_clip, sample_offset, color, object_id;
+	GLuint sample_count, sample_clip, sample_offset, objects, object_index;
+
+	/* texture buffer of struct xylo_object */
+	GLuint tbo, tex;
+	GLsizei max_objects;
+};
+
+/* Per-object data of the shapes program, read by the vertex shader from a
+   texture buffer as six RGBA32F texels */
+struct xylo_object
+{
+	float mvp[16];
+	float color[4];
+	float id[4]; /* x is the object ID, which fits in a float exactly */
 };
 
 struct xylo_quincunx
@@ -28,16 +41,81 @@ struct xylo_fb
 	GLsizei width, height;
 };
 
+/* Off-screen render targets of anti-aliased drawing, looked up by size and
+   anti-aliasing mode and reused in least recently used order */
+#define FB_POOL_SIZE 4
+
+struct xylo_fb_pool
+{
+	struct xylo_fb fbs[FB_POOL_SIZE];
+	int aa[FB_POOL_SIZE];
+	unsigned long used[FB_POOL_SIZE]; /* time of last use, zero if unused */
+	unsigned long clock;
+	size_t limit; /* total size of all targets in bytes */
+
+	/* most recently returned target, which object IDs are read from */
+	struct xylo_fb *last;
+};
+
+/* pixel pack buffer which object IDs are read into */
+struct xylo_pick_slot
+{
+	GLuint pbo;
+	GLsizeiptr size;
+	GLsync fence; /* NULL unless a read is pending */
+	unsigned serial;
+	GLint x, y;
+	GLsizei width, height;
+};
+
+#define PICK_RING 3
+
+/* ring of asynchronous object ID reads */
+struct xylo_picker
+{
+	struct xylo_pick_slot slots[PICK_RING];
+	unsigned next, serial;
+	GLushort *ids;
+	size_t ids_size;
+};
+
+/* Chooses the mode of XYLO_AA_AUTO based on recent drawing times */
+struct xylo_aa_governor
+{
+	unsigned long budget; /* microseconds */
+	double average; /* smoothed drawing time of `mode`, negative if unknown */
+	int mode;
+	unsigned calm; /* consecutive frames with room for a better mode */
+};
+
+#define AA_TIMER_RING 4
+
+/* Ring of GPU timer queries of drawing with XYLO_AA_AUTO, read without
+   waiting. CPU time is measured instead if the GPU has no timer. */
+struct xylo_aa_timer
+{
+	GLuint queries[AA_TIMER_RING];
+	int modes[AA_TIMER_RING]; /* mode drawn, or -1 if no query is pending */
+	unsigned next;
+	GLint bits;
+	struct pfclock *clock;
+	unsigned long long start; /* usec64 of the clock */
+};
+
 struct xylo
 {
 	struct gl_api *api;
+	struct xylo_dcmds *tree; /* commands of the tree being drawn */
 	struct xylo_shapes shapes;
 	struct xylo_quincunx quincunx;
 	struct xylo_rgss rgss;
-	struct xylo_fb samples;
+	struct xylo_fb_pool fbs;
+	struct xylo_picker picker;
 	unsigned begin;
 	struct saved_state save;
-	int aa;
+	int aa, current_aa;
+	struct xylo_aa_governor governor;
+	struct xylo_aa_timer timer;
 };
 
 struct xylo_outline
@@ -46,6 +124,7 @@ struct xylo_outline
 	GLsizei count;
 	GLenum type;
 	GLint basevertex;
+	float bounds[4]; /* x_min, y_min, x_max, y_max of control points */
 };
 
 struct xylo_outline_set
@@ -62,6 +141,7 @@ struct xylo_mesh
 	GLsizei count;
 	GLuint vao;
 	GLint first;
+	float bounds[4]; /* x_min, y_min, x_max, y_max of control points */
 };
 
 struct xylo_mesh_set
@@ -70,3 +150,12 @@ struct xylo_mesh_set
 	struct xylo_mesh *shapes;
 	GLuint vao, vbo;
 };
+
+/* vertices within welding distance of each other merged into one, found
+   through a grid hashed into buckets of chained vertex indices */
+struct xylo_weld
+{
+	float (*vertices)[2];
+	size_t n, max, mask;
+	unsigned *buckets, *next;
+};
@@ -0,0 +1,112 @@
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+
+#include "glapi/core.h"
+#include "types.h"
+#include "weld.h"
+
+/* When points are close enough to be considered the same */
+#define MIN_SQUARED_DISTANCE 1e-10
+
+/* Grid cells are twice the welding distance wide, so that all points within
+   welding distance of a point are in its own or one of the neighbouring
+   cells, with a margin against rounding */
+#define CELL_SIZE (2.0 * sqrt(MIN_SQUARED_DISTANCE))
+
+#define NONE UINT_MAX
+
+static float square_distance(float const a[2], float const b[2])
+{
+	double dx, dy;
+	dx = a[0] - b[0];
+	dy = a[1] - b[1];
+	return dx*dx + dy*dy;
+}
+
+static long long cell(float x)
+{
+	double c;
+
+	c = floor(x / CELL_SIZE);
+	/* keep far away and non-finite points in range, their distance is
+	   still checked exactly */
+	if (!(c > -0x1p62)) { return -0x1p62; }
+	if (c > 0x1p62) { return 0x1p62; }
+	return (long long)c;
+}
+
+static size_t bucket(struct xylo_weld const *weld, long long x, long long y)
+{
+	unsigned long long h;
+
+	h = (unsigned long long)x * 0x9e3779b97f4a7c15ull;
+	h ^= (unsigned long long)y * 0xc2b2ae3d27d4eb4full;
+	return (size_t)(h ^ h >> 29) & weld->mask;
+}
+
+int xylo_init_weld(struct xylo_weld *weld, float (*vertices)[2], size_t max)
+{
+	size_t i, nbuckets;
+
+	assert(weld != NULL);
+	assert(max < NONE);
+
+	/* at most half full */
+	for (nbuckets = 16; nbuckets < max * 2; nbuckets *= 2);
+
+	weld->buckets = malloc((nbuckets + max) * sizeof *weld->buckets);
+	if (!weld->buckets) { return -1; }
+	weld->next = weld->buckets + nbuckets;
+	for (i = 0; i < nbuckets; i++) { weld->buckets[i] = NONE; }
+	weld->vertices = vertices;
+	weld->n = 0;
+	weld->max = max;
+	weld->mask = nbuckets - 1;
+	return 0;
+}
+
+void xylo_term_weld(struct xylo_weld *weld)
+{
+	assert(weld != NULL);
+	free(weld->buckets);
+}
+
+unsigned xylo_weld_insert(struct xylo_weld *weld, float const pt[2])
+{
+	long long x, y, dx, dy;
+	unsigned i, first;
+	size_t b;
+
+	assert(weld != NULL);
+	assert(weld->n < weld->max);
+
+	/* the first vertex of those in neighbouring cells that is close
+	   enough, which is the one a linear search would find */
+	x = cell(pt[0]);
+	y = cell(pt[1]);
+	first = NONE;
+	for (dy = -1; dy <= 1; dy++) {
+		for (dx = -1; dx <= 1; dx++) {
+			b = bucket(weld, x + dx, y + dy);
+			for (i = weld->buckets[b]; i != NONE; i = weld->next[i]) {
+				if (i < first && square_distance(
+						weld->vertices[i],
+						pt) < MIN_SQUARED_DISTANCE) {
+					first = i;
+				}
+			}
+		}
+	}
+	if (first != NONE) { return first; }
+
+	i = weld->n++;
+	(void)memcpy(weld->vertices[i], pt, sizeof *weld->vertices);
+	b = bucket(weld, x, y);
+	weld->next[i] = weld->buckets[b];
+	weld->buckets[b] = i;
+	return i;
+}
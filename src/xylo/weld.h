@@ -0,0 +1,11 @@
+struct xylo_weld;
+
+/* Initialize `weld` for adding at most `max` vertices to the array
+   `vertices`. Return non-zero on allocation failure. */
+int xylo_init_weld(struct xylo_weld *weld, float (*vertices)[2], size_t max);
+
+void xylo_term_weld(struct xylo_weld *weld);
+
+/* Return the index of the first added vertex within welding distance of
+   `pt`, or else append `pt` to the vertex array and return its index */
+unsigned xylo_weld_insert(struct xylo_weld *weld, float const pt[2]);
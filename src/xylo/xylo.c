@@ -1,3 +1,4 @@
+#include <stddef.h>
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -5,15 +6,19 @@
 #include <string.h>
 
 #include "base/mem.h"
+#include "base/gbuf.h"
+#include "base/wbuf.h"
 #include "glapi/api.h"
 #include "glapi/core.h"
 #include "glam/program.h"
 #include "gm/matrix.h"
 #include "xylo/types.h"
 #include "xylo/xylo.h"
+#include "xylo/draw.h"
 
 #include "private.h"
 #include "fb.h"
+#include "pick.h"
 #include "types.h"
 #include "xylo.h"
 #include "shapes.h"
@@ -33,14 +38,24 @@ int init_xylo(struct xylo *xylo, struct gl_api *api)
 	if (xylo_init_shapes(&xylo->shapes, api)) { goto fail_shapes; }
 	if (xylo_init_quincunx(&xylo->quincunx, api)) { goto fail_quincunx; }
 	if (xylo_init_rgss(&xylo->rgss, api)) { goto fail_rgss; }
-	xylo_init_fb(gl, &xylo->samples, 1);
+	if (xylo->tree = malloc(sizeof *xylo->tree), !xylo->tree) {
+		goto fail_tree;
+	}
+	xylo_init_dcmds(xylo->tree);
+	xylo_init_fb_pool(gl, &xylo->fbs, FB_POOL_LIMIT);
+	xylo_init_picker(gl, &xylo->picker);
+	xylo_init_aa_governor(&xylo->governor, AA_BUDGET);
+	xylo_init_aa_timer(gl, &xylo->timer);
 	xylo->begin = 0;
 	xylo->aa = 0;
+	xylo->current_aa = 0;
 	xylo->api = api;
 	return err;
 
-fail_rgss: err--;
+fail_tree: err--;
 	xylo_term_rgss(&xylo->rgss, api);
+fail_rgss: err--;
+	xylo_term_quincunx(&xylo->quincunx, api);
 fail_quincunx: err--;
 	xylo_term_shapes(&xylo->shapes, api);
 fail_shapes: err--;
@@ -64,10 +79,14 @@ void term_xylo(struct xylo *xylo)
 
 	assert(xylo != NULL);
 	gl = gl_get_core33(xylo->api);
-	xylo_term_fb(gl, &xylo->samples);
+	xylo_term_aa_timer(gl, &xylo->timer);
+	xylo_term_picker(gl, &xylo->picker);
+	xylo_term_fb_pool(gl, &xylo->fbs);
 	xylo_term_shapes(&xylo->shapes, xylo->api);
 	xylo_term_quincunx(&xylo->quincunx, xylo->api);
 	xylo_term_rgss(&xylo->rgss, xylo->api);
+	xylo_term_dcmds(xylo->tree);
+	free(xylo->tree);
 }
 
 void free_xylo(struct xylo *xylo)
@@ -122,5 +141,15 @@ GLuint xylo_get_uint(struct gl_core33 const *restrict gl, GLenum t)
 unsigned xylo_get_object_id(struct xylo *xylo, GLsizei x, GLsizei y)
 {
 	struct gl_core33 const *restrict gl = gl_get_core33(xylo->api);
-	return xylo_fb_object_id(gl, &xylo->samples, x, y);
+	if (!xylo->fbs.last) { return 0; }
+	return xylo_fb_object_id(gl, xylo->fbs.last, x, y);
+}
+
+void xylo_set_fb_limit(struct xylo *xylo, size_t limit)
+{
+	struct gl_core33 const *restrict gl;
+
+	assert(xylo != NULL);
+	gl = gl_get_core33(xylo->api);
+	xylo_fb_pool_set_limit(gl, &xylo->fbs, limit);
 }
@@ -3,6 +3,9 @@ struct gl_core33;
 struct xylo;
 struct xylo_outline_set;
 struct xylo_mesh_set;
+struct xylo_pick;
+struct xylo_view;
+struct xylo_draw;
 
 struct xylo *make_xylo(struct gl_api *api);
 int init_xylo(struct xylo *dest, struct gl_api *api);
@@ -15,6 +18,14 @@ void xylo_begin(struct xylo *xylo);
 /* restore OpenGL state; call after drawing */
 void xylo_end(struct xylo *xylo);
 
+/* Draw the tree `draw` leaf by leaf, without compiling it into commands as
+   `xylo_draw()` does. This is what `xylo_draw()` falls back to when it runs
+   out of memory. */
+void xylo_draw_tree(
+	struct xylo *xylo,
+	struct xylo_view const *view,
+	struct xylo_draw const *draw);
+
 /* specify which shapes to draw - binds a vertex array object */
 void xylo_set_outline_set(struct xylo *xylo, struct xylo_outline_set *set);
 
@@ -25,3 +36,30 @@ GLuint xylo_get_uint(struct gl_core33 const *restrict gl, GLenum t);
 
 /* retrieve id of object most recently drawn at a pixel location */ 
 unsigned xylo_get_object_id(struct xylo *xylo, GLsizei x, GLsizei y);
+
+/* Start reading the IDs of the objects most recently drawn in a region,
+   without waiting for the GPU. Keep the region small, e.g. a single pixel
+   or the area around a pointer. Return a non-zero serial number of the
+   request, or zero if the region is outside of the most recent drawing. Up
+   to three requests can be in flight, and issuing another one drops the
+   oldest. */
+unsigned xylo_pick_object_ids(
+	struct xylo *xylo,
+	GLint x,
+	GLint y,
+	GLsizei width,
+	GLsizei height);
+
+/* Retrieve the most recent request made by `xylo_pick_object_ids()` which
+   has finished, typically one or two frames after it was made, without
+   waiting for the GPU. Requests older than it are dropped. Return 1 and fill
+   in `pick` if there was one, 0 if no request has finished yet, and
+   negative on failure. */
+int xylo_poll_object_ids(struct xylo *xylo, struct xylo_pick *pick);
+
+/* Limit the memory used by off-screen render targets of anti-aliased
+   drawing to `limit` bytes. Up to four targets are kept, one per recently
+   drawn combination of viewport size and anti-aliasing mode, so that views
+   of different sizes can be drawn every frame without reallocation. A
+   single target larger than the limit is still allocated when needed. */
+void xylo_set_fb_limit(struct xylo *xylo, size_t limit);